@@ -0,0 +1,17 @@
+/* checkpoint.h */
+
+/* model checkpoint slots; the simh private devices keep as many */
+#define NCKPT	2
+
+/* restore is 0 to take a checkpoint into slot, 1 to put it back */
+void cpu_checkpoint(int slot, int restore);
+void mem_checkpoint(int slot, int restore);
+void support_checkpoint(int slot, int restore);
+void timing_checkpoint(int slot, int restore);
+
+/* the simh private devices, ../simhv36-1/PDP11/private_*.c;
+   which is 0 for simh's context, 1 for the model's */
+void private_rk_save(int which, int slot);
+void private_rk_restore(int which, int slot);
+void private_stddev_save(int which, int slot);
+void private_stddev_restore(int which, int slot);
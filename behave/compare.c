@@ -1,32 +1,53 @@
 #include <stdio.h>
 
+#include "debug.h"
+
 typedef unsigned int u22;
 typedef unsigned short u16;
 
-enum {
-    T_SIMH=1,
-    T_RTL=2,
+#include "compare.h"
+
+/*
+ * each side's transactions for the current instruction are folded into
+ * a rolling hash as they are recorded, and kept in a ring of the last
+ * TRING; the lists are only compared entry by entry, and printed, when
+ * the counts or hashes of the two sides disagree.  rw is not compared.
+ */
+#define TRING	4096
 
-    T_MEM=1,
-    T_IO=2,
+struct side {
+	struct trans ring[TRING];
+	unsigned int count;		/* recorded this instruction */
+	unsigned long long hash;
+} sides[2];
 
-    T_READW = 1,
-    T_READB,
-    T_WRITEW,
-    T_WRITEB
-};
+extern void cosim_diverged(void);
 
-struct {
-	int rw, what;
-	unsigned int pa;
-	unsigned int data;
-} transactions[2][100];
-int tcount0, tcount1;
+#define FNV_BASIS	0xcbf29ce484222325ULL
+#define FNV_PRIME	0x100000001b3ULL
+
+static unsigned long long hash_trans(unsigned long long h, int what,
+				     unsigned int pa, unsigned int data)
+{
+	unsigned int v[3];
+	int i;
+
+	v[0] = what;
+	v[1] = pa & 0xffff;
+	v[2] = data;
+	for (i = 0; i < 3; i++) {
+		h = (h ^ (v[i] & 0xffff)) * FNV_PRIME;
+		h = (h ^ (v[i] >> 16)) * FNV_PRIME;
+	}
+	return h;
+}
 
 void reset_transactions(void)
 {
-	tcount0 = 0;
-	tcount1 = 0;
+	sides[0].count = 0;
+	sides[0].hash = FNV_BASIS;
+	sides[1].count = 0;
+	sides[1].hash = FNV_BASIS;
 }
 
 static char *text_what(int w)
@@ -35,6 +56,7 @@ static char *text_what(int w)
 	case T_MEM: return "mem";
 	case T_IO: return "io ";
 	}
+	return "?  ";
 }
 
 static char *text_rw(int r)
@@ -45,127 +67,170 @@ static char *text_rw(int r)
 	case T_WRITEW: return "writew";
 	case T_WRITEB: return "writeb";
 	}
+	return "?";
 }
 
-void check_transactions(void)
+static int differs(struct trans *t0, struct trans *t1)
 {
-	int i, t;
-	int show = 0;
+	return t0->what != t1->what ||
+/*	       t0->rw != t1->rw || */
+	       (t0->pa & 0xffff) != (t1->pa & 0xffff) ||
+	       t0->data != t1->data;
+}
 
-	if (tcount0 != tcount1) {
-		printf("compare: transactions disagree; rtl %d, simh %d\n",
-		       tcount1, tcount0);
-		show = 1;
+/* print two lists that disagree; entries first..last-1, mod size */
+static void show_lists(unsigned int c0, struct trans *l0,
+		       unsigned int c1, struct trans *l1,
+		       unsigned int first, unsigned int last, unsigned int size)
+{
+	struct trans *t0, *t1;
+	unsigned int i;
+
+	if (c0 != c1)
+		printf("compare: transactions disagree; rtl %u, simh %u\n",
+		       c1, c0);
+
+	for (i = first; i < last; i++)
+		if (differs(&l0[i % size], &l1[i % size]))
+			printf("compare: transaction %u differs\n", i+1);
+
+	printf("compare: transaction disagree\n");
+	if (first)
+		printf("(first %u not kept)\n", first);
+	printf("simh\t\t| rtl\n");
+	for (i = first; i < last; i++) {
+		t0 = &l0[i % size];
+		t1 = &l1[i % size];
+		printf("%u: %s %s %o %o | %s %s %o %o\n",
+		       i+1,
+		       text_what(t0->what), text_rw(t0->rw), t0->pa, t0->data,
+		       text_what(t1->what), text_rw(t1->rw), t1->pa, t1->data);
 	}
+	if (last < c0 && last < c1)
+		printf("(rest not kept)\n");
+}
 
-	for (i = 0; i < tcount0; i++) {
-		if (transactions[0][i].what != transactions[1][i].what ||
-/*		    transactions[0][i].rw != transactions[1][i].rw || */
-/*		    transactions[0][i].pa != transactions[1][i].pa || */
-		    (transactions[0][i].pa & 0xffff) !=
-		    (transactions[1][i].pa & 0xffff) ||
-		    transactions[0][i].data != transactions[1][i].data)
-		{
-			printf("compare: transaction %d differs\n", i+1);
-			show = 1;
-		}
-	}
+void check_transactions(void)
+{
+	struct side *s0 = &sides[0], *s1 = &sides[1];
+	unsigned int t;
 
-	t = tcount0;
-	if (tcount1 < tcount0)
-		t = tcount1;
-
-	if (show) {
-		printf("compare: transaction disagree\n");
-		printf("simh\t\t| rtl\n");
-		for (i = 0; i < t; i++) {
-			printf("%d: %s %s %o %o | %s %s %o %o\n",
-			       i+1, 
-			       text_what(transactions[0][i].what),
-			       text_rw(transactions[0][i].rw),
-			       transactions[0][i].pa,
-			       transactions[0][i].data,
-			       text_what(transactions[1][i].what),
-			       text_rw(transactions[1][i].rw),
-			       transactions[1][i].pa,
-			       transactions[1][i].data);
-		       
-		}
-	}
+	if (s0->count == s1->count && s0->hash == s1->hash)
+		return;
+
+	cosim_diverged();
+
+	t = s0->count < s1->count ? s0->count : s1->count;
+	show_lists(s0->count, s0->ring, s1->count, s1->ring,
+		   t > TRING ? t - TRING : 0, t, TRING);
 }
 
-void record_transaction(int who, int rw, int what, unsigned int pa,
-                        unsigned int data)
+/*
+ * pipelined cosim; each thread hands over its side's transactions for
+ * an instruction as a struct tsum, and the comparator thread diffs them
+ */
+void take_transactions(int who, struct tsum *ts)
+{
+	struct side *s = &sides[who-1];
+	unsigned int i;
+
+	ts->count = s->count;
+	ts->hash = s->hash;
+	for (i = 0; i < s->count && i < TKEEP; i++)
+		ts->t[i] = s->ring[i];
+
+	s->count = 0;
+	s->hash = FNV_BASIS;
+}
+
+void reset_side(int who)
 {
-	int t;
+	sides[who-1].count = 0;
+	sides[who-1].hash = FNV_BASIS;
+}
 
-	t = (who == T_SIMH) ? tcount0 : tcount1;
+/* returns nonzero, after printing both lists, if they disagree */
+int diff_transactions(struct tsum *simh, struct tsum *rtl)
+{
+	unsigned int t;
 
-	if (0) printf("[%d][%d] %d %d %o %o\n",
-	       who-1, t, rw, what, pa, data);
+	if (simh->count == rtl->count && simh->hash == rtl->hash)
+		return 0;
 
-	transactions[who-1][t].rw = rw;
-	transactions[who-1][t].what = what;
-	transactions[who-1][t].pa = pa;
-	transactions[who-1][t].data = data;
+	t = simh->count < rtl->count ? simh->count : rtl->count;
+	show_lists(simh->count, simh->t, rtl->count, rtl->t,
+		   0, t < TKEEP ? t : TKEEP, TKEEP);
+	return 1;
+}
 
-	if (who == T_SIMH)
-		tcount0++;
-	else
-		tcount1++;
+void record_transaction(int who, int rw, int what, unsigned int pa,
+                        unsigned int data)
+{
+	struct side *s = &sides[who-1];
+	struct trans *t = &s->ring[s->count % TRING];
+
+	if (0) printf("[%d][%u] %d %d %o %o\n",
+	       who-1, s->count, rw, what, pa, data);
+
+	t->rw = rw;
+	t->what = what;
+	t->pa = pa;
+	t->data = data;
+	s->hash = hash_trans(s->hash, what, pa, data);
+	s->count++;
 }
 
 void simh_record_mem_read_word(u22 pa, u16 data)
 {
-printf("simh: readw %o -> %o\n", pa, data & 0xffff);
+V_BUS printf("simh: readw %o -> %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_READW, T_MEM, pa, data);
 }
 
 void simh_record_io_read_word(u22 pa, u16 data)
 {
-printf("simh: io read %o -> %o\n", pa, data & 0xffff);
+V_BUS printf("simh: io read %o -> %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_READW, T_IO, pa, data);
 }
 
 void simh_record_mem_write_word(u22 pa, u16 data)
 {
-printf("simh: writew %o <- %o\n", pa, data & 0xffff);
+V_BUS printf("simh: writew %o <- %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_WRITEW, T_MEM, pa, data);
 }
 
 void simh_record_io_write_word(u22 pa, u16 data)
 {
-printf("simh: io write %o <- %o\n", pa, data & 0xffff);
+V_BUS printf("simh: io write %o <- %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_WRITEW, T_IO, pa, data);
 }
 
 void simh_record_mem_read_byte(u22 pa, u16 data)
 {
-printf("simh: readb %o -> %o\n", pa, data & 0xffff);
+V_BUS printf("simh: readb %o -> %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_READB, T_MEM, pa, data);
 }
 
 void simh_record_io_read_byte(u22 pa, u16 data)
 {
-printf("simh: io readb %o -> %o\n", pa, data & 0xffff);
+V_BUS printf("simh: io readb %o -> %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_READB, T_IO, pa, data);
 }
 
 void simh_record_mem_write_byte(u22 pa, u16 data)
 {
-printf("simh: writeb %o <- %o\n", pa, data & 0xffff);
+V_BUS printf("simh: writeb %o <- %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_WRITEB, T_MEM, pa, data);
 }
 
 void simh_record_io_write_byte(u22 pa, u16 data)
 {
-printf("simh: io writeb %o <- %o\n", pa, data & 0xffff);
+V_BUS printf("simh: io writeb %o <- %o\n", pa, data & 0xffff);
 record_transaction(T_SIMH, T_WRITEB, T_IO, pa, data);
 }
 
 void simh_report_pc(int PC, int IR)
 {
-printf("simh: pc %06o isn %06o\n", PC, IR);
+V_BUS printf("simh: pc %06o isn %06o\n", PC, IR);
 }
 
 
@@ -173,49 +238,49 @@ printf("simh: pc %06o isn %06o\n", PC, IR);
 
 void rtl_record_mem_read_word(u22 pa, u16 data)
 {
-if (1) printf("READ-MEM %6o -> %o\n", pa, data);
+V_BUS printf("READ-MEM %6o -> %o\n", pa, data);
 record_transaction(T_RTL, T_READW, T_MEM, pa, data);
 }
 
 void rtl_record_io_read_word(u22 pa, u16 data)
 {
-if (1) printf("READ-IO %6o -> %o\n", pa, data);
+V_BUS printf("READ-IO %6o -> %o\n", pa, data);
 record_transaction(T_RTL, T_READW, T_IO, pa, data);
 }
 
 void rtl_record_mem_write_word(u22 pa, u16 data)
 {
-if (1) printf("WRITE-MEM %6o <- %6o\n", pa, data);
+V_BUS printf("WRITE-MEM %6o <- %6o\n", pa, data);
 record_transaction(T_RTL, T_WRITEW, T_MEM, pa, data);
 }
 
 void rtl_record_io_write_word(u22 pa, u16 data)
 {
-if (1) printf("WRITE-IO %6o <- %6o\n", pa, data);
+V_BUS printf("WRITE-IO %6o <- %6o\n", pa, data);
 record_transaction(T_RTL, T_WRITEW, T_IO, pa, data);
 }
 
 void rtl_record_mem_read_byte(u22 pa, u16 data)
 {
-printf("READB-MEM %o -> %o\n", pa, data & 0xffff);
+V_BUS printf("READB-MEM %o -> %o\n", pa, data & 0xffff);
 record_transaction(T_RTL, T_READB, T_MEM, pa, data);
 }
 
 void rtl_record_io_read_byte(u22 pa, u16 data)
 {
-printf("READB-IO %o -> %o\n", pa, data & 0xffff);
+V_BUS printf("READB-IO %o -> %o\n", pa, data & 0xffff);
 record_transaction(T_RTL, T_READB, T_IO, pa, data);
 }
 
 void rtl_record_mem_write_byte(u22 pa, u16 data)
 {
-printf("WRITEB-MEM %o <- %o\n", pa, data & 0xffff);
+V_BUS printf("WRITEB-MEM %o <- %o\n", pa, data & 0xffff);
 record_transaction(T_RTL, T_WRITEB, T_MEM, pa, data);
 }
 
 void rtl_record_io_write_byte(u22 pa, u16 data)
 {
-printf("WRITEB-IO %o <- %o\n", pa, data & 0xffff);
+V_BUS printf("WRITEB-IO %o <- %o\n", pa, data & 0xffff);
 record_transaction(T_RTL, T_WRITEB, T_IO, pa, data);
 }
 
@@ -0,0 +1,35 @@
+/* compare.h */
+
+enum {
+    T_SIMH=1,
+    T_RTL=2,
+
+    T_MEM=1,
+    T_IO=2,
+
+    T_READW = 1,
+    T_READB,
+    T_WRITEW,
+    T_WRITEB
+};
+
+struct trans {
+	int rw, what;
+	unsigned int pa;
+	unsigned int data;
+};
+
+/* one side's transactions for one instruction; the first TKEEP kept */
+#define TKEEP	32
+
+struct tsum {
+	unsigned int count;
+	unsigned long long hash;
+	struct trans t[TKEEP];
+};
+
+void reset_transactions(void);
+void check_transactions(void);
+void reset_side(int who);
+void take_transactions(int who, struct tsum *ts);
+int diff_transactions(struct tsum *simh, struct tsum *rtl);
@@ -4,9 +4,14 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
 
 #include "cpu.h"
 #include "mem.h"
+#include "debug.h"
+#include "checkpoint.h"
+#include "timing.h"
 
 /* state */
 int halted;
@@ -277,10 +282,38 @@ enum {
 wire new_istate;
 int istate;
 
+#ifdef FAST
+#define verbose_mux	0
+#define verbose_data	0
+#define verbose_psw	0
+#define verbose_cc	0
+#else
 int verbose_mux;
 int verbose_data;
 int verbose_psw;
 int verbose_cc;
+#endif
+
+/*
+ * state ring; every state clocked is recorded here, and the last
+ * STATE_RING of them are written out by state_ring_write() when the
+ * cosim diverges.  this is the only state trace in a FAST build.
+ */
+#define STATE_RING	65536
+
+struct state_rec {
+    unsigned char istate;
+    unsigned char trap;
+    u16 isn;
+    u16 psw;
+    u16 regs[8];
+    u16 ss_data, dd_data, e1_data;
+    u22 ss_ea, dd_ea;
+};
+
+static struct state_rec state_ring[STATE_RING];
+static unsigned long long state_count;
+static unsigned long long isn_count;
 
 void check_for_interrupts(void);
 
@@ -289,24 +322,24 @@ void fetch(void)
     assert_trap_odd = 0;
 
     if (pc & 1) {
-        printf("fetch: odd pc %o\n", pc);
+        V_STATE printf("fetch: odd pc %o\n", pc);
 	assert_trap_odd = 1;
 	return;
     }
 
-    printf("------\n");
+    V_STATE printf("------\n");
 
     check_for_interrupts();
 
-    printf("f1: pc=%o, sp=%o, psw=%o ipl%d n%d z%d v%d c%d (%o %o %o %o %o %o %o %o)\n",
+    V_STATE printf("f1: pc=%o, sp=%o, psw=%o ipl%d n%d z%d v%d c%d (%o %o %o %o %o %o %o %o)\n",
 	   pc, sp, psw, ipl, cc_n, cc_z, cc_v, cc_c,
            regs[0], regs[1], regs[2], regs[3], regs[4], regs[5], regs[6], regs[7]);
-    printf("    trap=%d, interrupt=%d\n", trap, interrupt);
-    printf("    regs %6o %6o %6o %6o \n", regs[0], regs[1], regs[2], regs[3]);
-    printf("         %6o %6o %6o %6o \n", regs[4], regs[5], regs[6], regs[7]);
+    V_STATE printf("    trap=%d, interrupt=%d\n", trap, interrupt);
+    V_STATE printf("    regs %6o %6o %6o %6o \n", regs[0], regs[1], regs[2], regs[3]);
+    V_STATE printf("         %6o %6o %6o %6o \n", regs[4], regs[5], regs[6], regs[7]);
 
     isn = read_mem(pc);
-    dis(isn, raw_read_memory(pc+2), raw_read_memory(pc+4));
+    V_STATE dis(isn, raw_read_memory(pc+2), raw_read_memory(pc+4));
 }
 
 /*
@@ -330,8 +363,9 @@ do_ea_mux(void)
          ss_mode == 1 ? regs[ss_reg] :
 	 ss_mode == 2 ? regs[ss_reg] :
 	 ss_mode == 3 ? regs[ss_reg] :
-	 ss_mode == 4 ? (is_isn_byte ? (regs[ss_reg]-1) : (regs[ss_reg]-2)) :
-	 ss_mode == 5 ? (is_isn_byte ? (regs[ss_reg]-1) : (regs[ss_reg]-2)) :
+	 ss_mode == 4 ? ((is_isn_byte && ss_reg < 6) ?
+                         (regs[ss_reg]-1) : (regs[ss_reg]-2)) :
+	 ss_mode == 5 ? (regs[ss_reg]-2) :
 	 ss_mode == 6 ? pc :
 	 ss_mode == 7 ? pc :
 	 0) :
@@ -363,15 +397,15 @@ do_ea_mux(void)
     if (verbose_mux &&
         ss_ea != ss_ea_mux && (istate < e1 || istate >= t1))
     {
-        printf("  ea_mux: ss_ea_mux %6o\n", ss_ea_mux);
+        V_STATE printf("  ea_mux: ss_ea_mux %6o\n", ss_ea_mux);
 
         if (istate == s1) {
-            printf("          ss_mem_data %6o, R%d %6o\n",
+            V_STATE printf("          ss_mem_data %6o, R%d %6o\n",
                    ss_mem_data, ss_reg, regs[ss_reg]);
         }
 
         if (istate >= t1) {
-            printf("          %d%d%d%d %d%d%d%d %d\n",
+            V_STATE printf("          %d%d%d%d %d%d%d%d %d\n",
                    trap_odd, trap_bus, trap_ill, trap_priv,
                    trap_bpt, trap_iot, trap_emt, trap_trap,
                    interrupt);
@@ -390,8 +424,9 @@ do_ea_mux(void)
          dd_mode == 1 ? regs[dd_reg] :
 	 dd_mode == 2 ? regs[dd_reg] :
 	 dd_mode == 3 ? regs[dd_reg] :
-	 dd_mode == 4 ? (is_isn_byte ? (regs[dd_reg]-1) : (regs[dd_reg]-2)) :
-	 dd_mode == 5 ? (is_isn_byte ? (regs[dd_reg]-1) : (regs[dd_reg]-2)) :
+	 dd_mode == 4 ? ((is_isn_byte && dd_reg < 6) ?
+                         (regs[dd_reg]-1) : (regs[dd_reg]-2)) :
+	 dd_mode == 5 ? (regs[dd_reg]-2) :
 	 dd_mode == 6 ? pc :
 	 dd_mode == 7 ? pc :
 	 0) :
@@ -407,9 +442,9 @@ do_ea_mux(void)
 	dd_ea;
 
     if (dd_ea != dd_ea_mux && istate < e1 && verbose_mux) {
-	printf("  ea_mux: dd_ea_mux %6o\n", dd_ea_mux);
+	V_STATE printf("  ea_mux: dd_ea_mux %6o\n", dd_ea_mux);
         if (istate == d1) {
-            printf("          dd_mem_data %6o, R%d %6o\n",
+            V_STATE printf("          dd_mem_data %6o, R%d %6o\n",
                    dd_mem_data, dd_reg, regs[dd_reg]);
         }
     }
@@ -440,12 +475,12 @@ do_data_mux(void)
 	e1_data_mux;
 
     if (ss_data != ss_data_mux && verbose_mux) {
-	printf("  data_mux: ss%d reg%d mem %o mux %o\n",
+	V_STATE printf("  data_mux: ss%d reg%d mem %o mux %o\n",
 	       ss_mode, ss_reg, ss_mem_data, ss_data_mux);
     }
 
     if (dd_data != dd_data_mux && verbose_mux) {
-	printf("  data_mux: dd%d reg%d mem %o mux %o\n",
+	V_STATE printf("  data_mux: dd%d reg%d mem %o mux %o\n",
 	       dd_mode, dd_reg, dd_mem_data, dd_data_mux);
     }
 }
@@ -469,7 +504,7 @@ do_pc_mux(void)
 	pc;
 
     if (pc_mux != pc && verbose_mux) {
-	printf("  pc_mux: istate %d, ss %d dd %d, latch_pc %d, pc_mux %o\n",
+	V_STATE printf("  pc_mux: istate %d, ss %d dd %d, latch_pc %d, pc_mux %o\n",
 	       istate, ss_mode, dd_mode, latch_pc, pc_mux);
     }
 }
@@ -485,7 +520,7 @@ do_sp_mux(void)
 	sp;
 
     if (sp_mux != sp && verbose_mux) {
-	printf(" sp_mux: sp_mux %o\n", sp_mux);
+	V_STATE printf(" sp_mux: sp_mux %o\n", sp_mux);
     }
 }
 
@@ -506,7 +541,7 @@ do_cc_mux(void)
     }
 
     if (new_psw != psw && verbose_psw)
-        printf("  cc_mux: new_psw %o\n", new_psw);
+        V_STATE printf("  cc_mux: new_psw %o\n", new_psw);
 
     psw = new_psw;
 }
@@ -519,7 +554,7 @@ do_psw_mux(void)
         psw;
 
     if (psw_mux != psw && verbose_mux) {
-        printf(" psw_mux: mux %o\n", psw_mux);
+        V_STATE printf(" psw_mux: mux %o\n", psw_mux);
     }
 
     if (latch_psw_prio) {
@@ -531,9 +566,9 @@ void
 do_reg_mux(void)
 {
     if (istate == c1 && verbose_mux) {
-        printf("  reg_mux: ss post %d pre %d reg %d\n",
+        V_STATE printf("  reg_mux: ss post %d pre %d reg %d\n",
                ss_post_incr, ss_pre_dec, ss_reg);
-        printf("           dd post %d pre %d reg %d\n",
+        V_STATE printf("           dd post %d pre %d reg %d\n",
                dd_post_incr, dd_pre_dec, dd_reg);
     }
 
@@ -543,14 +578,14 @@ do_reg_mux(void)
         {
             regs[ss_reg] +=
                 (need_srcspec_dd_byte && ss_reg < 6 && ss_mode == 2) ? 1 : 2;
-            printf(" R%d <- %o (ss r++)\n", ss_reg, regs[ss_reg]);
+            V_STATE printf(" R%d <- %o (ss r++)\n", ss_reg, regs[ss_reg]);
         }
         else
             if (ss_pre_dec)
             {
                 regs[ss_reg] -=
                     (need_srcspec_dd_byte && ss_reg < 6 && ss_mode == 4) ? 1:2;
-                printf(" R%d <- %o (ss r--)\n", ss_reg, regs[ss_reg]);
+                V_STATE printf(" R%d <- %o (ss r--)\n", ss_reg, regs[ss_reg]);
             }
     }
 
@@ -560,14 +595,14 @@ do_reg_mux(void)
         {
             regs[dd_reg] +=
                 (need_destspec_dd_byte && dd_reg < 6 && dd_mode == 2) ? 1 : 2;
-            printf(" R%d <- %o (dd r++)\n", dd_reg, regs[dd_reg]);
+            V_STATE printf(" R%d <- %o (dd r++)\n", dd_reg, regs[dd_reg]);
         }
         else
             if (dd_pre_dec)
             {
                 regs[dd_reg] -=
                     (need_destspec_dd_byte && dd_reg < 6 && dd_mode == 4) ?1:2;
-                printf(" R%d <- %o (dd r--)\n", dd_reg, regs[dd_reg]);
+                V_STATE printf(" R%d <- %o (dd r--)\n", dd_reg, regs[dd_reg]);
             }
     }
 }
@@ -649,7 +684,7 @@ void decode1(void)
 	!(isn_15_6 == 00001) &&				/* jmp */
 	!(isn_15_6 == 00057) && !(isn_15_6 == 01057) &&	/* tst/tstb */
 	!(isn_15_12 == 002) && !(isn_15_12 == 012) &&	/* cmp/cmpb */
-	!(isn_15_12 == 003) &&				/* bit */
+	!(isn_15_12 == 003) && !(isn_15_12 == 013) &&	/* bit/bitb */
 	!(isn_15_9 == 0004) &&					/* jsr */
 	!((isn_15_6 >= 01000) && (isn_15_6 <= 01037)) && 	/* bcs-blo */
 	!((isn_15_6 >= 00004) && (isn_15_6 <= 00034)); 		/* br-ble */
@@ -683,11 +718,11 @@ void decode1(void)
     need_src_data =
         !((isn_15_6 == 00050) || (isn_15_6 == 01050));	/* clr/clrb */
 
-    printf("c1: isn %06o ss %d, dd %d, no_op %d, ill %d, push %d, pop %d\n",
+    V_STATE printf("c1: isn %06o ss %d, dd %d, no_op %d, ill %d, push %d, pop %d\n",
 	   isn, need_srcspec_dd, need_destspec_dd,
 	   no_operand, is_illegal, need_push_state, need_pop_reg);
 
-    printf("    need_src_data %d, need_dest_data %d\n",
+    V_STATE printf("    need_src_data %d, need_dest_data %d\n",
            need_src_data, need_dest_data);
 
     /* ea setup */
@@ -708,7 +743,7 @@ void decode1(void)
         need_srcspec_dd &&
         (ss_mode == 4 || ss_mode == 5);
 
-    printf(" ss: mode%d reg%d ind%d post %d pre %d\n",
+    V_STATE printf(" ss: mode%d reg%d ind%d post %d pre %d\n",
 	   ss_mode, ss_reg, ss_ea_ind,
 	   ss_post_incr, ss_pre_dec);
 
@@ -728,7 +763,7 @@ void decode1(void)
         need_destspec_dd &&
         (dd_mode == 4 || dd_mode == 5);
 
-    printf(" dd: mode%d reg%d ea %06o ind%d post %d pre %d\n",
+    V_STATE printf(" dd: mode%d reg%d ea %06o ind%d post %d pre %d\n",
 	   dd_mode, dd_reg, dd_ea, dd_ea_ind,
 	   dd_post_incr, dd_pre_dec);
 
@@ -742,7 +777,7 @@ void decode1(void)
     need_s4 = need_srcspec_dd && ss_mode != 0 && need_src_data;
     need_d4 = need_destspec_dd && dd_mode != 0 && need_dest_data;
 
-    printf(" need: dest_data %d; s1 %d, s2 %d, s4 %d; d1 %d, d2 %d, d4 %d\n", 
+    V_STATE printf(" need: dest_data %d; s1 %d, s2 %d, s4 %d; d1 %d, d2 %d, d4 %d\n", 
            need_dest_data,
            need_s1, need_s2, need_s4, need_d1, need_d2, need_d4);
 }
@@ -755,24 +790,24 @@ wire22 se_addr(wire22 addr)
 
 void source1(void)
 {
-    printf("s1:\n");
+    V_STATE printf("s1:\n");
 }
 
 void source2(void)
 {
     ss_mem_data = read_mem(se_addr(ss_ea_mux));
-    printf("s2: ss_ea_mux %6o, [ea]=%6o\n", ss_ea_mux, ss_mem_data);
+    V_STATE printf("s2: ss_ea_mux %6o, [ea]=%6o\n", ss_ea_mux, ss_mem_data);
 }
 
 void source3(void)
 {
-    printf("s3: ss_ea_mux %6o\n", ss_ea_mux);
+    V_STATE printf("s3: ss_ea_mux %6o\n", ss_ea_mux);
     ss_mem_data = read_mem(se_addr(ss_ea_mux));
 }
 
 void source4(void)
 {
-    printf("s4: ss_ea_mux %6o\n", ss_ea_mux);
+    V_STATE printf("s4: ss_ea_mux %6o\n", ss_ea_mux);
     ss_mem_data = is_isn_byte ?
         read_mem_byte(se_addr(ss_ea_mux)) :
         read_mem(se_addr(ss_ea_mux));
@@ -780,24 +815,24 @@ void source4(void)
 
 void dest1(void)
 {
-    printf("d1: dd_ea %6o, dd_ea_mux %6o\n", dd_ea, dd_ea_mux);
+    V_STATE printf("d1: dd_ea %6o, dd_ea_mux %6o\n", dd_ea, dd_ea_mux);
 }
 
 void dest2(void)
 {
-    printf("d2: dd_ea %6o, dd_ea_mux %6o\n", dd_ea, dd_ea_mux);
+    V_STATE printf("d2: dd_ea %6o, dd_ea_mux %6o\n", dd_ea, dd_ea_mux);
     dd_mem_data = read_mem(se_addr(dd_ea));
 }
 
 void dest3(void)
 {
-    printf("d3:\n");
+    V_STATE printf("d3:\n");
     dd_mem_data = read_mem(se_addr(dd_ea_mux));
 }
 
 void dest4(void)
 {
-    printf("d4:\n");
+    V_STATE printf("d4:\n");
     dd_mem_data = is_isn_byte ?
         read_mem_byte(se_addr(dd_ea_mux)) :
         read_mem(se_addr(dd_ea_mux));
@@ -847,7 +882,7 @@ wire zero_b(wire16 v)
 
 void execute(void)
 {
-    printf("e1:\n");
+    V_STATE printf("e1:\n");
 
     assert_halt = 0;
     assert_wait = 0;
@@ -870,9 +905,13 @@ void execute(void)
     latch_cc = 0;
     latch_psw_prio = 0;
 
+    /* enable_execute; a bus error on an operand aborts the instruction */
+    if (trap_bus)
+        return;
+
     if (verbose_data) {
-        printf(" ss_data %6o, dd_data %6o\n", ss_data, dd_data);
-        printf(" ss_ea   %6o, dd_ea   %6o\n", ss_ea, dd_ea);
+        V_STATE printf(" ss_data %6o, dd_data %6o\n", ss_data, dd_data);
+        V_STATE printf(" ss_ea   %6o, dd_ea   %6o\n", ss_ea, dd_ea);
     }
 
     if (isn_15_12 == 0) {
@@ -883,7 +922,7 @@ void execute(void)
 	    switch (isn & 7) {
 
 	    case 0:					    /* halt */
-		printf("e: HALT\n");
+		V_STATE printf("e: HALT\n");
 		if (current_mode == mode_kernel)
 		    assert_halt = 1;
 		else
@@ -891,7 +930,7 @@ void execute(void)
 		break;
 
 	    case 1:					    /* wait */
-		printf("e: WAIT\n");
+		V_STATE printf("e: WAIT\n");
 		assert_wait = 1;
 		break;
 
@@ -909,11 +948,11 @@ void execute(void)
 		break;
 
 	    case 2:					    /* rti */
-		printf("e: RTI\n");
+		V_STATE printf("e: RTI\n");
                 break;
 
 	    case 6:					    /* rtt */
-		printf("e: RTT\n");
+		V_STATE printf("e: RTT\n");
 		break;
 
 	    case 7:					    /* mfpt */
@@ -927,7 +966,7 @@ void execute(void)
 	    switch (isn_11_6) {
 
 	    case 001:					    /* jmp */
-		printf("e: JMP; dest_ea %6o\n", dd_ea);
+		V_STATE printf("e: JMP; dest_ea %6o\n", dd_ea);
 		new_pc = dd_ea;
 		latch_pc = 1;
 		break;
@@ -936,7 +975,7 @@ void execute(void)
                 switch (isn_5_0) {
                 case 000: case 001: case 002: case 003:
                 case 004: case 005: case 006: case 007:
-                    printf("e: RTS\n");
+                    V_STATE printf("e: RTS\n");
                     new_pc = dd_data;
                     latch_pc = 1;
                     break;
@@ -982,7 +1021,7 @@ void execute(void)
 		break;
 
 	    case 003:					    /* swab */
-		printf("e: SWAB\n");
+		V_STATE printf("e: SWAB\n");
 		e1_result = ((dd_data & 0xff00) >> 8) | ((dd_data & 0xff) << 8);
 
 		new_cc_n = sign_b(e1_result);
@@ -998,7 +1037,7 @@ void execute(void)
 	    case 004: case 005:				    /* br */
 		new_pc_w;
 		latch_pc = 1;
-		printf("e: br; isn %o, pc %o, new_pc %o\n", isn, pc, new_pc);
+		V_STATE printf("e: br; isn %o, pc %o, new_pc %o\n", isn, pc, new_pc);
 		break;
 
 	    case 006: case 007:				    /* br */
@@ -1068,7 +1107,7 @@ void execute(void)
 
 	    case 040: case 041: case 042: case 043:	    /* jsr */
 	    case 044: case 045: case 046: case 047:
-		printf(" JSR r%d; dd_data %6o, dd_ea %6o\n",
+		V_STATE printf(" JSR r%d; dd_data %6o, dd_ea %6o\n",
                        ss_reg, dd_data, dd_ea);
 		e1_result = pc;
 		new_pc = dd_ea;
@@ -1254,7 +1293,7 @@ void execute(void)
 		unsigned short temp, sign, shift;
 
 	    case 0:					    /* mul */
-                printf(" MUL %o %o\n", ss_data, dd_data);
+                V_STATE printf(" MUL %o %o\n", ss_data, dd_data);
 		e32_result = ss_data * dd_data;
 		new_cc_n = e32_result & 0x80000000 ? 1 : 0;
 		new_cc_z = e32_result & 0xffffffff ? 0 : 1;
@@ -1392,16 +1431,16 @@ void execute(void)
             break;
 
         case 010:
-            if (1) printf(" e: 010 isn_11_6 %o\n", isn_11_6);
+            V_STATE printf(" e: 010 isn_11_6 %o\n", isn_11_6);
             switch (isn_11_6) {
             case 000: case 001:				/* bpl */
-                printf("e: BPL\n"); 
+                V_STATE printf("e: BPL\n"); 
                new_pc_w;
                 latch_pc = cc_n == 0 ? 1 : 0;
                 break;
 
             case 002: case 003:				/* bpl */
-                printf("e: BPLB\n");
+                V_STATE printf("e: BPLB\n");
                 new_pc_b;
                 latch_pc = cc_n == 0 ? 1 : 0;
                 break;
@@ -1477,12 +1516,12 @@ void execute(void)
                 break;
 
             case 040: case 041: case 042: case 043:	/* emt */
-                printf(" EMT\n");
+                V_STATE printf(" EMT\n");
                 assert_trap_emt = 1;
                 break;
 
             case 044: case 045: case 046: case 047:	/* trap */
-                printf(" TRAP\n");
+                V_STATE printf(" TRAP\n");
                 assert_trap_trap = 1;
                 break;
 
@@ -1560,9 +1599,9 @@ void execute(void)
                 break;
 
             case 057:					/* tstb */
-                printf(" TSTB %o\n", dd_data & 0xff);
+                V_STATE printf(" TSTB %o\n", dd_data & 0xff);
                 e1_result = dd_data & 0xff;
-                printf(" TSTB %o, e1_result 0x%x\n", dd_data & 0xff, e1_result);
+                V_STATE printf(" TSTB %o, e1_result 0x%x\n", dd_data & 0xff, e1_result);
                 new_cc_n = sign_b(e1_result);
                 new_cc_z = zero_b(e1_result);
                 new_cc_v = 0;
@@ -1583,10 +1622,10 @@ void execute(void)
 
             case 061:					/* rolb */
                 e1_result = (dd_data & 0xff00) |
-                    (((dd_data & 0377) << 1) | cc_c);
+                    ((((dd_data & 0377) << 1) | cc_c) & 0377);
                 new_cc_n = sign_b(e1_result);
                 new_cc_z = zero_b(e1_result);
-                new_cc_c = dd_data & 0x80;
+                new_cc_c = (dd_data & 0200) ? 1 : 0;
                 new_cc_v = new_cc_n ^ new_cc_c;
                 latch_cc = 1;
 //note: byte write of src - rmw to memory word
@@ -1597,7 +1636,7 @@ void execute(void)
                     (((dd_data & 0377) >> 1) | dd_data & 0200);
                 new_cc_n = sign_b(e1_result);
                 new_cc_z = zero_b(e1_result);
-                new_cc_c = ss_data & 1;
+                new_cc_c = dd_data & 1;
                 new_cc_v = new_cc_n ^ new_cc_c;
                 latch_cc = 1;
 //note: byte write of src - rmw to memory word
@@ -1605,10 +1644,10 @@ void execute(void)
 
             case 063:					/* aslb */
                 e1_result = (dd_data & 0xff00) |
-                    ((dd_data & 0377) << 1);
+                    (((dd_data & 0377) << 1) & 0377);
                 new_cc_n = sign_b(e1_result);
                 new_cc_z = zero_b(e1_result);
-                new_cc_c = ss_data & 0x80;
+                new_cc_c = (dd_data & 0200) ? 1 : 0;
                 new_cc_v = new_cc_n ^ new_cc_c;
                 latch_cc = 1;
 //note: byte write of src - rmw to memory word
@@ -1709,20 +1748,24 @@ void execute(void)
     }
 
     if (verbose_data) {
-        printf(" ss_data %6o, dd_data %6o, e1_result %6o\n",
+        V_STATE printf(" ss_data %6o, dd_data %6o, e1_result %6o\n",
                ss_data, dd_data, e1_result);
-        printf(" latch_pc %d, latch_cc %d\n", latch_pc, latch_cc);
-        printf(" psw %o\n", psw);
+        V_STATE printf(" latch_pc %d, latch_cc %d\n", latch_pc, latch_cc);
+        V_STATE printf(" psw %o\n", psw);
     }
 }
 
 void writeback1(void)
 {
-    printf("w1: dd%d %d, dd_data %o, ss%d %d, ss_data %o, e1_data %o\n",
+    V_STATE printf("w1: dd%d %d, dd_data %o, ss%d %d, ss_data %o, e1_data %o\n",
 	   dd_mode, dd_reg, dd_data, ss_mode, ss_reg, ss_data, e1_data);
-    printf("    dd_ea_mux %06o, store_result %d, store_ss_reg %d, store_32 %d\n",
+    V_STATE printf("    dd_ea_mux %06o, store_result %d, store_ss_reg %d, store_32 %d\n",
 	   dd_ea_mux, store_result, store_ss_reg, store_result32);
 
+    /* nor is anything stored */
+    if (trap_bus)
+        return;
+
     if (store_result && dd_dest_mem) {
         if (is_isn_byte)
             write_mem_byte(se_addr(dd_ea_mux), e1_data);
@@ -1730,16 +1773,20 @@ void writeback1(void)
             write_mem(se_addr(dd_ea_mux), e1_data);
     }
     else if (store_result && dd_dest_reg) {
-	printf(" r%d <- %06o (dd)\n", dd_reg, e1_data);
+	V_STATE printf(" r%d <- %06o (dd)\n", dd_reg, e1_data);
+        /* byte ops leave the high byte, but movb and mfps sign extend */
+        if (is_isn_byte && isn_15_12 != 011 && isn_15_6 != 01067)
+            regs[dd_reg] = (regs[dd_reg] & 0177400) | (e1_data & 0377);
+        else
             regs[dd_reg] = e1_data;
     }
     else if (store_ss_reg) {
-	printf(" r%d <- %06o (ss)\n", ss_reg, e1_data);
+	V_STATE printf(" r%d <- %06o (ss)\n", ss_reg, e1_data);
 	regs[ss_reg] = e1_data;
     }
     else if (store_result32) {
-	printf(" r%d <- %06o (e32)\n", ss_reg, e32_result >> 16);
-	printf(" r%d <- %06o (e32)\n", ss_reg|1, e32_result & 0xffff);
+	V_STATE printf(" r%d <- %06o (e32)\n", ss_reg, e32_result >> 16);
+	V_STATE printf(" r%d <- %06o (e32)\n", ss_reg|1, e32_result & 0xffff);
 	regs[ss_reg    ] = e32_result >> 16;
 	regs[ss_reg | 1] = e32_result & 0xffff;
     }
@@ -1747,42 +1794,42 @@ void writeback1(void)
 }
 
 void pop1(void) {
-    printf("o1:\n");
+    V_STATE printf("o1:\n");
     pc_mem_data = read_mem(sp);
 }
 
 void pop2(void) {
-    printf("o2:\n");
+    V_STATE printf("o2:\n");
     psw_mem_data = read_mem(sp);
 }
 
 void pop3(void) {
-    printf("o3:\n");
+    V_STATE printf("o3:\n");
     pop_mem_data = read_mem(sp);
 }
 
 void push1(void) {
-    printf("p1:\n");
+    V_STATE printf("p1:\n");
     write_mem(sp-2, regs[ss_reg]);
 }
 
 void trap1(void) {
-    printf("t1: sp %o\n", sp);
+    V_STATE printf("t1: sp %o\n", sp);
     write_mem(sp-2, psw);
 }
 
 void trap2(void) {
-    printf("t2:\n");
+    V_STATE printf("t2:\n");
     write_mem(sp-2, pc);
 }
 
 void trap3(void) {
-    printf("t3: ss_ea %o, ss_ea_mux %o\n", ss_ea, ss_ea_mux);
+    V_STATE printf("t3: ss_ea %o, ss_ea_mux %o\n", ss_ea, ss_ea_mux);
     pc_mem_data = read_mem(ss_ea_mux);
 }
 
 void trap4(void) {
-    printf("t4: ss_ea %o, ss_ea_mux %o\n", ss_ea, ss_ea_mux);
+    V_STATE printf("t4: ss_ea %o, ss_ea_mux %o\n", ss_ea, ss_ea_mux);
     psw_mem_data = read_mem(ss_ea_mux);
 
     //hack
@@ -1861,7 +1908,7 @@ void check_for_traps(void)
             trap_bpt || trap_iot || trap_emt || trap_trap ||
             trap_ill || trap_odd || trap_priv || trap_bus;
 
-        if (trap) {
+        V_STATE if (trap) {
             printf("trap: asserts ");
             if (assert_trap_priv) printf("PRIV ");
             if (assert_trap_odd) printf("ODD ");
@@ -1879,12 +1926,12 @@ void check_for_traps(void)
 
     /* */
     if (assert_halt) {
-	printf("assert_halt\n");
+	V_STATE printf("assert_halt\n");
 	halted = 1;
     }
 
     if (assert_wait) {
-	printf("assert_wait\n");
+	V_STATE printf("assert_wait\n");
 	waited = 1;
     }
 }
@@ -1898,7 +1945,7 @@ int ipl_below(int psw_ipl, int ipl_bits)
 
     mask = ~((1 << psw_ipl) - 1);
     mask <<= 1;
-    printf("ipl: mask 0x%x, bits 0x%x\n", mask, ipl_bits);
+    V_STATE printf("ipl: mask 0x%x, bits 0x%x\n", mask, ipl_bits);
 
     if (ipl_bits & mask)
         return 1;
@@ -1919,7 +1966,7 @@ void check_for_interrupts(void)
         if (assert_int & ipl_below(ipl, assert_int_ipl)) {
             interrupt = 1;
             interrupt_vector = assert_int_vec;
-            printf("interrupt: asserts; vector %o\n", interrupt_vector);
+            V_STATE printf("interrupt: asserts; vector %o\n", interrupt_vector);
 
             /* hack, but ok; */
             assert_int = 0;
@@ -2038,8 +2085,65 @@ void update_muxes(void)
     do_sp_mux();
 }
 
+void record_state(void)
+{
+    struct state_rec *r = &state_ring[state_count++ & (STATE_RING-1)];
+    int i;
+
+    r->istate = istate;
+    r->trap = trap | (interrupt << 1);
+    r->isn = isn;
+    r->psw = psw;
+    for (i = 0; i < 8; i++)
+        r->regs[i] = regs[i];
+    r->ss_data = ss_data;
+    r->dd_data = dd_data;
+    r->e1_data = e1_data;
+    r->ss_ea = ss_ea;
+    r->dd_ea = dd_ea;
+}
+
+/* what the state is doing, for timing.c */
+static int timing_phase(void)
+{
+    switch (istate) {
+    case f1: case c1: return TP_FETCH;
+    case s1: case s2: case s3: case s4: return TP_SRC;
+    case d1: case d2: case d3: case d4: return TP_DST;
+    case t1: case t2: case t3: case t4: return TP_TRAP;
+    case i1: return TP_IDLE;
+    }
+    return TP_EXEC;
+}
+
+/*
+ * clocks the rtl spends in a state beyond the one the model clocks; t0,
+ * which the model goes straight past, and e1 held by execute.v until
+ * mul1616 or div3216 have gone through each bit or shift32 has shifted
+ */
+static int timing_extra(void)
+{
+    int n;
+
+    if (istate == t1)
+        return 1;
+    if (istate != e1)
+        return 0;
+
+    switch (isn_15_9) {
+    case 0070: return 17;			/* mul */
+    case 0071: return 33;			/* div */
+    case 0072:					/* ash */
+    case 0073:					/* ashc */
+        n = dd_data & 077;
+        return 1 + (n < 32 ? n : 64 - n);
+    }
+    return 0;
+}
+
 void clock_registers(void)
 {
+    record_state();
     update_muxes();
 
     pc = pc_mux;
@@ -2088,6 +2192,8 @@ void clock_registers(void)
     else
 	e1_data = e1_data;
 
+    timing_state(timing_phase(), timing_extra());
+
     next_state();
 }
 
@@ -2095,6 +2201,7 @@ void clock_registers(void)
 void step(int *did_trap)
 {
     istate = f1;
+    isn_count++;
 
     fetch();
     clock_registers();
@@ -2127,6 +2234,28 @@ void step(int *did_trap)
         if (istate == h1)
             break;
     }
+
+    timing_isn(isn);
+}
+
+static double run_start;
+
+static double now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+void report_rate(void)
+{
+    double t = now() - run_start;
+
+    if (t <= 0)
+        t = 1e-6;
+    printf("%llu instructions, %llu states in %.3fs; %.0f states/sec\n",
+           isn_count, state_count, t, state_count / t);
 }
 
 void run(void)
@@ -2135,14 +2264,17 @@ void run(void)
     int trap_sync = 0;
 
     istate = f1;
+    run_start = now();
 
     while (1) {
-        reset_transactions();
+        cosim_begin();
 
         step(&did_trap);
 
 	if (istate == h1) {
 	    printf("halted\n");
+            if (!cosim_end())
+                report_rate();
 	    break;
 	}
 
@@ -2156,14 +2288,148 @@ void run(void)
                 did_trap = 0;
             } else {
                 cosim_check();
-                check_transactions();
             }
         }
+
+        /* pipelined cosim found a divergence behind us */
+        if (cosim_stopped()) {
+            cosim_end();
+            break;
+        }
     }
 }
 
 
 /* debug */
+static char *state_names[] = {
+    "h1", "f1", "c1", "s1", "s2", "s3", "s4", "d1", "d2", "d3", "d4",
+    "e1", "w1", "o1", "o2", "o3", "p1", "t1", "t2", "t3", "t4", "i1"
+};
+
+/* write the state ring, oldest first */
+int state_ring_write(char *filename)
+{
+    FILE *f;
+    unsigned long long n, first;
+
+    if ((f = fopen(filename, "wb")) == NULL) {
+        perror(filename);
+        return -1;
+    }
+
+    n = state_count < STATE_RING ? state_count : STATE_RING;
+    first = state_count - n;
+    fwrite(&state_count, sizeof(state_count), 1, f);
+    for (; first < state_count; first++)
+        fwrite(&state_ring[first & (STATE_RING-1)],
+               sizeof(struct state_rec), 1, f);
+    fclose(f);
+
+    printf("state ring: last %llu of %llu states written to %s\n",
+           n, state_count, filename);
+    return 0;
+}
+
+/* number of states clocked so far */
+unsigned long long state_ring_count(void)
+{
+    return state_count;
+}
+
+/* print a file written by state_ring_write(), from state first on */
+int state_ring_print(char *filename, unsigned long long first)
+{
+    FILE *f;
+    struct state_rec r;
+    unsigned long long count, n;
+
+    if ((f = fopen(filename, "rb")) == NULL ||
+        fread(&count, sizeof(count), 1, f) != 1)
+    {
+        perror(filename);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    n = (ftell(f) - sizeof(count)) / sizeof(r);
+    fseek(f, sizeof(count), SEEK_SET);
+
+    for (n = count - n; fread(&r, sizeof(r), 1, f) == 1; n++) {
+        if (n < first)
+            continue;
+        printf("%llu %s: isn %06o psw %06o trap %d int %d "
+               "ss %06o/%06o dd %06o/%06o e %06o\n",
+               n, r.istate < 22 ? state_names[r.istate] : "??",
+               r.isn, r.psw, r.trap & 1, r.trap >> 1,
+               r.ss_ea, r.ss_data, r.dd_ea, r.dd_data, r.e1_data);
+        printf("    regs %06o %06o %06o %06o %06o %06o %06o %06o\n",
+               r.regs[0], r.regs[1], r.regs[2], r.regs[3],
+               r.regs[4], r.regs[5], r.regs[6], r.regs[7]);
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/*
+ * cosim checkpoints; taken between instructions, so only the registers
+ * and the latched trap/interrupt requests matter, not the muxes
+ */
+static struct cpu_ckpt {
+    u16 regs[8];
+    u16 psw, isn;
+    int istate, current_mode;
+    int halted, waited;
+    int trap, trap_bpt, trap_iot, trap_emt, trap_trap;
+    int trap_odd, trap_bus, trap_ill, trap_priv;
+    int interrupt;
+    u16 interrupt_vector;
+    wire assert_wait, assert_halt, assert_reset, assert_bpt, assert_iot;
+    wire assert_trap_odd, assert_trap_ill, assert_trap_priv;
+    wire assert_trap_emt, assert_trap_trap, assert_trap_bus;
+    wire assert_int;
+    wire16 assert_int_vec, assert_int_ipl;
+    u16 ss_data, dd_data, e1_data;
+    u22 ss_ea, dd_ea;
+    unsigned long long state_count, isn_count;
+} cpu_saved[NCKPT];
+
+void cpu_checkpoint(int slot, int restore)
+{
+    struct cpu_ckpt *c = &cpu_saved[slot];
+
+#define CK(v)	if (restore) v = c->v; else c->v = v
+    if (restore)
+        memcpy(regs, c->regs, sizeof(regs));
+    else
+        memcpy(c->regs, regs, sizeof(regs));
+    CK(psw); CK(isn);
+    CK(istate); CK(current_mode);
+    CK(halted); CK(waited);
+    CK(trap); CK(trap_bpt); CK(trap_iot); CK(trap_emt); CK(trap_trap);
+    CK(trap_odd); CK(trap_bus); CK(trap_ill); CK(trap_priv);
+    CK(interrupt); CK(interrupt_vector);
+    CK(assert_wait); CK(assert_halt); CK(assert_reset);
+    CK(assert_bpt); CK(assert_iot);
+    CK(assert_trap_odd); CK(assert_trap_ill); CK(assert_trap_priv);
+    CK(assert_trap_emt); CK(assert_trap_trap); CK(assert_trap_bus);
+    CK(assert_int); CK(assert_int_vec); CK(assert_int_ipl);
+    CK(ss_data); CK(dd_data); CK(e1_data);
+    CK(ss_ea); CK(dd_ea);
+    CK(state_count); CK(isn_count);
+#undef CK
+}
+
+/* what the current memory access is for, for the cache model */
+int cpu_access_class(void)
+{
+    if (istate == f1)
+        return CL_FETCH;
+    if (istate >= t1 && istate <= t4)
+        return CL_TRAP;
+    return isn_class(isn);
+}
+
 void debug_set_pc(u16 new_pc)
 {
     pc = new_pc;
@@ -2184,7 +2450,7 @@ void debug_reset(void)
 void
 support_signals_bus_error(u22 addr)
 {
-    printf("assert_trap_bus = 1 (pc %o, addr %o)\n", pc, addr);
+    V_STATE printf("assert_trap_bus = 1 (pc %o, addr %o)\n", pc, addr);
     assert_trap_bus = 1;
 }
 
@@ -1,4 +1,33 @@
 
+#define VERB_STATE	1	/* cpu states, muxes, disassembly */
+#define VERB_BUS	2	/* memory and i/o transactions */
+#define VERB_DEV	4	/* device models */
 #define VERB_SIMH	8
 
-#define V_SIMH if (verbose & VERB_SIMH)
+/* a FAST build compiles all tracing out; see the state ring in cpu.c */
+#ifdef FAST
+#define V_STATE if (0)
+#define V_BUS	if (0)
+#define V_DEV	if (0)
+#define V_SIMH	if (0)
+#else
+#define V_STATE if (verbose & VERB_STATE)
+#define V_BUS	if (verbose & VERB_BUS)
+#define V_DEV	if (verbose & VERB_DEV)
+#define V_SIMH	if (verbose & VERB_SIMH)
+#endif
+
+extern int verbose;
+
+/* the cosim, in run.c; called by the model at each instruction */
+void cosim_begin(void);
+void cosim_check(void);
+void cosim_trap(void);
+int cosim_stopped(void);
+int cosim_end(void);
+
+/* the state ring and the instruction rate, in cpu.c */
+int state_ring_write(char *filename);
+int state_ring_print(char *filename, unsigned long long first);
+unsigned long long state_ring_count(void);
+void report_rate(void);
@@ -245,6 +245,13 @@ void dis(u16 inst, u16 arg1, u16 arg2)
         printf("   %06o ?\n", inst);
 }
 
+/* the I_xx type of an instruction, 0 if it does not decode */
+int
+isn_class(u16 inst)
+{
+    return isn_decode[inst] ? isn_decode[inst]->isn_type : 0;
+}
+
 void
 make_isn_table(void)
 {
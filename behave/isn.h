@@ -94,6 +94,7 @@ enum {
     ISN_BICB,
     ISN_BISB,
     ISN_SUB,
+    ISN_NUM
 };
 
 enum {
@@ -0,0 +1,230 @@
+/* load.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cpu.h"
+#include "load.h"
+
+/*
+ * program loaders, by file name:
+ *
+ *  .mem	"addr data" in octal, a word a line; what the rtl sims, the
+ *		tests and utils/loadtomem use.  no start address.
+ *  .sav	rt-11 save image; memory from 0 up, start address at 040
+ *		and stack at 042.  copied straight from the mapped file.
+ *  other	absolute loader tape (.bin, .bic, .lda), as loadtomem
+ *		reads it; the last block gives the start address.
+ *
+ * the .mem and tape formats are decoded into a 64k image first, so
+ * whatever the format the caller has one block of words to copy.
+ */
+
+static u16 image[32768];
+
+static char *suffix(char *filename)
+{
+    char *p = strrchr(filename, '.');
+
+    return p ? p + 1 : "";
+}
+
+/* the words from lo to hi (byte addresses, inclusive) of image[] */
+static void load_image(struct load *ld, unsigned lo, unsigned hi)
+{
+    ld->addr = lo & ~1;
+    ld->data = &image[lo >> 1];
+    ld->words = lo <= hi ? (hi >> 1) - (lo >> 1) + 1 : 0;
+}
+
+static int load_mem(char *filename, struct load *ld)
+{
+    FILE *f;
+    unsigned addr, data, lo, hi;
+    char line[128];
+    int n;
+
+    if ((f = fopen(filename, "r")) == NULL) {
+        perror(filename);
+        return -1;
+    }
+
+    lo = sizeof(image)*2;
+    hi = 0;
+    for (n = 1; fgets(line, sizeof(line), f); n++) {
+        if (sscanf(line, "%o %o", &addr, &data) != 2)
+            continue;
+        if (addr >= sizeof(image)*2) {
+            fprintf(stderr, "%s:%d: address %o out of range\n",
+                    filename, n, addr);
+            fclose(f);
+            return -1;
+        }
+        image[addr >> 1] = data;
+        if (addr < lo) lo = addr;
+        if (addr > hi) hi = addr;
+    }
+
+    fclose(f);
+    load_image(ld, lo, hi);
+    return 0;
+}
+
+static int map_file(char *filename, struct load *ld)
+{
+    struct stat st;
+    int fd;
+
+    if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+        perror(filename);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    ld->map_len = st.st_size;
+    ld->map = mmap(NULL, ld->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (ld->map == MAP_FAILED) {
+        perror(filename);
+        ld->map = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int load_sav(char *filename, struct load *ld)
+{
+    if (map_file(filename, ld))
+        return -1;
+
+    if (ld->map_len < 01000) {
+        fprintf(stderr, "%s: too short for a save image\n", filename);
+        load_done(ld);
+        return -1;
+    }
+
+    /* pdp-11 words are little endian, as is the host */
+    ld->data = (u16 *)ld->map;
+    ld->addr = 0;
+    ld->words = ld->map_len / 2;
+    ld->start = ld->data[040/2];
+    ld->sp = ld->data[042/2];
+    return 0;
+}
+
+static int load_tape(char *filename, struct load *ld)
+{
+    unsigned char *b;
+    unsigned count, origin, lo, hi;
+    int state, csum, i;
+    size_t o;
+
+    if (map_file(filename, ld))
+        return -1;
+
+    b = (unsigned char *)ld->map;
+    lo = sizeof(image)*2;
+    hi = 0;
+    count = origin = 0;
+    state = csum = 0;
+
+    for (o = 0; o < ld->map_len; o++) {
+        i = b[o];
+        csum += i;
+
+        switch (state) {
+        case 0:					/* leader */
+            if (i == 1) state = 1;
+            else csum = 0;
+            break;
+        case 1:					/* ignore after 001 */
+            state = 2;
+            break;
+        case 2:					/* low count */
+            count = i;
+            state = 3;
+            break;
+        case 3:					/* high count */
+            count |= i << 8;
+            state = 4;
+            break;
+        case 4:					/* low origin */
+            origin = i;
+            state = 5;
+            break;
+        case 5:					/* high origin */
+            origin |= i << 8;
+            if (count == 6) {
+                if (origin != 1)
+                    ld->start = origin & 0177776;
+                goto done;
+            }
+            count -= 6;
+            state = 6;
+            break;
+        case 6:					/* data */
+            if (origin & 1)
+                image[origin >> 1] = (image[origin >> 1] & 0377) | (i << 8);
+            else
+                image[origin >> 1] = (image[origin >> 1] & 0177400) | i;
+            if (origin < lo) lo = origin;
+            if (origin > hi) hi = origin;
+            origin = (origin + 1) & 0177777;
+            if (--count == 0)
+                state = 7;
+            break;
+        case 7:					/* checksum */
+            if (csum & 0377)
+                fprintf(stderr, "%s: bad checksum at offset %lu\n",
+                        filename, (unsigned long)o);
+            csum = state = 0;
+            break;
+        }
+    }
+
+    fprintf(stderr, "%s: no end block\n", filename);
+
+done:
+    load_image(ld, lo, hi);
+    return 0;
+}
+
+/* returns -1, having said why, if the file can't be loaded */
+int load_file(char *filename, struct load *ld)
+{
+    char *s = suffix(filename);
+
+    memset(ld, 0, sizeof(*ld));
+    ld->start = -1;
+    ld->sp = -1;
+    memset(image, 0, sizeof(image));
+
+    if (strcasecmp(s, "mem") == 0)
+        return load_mem(filename, ld);
+    if (strcasecmp(s, "sav") == 0)
+        return load_sav(filename, ld);
+    return load_tape(filename, ld);
+}
+
+void load_done(struct load *ld)
+{
+    if (ld->map)
+        munmap(ld->map, ld->map_len);
+    ld->map = NULL;
+}
+
+
+/*
+ * Local Variables:
+ * indent-tabs-mode:nil
+ * c-basic-offset:4
+ * End:
+*/
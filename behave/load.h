@@ -0,0 +1,16 @@
+/* load.h */
+
+/* a program image, ready to copy into memory in one go */
+struct load {
+    u16 *data;
+    u22 addr;			/* where data[0] goes */
+    int words;
+    int start;			/* -1 if the file gives none */
+    int sp;			/* -1 if the file gives none */
+
+    void *map;			/* the file, if mapped */
+    size_t map_len;
+};
+
+int load_file(char *filename, struct load *ld);
+void load_done(struct load *ld);
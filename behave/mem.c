@@ -3,10 +3,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
 
 #include "cpu.h"
 #include "mem.h"
 #include "support.h"
+#include "debug.h"
+#include "timing.h"
+#include "checkpoint.h"
 
 static u16 *memory;
 static int memory_size;
@@ -36,119 +40,289 @@ raw_write_memory(u22 addr, u16 data)
 int mem_init(void)
 {
     memory_size = 1 * 1024 * 1024;
-    memory = (u16 *)malloc(memory_size);
+    memory = (u16 *)calloc(1, memory_size);
 
     return 0;
 }
 
-#define	CACHE_LINES	32
-#define LINESIZE	8
-#define LINESIZE_LOG2	3
-#define LINESIZE_MASK	0x0000f8
-#define ADDR_MASK	0x3ffff8
+/* copy a program image in; -1 if it doesn't fit */
+int mem_load(u22 addr, u16 *data, int words)
+{
+    if (addr + words*2 > memory_size) {
+        fprintf(stderr, "mem: %d words at %o don't fit in %d bytes\n",
+                words, addr, memory_size);
+        return -1;
+    }
+
+    memcpy(&memory[addr/2], data, words*2);
+    return 0;
+}
 
-struct cache_s {
-    int flags;
-#define C_FILLED 0x1
-#define C_DIRTY	 0x2
+/*
+ * cache model.  it keeps only tags, to count the hits and misses a
+ * cache in front of bus.v would see; memory[] still holds the data, so
+ * the cosim is unaffected.  configured with cache_config(), off until
+ * then.  write-back caches allocate on a write miss, write-through
+ * ones do not.
+ */
+enum { CP_LRU, CP_FIFO, CP_RANDOM };
+
+static struct {
+    int size;			/* bytes; 0 is off */
+    int ways;
+    int line;			/* bytes */
+    int write_back;
+    int policy;
+    int sets;
+} cc;
+
+struct cline {
     u22 tag;
-    u16 data[LINESIZE/2];
-} cache[CACHE_LINES];
+    int valid, dirty;
+    unsigned long long stamp;	/* last use (lru) or fill (fifo) */
+};
+
+struct cstats {
+    unsigned long long reads, read_hits;
+    unsigned long long writes, write_hits;
+};
+
+static struct cline *clines;
+static struct cstats cstats[CL_NUM];
+static unsigned long long cache_clock;
+static unsigned long long cache_fills, cache_writebacks, cache_writethrus;
+
+static char *class_names[CL_NUM] = {
+    "?", "single", "single b", "double", "double b",
+    "misc", "control", "cc", "fetch", "trap"
+};
+
+static int is_pow2(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
 
-void flush_line(int line)
+/*
+ * opts is a comma separated list of
+ *	size=N[k]  ways=N  line=N  wb|wt  lru|fifo|random
+ * returns -1 on a bad option or geometry
+ */
+int cache_config(char *opts)
 {
-    if (cache[line].flags & C_DIRTY) {
-        int i;
-        for (i = 0; i < LINESIZE/2; i++) {
-            memory[ cache[line].tag + i ] = cache[line].data[i];
+    char buf[256], *o, *v;
+    int n;
+
+    cc.size = 8192;
+    cc.ways = 1;
+    cc.line = 16;
+    cc.write_back = 1;
+    cc.policy = CP_LRU;
+
+    strncpy(buf, opts, sizeof(buf)-1);
+    buf[sizeof(buf)-1] = 0;
+
+    for (o = strtok(buf, ","); o; o = strtok(NULL, ",")) {
+        if ((v = strchr(o, '=')) != NULL) {
+            *v++ = 0;
+            n = strtol(v, &v, 0);
+            if (*v == 'k' || *v == 'K')
+                n *= 1024;
+        }
+
+        if (strcmp(o, "size") == 0) cc.size = n;
+        else if (strcmp(o, "ways") == 0) cc.ways = n;
+        else if (strcmp(o, "line") == 0) cc.line = n;
+        else if (strcmp(o, "wb") == 0) cc.write_back = 1;
+        else if (strcmp(o, "wt") == 0) cc.write_back = 0;
+        else if (strcmp(o, "lru") == 0) cc.policy = CP_LRU;
+        else if (strcmp(o, "fifo") == 0) cc.policy = CP_FIFO;
+        else if (strcmp(o, "random") == 0) cc.policy = CP_RANDOM;
+        else {
+            fprintf(stderr, "cache: unknown option %s\n", o);
+            cc.size = 0;
+            return -1;
         }
     }
-    cache[line].tag = 0;
-    cache[line].flags = 0;
+
+    if (!is_pow2(cc.line) || cc.line < 2 || !is_pow2(cc.ways) ||
+        !is_pow2(cc.size) || cc.size < cc.line * cc.ways)
+    {
+        fprintf(stderr, "cache: bad geometry; size %d, ways %d, line %d\n",
+                cc.size, cc.ways, cc.line);
+        cc.size = 0;
+        return -1;
+    }
+
+    cc.sets = cc.size / (cc.line * cc.ways);
+    clines = (struct cline *)calloc(cc.sets * cc.ways, sizeof(struct cline));
+    return 0;
 }
 
-void fill_line(int line, u22 addr)
+/* one word or byte access to memory */
+static void cache_access(u22 addr, int write)
 {
-    int i;
-    printf("cache: fill line %d @ %08x\n", line, cache[line].tag);
-    for (i = 0; i < LINESIZE/2; i++) {
-        cache[line].data[i] = memory[ cache[line].tag + i ];
+    struct cline *set, *l, *victim;
+    struct cstats *st;
+    u22 tag;
+    int i, hit;
+
+    if (cc.size == 0)
+        return;
+
+    st = &cstats[cpu_access_class()];
+    tag = addr / cc.line;
+    set = &clines[(tag % cc.sets) * cc.ways];
+    cache_clock++;
+
+    hit = 0;
+    victim = NULL;
+    for (i = 0; i < cc.ways; i++) {
+        l = &set[i];
+        if (l->valid && l->tag == tag) {
+            hit = 1;
+            break;
+        }
+        if (victim == NULL || !l->valid ||
+            (victim->valid && l->stamp < victim->stamp))
+            victim = l;
+    }
+
+    if (write) {
+        st->writes++;
+        st->write_hits += hit;
+    } else {
+        st->reads++;
+        st->read_hits += hit;
     }
-    cache[line].flags = C_FILLED;
-    cache[line].tag = addr & ADDR_MASK;
+
+    if (!hit) {
+        /* write-through does not allocate on a write */
+        if (write && !cc.write_back) {
+            cache_writethrus++;
+            return;
+        }
+
+        if (cc.policy == CP_RANDOM && victim->valid)
+            victim = &set[rand() % cc.ways];
+        if (victim->valid && victim->dirty)
+            cache_writebacks++;
+
+        l = victim;
+        l->tag = tag;
+        l->valid = 1;
+        l->dirty = 0;
+        l->stamp = cache_clock;
+        cache_fills++;
+    } else if (cc.policy == CP_LRU)
+        l->stamp = cache_clock;
+
+    if (write) {
+        if (cc.write_back)
+            l->dirty = 1;
+        else
+            cache_writethrus++;
+    }
+
+    V_BUS printf("cache: %s %o %s\n",
+                 write ? "write" : "read", addr, hit ? "hit" : "miss");
+}
+
+static void pct(unsigned long long n, unsigned long long d)
+{
+    if (d)
+        printf(" %6.2f%%", 100.0 * n / d);
+    else
+        printf("       -");
+}
+
+void cache_report(void)
+{
+    struct cstats t, *st;
+    int c;
+
+    if (cc.size == 0)
+        return;
+
+    printf("cache: %d bytes, %d way, %d byte lines, %s, %s\n",
+           cc.size, cc.ways, cc.line,
+           cc.write_back ? "write-back" : "write-through",
+           cc.policy == CP_LRU ? "lru" :
+           cc.policy == CP_FIFO ? "fifo" : "random");
+    printf("class          reads   hit%%      writes   hit%%\n");
+
+    memset(&t, 0, sizeof(t));
+    for (c = 0; c < CL_NUM; c++) {
+        st = &cstats[c];
+        if (st->reads + st->writes == 0)
+            continue;
+        printf("%-8s %11llu", class_names[c], st->reads);
+        pct(st->read_hits, st->reads);
+        printf(" %11llu", st->writes);
+        pct(st->write_hits, st->writes);
+        printf("\n");
+
+        t.reads += st->reads;
+        t.read_hits += st->read_hits;
+        t.writes += st->writes;
+        t.write_hits += st->write_hits;
+    }
+
+    printf("%-8s %11llu", "total", t.reads);
+    pct(t.read_hits, t.reads);
+    printf(" %11llu", t.writes);
+    pct(t.write_hits, t.writes);
+    printf("\n");
+    printf("cache: %llu line fills, %llu write-backs, %llu write-throughs\n",
+           cache_fills, cache_writebacks, cache_writethrus);
 }
 
 u16 read_mem(u22 addr)
 {
     u16 data;
 
+    timing_bus(addr, 0, 0, 0);
+
     if (addr >= IOPAGEBASE) {
         data = io_read(addr);
         rtl_record_io_read_word(addr, data);
         return data;
     }
 
-#if 1
     if (addr/2 > memory_size) {
         rtl_record_mem_read_word(addr, 0);
         return 0/*0xffff*/;
     }
 
+    cache_access(addr, 0);
     data = memory[addr/2];
     rtl_record_mem_read_word(addr, data);
     return data;
-#else
-    unsigned int line, off;
-
-    line = (addr & LINESIZE_MASK) >> LINESIZE_LOG2;
-    off = addr & ~ADDR_MASK;
-    if (cache[line].tag != (addr & ADDR_MASK) ||
-        !(cache[line].flags & C_FILLED))
-    {
-        flush_line(line);
-        fill_line(line, addr);
-    }
-
-    printf("cache: hit %08x, line %d\n", addr, line);
-    return cache[line].data[off];
-#endif
 }
 
 void write_mem(u22 addr, u16 data)
 {
+    timing_bus(addr, data, 1, 0);
+
     if (addr >= IOPAGEBASE) {
         rtl_record_io_write_word(addr, data);
         return io_write(addr, data, 0);
     }
 
-#if 1
     rtl_record_mem_write_word(addr, data);
 
     if (addr/2 > memory_size)
         return;
 
+    cache_access(addr, 1);
     memory[addr/2] = data;
-#else
-    unsigned int line, off;
-
-    line = (addr & LINESIZE_MASK) >> LINESIZE_LOG2;
-    off = addr & ~ADDR_MASK;
-    if (cache[line].tag != (addr & ADDR_MASK) ||
-        !(cache[line].flags & C_FILLED))
-    {
-        flush_line(line);
-        fill_line(line, addr);
-    }
-
-    cache[line].data[off] = data;
-    cache[line].flags |= C_DIRTY;
-#endif    
 }
 
 u16 read_mem_byte(u22 addr)
 {
     u16 data;
 
+    timing_bus(addr, 0, 0, 1);
+
     if (addr >= IOPAGEBASE) {
         data = io_read(addr);
         if (addr & 1)
@@ -159,6 +333,8 @@ u16 read_mem_byte(u22 addr)
         return data;
     }
 
+    cache_access(addr, 0);
+
     if (addr & 1) {
         data = raw_read_memory(addr) >> 8;
         rtl_record_mem_read_byte(addr, data);
@@ -172,11 +348,15 @@ u16 read_mem_byte(u22 addr)
 
 void write_mem_byte(u22 addr, u16 data)
 {
+    timing_bus(addr, data, 1, 1);
+
     if (addr >= IOPAGEBASE) {
         rtl_record_io_write_byte(addr, data & 0xff);
         return io_write(addr, data, 1);
     }
 
+    cache_access(addr, 1);
+
     if (addr & 1) {
         rtl_record_mem_write_byte(addr, data & 0xff);
         raw_write_memory(addr, (raw_read_memory(addr) & 0xff) | (data << 8));
@@ -186,6 +366,47 @@ void write_mem_byte(u22 addr, u16 data)
     }
 }
 
+/* memory and the cache model, for cosim checkpoints */
+static u16 *memory_saved[NCKPT];
+static struct cline *clines_saved[NCKPT];
+static struct cstats cstats_saved[NCKPT][CL_NUM];
+static unsigned long long cache_saved[NCKPT][4];
+
+void mem_checkpoint(int slot, int restore)
+{
+    int n = cc.sets * cc.ways * sizeof(struct cline);
+    unsigned long long *cs = cache_saved[slot];
+
+    if (memory_saved[slot] == NULL)
+        memory_saved[slot] = (u16 *)malloc(memory_size);
+    if (clines_saved[slot] == NULL && n)
+        clines_saved[slot] = (struct cline *)malloc(n);
+    if (memory_saved[slot] == NULL || (n && clines_saved[slot] == NULL)) {
+        fprintf(stderr, "mem: no memory for checkpoint %d\n", slot);
+        exit(1);
+    }
+
+    if (restore) {
+        memcpy(memory, memory_saved[slot], memory_size);
+        if (n)
+            memcpy(clines, clines_saved[slot], n);
+        memcpy(cstats, cstats_saved[slot], sizeof(cstats));
+        cache_clock = cs[0];
+        cache_fills = cs[1];
+        cache_writebacks = cs[2];
+        cache_writethrus = cs[3];
+    } else {
+        memcpy(memory_saved[slot], memory, memory_size);
+        if (n)
+            memcpy(clines_saved[slot], clines, n);
+        memcpy(cstats_saved[slot], cstats, sizeof(cstats));
+        cs[0] = cache_clock;
+        cs[1] = cache_fills;
+        cs[2] = cache_writebacks;
+        cs[3] = cache_writethrus;
+    }
+}
+
 
 
 
@@ -4,7 +4,18 @@
 /* read with byte address */
 u16 read_mem(u22 addr);
 void write_mem(u22 addr, u16 data);
+int mem_load(u22 addr, u16 *data, int words);
 
 /* for debug only */
 u16 raw_read_memory(u22 addr);
 void raw_write_memory(u22 addr, u16 data);
+
+/* cache model; access classes are the isn.h I_xx types and these */
+#define CL_FETCH	8
+#define CL_TRAP		9
+#define CL_NUM		10
+
+int cache_config(char *opts);
+void cache_report(void);
+int cpu_access_class(void);
+int isn_class(u16 inst);		/* dis.c */
@@ -4,6 +4,7 @@
 
 #include "cpu.h"
 #include "support.h"
+#include "debug.h"
 
 #if 0
 static u16 rkds;
@@ -81,7 +82,7 @@ static int rkintq;
 
 u16 io_rk_read(u22 addr)
 {
-    printf("io_rk_read %o decode %o\n", addr, ((addr >> 1) & 07));
+    V_DEV printf("io_rk_read %o decode %o\n", addr, ((addr >> 1) & 07));
 
     switch ((addr >> 1) & 07) {			/* decode PA<3:1> */
 
@@ -126,7 +127,7 @@ u16 io_rk_read(u22 addr)
 
 static void rk_set_done(int error)
 {
-    if (1) printf("rk: done; error %o\n", error);
+    V_DEV printf("rk: done; error %o\n", error);
 
     rkcs |= CSR_DONE;
     if (error != 0) {
@@ -148,7 +149,7 @@ static void rk_set_done(int error)
 
 static void rk_clr_done(void)
 {
-    if (1) printf("rk: not done\n");
+    V_DEV printf("rk: not done\n");
 
     rkcs &= ~CSR_DONE;
     rkintq &= ~1;
@@ -162,7 +163,7 @@ void rk_service(void)
     unsigned int ma;
     unsigned short comp;
 
-    printf("rk_service; func %o\n", rk_func);
+    V_DEV printf("rk_service; func %o\n", rk_func);
 
     if (rk_func == RKCS_SEEK) {
         rkcs |= RKCS_SCP;
@@ -202,7 +203,7 @@ void rk_service(void)
 //        rker |= RKER_OVR;
 //    }
 
-    printf("rk: seek %d\n", da * sizeof(short));
+    V_DEV printf("rk: seek %d\n", da * sizeof(short));
     err = lseek(rk_fd, da * sizeof(short), SEEK_SET);
     if (wc && (err >= 0)) {
         err = 0;
@@ -221,9 +222,9 @@ void rk_service(void)
                     cda = cda + 256;
                 }
             } else {
-printf("rk: read() wc %d\n", wc);
+V_DEV printf("rk: read() wc %d\n", wc);
                 i = read(rk_fd, rkxb, sizeof(short)*wc);
-printf("rk: read() ret %d\n", i);
+V_DEV printf("rk: read() ret %d\n", i);
                 if (i >= 0 && i < sizeof(short)*wc) {
                     i /= 2;
                     for (; i < wc; i++)
@@ -235,8 +236,8 @@ printf("rk: read() ret %d\n", i);
                 raw_write_memory(ma, rkxb[wc - 1]);
             } else {
 int oldma = ma;
-printf("rk: read(), dma wc=%d, ma=%o\n", wc, ma);
-printf("rk: buffer %06o %06o %06o %06o\n",
+V_DEV printf("rk: read(), dma wc=%d, ma=%o\n", wc, ma);
+V_DEV printf("rk: buffer %06o %06o %06o %06o\n",
        rkxb[0], rkxb[1], rkxb[2], rkxb[3]);
                 for (i = 0; i < wc; i++) {
                     raw_write_memory(ma, rkxb[i]);
@@ -259,7 +260,7 @@ show(oldma);
             }
 
             awc = (wc + (256 - 1)) & ~(256 - 1);
-printf("rk: write()\n");
+V_DEV printf("rk: write()\n");
             write(rk_fd, rkxb, awc*2);
             break;
 
@@ -319,7 +320,7 @@ printf("rk: write()\n");
 
 static void rk_go(void)
 {
-    printf("rk_go!\n");
+    V_DEV printf("rk_go!\n");
 
     rk_func = (rkcs >> 1) & 7;
     if (rk_func == RKCS_CTLRESET) {
@@ -383,12 +384,12 @@ static void rk_go(void)
 
 void io_rk_write(u22 addr, u16 data, int writeb)
 {
-    printf("io_rk_write %o decode %o\n", addr, ((addr >> 1) & 07));
+    V_DEV printf("io_rk_write %o decode %o\n", addr, ((addr >> 1) & 07));
 
     switch ((addr >> 1) & 07) {			/* decode PA<3:1> */
 
     case 2:						/* RKCS */
-        printf("rk: rkcs <- %o\n", data);
+        V_DEV printf("rk: rkcs <- %o\n", data);
         if (writeb) {
             data = (addr & 1)? (rkcs & 0377) |
                 (data << 8): (rkcs & ~0377) | data;
@@ -413,7 +414,7 @@ void io_rk_write(u22 addr, u16 data, int writeb)
                 (rkwc & ~0377) | data;
         }
         rkwc = data;
-        printf("rk: rkwc <- %o\n", rkwc);
+        V_DEV printf("rk: rkwc <- %o\n", rkwc);
         return;
 
     case 4:						/* RKBA */
@@ -423,7 +424,7 @@ void io_rk_write(u22 addr, u16 data, int writeb)
                 (rkba & ~0377) | data;
         }
         rkba = data;
-        printf("rk: rkba <- %o\n", rkba);
+        V_DEV printf("rk: rkba <- %o\n", rkba);
         return;
 
     case 5:						/* RKDA */
@@ -435,11 +436,11 @@ void io_rk_write(u22 addr, u16 data, int writeb)
                 (rkda & ~0377) | data;
         }
         rkda = data;
-        printf("rk: rkda <- %o\n", rkda);
+        V_DEV printf("rk: rkda <- %o\n", rkda);
         return;
 
     default:
-        printf("rk: ??\n");
+        V_DEV printf("rk: ??\n");
         return;
     }
 }
@@ -1,14 +1,43 @@
 /* run.c */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
 #include "cpu.h"
+#include "mem.h"
+#include "timing.h"
 #include "debug.h"
+#include "compare.h"
+#include "checkpoint.h"
+#include "load.h"
 
 int verbose;
 int boot;
+char *load_name;			/* program image to run, -l */
+int start_pc = -1;			/* -g */
+char *ring_file = "behave.ring";
+#ifdef FAST
+int pipelined = 1;
+#else
+int pipelined = 0;
+#endif
+int ckpt_interval = 10000;		/* cosim points; 0 for none */
+int clk_interval = 10000;		/* line clock, cosim points; 0 for none */
 
 #define SIMH_COSIM
 
+/* simh entry points, from scp.h and scp.c */
+typedef struct sim_snap SIM_SNAP;
+SIM_SNAP *simh_snapshot(void);
+int simh_restore(SIM_SNAP *sp);
+void sim_snap_free(SIM_SNAP *sp);
+void simh_load_mem(int addr, unsigned short *data, int words);
+int simh_run_until(int pc, int max);
+int sim_os_poll_out(void);		/* sim_console.h */
+void clk_tick(void);			/* pdp11_stddev.c */
+void io_clk_tick(void);			/* private_stddev.c */
+
 u16 test1[] = {
     000500, 0012706,
     000502, 0000500,
@@ -372,14 +401,44 @@ write_test_code(int addr, unsigned code)
 #endif
 }
 
+/* load a program image into both sides; returns the start address */
+int
+load_program(char *filename, int *psp)
+{
+    struct load ld;
+
+    if (load_file(filename, &ld) || mem_load(ld.addr, ld.data, ld.words)) {
+        load_done(&ld);
+        exit(1);
+    }
+#ifdef SIMH_COSIM
+    simh_load_mem(ld.addr, ld.data, ld.words);
+#endif
+
+    printf("%s: %d words at %o", filename, ld.words, ld.addr);
+    if (ld.start >= 0)
+        printf(", start %o", ld.start);
+    printf("\n");
+
+    load_done(&ld);
+    *psp = ld.sp;
+    return ld.start;
+}
+
 void
 fill_test_code(int testnum)
 {
     int i, j;
     unsigned short pc;
     unsigned int addr;
+    int sp = -1;
 
-    if (!boot) {
+    if (load_name) {
+        i = load_program(load_name, &sp);
+        pc = i >= 0 ? i : 0500;
+    }
+
+    if (!boot && !load_name) {
         for (i = 0; tests[i].ttype; i++) {
             if (tests[i].num == testnum) {
                 u16 *cp = tests[i].code;
@@ -422,8 +481,15 @@ fill_test_code(int testnum)
         pc = 02002;
     }
 
+    if (start_pc >= 0)
+        pc = start_pc;
+
     debug_reset();
     debug_set_pc(pc);
+    if (sp >= 0) {
+        extern u16 regs[8];
+        regs[6] = sp;
+    }
 
 #ifdef SIMH_COSIM
     simh_set_pc(pc);
@@ -435,7 +501,402 @@ fill_test_code(int testnum)
 #endif
 }
 
+static int ring_written;
+static volatile int cosim_stop;
+static unsigned long long cosim_seq;	/* cosim points so far */
+static unsigned long long diverged_at;
+static unsigned long long replay_end;	/* nonzero while replaying */
+
+/* first divergence; keep the states that led up to it */
+void
+cosim_diverged(void)
+{
+    if (!diverged_at)
+        diverged_at = cosim_seq;
+
+    /* with checkpoints, stop here and replay the interval */
+    if (ckpt_interval)
+        cosim_stop = 1;
+
+    if (!ring_written) {
+        ring_written = 1;
+        state_ring_write(ring_file);
+        report_rate();
+    }
+}
+
 #ifdef SIMH_COSIM
+//#define PSW_CHECK_MASK 0xf
+#define PSW_CHECK_MASK 0xffff
+
+/* compare the architected state; returns nonzero if it disagrees */
+static int
+compare_state(u16 *rregs, u16 rpsw, u16 *sregs, u16 spsw)
+{
+    int i, bad = 0;
+
+    if ((rpsw & PSW_CHECK_MASK) != (spsw & PSW_CHECK_MASK)) {
+        printf("psw disagrees: rtl %o, simh %o\n", rpsw, spsw);
+        bad++;
+    }
+
+    for (i = 0; i < 8; i++) {
+        if (rregs[i] != sregs[i]) {
+            printf("R%d disagree; rtl %06o simh %06o\n",
+                   i, rregs[i], sregs[i]);
+            bad++;
+        }
+    }
+
+    return bad;
+}
+
+/*
+ * pipelined cosim.  the model runs on the main thread and publishes a
+ * record for each retired instruction (or trap resync point); a simh
+ * thread replays the records one at a time against simh and publishes
+ * its own, and a comparator thread checks the two.
+ *
+ * both queues are lock free rings.  the model queue has one producer
+ * and two in-order consumers: simh advances tail as it replays a
+ * record, the comparator advances done once it has checked it, and
+ * only then may the model reuse the slot.  the model runs ahead until
+ * the ring is full, and stops when the comparator reports a divergence.
+ */
+#define CQ_SIZE	1024
+
+enum { CQ_STEP = 1, CQ_SYNC, CQ_CKPT, CQ_END };
+
+struct crec {
+    int kind;
+    unsigned long long seq;		/* instruction number */
+    int slot;				/* CQ_CKPT */
+    u16 regs[8];
+    u16 psw;
+    struct tsum ts;
+};
+
+struct cq {
+    volatile unsigned int head;		/* producer */
+    volatile unsigned int tail;		/* consumer */
+    volatile unsigned int done;		/* comparator; model queue only */
+    struct crec rec[CQ_SIZE];
+};
+
+static struct cq mq, sq;
+static pthread_t simh_thread, compare_thread;
+static int cosim_running;
+
+static void cosim_publish(int kind, int slot);
+
+/*
+ * checkpoints.  every ckpt_interval cosim points both sides are saved
+ * at the same instruction boundary, alternating between NCKPT slots;
+ * the model side by the model, the simh side when simh gets there,
+ * which in the pipelined cosim is later, on the simh thread.  on a
+ * divergence cosim_replay() restores the newest slot that both sides
+ * reached before the failing instruction and reruns only from there,
+ * serially and with full tracing.
+ */
+struct ckpt {
+    unsigned long long seq;		/* model side; 0 if empty */
+    volatile unsigned long long simh_seq;
+    SIM_SNAP *simh;
+};
+
+static struct ckpt ckpts[NCKPT];
+static int ckpt_next;
+
+static void
+ckpt_simh(int slot, unsigned long long seq)
+{
+    struct ckpt *c = &ckpts[slot];
+
+    if (c->simh)
+        sim_snap_free(c->simh);
+    c->simh = simh_snapshot();
+    private_stddev_save(0, slot);
+    private_rk_save(0, slot);
+    c->simh_seq = seq;
+}
+
+static void
+ckpt_maybe(void)
+{
+    static unsigned long long last;
+    int slot;
+
+    if (!ckpt_interval || replay_end || cosim_seq - last < ckpt_interval)
+        return;
+    last = cosim_seq;
+
+    slot = ckpt_next;
+    ckpt_next = (ckpt_next + 1) % NCKPT;
+
+    ckpts[slot].seq = cosim_seq;
+    cpu_checkpoint(slot, 0);
+    mem_checkpoint(slot, 0);
+    support_checkpoint(slot, 0);
+    timing_checkpoint(slot, 0);
+
+    if (pipelined)
+        cosim_publish(CQ_CKPT, slot);
+    else
+        ckpt_simh(slot, cosim_seq);
+}
+
+/* count a cosim point; nonzero if a replay has gone past its end */
+static int
+cosim_next(void)
+{
+    cosim_seq++;
+
+    if (replay_end && cosim_seq > replay_end) {
+        printf("cosim: replay passed instruction %llu without diverging\n",
+               replay_end);
+        cosim_stop = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* after run() stops on a divergence; nonzero if it should run again */
+int
+cosim_replay(void)
+{
+    extern int show_i, show_m;
+    struct ckpt *c;
+    int i, slot;
+
+    if (!ckpt_interval || !diverged_at || replay_end)
+        return 0;
+
+    slot = -1;
+    for (i = 0; i < NCKPT; i++) {
+        c = &ckpts[i];
+        if (c->seq && c->seq == c->simh_seq && c->seq < diverged_at &&
+            (slot < 0 || c->seq > ckpts[slot].seq))
+            slot = i;
+    }
+
+    if (slot < 0) {
+        printf("cosim: no checkpoint before instruction %llu\n",
+               diverged_at);
+        return 0;
+    }
+
+    c = &ckpts[slot];
+    printf("cosim: replaying instructions %llu..%llu\n",
+           c->seq + 1, diverged_at);
+
+    cpu_checkpoint(slot, 1);
+    mem_checkpoint(slot, 1);
+    support_checkpoint(slot, 1);
+    timing_checkpoint(slot, 1);
+    simh_restore(c->simh);
+    private_stddev_restore(0, slot);
+    private_rk_restore(0, slot);
+
+    cosim_seq = c->seq;
+    replay_end = diverged_at;
+    pipelined = 0;
+    cosim_stop = 0;
+    ring_written = 0;
+
+    verbose = 0xffff;
+    show_i = 1;
+    show_m = 1;
+    return 1;
+}
+
+/*
+ * the kw11-l line clock.  simh's ticks on a timer calibrated against
+ * the host clock, and the model's not at all, so in the cosim the
+ * first tick diverged.  instead both sides tick after every
+ * clk_interval cosim points, each at the same instruction boundary;
+ * the model here, simh wherever it has finished that point.
+ */
+static void
+clk_model(void)
+{
+    if (clk_interval && cosim_seq % clk_interval == 0)
+        io_clk_tick();
+}
+
+static void
+clk_simh(unsigned long long seq)
+{
+    if (clk_interval && seq % clk_interval == 0)
+        clk_tick();
+}
+
+static void *
+cosim_simh_loop(void *arg)
+{
+    struct crec *m, *r;
+    int i;
+
+    while (1) {
+        while (mq.tail == mq.head || sq.head - sq.tail >= CQ_SIZE) {
+            if (cosim_stop)
+                return NULL;
+            sched_yield();
+        }
+        __sync_synchronize();
+
+        m = &mq.rec[mq.tail % CQ_SIZE];
+        r = &sq.rec[sq.head % CQ_SIZE];
+        r->kind = m->kind;
+        r->seq = m->seq;
+
+        if (m->kind == CQ_CKPT) {
+            ckpt_simh(m->slot, m->seq);
+        } else if (m->kind != CQ_END) {
+            reset_side(T_SIMH);
+            if (m->kind == CQ_SYNC)
+                simh_run_until(m->regs[7], 10);
+            else
+                simh_step();
+
+            for (i = 0; i < 8; i++)
+                simh_read_reg(i, &r->regs[i]);
+            simh_read_psw(&r->psw);
+            take_transactions(T_SIMH, &r->ts);
+            clk_simh(m->seq);
+        }
+
+        __sync_synchronize();
+        sq.head++;
+        mq.tail++;
+
+        if (m->kind == CQ_END)
+            return NULL;
+    }
+}
+
+static int
+cosim_compare(struct crec *m, struct crec *s)
+{
+    if (m->kind == CQ_SYNC) {
+        if (m->regs[7] == s->regs[7])
+            return 0;
+        printf("simh: trap out of sync; rtl pc %o, simh pc %o\n",
+               m->regs[7], s->regs[7]);
+        return 1;
+    }
+
+    return compare_state(m->regs, m->psw, s->regs, s->psw) +
+        diff_transactions(&s->ts, &m->ts);
+}
+
+static void *
+cosim_compare_loop(void *arg)
+{
+    struct crec *m, *s;
+
+    while (1) {
+        while (sq.tail == sq.head) {
+            if (cosim_stop)
+                return NULL;
+            sched_yield();
+        }
+        __sync_synchronize();
+
+        s = &sq.rec[sq.tail % CQ_SIZE];
+        m = &mq.rec[mq.done % CQ_SIZE];
+        if (s->kind == CQ_END)
+            return NULL;
+
+        if (s->kind != CQ_CKPT && cosim_compare(m, s)) {
+            printf("cosim: diverged at instruction %llu\n", m->seq);
+            diverged_at = m->seq;
+            cosim_stop = 1;
+            return NULL;
+        }
+
+        __sync_synchronize();
+        sq.tail++;
+        mq.done++;
+    }
+}
+
+static void
+cosim_publish(int kind, int slot)
+{
+    extern u16 regs[8];
+    extern u16 psw;
+    struct crec *r;
+    int i;
+
+    while (mq.head - mq.done >= CQ_SIZE) {
+        if (cosim_stop)
+            return;
+        sched_yield();
+    }
+
+    r = &mq.rec[mq.head % CQ_SIZE];
+    r->kind = kind;
+    r->seq = cosim_seq;
+    r->slot = slot;
+    for (i = 0; i < 8; i++)
+        r->regs[i] = regs[i];
+    r->psw = psw;
+    if (kind == CQ_STEP)
+        take_transactions(T_RTL, &r->ts);
+
+    __sync_synchronize();
+    mq.head++;
+}
+
+/* start of each model instruction */
+void
+cosim_begin(void)
+{
+    if (!pipelined) {
+        reset_transactions();
+        return;
+    }
+
+    if (!cosim_running) {
+        /* the model may be a queue ahead of the comparator; keep the
+           older slot behind any divergence it can find */
+        if (ckpt_interval && ckpt_interval < 2*CQ_SIZE)
+            ckpt_interval = 2*CQ_SIZE;
+
+        cosim_running = 1;
+        pthread_create(&simh_thread, NULL, cosim_simh_loop, NULL);
+        pthread_create(&compare_thread, NULL, cosim_compare_loop, NULL);
+    }
+
+    reset_side(T_RTL);
+}
+
+int
+cosim_stopped(void)
+{
+    return cosim_stop;
+}
+
+/* drain the queues; returns nonzero if the cosim diverged */
+int
+cosim_end(void)
+{
+    if (!cosim_running)
+        return cosim_stop;
+
+    if (!cosim_stop)
+        cosim_publish(CQ_END, 0);
+    pthread_join(simh_thread, NULL);
+    pthread_join(compare_thread, NULL);
+    cosim_running = 0;
+
+    if (cosim_stop) {
+        printf("cosim: model stopped at instruction %llu\n", cosim_seq);
+        cosim_diverged();
+    }
+    return cosim_stop;
+}
+
 void
 cosim_check()
 {
@@ -445,63 +906,97 @@ cosim_check()
     unsigned short spsw;
     extern u16 psw;
 
+    if (cosim_next())
+        return;
+
+    /* neither side may wait on the keyboard; show held console output */
+    if ((cosim_seq & 1023) == 0)
+        sim_os_poll_out();
+
+    clk_model();
+
+    if (pipelined) {
+        cosim_publish(CQ_STEP, 0);
+        ckpt_maybe();
+        return;
+    }
+
     V_SIMH printf("simh step\n");
 
     simh_step();
 
     simh_read_psw(&spsw);
+    for (i = 0; i < 8; i++)
+        simh_read_reg(i, &simh_regs[i]);
 
-//#define PSW_CHECK_MASK 0xf
-#define PSW_CHECK_MASK 0xffff
-
-    if ((psw & PSW_CHECK_MASK) != (spsw & PSW_CHECK_MASK)) {
-        printf("psw disagrees: rtl %o, simh %o\n", psw, spsw);
-    }
+    if (compare_state(regs, psw, simh_regs, spsw))
+        cosim_diverged();
 
-    for (i = 0; i < 8; i++) {
-        simh_read_reg(i, &simh_regs[i]);
-        if (regs[i] != simh_regs[i])
-            printf("R%d disagree; rtl %06o simh %06o\n",
-                   i, regs[i], simh_regs[i]);
-    }
+    check_transactions();
+    clk_simh(cosim_seq);
 
+    if (!cosim_stop)
+        ckpt_maybe();
 }
 
 void cosim_trap(void)
 {
-    int i;
     unsigned short pc;
     extern u16 regs[8];
-    int steps = 0;
 
-    simh_read_reg(7, &pc);
-    V_SIMH printf("simh step; rtl @ %o, simh @ %o\n", regs[7], pc);
+    if (cosim_next())
+        return;
 
-    for (i = 0; i < 10; i++) {
-        steps++;
-        simh_step();
-        simh_read_reg(7, &pc);
-        if (1) printf("syncing: simh pc %o, rtl pc %o\n", pc, regs[7]);
+    clk_model();
 
-        if (pc == regs[7]) {
-            V_SIMH printf("simh: traps sync after %d steps\n", steps);
-            break;
-        }
+    if (pipelined) {
+        cosim_publish(CQ_SYNC, 0);
+        return;
     }
 
-    if (i == 10) {
+    simh_read_reg(7, &pc);
+    V_SIMH printf("simh step; rtl @ %o, simh @ %o\n", regs[7], pc);
+
+    /* one trip into simh, stopping at the rtl pc or after 10 steps */
+    simh_run_until(regs[7], 10);
+    simh_read_reg(7, &pc);
+    V_SIMH printf("syncing: simh pc %o, rtl pc %o\n", pc, regs[7]);
+
+    if (pc == regs[7]) {
+        V_SIMH printf("simh: traps sync\n");
+    } else {
         printf("simh: trap out of sync\n");
+        cosim_diverged();
     }
+
+    clk_simh(cosim_seq);
 }
 
 void
 cosim_setup(void)
 {
 	simh_init();
+#ifdef FAST
+	{
+	    extern int show_i, show_m;
+	    show_i = 0;			/* no simh tracing either */
+	    show_m = 0;
+	}
+#endif
 //	simh_command("set cpu 11/44");
 	simh_command("set cpu 11/34");
 	simh_command("set cpu 256k");
-        simh_command("att rk0 rk.dsk");
+        {
+            extern char *private_rk_image;
+            char cmd[256];
+
+            snprintf(cmd, sizeof(cmd), "att rk0 %s", private_rk_image);
+            simh_command(cmd);
+        }
+
+        /* clock ticks come from clk_simh() */
+        if (clk_interval)
+            simh_command("deposit clk ext 1");
 
         if (1) {
             simh_command("set RHA disabled");
@@ -517,12 +1012,18 @@ cosim_setup(void)
             simh_command("set RQ disabled");
             simh_command("set TM disabled");
             simh_command("set TQ disabled");
+            simh_command("set PTR disabled");
+            simh_command("set PTP disabled");
         }
 }
 #else
 void cosim_setup(void) {}
+void cosim_begin(void) {}
 void cosim_check(void) {}
 void cosim_trap(void) {}
+int cosim_stopped(void) { return 0; }
+int cosim_end(void) { return 0; }
+int cosim_replay(void) { return 0; }
 #endif
 
 
@@ -536,14 +1037,51 @@ main(int argc, char *argv[])
     test_no = 1;
     verbose = 0xffff;
 
-    while ((c = getopt(argc, argv, "bv:t:")) != -1) {
+    while ((c = getopt(argc, argv, "bc:C:g:k:l:L:psv:t:T:r:R:")) != -1) {
         switch (c) {
         case 'b':
             boot = 1;
             break;
+        case 'c':
+            ckpt_interval = atoi(optarg);
+            break;
+        case 'C':
+            if (cache_config(optarg))
+                exit(1);
+            break;
+        case 'g':
+            start_pc = strtol(optarg, NULL, 8);
+            break;
+        case 'k':
+            {
+                extern char *private_rk_image;
+                private_rk_image = optarg;
+            }
+            break;
+        case 'l':
+            load_name = optarg;
+            break;
+        case 'L':
+            clk_interval = atoi(optarg);
+            break;
+        case 'p':
+            pipelined = 1;
+            break;
+        case 's':
+            pipelined = 0;
+            break;
+        case 'r':
+            ring_file = optarg;
+            break;
+        case 'R':
+            exit(state_ring_print(optarg, 0) ? 1 : 0);
         case 't':
             test_no = atoi(optarg);
             break;
+        case 'T':
+            if (timing_config(optarg))
+                exit(1);
+            break;
         case 'v':
             verbose = atoi(optarg);
             break;
@@ -557,6 +1095,22 @@ main(int argc, char *argv[])
     reset_support();
     run();
 
+    /* rerun the failing interval from the last good checkpoint */
+    if (cosim_replay()) {
+#ifdef FAST
+        /* no tracing compiled in; the state ring is the trace */
+        unsigned long long first = state_ring_count();
+
+        run();
+        state_ring_print(ring_file, first);
+#else
+        run();
+#endif
+    }
+
+    cache_report();
+    timing_report();
+
     printf("done!\n");
 }
 
@@ -4,6 +4,8 @@
 
 #include "cpu.h"
 #include "support.h"
+#include "debug.h"
+#include "checkpoint.h"
 
 int support_int_bits;
 
@@ -18,7 +20,7 @@ void support_clear_int_bits(void)
 
 void cpu_int_set(int bit)
 {
-    printf("cpu_int_set(%d)\n", bit);
+    V_DEV printf("cpu_int_set(%d)\n", bit);
 
     support_int_bits |= 1 << bit;
     /* flag cpu here */
@@ -41,14 +43,14 @@ void cpu_int_set(int bit)
     }
 
     if (assert_int_ipl) {
-        printf("cpu_int_set; vector %o,ipl bits 0x%x\n", 
+        V_DEV printf("cpu_int_set; vector %o,ipl bits 0x%x\n", 
                assert_int_vec, assert_int_ipl);
     }
 }
 
 void cpu_int_clear(int bit)
 {
-    printf("cpu_int_clear(%o)\n", bit);
+    V_DEV printf("cpu_int_clear(%o)\n", bit);
 
     support_int_bits &= ~(1 << bit);
     if (support_int_bits == 0)
@@ -77,7 +79,7 @@ static u8 tto_data;
 
 u16 io_tti_read(u22 addr)
 {
-    printf("io_tti_read(%o)\n", addr);
+    V_DEV printf("io_tti_read(%o)\n", addr);
     if (addr & 2) {
         tti_csr = tti_csr & ~CSR_DONE;
         cpu_int_clear(1);
@@ -89,7 +91,7 @@ u16 io_tti_read(u22 addr)
 
 void io_tti_write(u22 addr, u16 data)
 {
-    printf("io_tti_write() addr=%o, data=%o\n", addr, data);
+    V_DEV printf("io_tti_write() addr=%o, data=%o\n", addr, data);
     if ((addr & 2) == 0) {
         if (addr & 1)
             return;
@@ -106,7 +108,7 @@ void io_tti_write(u22 addr, u16 data)
 
 u16 io_tto_read(u22 addr)
 {
-    printf("io_tto_read(%o)\n", addr);
+    V_DEV printf("io_tto_read(%o)\n", addr);
     if (addr & 2) {
         return tto_data;
     } else {
@@ -116,7 +118,7 @@ u16 io_tto_read(u22 addr)
 
 void io_tto_write(u22 addr, u16 data)
 {
-    printf("io_tto_write(%o) %o\n", addr, data);
+    V_DEV printf("io_tto_write(%o) %o\n", addr, data);
     if (addr & 2) {
         if ((addr & 1) == 0) {
             printf("TTO %o %c\n", data, data);
@@ -146,14 +148,14 @@ u16 io_sr_read(u22 addr)
 u16 io_psw_read(u22 addr)
 {
     extern u16 psw;
-    printf("psw: read\n");
+    V_DEV printf("psw: read\n");
     return psw;
 }
 
 void io_psw_write(u22 addr, u16 data, int writeb)
 {
     extern u16 psw;
-    printf("psw: write; data %o, writeb %d\n");
+    V_DEV printf("psw: write; data %o, writeb %d\n");
     if (writeb) {
         if (addr & 1)
             psw = (psw & 0xff) | (data << 8);
@@ -161,7 +163,7 @@ void io_psw_write(u22 addr, u16 data, int writeb)
             psw = (psw & 0xff00) | (data & 0xff);
     } else
         psw = data;
-    printf("psw: new %o", psw);
+    V_DEV printf("psw: new %o", psw);
 }
 
 u16 io_clk_read(u22 addr)
@@ -189,7 +191,7 @@ void io_clk_write(u22 addr, u16 data)
 u16 io_pclk_read(u22 addr)
 {
     u16 v;
-printf("io_pclk_read %o\n", addr);
+V_DEV printf("io_pclk_read %o\n", addr);
     switch ((addr >> 1) & 3) {
     case 0:
         v = pclk_csr;
@@ -260,7 +262,7 @@ u16 io_read(u22 addr)
 
 void io_write(u22 addr, u16 data, int writeb)
 {
-    printf("io_write(addr=%o, data=%o, writeb=%d)\n", addr, data, writeb);
+    V_DEV printf("io_write(addr=%o, data=%o, writeb=%d)\n", addr, data, writeb);
 
     if (addr >= IOBASE_TTI && addr < IOBASE_TTI+4) {
 	return io_tti_write(addr, data);
@@ -318,7 +320,7 @@ u16 io_sr_read(u22 addr)
 u16 io_psw_read(u22 addr)
 {
     extern u16 psw;
-    printf("psw: read\n");
+    V_DEV printf("psw: read\n");
     return psw;
 }
 
@@ -326,7 +328,7 @@ void io_psw_write(u22 addr, u16 data, int writeb)
 {
     extern u16 psw;
 
-    printf("psw: write; data %o, writeb %d\n", data, writeb);
+    V_DEV printf("psw: write; data %o, writeb %d\n", data, writeb);
     if (writeb) {
         if (addr & 1)
             psw = (psw & 0xff) | (data << 8);
@@ -334,7 +336,7 @@ void io_psw_write(u22 addr, u16 data, int writeb)
             psw = (psw & 0xff00) | (data & 0xff);
     } else
         psw = data;
-    printf("psw: new %o", psw);
+    V_DEV printf("psw: new %o", psw);
 }
 
 u16 io_read(u22 addr)
@@ -345,7 +347,7 @@ u16 io_read(u22 addr)
     if (addr >= IOBASE_TTO && addr < IOBASE_TTO+4)
 	return io_tto_read(addr);
 
-    if (addr >= IOBASE_CLK && addr < IOBASE_CLK+4)
+    if (addr >= IOBASE_CLK && addr < IOBASE_CLK+2)
 	return io_clk_read(addr);
 
     if (addr >= IOBASE_SR && addr < IOBASE_SR+2)
@@ -376,7 +378,7 @@ u16 io_read(u22 addr)
 
 void io_write(u22 addr, u16 data, int writeb)
 {
-    printf("io_write(addr=%o, data=%o, writeb=%d)\n", addr, data, writeb);
+    V_DEV printf("io_write(addr=%o, data=%o, writeb=%d)\n", addr, data, writeb);
 
     if (addr >= IOBASE_TTI && addr < IOBASE_TTI+4) {
 	io_tti_write(addr, data);
@@ -388,7 +390,7 @@ void io_write(u22 addr, u16 data, int writeb)
         return;
     }
 
-    if (addr >= IOBASE_CLK && addr < IOBASE_CLK+4) {
+    if (addr >= IOBASE_CLK && addr < IOBASE_CLK+2) {
 	io_clk_write(addr, data);
         return;
     }
@@ -421,6 +423,25 @@ void reset_support(void)
 
 #endif
 
+/*
+ * the rtl side of the devices lives in the simh private_* files (context
+ * 1); checkpoint it along with the interrupt bits
+ */
+static int support_int_bits_saved[NCKPT];
+
+void support_checkpoint(int slot, int restore)
+{
+    if (restore) {
+        support_int_bits = support_int_bits_saved[slot];
+        private_stddev_restore(1, slot);
+        private_rk_restore(1, slot);
+    } else {
+        support_int_bits_saved[slot] = support_int_bits;
+        private_stddev_save(1, slot);
+        private_rk_save(1, slot);
+    }
+}
+
 
 /*
  * Local Variables:
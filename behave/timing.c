@@ -0,0 +1,319 @@
+/* timing.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "isn.h"
+#include "support.h"
+#include "timing.h"
+#include "checkpoint.h"
+
+/*
+ * cycle accounting, after the rtl.  the model clocks the same states as
+ * rtl/pdp11.v, one clock each, and these are added:
+ *
+ *  - bus waits.  a state that goes to the bus holds istate until bus_ack;
+ *    bus_rd is registered, bus.v's grant_state goes 0 -> 1, and only then
+ *    does ram_async.v answer (done one clock after rd).  the i/o page acks
+ *    with the grant.  2 waits each by default; see mem= and io=.
+ *  - the rtl's t0 (f1 -> t0 -> t1), which the model skips; cpu.c passes
+ *    it in as extra on t1.
+ *  - e1 holding for mul1616, div3216 and shift32; also from cpu.c.
+ *  - rk transfers.  rk_regs.v drives ide.v, where each ata register or
+ *    data cycle takes ATA_DELAY + 10 clocks, and takes the bus for a dma
+ *    cycle per word when the cpu is next in f1.  the dma clocks are the
+ *    cpu's; the ide clocks overlap it, but the model's rk finishes at
+ *    once, so whatever the cpu would have spun waiting for it is missing.
+ *    both are reported.
+ */
+
+#define OP_TRAP		ISN_NUM		/* trap or interrupt entry */
+#define OP_ILL		(ISN_NUM+1)	/* no such instruction */
+#define OP_NUM		(ISN_NUM+2)
+
+#define RKCS		(IOBASE_RK + 4)
+#define RKWC		(IOBASE_RK + 6)
+
+extern raw_isn_t *isn_decode[];
+
+static struct {
+    int on;
+    double mhz;
+    int mem_wait, io_wait;
+    int ata_delay, dma;
+} tc;
+
+struct opstats {
+    unsigned long long count, cycles;
+};
+
+static struct tstats {
+    unsigned long long cur[TP_NUM];	/* this instruction, by phase */
+    unsigned long long pending;		/* bus waits not yet clocked */
+    unsigned long long phase[TP_NUM];
+    unsigned long long bus_waits;
+    struct opstats ops[OP_NUM];
+    struct opstats src[8], dst[8];	/* s and d states, by mode */
+    unsigned long long isns;
+    unsigned long long dma, ide;
+    unsigned long long rk_xfers, rk_words;
+    u16 rkwc;
+} ts;
+
+static char *phase_names[TP_NUM] = {
+    "fetch", "src", "dst", "exec", "trap", "idle"
+};
+
+/*
+ * opts is a comma separated list of
+ *	mhz=N  mem=N  io=N  ata=N  dma=N
+ * returns -1 on a bad option
+ */
+int timing_config(char *opts)
+{
+    char buf[256], *o, *v;
+    double n;
+
+    tc.mhz = 50;		/* s3board sysclk, undivided */
+    tc.mem_wait = 2;
+    tc.io_wait = 2;
+    tc.ata_delay = 20;		/* ide.v ATA_DELAY */
+    tc.dma = 4;
+
+    strncpy(buf, opts, sizeof(buf)-1);
+    buf[sizeof(buf)-1] = 0;
+
+    for (o = strtok(buf, ","); o; o = strtok(NULL, ",")) {
+        n = 0;
+        if ((v = strchr(o, '=')) != NULL) {
+            *v++ = 0;
+            n = strtod(v, NULL);
+        }
+
+        if (strcmp(o, "mhz") == 0 && n > 0) tc.mhz = n;
+        else if (strcmp(o, "mem") == 0) tc.mem_wait = n;
+        else if (strcmp(o, "io") == 0) tc.io_wait = n;
+        else if (strcmp(o, "ata") == 0) tc.ata_delay = n;
+        else if (strcmp(o, "dma") == 0) tc.dma = n;
+        else if (*o) {
+            fprintf(stderr, "timing: unknown option %s\n", o);
+            return -1;
+        }
+    }
+
+    tc.on = 1;
+    return 0;
+}
+
+/* clocks for an rk command, from the rk_regs.v state machine */
+static void rk_command(int func)
+{
+    unsigned long long ata = tc.ata_delay + 10;
+    unsigned long long words, c;
+
+    words = (0200000 - ts.rkwc) & 0177777;
+    if (words == 0)
+        words = 0200000;
+
+    switch (func) {
+    case 1:					/* write */
+    case 2:					/* read */
+        c = 12*ata + 2;			/* init0-init11, wait0-1 */
+        c += words * (ata + tc.dma);	/* read0/read1, write0/write1 */
+        c += (words - 1) / 256 * 2*ata;	/* init10-11 per sector */
+        if (words % 256)
+            c += (256 - words % 256) * 2*ata;	/* last1-3 flush */
+        c += 2*ata + 2;			/* last0-1, done0-1 */
+        ts.dma += words * tc.dma;
+        ts.rk_words += words;
+        ts.rk_xfers++;
+        break;
+    case 3:					/* write check */
+    case 5:					/* read check */
+        c = ata + 2;
+        break;
+    default:
+        c = 2;
+        break;
+    }
+
+    ts.ide += c;
+}
+
+/* a cpu bus cycle; i/o page writes are watched for rk commands */
+void timing_bus(u22 addr, u16 data, int write, int writeb)
+{
+    if (!tc.on)
+        return;
+
+    if (addr < IOPAGEBASE) {
+        ts.pending += tc.mem_wait;
+        return;
+    }
+
+    ts.pending += tc.io_wait;
+
+    if (!write)
+        return;
+    if (addr == RKWC && !writeb)
+        ts.rkwc = data;
+    if (addr == RKCS && (data & 1))
+        rk_command((data >> 1) & 7);
+}
+
+/* one state clocked, plus any clocks the rtl holds it for */
+void timing_state(int phase, int extra)
+{
+    unsigned long long c;
+
+    if (!tc.on)
+        return;
+
+    c = 1 + extra + ts.pending;
+    ts.bus_waits += ts.pending;
+    ts.pending = 0;
+
+    ts.cur[phase] += c;
+    ts.phase[phase] += c;
+}
+
+/* the instruction is done; charge its clocks to opcode and modes */
+void timing_isn(u16 isn)
+{
+    raw_isn_t *r;
+    unsigned long long c;
+    int op, p;
+
+    if (!tc.on)
+        return;
+
+    r = isn_decode[isn];
+    op = ts.cur[TP_TRAP] ? OP_TRAP : r ? r->isn_num : OP_ILL;
+
+    for (c = 0, p = 0; p < TP_NUM; p++)
+        if (p != TP_IDLE)
+            c += ts.cur[p];
+
+    ts.ops[op].count++;
+    ts.ops[op].cycles += c;
+    if (op != OP_TRAP)
+        ts.isns++;
+
+    if (r && op != OP_TRAP) {
+        if (r->isn_regs == R_SSDD) {
+            ts.src[(isn >> 9) & 7].count++;
+            ts.src[(isn >> 9) & 7].cycles += ts.cur[TP_SRC];
+        }
+        switch (r->isn_regs) {
+        case R_DD: case R_SS: case R_SSDD: case R_RSS: case R_RDD:
+            ts.dst[(isn >> 3) & 7].count++;
+            ts.dst[(isn >> 3) & 7].cycles += ts.cur[TP_DST];
+            break;
+        }
+    }
+
+    memset(ts.cur, 0, sizeof(ts.cur));
+}
+
+static char *op_name(int op)
+{
+    int i;
+
+    if (op == OP_TRAP)
+        return "(trap)";
+    if (op == OP_ILL)
+        return "(illegal)";
+    for (i = 0; i < 0x10000; i++)
+        if (isn_decode[i] && isn_decode[i]->isn_num == op)
+            return isn_decode[i]->isn_name;
+    return "?";
+}
+
+static int by_cycles(const void *a, const void *b)
+{
+    const struct opstats *x = &ts.ops[*(int *)a];
+    const struct opstats *y = &ts.ops[*(int *)b];
+
+    return x->cycles < y->cycles ? 1 : x->cycles > y->cycles ? -1 : 0;
+}
+
+static double ratio(unsigned long long n, unsigned long long d)
+{
+    return d ? (double)n / d : 0;
+}
+
+void timing_report(void)
+{
+    int order[OP_NUM];
+    unsigned long long cpu, wall;
+    struct opstats *o;
+    int i, p;
+
+    if (!tc.on)
+        return;
+
+    for (cpu = 0, p = 0; p < TP_NUM; p++)
+        if (p != TP_IDLE)
+            cpu += ts.phase[p];
+
+    printf("timing: %.1f MHz; ram %d, i/o %d wait states; "
+           "ata delay %d, dma %d\n",
+           tc.mhz, tc.mem_wait, tc.io_wait, tc.ata_delay, tc.dma);
+
+    printf("op              count       cycles     cpi  %%cycles\n");
+    for (i = 0; i < OP_NUM; i++)
+        order[i] = i;
+    qsort(order, OP_NUM, sizeof(order[0]), by_cycles);
+    for (i = 0; i < OP_NUM; i++) {
+        o = &ts.ops[order[i]];
+        if (o->count == 0)
+            continue;
+        printf("%-9s %11llu %12llu %7.2f %7.2f%%\n",
+               op_name(order[i]), o->count, o->cycles,
+               ratio(o->cycles, o->count), 100 * ratio(o->cycles, cpu));
+    }
+
+    printf("mode     src count  cycles/op    dst count  cycles/op\n");
+    for (i = 0; i < 8; i++)
+        printf("%d      %11llu %10.2f %13llu %10.2f\n", i,
+               ts.src[i].count, ratio(ts.src[i].cycles, ts.src[i].count),
+               ts.dst[i].count, ratio(ts.dst[i].cycles, ts.dst[i].count));
+
+    printf("cycles:");
+    for (p = 0; p < TP_NUM; p++)
+        printf(" %s %llu", phase_names[p], ts.phase[p]);
+    printf("; bus waits %llu, dma %llu\n", ts.bus_waits, ts.dma);
+
+    wall = cpu + ts.phase[TP_IDLE] + ts.dma;
+    printf("timing: %llu instructions, %llu cycles, cpi %.2f; "
+           "est. %.2f MIPS\n",
+           ts.isns, wall, ratio(cpu, ts.isns),
+           wall ? ts.isns * tc.mhz / wall : 0);
+
+    if (ts.rk_xfers)
+        printf("timing: rk %llu transfers, %llu words, %llu ide cycles; "
+               "est. %.2f MIPS waiting on each\n",
+               ts.rk_xfers, ts.rk_words, ts.ide,
+               ts.isns * tc.mhz / (wall + ts.ide));
+}
+
+/* the counters, for cosim checkpoints */
+static struct tstats ts_saved[NCKPT];
+
+void timing_checkpoint(int slot, int restore)
+{
+    if (restore)
+        ts = ts_saved[slot];
+    else
+        ts_saved[slot] = ts;
+}
+
+
+/*
+ * Local Variables:
+ * indent-tabs-mode:nil
+ * c-basic-offset:4
+ * End:
+*/
@@ -0,0 +1,16 @@
+/* timing.h */
+
+/* what a clocked state is doing, for the cycle accounting */
+#define TP_FETCH	0	/* f1, c1 */
+#define TP_SRC		1	/* s1..s4 */
+#define TP_DST		2	/* d1..d4 */
+#define TP_EXEC		3	/* e1, w1, o1..o3, p1 */
+#define TP_TRAP		4	/* t1..t4 */
+#define TP_IDLE		5	/* i1 */
+#define TP_NUM		6
+
+int timing_config(char *opts);
+void timing_state(int phase, int extra);
+void timing_bus(u22 addr, u16 data, int write, int writeb);
+void timing_isn(u16 isn);
+void timing_report(void);
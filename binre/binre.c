@@ -14,6 +14,7 @@
 #include "mach.h"
 #include "isn.h"
 #include "support.h"
+#include "cfg.h"
 
 extern u_short isn_dispatch[0x10000];
 extern raw_isn_t *isn_decode[0x10000];
@@ -34,6 +35,7 @@ char *mem_filename;
 int use_rl02;
 int use_rk05;
 int initial_pc;
+char *graph;
 
 u_char cc_c, cc_n, cc_z, cc_v;
 
@@ -1363,6 +1365,31 @@ init(void)
     pc = initial_pc;
 }
 
+/* the control flow graph from initial_pc and the vectors, instead of running */
+int dump_graph(void)
+{
+    cfg_t *g;
+
+    g = cfg_new(memory, 0160000);
+    if (g == NULL)
+        return -1;
+
+    cfg_entry(g, initial_pc);
+    cfg_vectors(g, 0, 0157777);
+    if (cfg_build(g) < 0) {
+        cfg_free(g);
+        return -1;
+    }
+
+    if (strcmp(graph, "json") == 0)
+        cfg_json(g, stdout);
+    else
+        cfg_dot(g, stdout);
+
+    cfg_free(g);
+    return 0;
+}
+
 extern int optind;
 extern char *optarg;
 
@@ -1377,7 +1404,7 @@ main(int argc, char *argv[])
     use_rk05 = 1;
     use_rl02 = 0;
 
-    while ((c = getopt(argc, argv, "c:dm:f:m:p:r:")) != -1) {
+    while ((c = getopt(argc, argv, "c:dm:f:m:p:r:G:")) != -1) {
         switch (c) {
         case 'd':
             debug++;
@@ -1407,10 +1434,19 @@ main(int argc, char *argv[])
                 use_rk05 = 0;
             }
             break;
+        case 'G':
+            graph = strdup(optarg);
+            break;
 	}
     }
 
     init();
+
+    if (graph) {
+        debug = 0;
+        exit(dump_graph() ? 1 : 0);
+    }
+
     run();
     exit(0);
 }
@@ -0,0 +1,481 @@
+/*
+ * cfg.c
+ *
+ * basic blocks and the control flow graph of a pdp-11 memory image,
+ * by recursive descent from entry points using the isn_decode[] tables.
+ *
+ * branch, sob, and jmp/jsr to #a, @#a or a relative address have static
+ * targets; everything else that loads the pc (rts, rti, jmp @(r), add
+ * to pc...) is an indirect exit.  jsr and traps are assumed to come back
+ * to the next instruction.  "mov #x,@#v" with v in the vectors makes x
+ * an entry point too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isn.h"
+#include "cfg.h"
+
+extern raw_isn_t *isn_decode[0x10000];
+extern void make_isn_table(void);
+
+typedef struct {
+    int i_next;                 /* past it and its operand words */
+    int i_exit;
+    int i_indirect;
+    int i_taken;
+    int i_vector;
+    int i_entry;                /* from "mov #x,@#vector"; else -1 */
+} cfg_isn_t;
+
+static char *exit_names[] = {
+    "fall", "branch", "jump", "call", "trap", "return", "stop"
+};
+
+char *
+cfg_exit_name(int exit)
+{
+    return exit_names[exit];
+}
+
+static int
+cfg_word(cfg_t *g, int addr)
+{
+    addr &= 0177776;
+    return addr < g->g_size ? g->g_mem[addr >> 1] : 0;
+}
+
+static int
+operand_words(int m, int r)
+{
+    return m == M_INDEXED || m == M_INDEX_DEF ||
+        (r == 7 && (m == M_AUTOINC || m == M_AUTOINC_DEF));
+}
+
+/* where jmp or jsr goes, if that doesn't depend on a register */
+static int
+cfg_target(cfg_t *g, int m, int r, int wa, int next)
+{
+    if (r != 7)
+        return -1;
+
+    switch (m) {
+    case M_AUTOINC:             /* (pc)+, the operand word itself */
+        return wa;
+    case M_AUTOINC_DEF:         /* @#a */
+        return cfg_word(g, wa);
+    case M_INDEXED:             /* a */
+        return (cfg_word(g, wa) + next) & 0177777;
+    }
+
+    return -1;
+}
+
+static void
+cfg_trap(cfg_isn_t *i, int vector)
+{
+    i->i_exit = CFG_TRAP;
+    i->i_vector = vector;
+}
+
+static void
+cfg_isn(cfg_t *g, int addr, cfg_isn_t *i)
+{
+    raw_isn_t *ri;
+    int inst, sm, sr, dm, dr, sa, da, a, off;
+
+    inst = cfg_word(g, addr);
+    ri = isn_decode[inst];
+    a = addr + 2;
+
+    i->i_exit = CFG_FALL;
+    i->i_indirect = 0;
+    i->i_taken = -1;
+    i->i_vector = 0;
+    i->i_entry = -1;
+
+    if (ri == NULL) {
+        /* only the single-bit condition code ops are in the table */
+        if ((inst & 0177740) != 0240)
+            cfg_trap(i, 010);
+        i->i_next = a & 0177777;
+        return;
+    }
+
+    sm = sr = dm = dr = -1;
+    sa = da = 0;
+
+    switch (ri->isn_regs) {
+    case R_DD:
+    case R_RDD:
+        dm = (inst >> 3) & 07;
+        dr = inst & 07;
+        break;
+    case R_SS:
+    case R_RSS:
+        sm = (inst >> 3) & 07;
+        sr = inst & 07;
+        break;
+    case R_SSDD:
+        sm = (inst >> 9) & 07;
+        sr = (inst >> 6) & 07;
+        dm = (inst >> 3) & 07;
+        dr = inst & 07;
+        break;
+    }
+
+    if (sr >= 0 && operand_words(sm, sr)) {
+        sa = a;
+        a += 2;
+    }
+
+    if (dr >= 0 && operand_words(dm, dr)) {
+        da = a;
+        a += 2;
+    }
+
+    i->i_next = a & 0177777;
+
+    if (ri->isn_regs == R_8OFF) {
+        off = (signed char)(inst & 0377);
+        i->i_taken = (i->i_next + 2*off) & 0177777;
+        i->i_exit = ri->isn_num == ISN_BR ? CFG_JUMP : CFG_BRANCH;
+        return;
+    }
+
+    switch (ri->isn_num) {
+    case ISN_HALT:
+        i->i_exit = CFG_STOP;
+        break;
+    case ISN_RTI:
+    case ISN_RTT:
+    case ISN_RTS:
+    case ISN_MARK:
+        i->i_exit = CFG_RETURN;
+        i->i_indirect = 1;
+        break;
+    case ISN_BPT:
+        cfg_trap(i, 014);
+        break;
+    case ISN_IOT:
+        cfg_trap(i, 020);
+        break;
+    case ISN_EMT:
+        cfg_trap(i, 030);
+        break;
+    case ISN_TRAP:
+        cfg_trap(i, 034);
+        break;
+    case ISN_CSM:
+        cfg_trap(i, 010);
+        break;
+    case ISN_SOB:
+        i->i_taken = (i->i_next - 2*(inst & 077)) & 0177777;
+        i->i_exit = CFG_BRANCH;
+        break;
+    case ISN_JMP:
+    case ISN_JSR:
+        if (dm == M_REG) {
+            cfg_trap(i, 04);
+            break;
+        }
+        i->i_exit = ri->isn_num == ISN_JMP ? CFG_JUMP : CFG_CALL;
+        i->i_taken = cfg_target(g, dm, dr, da, i->i_next);
+        i->i_indirect = i->i_taken < 0;
+        break;
+    case ISN_CMP:
+    case ISN_CPMB:
+    case ISN_BIT:
+    case ISN_BITB:
+    case ISN_TST:
+    case ISN_TSTB:
+        break;
+    default:
+        /* anything else into the pc */
+        if (dm == M_REG && dr == 7) {
+            i->i_exit = CFG_JUMP;
+            if (ri->isn_num == ISN_MOV && sm == M_AUTOINC && sr == 7)
+                i->i_taken = cfg_word(g, sa);
+            i->i_indirect = i->i_taken < 0;
+        }
+
+        /* a trap or interrupt vector being set up */
+        if (ri->isn_num == ISN_MOV &&
+            sm == M_AUTOINC && sr == 7 &&
+            dm == M_AUTOINC_DEF && dr == 7 &&
+            cfg_word(g, da) < 0400)
+        {
+            i->i_entry = cfg_word(g, sa);
+        }
+        break;
+    }
+}
+
+cfg_t *
+cfg_new(unsigned short *mem, int size)
+{
+    cfg_t *g;
+
+    if (isn_decode[0] == NULL)
+        make_isn_table();
+
+    g = (cfg_t *)malloc(sizeof(cfg_t));
+    if (g == NULL)
+        return NULL;
+
+    memset(g, 0, sizeof(cfg_t));
+    g->g_mem = mem;
+    g->g_size = size & ~1;
+    g->g_map = (unsigned char *)calloc(g->g_size / 2 + 1, 1);
+    g->g_work = (int *)malloc((g->g_size / 2 + 1) * sizeof(int));
+
+    if (g->g_map == NULL || g->g_work == NULL) {
+        cfg_free(g);
+        return NULL;
+    }
+
+    return g;
+}
+
+void
+cfg_free(cfg_t *g)
+{
+    free(g->g_map);
+    free(g->g_work);
+    free(g->g_blocks);
+    free(g);
+}
+
+/* a block starts here; it gets decoded by cfg_build() */
+void
+cfg_entry(cfg_t *g, int addr)
+{
+    if ((addr & 1) || addr < 0 || addr >= g->g_size ||
+        (g->g_map[addr >> 1] & CFG_LEADER))
+        return;
+
+    g->g_map[addr >> 1] |= CFG_LEADER;
+    g->g_work[g->g_nwork++] = addr;
+}
+
+/* trap and interrupt vectors that point between lo and hi */
+void
+cfg_vectors(cfg_t *g, int lo, int hi)
+{
+    int v, addr;
+
+    for (v = 04; v < 01000 && v < g->g_size; v += 4) {
+        addr = cfg_word(g, v);
+        if (addr != 0 && addr >= lo && addr <= hi)
+            cfg_entry(g, addr);
+    }
+}
+
+/* mark instructions and leaders reachable from the entries */
+static void
+cfg_discover(cfg_t *g)
+{
+    cfg_isn_t i;
+    int addr;
+
+    while (g->g_nwork > 0) {
+        addr = g->g_work[--g->g_nwork];
+
+        while ((addr & 1) == 0 && addr < g->g_size) {
+            /* run into code already seen; two ways in, so a leader */
+            if (g->g_map[addr >> 1] & CFG_ISN) {
+                cfg_entry(g, addr);
+                break;
+            }
+
+            g->g_map[addr >> 1] |= CFG_ISN;
+
+            cfg_isn(g, addr, &i);
+            addr = i.i_next;
+
+            if (i.i_entry >= 0)
+                cfg_entry(g, i.i_entry);
+            if (i.i_taken >= 0)
+                cfg_entry(g, i.i_taken);
+
+            if (i.i_exit == CFG_FALL)
+                continue;
+
+            if (i.i_exit == CFG_BRANCH || i.i_exit == CFG_CALL ||
+                i.i_exit == CFG_TRAP)
+                cfg_entry(g, addr);
+            break;
+        }
+    }
+}
+
+/* returns the number of blocks, or -1 */
+int
+cfg_build(cfg_t *g)
+{
+    cfg_block_t *b, *t;
+    cfg_isn_t i;
+    int a, w, n;
+
+    cfg_discover(g);
+
+    for (n = 0, g->g_isns = 0, w = 0; w < g->g_size / 2; w++) {
+        if (g->g_map[w] & CFG_LEADER)
+            n++;
+        if (g->g_map[w] & CFG_ISN)
+            g->g_isns++;
+    }
+
+    free(g->g_blocks);
+    g->g_blocks = (cfg_block_t *)calloc(n + 1, sizeof(cfg_block_t));
+    if (g->g_blocks == NULL)
+        return -1;
+    g->g_nblocks = n;
+
+    for (b = g->g_blocks, w = 0; w < g->g_size / 2; w++) {
+        if (!(g->g_map[w] & CFG_LEADER))
+            continue;
+
+        b->b_start = a = w << 1;
+
+        for (;;) {
+            cfg_isn(g, a, &i);
+            b->b_last = a;
+            b->b_isns++;
+            a = i.i_next;
+
+            if (i.i_exit != CFG_FALL)
+                break;
+
+            if ((a & 1) || a >= g->g_size) {
+                i.i_exit = CFG_STOP;
+                break;
+            }
+
+            if (g->g_map[a >> 1] & CFG_LEADER)
+                break;
+        }
+
+        b->b_end = a;
+        b->b_exit = i.i_exit;
+        b->b_indirect = i.i_indirect;
+        b->b_taken = i.i_taken;
+        b->b_vector = i.i_vector;
+        b->b_fall = -1;
+
+        switch (b->b_exit) {
+        case CFG_FALL:
+        case CFG_BRANCH:
+        case CFG_CALL:
+        case CFG_TRAP:
+            if ((a & 1) == 0 && a < g->g_size)
+                b->b_fall = a;
+            break;
+        }
+
+        b++;
+    }
+
+    for (b = g->g_blocks; b < g->g_blocks + n; b++) {
+        if (b->b_taken >= 0 && (t = cfg_block(g, b->b_taken)))
+            t->b_preds++;
+        if (b->b_fall >= 0 && (t = cfg_block(g, b->b_fall)))
+            t->b_preds++;
+    }
+
+    return n;
+}
+
+/* the block starting at addr, or NULL */
+cfg_block_t *
+cfg_block(cfg_t *g, int addr)
+{
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = g->g_nblocks - 1;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (g->g_blocks[mid].b_start == addr)
+            return &g->g_blocks[mid];
+        if (g->g_blocks[mid].b_start < addr)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+
+    return NULL;
+}
+
+void
+cfg_dot(cfg_t *g, FILE *f)
+{
+    cfg_block_t *b;
+    int computed;
+
+    fprintf(f, "digraph cfg {\n");
+    fprintf(f, "    node [shape=box, fontname=\"monospace\"];\n");
+
+    computed = 0;
+    for (b = g->g_blocks; b < g->g_blocks + g->g_nblocks; b++) {
+        fprintf(f, "    b%06o [label=\"%06o-%06o\\n%d isns, %s",
+                b->b_start, b->b_start, b->b_last, b->b_isns,
+                cfg_exit_name(b->b_exit));
+        if (b->b_exit == CFG_TRAP)
+            fprintf(f, " %03o", b->b_vector);
+        fprintf(f, "\"];\n");
+
+        if (b->b_taken >= 0)
+            fprintf(f, "    b%06o -> b%06o%s;\n", b->b_start, b->b_taken,
+                    b->b_exit == CFG_CALL ? " [label=\"call\"]" : "");
+
+        if (b->b_indirect) {
+            fprintf(f, "    b%06o -> computed [style=dotted];\n",
+                    b->b_start);
+            computed = 1;
+        }
+
+        if (b->b_fall >= 0)
+            fprintf(f, "    b%06o -> b%06o [style=dashed];\n",
+                    b->b_start, b->b_fall);
+    }
+
+    if (computed)
+        fprintf(f, "    computed [shape=diamond, label=\"?\"];\n");
+
+    fprintf(f, "}\n");
+}
+
+void
+cfg_json(cfg_t *g, FILE *f)
+{
+    cfg_block_t *b;
+
+    fprintf(f, "{\n  \"instructions\": %d,\n  \"blocks\": [", g->g_isns);
+
+    for (b = g->g_blocks; b < g->g_blocks + g->g_nblocks; b++) {
+        fprintf(f, "%s\n    { \"start\": %d, \"end\": %d, \"last\": %d, "
+                "\"isns\": %d, \"exit\": \"%s\", \"indirect\": %s, "
+                "\"taken\": %d, \"fall\": %d, \"vector\": %d, "
+                "\"preds\": %d }",
+                b == g->g_blocks ? "" : ",",
+                b->b_start, b->b_end, b->b_last, b->b_isns,
+                cfg_exit_name(b->b_exit),
+                b->b_indirect ? "true" : "false",
+                b->b_taken, b->b_fall, b->b_vector, b->b_preds);
+    }
+
+    fprintf(f, "\n  ]\n}\n");
+}
+
+
+
+/*
+ * Local Variables:
+ * indent-tabs-mode:nil
+ * c-basic-offset:4
+ * End:
+*/
@@ -0,0 +1,63 @@
+/*
+ * cfg.h
+ *
+ * control flow graph of a pdp-11 memory image
+ */
+
+/* how a block ends */
+enum {
+    CFG_FALL = 0,       /* into the next block, which is a leader */
+    CFG_BRANCH,         /* conditional; to b_taken or b_fall */
+    CFG_JUMP,           /* to b_taken, or somewhere computed */
+    CFG_CALL,           /* jsr; to b_taken or computed, back to b_fall */
+    CFG_TRAP,           /* through b_vector, back to b_fall */
+    CFG_RETURN,         /* rts, rti, rtt, mark; always computed */
+    CFG_STOP,           /* halt, or off the end of the image */
+};
+
+/* g_map, per word */
+#define CFG_ISN         0x1     /* an instruction starts here */
+#define CFG_LEADER      0x2     /* and a block */
+
+typedef struct {
+    int b_start;                /* byte address of the first instruction */
+    int b_end;                  /* and past the last */
+    int b_last;                 /* the last instruction */
+    int b_isns;
+    int b_exit;                 /* CFG_ */
+    int b_indirect;             /* the exit's target is computed */
+    int b_taken;                /* static target, or -1 */
+    int b_fall;                 /* the next block, or -1 */
+    int b_vector;               /* for CFG_TRAP */
+    int b_preds;                /* edges in, not counting traps */
+} cfg_block_t;
+
+typedef struct {
+    unsigned short *g_mem;      /* the image, by word, from 0 */
+    int g_size;                 /* in bytes */
+    unsigned char *g_map;
+    int *g_work;
+    int g_nwork;
+    cfg_block_t *g_blocks;      /* in address order */
+    int g_nblocks;
+    int g_isns;
+} cfg_t;
+
+cfg_t *cfg_new(unsigned short *mem, int size);
+void cfg_free(cfg_t *g);
+void cfg_entry(cfg_t *g, int addr);
+void cfg_vectors(cfg_t *g, int lo, int hi);
+int cfg_build(cfg_t *g);
+cfg_block_t *cfg_block(cfg_t *g, int addr);
+char *cfg_exit_name(int exit);
+void cfg_dot(cfg_t *g, FILE *f);
+void cfg_json(cfg_t *g, FILE *f);
+
+
+
+/*
+ * Local Variables:
+ * indent-tabs-mode:nil
+ * c-basic-offset:4
+ * End:
+*/
@@ -0,0 +1,527 @@
+/* decode.c */
+
+#include <stdio.h>
+
+#include "xlate.h"
+
+/*
+ * pdp-11 instructions into xlate ops.  fetch() and decode() take the
+ * instruction at pc, leave pc past it and its operand words, and put its
+ * ops in the fifo; flow and target say where control goes next.
+ *
+ * the ops don't use r7 for the pc's own address modes; the decoder knows
+ * where the operand words are and the ops load them from there, so an
+ * immediate the program patches still works.  r7 as a plain register
+ * (mode 0, 1, 4 or 5) is set to what the pc would be first.
+ */
+
+#define maskmatch(v, bits, mask)	(((v) & (mask)) == (bits))
+
+u22 pc;
+u16 isn;
+
+int flow;			/* F_ */
+int target;			/* branch, jump or call target; -1 if computed */
+int entry;			/* x, from "mov #x,@#vector"; else -1 */
+
+static int const_addr;		/* operand address, if not from a register */
+
+char *xlate_name[X_NUM] = {
+	"LI", "SI", "ADDA", "ADDIM", "SWAB",
+	"HALT", "WAIT", "RESET",
+	"JUMP",
+	"LIB", "SIB", "LA", "MOVR",
+	"MOV", "CMP", "BIT", "BIC", "BIS", "ADD", "SUB",
+	"CLR", "COM", "INC", "DEC", "NEG", "ADC", "SBC", "TST",
+	"ROR", "ROL", "ASR", "ASL", "SXT", "XOR",
+	"MUL", "DIV", "ASH", "ASHC",
+	"MFPS", "MTPS", "PSP",
+	"SPL", "CC", "BR", "SOB", "TRAP", "RTI",
+};
+
+void fetch(void)
+{
+	isn = read_mem(pc);
+	pc = (pc + 2) & 0177777;
+}
+
+#define MAX_XLATE_FIFO 32
+u32 xlate_fifo[MAX_XLATE_FIFO];
+int xlate_fifo_head;
+int xlate_fifo_tail;
+
+/* returns 0 when empty */
+int get_xlate_fifo(u32 *v)
+{
+	if (xlate_fifo_tail == xlate_fifo_head)
+		return 0;
+
+	*v = xlate_fifo[xlate_fifo_tail++];
+	if (xlate_fifo_tail == MAX_XLATE_FIFO)
+		xlate_fifo_tail = 0;
+	return 1;
+}
+
+void put_xlate_fifo(u32 v)
+{
+	xlate_fifo[xlate_fifo_head++] = v;
+	if (xlate_fifo_head == MAX_XLATE_FIFO)
+		xlate_fifo_head = 0;
+}
+
+void put_xlate_ins(int op, int rd, int rs, int immed)
+{
+	u32 v;
+
+	v = (op << 24) | (rd << 20) | (rs << 16) | (immed & 0xffff);
+	put_xlate_fifo(v);
+}
+
+/* the address of the next operand word */
+static int next_word(void)
+{
+	int a = pc;
+
+	pc = (pc + 2) & 0177777;
+	return a;
+}
+
+/*
+ * an operand's address into areg; returns -1, or for mode 0 the register
+ * itself.  const_addr is the address when no register goes into it.
+ */
+static int operand(int mode, int reg, int byte, int areg)
+{
+	int delta = (byte && reg < R_SP) ? 1 : 2;
+	int a;
+
+	const_addr = -1;
+
+	if (reg == R_PC) {
+		switch (mode) {
+		case 2:					/* #n */
+			const_addr = next_word();
+			put_xlate_ins(X_LA, areg, 0, const_addr);
+			return -1;
+		case 3:					/* @#a */
+			a = next_word();
+			const_addr = read_mem(a);
+			put_xlate_ins(X_LI, areg, R_Z, a);
+			return -1;
+		case 6:					/* a */
+			a = next_word();
+			const_addr = (read_mem(a) + pc) & 0177777;
+			put_xlate_ins(X_LI, areg, R_Z, a);
+			put_xlate_ins(X_ADDIM, areg, 0, pc);
+			return -1;
+		case 7:					/* @a */
+			a = next_word();
+			put_xlate_ins(X_LI, areg, R_Z, a);
+			put_xlate_ins(X_ADDIM, areg, 0, pc);
+			put_xlate_ins(X_LI, areg, areg, 0);
+			return -1;
+		}
+		put_xlate_ins(X_LA, R_PC, 0, pc);
+	}
+
+	switch (mode) {
+	case 0:
+		return reg;
+	case 1:
+		put_xlate_ins(X_MOVR, areg, reg, 0);
+		break;
+	case 2:
+		put_xlate_ins(X_MOVR, areg, reg, 0);
+		put_xlate_ins(X_ADDIM, reg, 0, delta);
+		break;
+	case 3:
+		put_xlate_ins(X_LI, areg, reg, 0);
+		put_xlate_ins(X_ADDIM, reg, 0, 2);
+		break;
+	case 4:
+		put_xlate_ins(X_ADDIM, reg, 0, -delta);
+		put_xlate_ins(X_MOVR, areg, reg, 0);
+		break;
+	case 5:
+		put_xlate_ins(X_ADDIM, reg, 0, -2);
+		put_xlate_ins(X_LI, areg, reg, 0);
+		break;
+	case 6:
+		put_xlate_ins(X_LI, areg, R_Z, next_word());
+		put_xlate_ins(X_ADDA, areg, reg, 0);
+		break;
+	case 7:
+		put_xlate_ins(X_LI, areg, R_Z, next_word());
+		put_xlate_ins(X_ADDA, areg, reg, 0);
+		put_xlate_ins(X_LI, areg, areg, 0);
+		break;
+	}
+
+	return -1;
+}
+
+static void load(int reg, int areg, int byte)
+{
+	put_xlate_ins(byte ? X_LIB : X_LI, reg, areg, 0);
+}
+
+static void store(int reg, int areg, int byte)
+{
+	put_xlate_ins(byte ? X_SIB : X_SI, reg, areg, 0);
+}
+
+static void jump(int reg)
+{
+	put_xlate_ins(X_JUMP, 0, reg, 0);
+	flow = F_JUMP;
+}
+
+static void trap(int vector)
+{
+	put_xlate_ins(X_LA, R_S3, 0, pc);
+	put_xlate_ins(X_TRAP, 0, R_S3, vector);
+	flow = F_TRAP;
+}
+
+/* a source operand's value into a register; returns it */
+static int source(int mode, int reg, int byte)
+{
+	int vs;
+
+	vs = operand(mode, reg, byte, R_S1);
+	if (vs < 0) {
+		load(R_S0, R_S1, byte);
+		vs = R_S0;
+	}
+	return vs;
+}
+
+/*
+ * the destination of the op at isn's low six bits, with source vs.
+ * reads says whether the op uses the old value, writes if it changes it.
+ */
+static void dest_op(int op, int vs, int byte, int reads, int writes)
+{
+	int vd, f;
+
+	f = byte ? XF_BYTE : 0;
+
+	/* mov r0,(r0)+ moves r0 as it was */
+	if (vs == (isn & 7) && vs != R_PC &&
+	    ((isn >> 3) & 7) >= 2 && ((isn >> 3) & 7) <= 5)
+	{
+		put_xlate_ins(X_MOVR, R_S0, vs, 0);
+		vs = R_S0;
+	}
+
+	vd = operand((isn >> 3) & 7, isn & 7, byte, R_S2);
+	if (vd < 0) {
+		if (reads)
+			load(R_S3, R_S2, byte);
+		vd = R_S3;
+	} else if (op == X_MOV || op == X_MFPS)
+		f |= byte ? XF_SEXT : 0;
+
+	put_xlate_ins(op, vd, vs, f);
+
+	if (vd == R_S3 && writes)
+		store(R_S3, R_S2, byte);
+	if (vd == R_PC && writes)
+		jump(R_PC);
+}
+
+static void double_op(int op, int byte, int reads, int writes)
+{
+	int vs, src_addr;
+
+	vs = source((isn >> 9) & 7, (isn >> 6) & 7, byte);
+	src_addr = ((isn & 07700) == 02700) ? const_addr : -1;
+
+	dest_op(op, vs, byte, reads, writes);
+
+	/* a trap or interrupt vector being set up */
+	if (op == X_MOV && !byte && src_addr >= 0 &&
+	    const_addr >= 0 && const_addr < 0400)
+		entry = read_mem(src_addr);
+}
+
+/* jmp and jsr; pushes reg first for jsr */
+static void jump_op(int call, int reg)
+{
+	if (operand((isn >> 3) & 7, isn & 7, 0, R_S2) >= 0) {
+		trap(04);				/* jmp/jsr r */
+		return;
+	}
+
+	if (call) {
+		put_xlate_ins(X_ADDIM, R_SP, 0, -2);
+		if (reg == R_PC) {
+			put_xlate_ins(X_LA, R_S3, 0, pc);
+			put_xlate_ins(X_SI, R_S3, R_SP, 0);
+		} else {
+			put_xlate_ins(X_SI, reg, R_SP, 0);
+			put_xlate_ins(X_LA, reg, 0, pc);
+		}
+	}
+
+	target = const_addr;
+	jump(R_S2);
+	if (call)
+		flow = F_CALL;
+}
+
+static void branch(int cond)
+{
+	int offset;
+
+	offset = isn & 0377;
+	if (offset & 0200)
+		offset -= 0400;
+
+	target = (pc + 2*offset) & 0177777;
+	put_xlate_ins(X_BR, cond, 0, target);
+	flow = cond == 1 ? F_JUMP : F_BRANCH;
+}
+
+void decode(void)
+{
+	int reg, byte;
+
+	xlate_fifo_head = xlate_fifo_tail = 0;
+	flow = F_NEXT;
+	target = -1;
+	entry = -1;
+
+	reg = (isn >> 6) & 7;
+	byte = (isn & 0100000) != 0;
+
+	if (maskmatch(isn, 0000000, 0177770)) {
+		switch (isn & 7) {
+		/* HALT	MS	-	000000 */
+		case 0:
+			put_xlate_ins(X_LA, R_S3, 0, pc);
+			put_xlate_ins(X_HALT, 0, R_S3, 0);
+			flow = F_STOP;
+			break;
+		/* WAIT	MS	-	000001 */
+		case 1:
+			put_xlate_ins(X_WAIT, 0, 0, 0);
+			break;
+		/* RTI	MS	-	000002 */
+		/* RTT	MS	-	000006 */
+		case 2:
+		case 6:
+			put_xlate_ins(X_LI, R_S2, R_SP, 0);
+			put_xlate_ins(X_LI, R_S3, R_SP, 2);
+			put_xlate_ins(X_ADDIM, R_SP, 0, 4);
+			put_xlate_ins(X_RTI, R_S3, R_S2, isn == 6);
+			flow = F_JUMP;
+			break;
+		/* BPT	PC	-	000003 */
+		case 3:
+			trap(014);
+			break;
+		/* IOT	PC	-	000004 */
+		case 4:
+			trap(020);
+			break;
+		/* RESET MS	-	000005 */
+		case 5:
+			put_xlate_ins(X_RESET, 0, 0, 0);
+			break;
+		/* MFPT	MS	-	000007 */
+		case 7:
+			trap(010);
+			break;
+		}
+		return;
+	}
+
+	/* JMP	PC	DD	0001DD */
+	if (maskmatch(isn, 0000100, 0177700)) {
+		jump_op(0, 0);
+		return;
+	}
+
+	/* RTS	PC	R	00020R */
+	if (maskmatch(isn, 0000200, 0177770)) {
+		reg = isn & 7;
+		if (reg == R_PC) {
+			put_xlate_ins(X_LI, R_S2, R_SP, 0);
+		} else {
+			put_xlate_ins(X_MOVR, R_S2, reg, 0);
+			put_xlate_ins(X_LI, reg, R_SP, 0);
+		}
+		put_xlate_ins(X_ADDIM, R_SP, 0, 2);
+		jump(R_S2);
+		return;
+	}
+
+	/* SPL	PC	N	00023N */
+	if (maskmatch(isn, 0000230, 0177770)) {
+		put_xlate_ins(X_SPL, 0, 0, isn & 7);
+		return;
+	}
+
+	/* CLC .. SCC, NOP	CC	-	00024N-00027N */
+	if (maskmatch(isn, 0000240, 0177740)) {
+		if (isn & 017)
+			put_xlate_ins(X_CC, 0, 0, isn & 037);
+		return;
+	}
+
+	/* SWAB	SO	DD	0003DD */
+	if (maskmatch(isn, 0000300, 0177700)) {
+		dest_op(X_SWAB, 0, 0, 1, 1);
+		return;
+	}
+
+	/* BR BNE BEQ BGE BLT BGT BLE	PC	8OFF	0004OO-0037OO */
+	if (maskmatch(isn, 0000000, 0174000) && (isn & 03400)) {
+		branch((isn >> 8) & 7);
+		return;
+	}
+
+	/* BPL BMI BHI BLOS BVC BVS BCC BCS	PC	8OFF	1000OO-1037OO */
+	if (maskmatch(isn, 0100000, 0174000)) {
+		branch(8 + ((isn >> 8) & 7));
+		return;
+	}
+
+	/* JSR	PC	RDD	004RDD */
+	if (maskmatch(isn, 0004000, 0177000)) {
+		jump_op(1, reg);
+		return;
+	}
+
+	/* EMT	PC	-	104000	104377 */
+	/* TRAP	PC	-	104400	104777 */
+	if (maskmatch(isn, 0104000, 0177000)) {
+		trap((isn & 0400) ? 034 : 030);
+		return;
+	}
+
+	/* single operand, word and byte */
+	if (maskmatch(isn, 0005000, 0077000) ||
+	    maskmatch(isn, 0006000, 0077400))
+	{
+		switch ((isn >> 6) & 077) {
+		case 050: dest_op(X_CLR, 0, byte, 0, 1); return;
+		case 051: dest_op(X_COM, 0, byte, 1, 1); return;
+		case 052: dest_op(X_INC, 0, byte, 1, 1); return;
+		case 053: dest_op(X_DEC, 0, byte, 1, 1); return;
+		case 054: dest_op(X_NEG, 0, byte, 1, 1); return;
+		case 055: dest_op(X_ADC, 0, byte, 1, 1); return;
+		case 056: dest_op(X_SBC, 0, byte, 1, 1); return;
+		case 057: dest_op(X_TST, 0, byte, 1, 0); return;
+		case 060: dest_op(X_ROR, 0, byte, 1, 1); return;
+		case 061: dest_op(X_ROL, 0, byte, 1, 1); return;
+		case 062: dest_op(X_ASR, 0, byte, 1, 1); return;
+		case 063: dest_op(X_ASL, 0, byte, 1, 1); return;
+		}
+	}
+
+	/* MARK	PC	NN	0064NN */
+	if (maskmatch(isn, 0006400, 0177700)) {
+		put_xlate_ins(X_LA, R_SP, 0, pc + 2*(isn & 077));
+		put_xlate_ins(X_MOVR, R_S2, 5, 0);
+		put_xlate_ins(X_LI, 5, R_SP, 0);
+		put_xlate_ins(X_ADDIM, R_SP, 0, 2);
+		jump(R_S2);
+		return;
+	}
+
+	/*
+	 * MFPI	MS	SS	0065SS
+	 * MFPD	MS	SS	1065SS
+	 * MTPI	MS	DD	0066DD
+	 * MTPD	MS	DD	1066DD
+	 * no mmu, so the previous space is this one: a push and a pop.
+	 * but sp is the previous mode's.
+	 */
+	if (maskmatch(isn, 0006500, 0077700)) {
+		if ((isn & 077) == R_SP) {
+			put_xlate_ins(X_PSP, R_S0, 0, 0);
+			reg = R_S0;
+		} else
+			reg = source((isn >> 3) & 7, isn & 7, 0);
+		put_xlate_ins(X_MOV, R_S3, reg, 0);
+		put_xlate_ins(X_ADDIM, R_SP, 0, -2);
+		put_xlate_ins(X_SI, R_S3, R_SP, 0);
+		return;
+	}
+	if (maskmatch(isn, 0006600, 0077700)) {
+		put_xlate_ins(X_LI, R_S0, R_SP, 0);
+		put_xlate_ins(X_ADDIM, R_SP, 0, 2);
+		if ((isn & 077) == R_SP) {
+			put_xlate_ins(X_MOV, R_S0, R_S0, 0);
+			put_xlate_ins(X_PSP, R_S0, 0, 1);
+		} else
+			dest_op(X_MOV, R_S0, 0, 0, 1);
+		return;
+	}
+
+	/* SXT	SO	DD	0067DD */
+	if (maskmatch(isn, 0006700, 0177700)) {
+		dest_op(X_SXT, 0, 0, 0, 1);
+		return;
+	}
+
+	/* MTPS	MS	SS	1064SS */
+	if (maskmatch(isn, 0106400, 0177700)) {
+		put_xlate_ins(X_MTPS, 0, source((isn >> 3) & 7, isn & 7, 1), 0);
+		return;
+	}
+
+	/* MFPS	MS	DD	1067DD */
+	if (maskmatch(isn, 0106700, 0177700)) {
+		dest_op(X_MFPS, 0, 1, 0, 1);
+		return;
+	}
+
+	/* MUL DIV ASH ASHC	DO	RSS	070RSS-073RSS */
+	if (maskmatch(isn, 0070000, 0174000)) {
+		static int eis[4] = { X_MUL, X_DIV, X_ASH, X_ASHC };
+
+		put_xlate_ins(eis[(isn >> 9) & 3], reg,
+			      source((isn >> 3) & 7, isn & 7, 0), 0);
+		return;
+	}
+
+	/* XOR	DO	RDD	074RDD */
+	if (maskmatch(isn, 0074000, 0177000)) {
+		dest_op(X_XOR, reg, 0, 1, 1);
+		return;
+	}
+
+	/* SOB	PC	R8OFF	077ROO */
+	if (maskmatch(isn, 0077000, 0177000)) {
+		target = (pc - 2*(isn & 077)) & 0177777;
+		put_xlate_ins(X_SOB, reg, 0, target);
+		flow = F_BRANCH;
+		return;
+	}
+
+	/* double operand, word and byte */
+	switch (isn >> 12) {
+	case 001: case 011: double_op(X_MOV, byte, 0, 1); return;
+	case 002: case 012: double_op(X_CMP, byte, 1, 0); return;
+	case 003: case 013: double_op(X_BIT, byte, 1, 0); return;
+	case 004: case 014: double_op(X_BIC, byte, 1, 1); return;
+	case 005: case 015: double_op(X_BIS, byte, 1, 1); return;
+	case 006: double_op(X_ADD, 0, 1, 1); return;
+	case 016: double_op(X_SUB, 0, 1, 1); return;
+	}
+
+	/* fis, cis, fpp, csm and the rest */
+	trap(010);
+}
+
+
+
+/*
+ * Local Variables:
+ * indent-tabs-mode:nil
+ * c-basic-offset:4
+ * End:
+*/
@@ -1,547 +1,256 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <memory.h>
 
 #include "xlate.h"
+#include "cfg.h"
+
+/*
+ * rbs - pdp-11 program to c, ahead of time.
+ *
+ *	rbs [-g start] [-o out.c] [-G dot|json] file.sav|file.mem
+ *
+ * a .mem image starts at 0500 unless -g says otherwise, the origin of
+ * tests/basic and verif/runbasic.sh; a .sav image at its word 040.
+ *
+ * code is found by recursive descent from the start address, the trap
+ * and interrupt vectors, and anything a "mov #x,@#vector" puts in one
+ * (../binre/cfg.c); -G writes that graph instead.  each basic block
+ * becomes a c function of the xlate ops for its
+ * instructions, returning the next pc.  compile the output with rt.c
+ * and decode.c; rt.c interprets whatever wasn't found here (computed
+ * jumps to code the descent didn't reach) with the same ops.
+ *
+ * the translation is of the image as loaded; code that modifies its own
+ * instructions is not going to work.  immediates and addresses are
+ * loaded from memory at run time, so patching those is fine.
+ */
+
+#define IOPAGE	0160000
+
+u16 memory[32768];
+int image_lo, image_hi;			/* byte addresses, inclusive */
+int start = -1;
+int sp = -1;
+
+cfg_t *cfg;
 
-typedef unsigned char u8;
-typedef unsigned short u16;
-
-typedef unsigned int u22;
-
-u22 pc;
-u16 isn;
-
-u16 *memory;
-int memory_size;
-
-int dmode, dreg;
-int smode, sreg;
-u22 src, dest;
-int regdelta;
-int reg;
-int trap;
-int offset;
+u16 read_mem(u22 addr)
+{
+	return memory[(addr & 0177777) >> 1];
+}
 
-int mem_init(void)
+char *suffix(char *filename)
 {
-	memory_size = 1 * 1024 * 1024;
-	memory = (u16 *)malloc(memory_size);
+	char *p = strrchr(filename, '.');
 
-	return 0;
+	return p ? p + 1 : "";
 }
 
-#define	CACHE_LINES	32
-#define LINESIZE	8
-#define LINESIZE_LOG2	3
-#define LINESIZE_MASK	0x0000f8
-#define ADDR_MASK	0x3ffff8
-
-struct cache_s {
-	int flags;
-#define C_FILLED 0x1
-#define C_DIRTY	 0x2
-	u22 tag;
-	u16 data[LINESIZE/2];
-} cache[CACHE_LINES];
-
-void flush_line(int line)
+/* "addr data" in octal, a word a line */
+int load_mem(char *filename)
 {
-	if (cache[line].flags & C_DIRTY) {
-		int i;
-		for (i = 0; i < LINESIZE/2; i++) {
-			memory[ cache[line].tag + i ] = cache[line].data[i];
+	FILE *f;
+	unsigned addr, data;
+	char line[128];
+
+	if ((f = fopen(filename, "r")) == NULL) {
+		perror(filename);
+		return -1;
+	}
+
+	image_lo = IOPAGE;
+	image_hi = 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%o %o", &addr, &data) != 2)
+			continue;
+		if (addr >= IOPAGE) {
+			fprintf(stderr, "%s: address %o out of range\n",
+				filename, addr);
+			fclose(f);
+			return -1;
 		}
+		memory[addr >> 1] = data;
+		if (addr < image_lo) image_lo = addr & ~1;
+		if (addr > image_hi) image_hi = addr | 1;
 	}
-	cache[line].tag = 0;
-	cache[line].flags = 0;
+
+	fclose(f);
+	return 0;
 }
 
-void fill_line(int line, u22 addr)
+/* rt-11 save image; memory from 0, start at 040 and stack at 042 */
+int load_sav(char *filename)
 {
-	int i;
-	printf("cache: fill line %d @ %08x\n", line, cache[line].tag);
-	for (i = 0; i < LINESIZE/2; i++) {
-		cache[line].data[i] = memory[ cache[line].tag + i ];
+	FILE *f;
+	int n;
+
+	if ((f = fopen(filename, "rb")) == NULL) {
+		perror(filename);
+		return -1;
 	}
-	cache[line].flags = C_FILLED;
-	cache[line].tag = addr & ADDR_MASK;
-}
 
-u16 read_mem(u22 addr)
-{
-#if 0
-	return memory[addr/2];
-#else
-	unsigned int line, off;
-
-	line = (addr & LINESIZE_MASK) >> LINESIZE_LOG2;
-	off = addr & ~ADDR_MASK;
-	if (cache[line].tag != (addr & ADDR_MASK) ||
-	    !(cache[line].flags & C_FILLED))
-	{
-		flush_line(line);
-		fill_line(line, addr);
+	n = fread(memory, 1, IOPAGE, f);
+	fclose(f);
+
+	if (n < 01000) {
+		fprintf(stderr, "%s: too short for a save image\n", filename);
+		return -1;
 	}
 
-	printf("cache: hit %08x, line %d\n", addr, line);
-	return cache[line].data[off];
-#endif
+	image_lo = 0;
+	image_hi = (n - 1) | 1;
+	start = memory[040/2];
+	sp = memory[042/2];
+	return 0;
 }
 
-void fetch(void)
+void emit_block(FILE *f, int addr)
 {
-	isn = read_mem(pc);
-	pc += 2;
-}
+	u32 si;
+	int a, op;
 
-#define MAX_XLATE_FIFO 32
-u32 xlate_fifo[MAX_XLATE_FIFO];
-int xlate_fifo_head;
-int xlate_fifo_tail;
+	fprintf(f, "static int b_%06o(void)\n{\n", addr);
 
-u32 get_xlate_fifo(void)
-{
-	if (xlate_fifo_tail == xlate_fifo_head)
-		return 0;
+	for (;;) {
+		pc = addr;
+		fetch();
+		decode();
+
+		fprintf(f, "\t/* %06o:", addr);
+		for (a = addr; a != pc; a = (a + 2) & 0177777)
+			fprintf(f, " %06o", read_mem(a));
+		fprintf(f, " */\n");
+		fprintf(f, "\trt_pc = %#o;\n", pc);
+
+		while (get_xlate_fifo(&si)) {
+			op = si >> 24;
+			fprintf(f, "\t%s(%d, %d, %#o);\n", xlate_name[op],
+				(si >> 20) & 0xf, (si >> 16) & 0xf, si & 0xffff);
+		}
 
-	v = xlate_fifo[xlate_fifo_tail++];
-	if (xlate_fifo_tail == MAX_XLATE_FIFO)
-		xlate_fifo_tail = 0;
+		addr = pc;
+		if (flow != F_NEXT || (addr & 1) || addr >= IOPAGE ||
+		    (cfg->g_map[addr >> 1] & CFG_LEADER))
+			break;
+	}
+
+	fprintf(f, "\treturn %#o;\n}\n\n", addr);
 }
 
-void put_xlate_fifo(u32 v)
+void emit(FILE *f, char *filename)
 {
-	xlate_fifo[xlate_fifo_head++] = v;
-	if (xlate_fifo_head == MAX_XLATE_FIFO)
-		xlate_fifo_head = 0;
+	cfg_block_t *b;
+	int a, n;
+
+	fprintf(f, "/* %s, by rbs; compile with rt.c and decode.c */\n\n",
+		filename);
+	fprintf(f, "#define GOTO(a)\treturn (a)\n");
+	fprintf(f, "#include \"rt.h\"\n\n");
+
+	fprintf(f, "u16 rt_image[] = {");
+	for (n = 0, a = image_lo; a <= image_hi; a += 2, n++)
+		fprintf(f, "%s%#o,", n % 8 ? " " : "\n\t", read_mem(a));
+	fprintf(f, "\n};\n\n");
+
+	fprintf(f, "int rt_image_addr = %#o;\n", image_lo);
+	fprintf(f, "int rt_image_words = %d;\n", n);
+	fprintf(f, "int rt_start = %#o;\n", start);
+	fprintf(f, "int rt_sp = %#o;\n\n", sp);
+
+	for (b = cfg->g_blocks; b < cfg->g_blocks + cfg->g_nblocks; b++)
+		emit_block(f, b->b_start);
+
+	fprintf(f, "void rt_blocks(void)\n{\n");
+	for (b = cfg->g_blocks; b < cfg->g_blocks + cfg->g_nblocks; b++)
+		fprintf(f, "\trt_block[%#o] = b_%06o;\n",
+			b->b_start >> 1, b->b_start);
+	fprintf(f, "}\n");
 }
 
-void put_xlate_ins(int op, int rd, int rs, int immed)
+void usage(void)
 {
-	u32 v;
-
-	v = (op << 24) | (rd << 20) | (rs << 16) | (immed & 0xffff);
-	put_xlate_fifo(v);
+	fprintf(stderr, "usage: rbs [-g start] [-o out.c] [-G dot|json] "
+		"file.sav|file.mem\n");
+	exit(1);
 }
 
-unsigned int reg_file[16];
-#define R_R0 0
-#define R_PC 7
-#define R_SP 6
-#define R_S0 8
-#define R_S1 9
-#define R_S2 10
-#define R_PS 15
-
-void decode(void)
+int main(int argc, char *argv[])
 {
-	if (maskmatch(isn, 0000000, 0177770)) {
-		switch (isn & 7) {
-		/* HALT	MS	-	000000 */
-		case 0:
-			put_xlate_fifo(X_HALT);
-			break;
-		/* WAIT	MS	-	000001 */
-		case 1:
-			put_xlate_fifo(X_WAIT);
-			break;
-		/* RTI	MS	-	000002 */
-		case 2:
-			put_xlate_ins(X_LI, R_PC, R_SP, 0);
-			put_xlate_ins(X_LI, R_PS, R_SP, 2);
-			put_xlate_ins(X_ADDIM, R_SP, 0, 4);
-			break;
-		/* BPT	PC	-	000003 */
-		case 3:
-			break;
-		/* IOT	PC	-	000004 */
-		case 4:
-			break;
-		/* RESET MS	-	000005 */
-		case 5:
-			put_xlate_fifo(X_RESET);
-			break;
-		/* RTT	MS	-	000006 */
-		case 6:
-			break;
-		/* MFPT	MS	-	000007 */
-		case 7:
-			break;
-		}
-	}
-
-	if (maskmatch(isn, 0000000, 0177000)) {
+	char *out = NULL, *graph = NULL;
+	FILE *f;
+	int c;
 
-		switch (isn & 0777) {
-		/* JMP	PC	DD	000100 */
-		case 0100:
-			put_xlate_ins(X_ADDA, R_PC, R_PC, isn & 077);
-			break;
-		/* RTS	PC	R	000200 */
-		case 0200:
-			reg = (isn >> 0) & 7;
-			put_xlate_ins(X_MOVR, R_PC, reg, 0);
-			put_xlate_ins(X_LI, reg, R_PC, 0);
-			put_xlate_ins(X_ADDIM, R_PC, 0, 2);
+	while ((c = getopt(argc, argv, "g:o:G:")) != -1) {
+		switch (c) {
+		case 'g':
+			start = strtol(optarg, NULL, 8);
 			break;
-		/* SPL	PC	N	000230 */
-		case 0230:
+		case 'o':
+			out = optarg;
 			break;
-		/* SCC	CC	-	000277 */
-		/* SEN	CC	-	000270 */
-		/* SEZ	CC	-	000264 */
-		/* SEV	CC	-	000262 */
-		/* SEC	CC	-	000261 */
-		/* S	CC	-	000260 */
-		/* CCC	CC	-	000257 */
-		/* CLN	CC	-	000250 */
-		/* CLZ	CC	-	000244 */
-		/* CLV	CC	-	000242 */
-		/* CLC	CC	-	000241 */
-		/* C	CC	-	000240 */
+		case 'G':
+			graph = optarg;
+			if (strcmp(graph, "dot") && strcmp(graph, "json"))
+				usage();
 			break;
+		default:
+			usage();
 		}
 	}
 
-/* ASLB	SOB	DD	1063MD */
-/* ASRB	SOB	DD	1062MD */
-/* ROLB	DOB	DD	1061MD */
-/* RORB	DOB	DD	1060MD */
-/* TSTB	SOB	DD	1057MD */
-/* SBCB	SOB	DD	1056MD */
-/* ADCB	SOB	DD	1055MD */
-/* NEGB	SOB	DD	1054MD */
-/* DECB	SOB	DD	1053MD */
-/* INCB	SOB	DD	1052MD */
-/* COMB	SOB	DD	1051MD */
-/* CLRB	SOB	DD	1050MD */
-/* CSM	PC	DD	0070MD */
-/* SXT	SO	DD	0067MD */
-/* MTPI	MS	DD	0066MD */
-/* ASR	SO	DD	0062MD */
-/* ROL	DO	DD	0061MD */
-/* ROR	DO	DD	0060MD */
-/* TST	SO	DD	0057MD */
-/* SBC	SO	DD	0056MD */
-/* ADC	SO	DD	0055MD */
-/* NEG	SO	DD	0054MD */
-/* DEC	SO	DD	0053MD */
-/* INC	SO	DD	0052MD */
-/* COM	SO	DD	0051MD */
-/* CLR	SO	DD	0050MD */
-/* SWAB	SO	DD	0003MD */
-
-/* MFPS	MS	DD	1067MD */
-	if (maskmatch(isn, 0106700, 0177700)) {
-	}
-
-/* MTPD	MS	DD	1066MD */
-	if (maskmatch(isn, 0106600, 0177700)) {
-	}
-
-	    maskmatch(isn, 0106300, 0177700) ||
-	    maskmatch(isn, 0106200, 0177700) ||
-	    maskmatch(isn, 0106100, 0177700) ||
-	    maskmatch(isn, 0106000, 0177700) ||
-	    maskmatch(isn, 0105700, 0177700) ||
-	    maskmatch(isn, 0105600, 0177700) ||
-	    maskmatch(isn, 0105500, 0177700) ||
-	    maskmatch(isn, 0105400, 0177700) ||
-	    maskmatch(isn, 0105300, 0177700) ||
-	    maskmatch(isn, 0105200, 0177700) ||
-	    maskmatch(isn, 0105100, 0177700) ||
-	    maskmatch(isn, 0105000, 0177700) ||
-	    maskmatch(isn, 0007000, 0177700) ||
-	    maskmatch(isn, 0006700, 0177700) ||
-	    maskmatch(isn, 0006600, 0177700) ||
-
-/* ASL	SO	DD	0063MD */
-	if (maskmatch(isn, 0006300, 0177700)) {
-		put_xlate_dd(X_ASL, isn);
-	}
-
-	    maskmatch(isn, 0006200, 0177700) ||
-	    maskmatch(isn, 0006100, 0177700) ||
-	    maskmatch(isn, 0006000, 0177700) ||
-	    maskmatch(isn, 0005700, 0177700) ||
-	    maskmatch(isn, 0005600, 0177700) ||
-	    maskmatch(isn, 0005500, 0177700) ||
-	    maskmatch(isn, 0005400, 0177700) ||
-	    maskmatch(isn, 0005300, 0177700) ||
-	    maskmatch(isn, 0005200, 0177700) ||
-	    maskmatch(isn, 0005100, 0177700) ||
-	    maskmatch(isn, 0005000, 0177700) ||
-	    maskmatch(isn, 0000300, 0177700) ||
-	    0)
-	{
-            dmode = (isn >> 3) & 7;
-            dreg = (isn >> 0) & 7;
-            if (dreg > 5) regdelta = 2; else regdelta = 0;
-            switch (dmode) {
-            case 0:
-                dest = &regs[dreg]; break;
-            case 1:
-                dest = memory + regs[dreg] / 2; break;
-            case 2:
-                dest = memory + regs[dreg] / 2;
-                regs[dreg] += regdelta;
-                break;
-            case 3:
-                dest = memory + memory[ regs[dreg] / 2 ] / 2;
-                regs[dreg] += regdelta;
-                break;
-            case 4:
-                regs[dreg] -= regdelta;
-                dest = memory + regs[dreg];
-                break;
-            case 5: 
-                regs[dreg] -= regdelta;
-                dest = memory + memory[ regs[dreg] / 2 ];
-                break;
-            case 6:
-                dest = memory + regs[dreg] + memory[ pc / 2 ];
-                pc += 2;
-                break;
-            case 7:
-                dest = memory + memory[ regs[dreg] + memory[ pc / 2 ] ];
-                pc += 2;
-                break;
-            }
-	}
-
-/* XOR	DO	RDD	074RMD */
-/* JSR	PC	RDD	004RMD */
-	if (maskmatch(isn, 0074000, 0177000) ||
-	    maskmatch(isn, 0004000, 0177000))
-	{
-            reg = (isn >> 6) & 7;
-            dmode = (isn >> 3) & 7;
-            dreg = (isn >> 0) & 7;
-	}
-
-/* ASH	DO	RSS	072RMS */
-/* ASHC	DO	RSS	073RMS */
-/* DIV	DO	RSS	071RMS */
-/* MUL	DO	RSS	070RMS */
-	if (maskmatch(isn, 0073000, 0177000) ||
-	    maskmatch(isn, 0072000, 0177000) ||
-	    maskmatch(isn, 0071000, 0177000) ||
-	    maskmatch(isn, 0070000, 0177000))
-	{
-            reg = (isn >> 6) & 7;
-            smode = (isn >> 3) & 7;
-            sreg = (isn >> 0) & 7;
-	}
-
-/* MFPD	MS	SS	1065SS */
-/* MTPS	MS	SS	1064SS */
-/* MFPI	MS	SS	0065SS */
-	if (maskmatch(isn, 0106500, 0177700) ||
-	    maskmatch(isn, 0106400, 0177700) ||
-	    maskmatch(isn, 0006500, 0177700))
-	{
-            smode = (isn >> 3) & 7;
-            sreg = (isn >> 0) & 7;
+	if (optind != argc - 1)
+		usage();
+
+	c = start;
+	if (strcasecmp(suffix(argv[optind]), "sav") == 0) {
+		if (load_sav(argv[optind]))
+			exit(1);
+	} else if (load_mem(argv[optind]))
+		exit(1);
+
+	if (c >= 0)
+		start = c;
+	if (start < 0)
+		start = 0500;			/* as tests/basic, go 500 */
+	if (sp < 0)
+		sp = 01000;
+	if (image_lo > image_hi) {
+		fprintf(stderr, "%s: nothing loaded\n", argv[optind]);
+		exit(1);
 	}
 
-/* SUB	DO	SSDD	16MSMD */
-/* BISB	DOB	SSDD	15MSMD */
-/* BICB	DOB	SSDD	14MSMD */
-/* BITB	DOB	SSDD	13MSMD */
-/* CPMB	DOB	SSDD	12MSMD */
-/* MOVB	DOB	SSDD	11MSMD */
-/* ADD	DO	SSDD	06MSMD */
-/* BIS	DO	SSDD	05MSMD */
-/* BIC	DO	SSDD	04MSMD */
-/* BIT	DO	SSDD	03MSMD */
-/* CMP	DO	SSDD	02MSMD */
-/* MOV	DO	SSDD	01MSMD */
-	if (maskmatch(isn, 0160000, 0170000) ||
-	    maskmatch(isn, 0150000, 0170000) ||
-	    maskmatch(isn, 0140000, 0170000) ||
-	    maskmatch(isn, 0130000, 0170000) ||
-	    maskmatch(isn, 0120000, 0170000) ||
-	    maskmatch(isn, 0110000, 0170000) ||
-	    maskmatch(isn, 0060000, 0170000) ||
-	    maskmatch(isn, 0050000, 0170000) ||
-	    maskmatch(isn, 0040000, 0170000) ||
-	    maskmatch(isn, 0030000, 0170000) ||
-	    maskmatch(isn, 0020000, 0170000) ||
-	    maskmatch(isn, 0010000, 0170000))
-	{
-            smode = (isn >> 9) & 7;
-            sreg = (isn >> 6) & 7;
-            dmode = (isn >> 3) & 7;
-            dreg = (isn >> 0) & 7;
-
-            if (sreg > 5) regdelta = 2;
-            switch (smode) {
-            case 0:
-                src = &regs[sreg]; break;
-            case 1:
-                src = memory + regs[sreg] / 2; break;
-            case 2:
-                src = memory + regs[sreg] / 2;
-                regs[sreg] += regdelta;
-                break;
-            case 3:
-                src = memory + memory[ regs[sreg] / 2 ] / 2;
-                regs[sreg] += regdelta;
-                break;
-            case 4:
-                regs[sreg] -= regdelta;
-                src = memory + regs[sreg];
-                break;
-            case 5: 
-                regs[sreg] -= regdelta;
-                src = memory + memory[ regs[sreg] / 2 ];
-                break;
-            case 6:
-                src = memory + regs[sreg] + memory[ pc / 2 ];
-                pc += 2;
-                break;
-            case 7:
-                src = memory + memory[ regs[sreg] + memory[ pc / 2 ] ];
-                pc += 2;
-                break;
-            }
-
-            if (dreg > 5) regdelta = 2;
-            switch (dmode) {
-            case 0:
-                dest = &regs[dreg]; break;
-            case 1:
-                dest = memory + regs[dreg] / 2; break;
-            case 2:
-                dest = memory + regs[dreg] / 2;
-                regs[dreg] += regdelta;
-                break;
-            case 3:
-                dest = memory + memory[ regs[dreg] / 2 ] / 2;
-                regs[dreg] += regdelta;
-                break;
-            case 4:
-                regs[dreg] -= regdelta;
-                dest = memory + regs[dreg];
-                break;
-            case 5: 
-                regs[dreg] -= regdelta;
-                dest = memory + memory[ regs[dreg] / 2 ];
-                break;
-            case 6:
-                dest = memory + regs[dreg] + memory[ pc / 2 ];
-                pc += 2;
-                break;
-            case 7:
-                dest = memory + memory[ regs[dreg] + memory[ pc / 2 ] ];
-                pc += 2;
-                break;
-            }
+	if ((cfg = cfg_new(memory, IOPAGE)) == NULL) {
+		fprintf(stderr, "rbs: out of memory\n");
+		exit(1);
 	}
-
-/* TRAP	PC	-	104400	104777 */
-/* EMT	PC	-	104000	104377 */
-	if (maskmatch(isn, 0104400, 0177400) ||
-	    maskmatch(isn, 0104000, 0177400))
-	{
-		trap = isn & 0377;
-	}
-
-/* BCS	PC	8OFF	1034OO */
-/* BCC	PC	8OFF	1030OO */
-/* BLO	PC	8OFF	1034OO */
-/* BHIS	PC	8OFF	1030OO */
-/* BVS	PC	8OFF	1024OO */
-/* BVC	PC	8OFF	1020OO */
-/* BLOS	PC	8OFF	1014OO */
-/* BHI	PC	8OFF	1010OO */
-/* BMI	PC	8OFF	1004OO */
-/* BPL	PC	8OFF	1000OO */
-/* SOB	PC	R8OFF	0770OO */
-	if (maskmatch(isn, 0103400, 0177700) ||
-	    maskmatch(isn, 0103000, 0177700) ||
-	    maskmatch(isn, 0102400, 0177700) ||
-	    maskmatch(isn, 0102000, 0177700) ||
-	    maskmatch(isn, 0101400, 0177700) ||
-	    maskmatch(isn, 0101000, 0177700) ||
-	    maskmatch(isn, 0100000, 0177700) ||
-	    maskmatch(isn, 0077000, 0177700))
-	{
-		offset = isn & 077;
-	}
-
-/* MARK	PC	NN	0064NN */
-/* BLE	PC	8OFF	0034OO */
-/* BGT	PC	8OFF	0030OO */
-/* BLT	PC	8OFF	0024OO */
-/* BGE	PC	8OFF	0020OO */
-/* BEQ	PC	8OFF	0014OO */
-/* BNE	PC	8OFF	0010OO */
-/* BR	PC	8OFF	0004OO */
-	if (maskmatch(isn, 0006400, 0177700) ||
-	    maskmatch(isn, 0003400, 0177700) ||
-	    maskmatch(isn, 0002400, 0177700) ||
-	    maskmatch(isn, 0002000, 0177700) ||
-	    maskmatch(isn, 0001400, 0177700) ||
-	    maskmatch(isn, 0001000, 0177700) ||
-	    maskmatch(isn, 0000400, 0177700))
-	{
-		offset = isn & 077;
+	cfg_entry(cfg, start);
+	cfg_vectors(cfg, image_lo, image_hi);
+	if (cfg_build(cfg) < 0) {
+		fprintf(stderr, "rbs: out of memory\n");
+		exit(1);
 	}
 
-}
-
-void execute(void)
-{
-	u32 si;
-
-	while (si = get_xlate_fifo()) {
-		u8 op, dreg, sreg;
-		int immed;
-
-		op = si >> 24;
-		dreg = (si >> 20) & 0xf;
-		sreg = (si >> 16) & 0xf;
-		immed = (int)(sh & 0xffff);
-
-		switch (op) {
-		case X_LI:
-			reg_file[dreg] = memory[ reg_file[sreg] ];
-			break;
-		case X_SI:
-			memory[ reg_file[sreg] ] = reg_file[dreg];
-			break;
-		case X_ADDA:
-			reg_file[dreg] += reg_file[sreg];
-			break;
-		case X_ADDIM:
-			reg_file[dreg] = ((int)reg_file[dreg] + immed);
-		case X_SWAB:
-			reg_file[dreg] = swab(reg_file[dreg]);
-			break;
-		}
+	f = stdout;
+	if (out && (f = fopen(out, "w")) == NULL) {
+		perror(out);
+		exit(1);
 	}
-}
 
-void step(void)
-{
-	fetch();
-	translate();
-	execute();
-}
+	if (graph == NULL)
+		emit(f, argv[optind]);
+	else if (strcmp(graph, "dot") == 0)
+		cfg_dot(cfg, f);
+	else
+		cfg_json(cfg, f);
 
-void run(void)
-{
-	step();
-}
+	if (f != stdout)
+		fclose(f);
 
-main()
-{
-	int c;
+	fprintf(stderr, "rbs: %d instructions, %d blocks\n",
+		cfg->g_isns, cfg->g_nblocks);
 
-	mem_init();
-	for (c = 0; c < 10; c++) {
-		run();
-	}
+	exit(0);
 }
@@ -0,0 +1,337 @@
+/* rt.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "rt.h"
+
+/*
+ * runtime for rbs's output: memory, the console, traps, and the loop
+ * that calls the translated blocks.  an address with no block (a
+ * computed jump somewhere rbs didn't find) is interpreted an instruction
+ * at a time, with the same ops, until it gets back to one.
+ *
+ * 56k of memory and the i/o page; the only devices are the console
+ * terminal, on stdin and stdout, the switch register (0) and the psw.
+ * there are no interrupts, and no mmu, but kernel and user mode have
+ * their own stack pointers.
+ * a bus error traps through 4 with the pc past the instruction; with
+ * the t bit set, it's an instruction at a time, and a trace trap after.
+ */
+
+#define IOPAGE	0160000
+
+#define SR	0177570
+#define TKS	0177560
+#define TKB	0177562
+#define TPS	0177564
+#define TPB	0177566
+#define PSW	0177776
+
+u16 R[16];
+u16 rt_pc;
+rt_block_t rt_block[32768];
+
+static u16 M[32768];
+static u16 stack[4];			/* the other modes' sp */
+
+static jmp_buf fault;
+static int in_trap;
+static int halted;
+
+static unsigned long long blocks, interpreted;
+
+static void bus_error(u16 addr)
+{
+	if (in_trap) {
+		fprintf(stderr, "rt: double bus error at %06o, pc %06o\n",
+			addr, rt_pc);
+		exit(1);
+	}
+	longjmp(fault, 1);
+}
+
+/* a mode change changes stacks */
+static void set_ps(u16 ps)
+{
+	int cm = R[R_PS] >> 14, nm = ps >> 14;
+
+	if (cm != nm) {
+		stack[cm] = R[R_SP];
+		R[R_SP] = stack[nm];
+	}
+	R[R_PS] = ps;
+}
+
+static u16 io_read(u16 addr)
+{
+	int c;
+
+	switch (addr) {
+	case TKS:
+	case TPS:
+		return 0200;
+	case TKB:
+		fflush(stdout);
+		c = getchar();
+		return c == EOF ? 032 : c;	/* ^z */
+	case TPB:
+	case SR:
+		return 0;
+	case PSW:
+		return R[R_PS];
+	}
+
+	bus_error(addr);
+	return 0;
+}
+
+static void io_write(u16 addr, u16 data)
+{
+	switch (addr) {
+	case TKS:
+	case TKB:
+	case TPS:
+	case SR:
+		return;
+	case TPB:
+		putchar(data & 0377);
+		return;
+	case PSW:
+		set_ps((data & ~PS_T) | (R[R_PS] & PS_T));
+		return;
+	}
+
+	bus_error(addr);
+}
+
+u16 rt_read(u16 addr)
+{
+	if (addr & 1)
+		bus_error(addr);
+	if (addr < IOPAGE)
+		return M[addr >> 1];
+	return io_read(addr);
+}
+
+u16 rt_readb(u16 addr)
+{
+	u16 w;
+
+	w = addr < IOPAGE ? M[addr >> 1] : io_read(addr & ~1);
+	return (addr & 1) ? w >> 8 : w & 0377;
+}
+
+void rt_write(u16 addr, u16 data)
+{
+	if (addr & 1)
+		bus_error(addr);
+	if (addr < IOPAGE)
+		M[addr >> 1] = data;
+	else
+		io_write(addr, data);
+}
+
+void rt_writeb(u16 addr, u16 data)
+{
+	u16 *w, old;
+
+	if (addr < IOPAGE) {
+		w = &M[addr >> 1];
+		if (addr & 1)
+			*w = (*w & 0377) | (data << 8);
+		else
+			*w = (*w & 0177400) | (data & 0377);
+		return;
+	}
+
+	/* only the psw cares which byte */
+	old = addr == (PSW | 1) || addr == PSW ? R[R_PS] : 0;
+	if (addr & 1)
+		io_write(addr & ~1, (old & 0377) | (data << 8));
+	else
+		io_write(addr, (old & 0177400) | (data & 0377));
+}
+
+/* mfpi/mtpi sp */
+void rt_psp(int reg, int write)
+{
+	int cm = R[R_PS] >> 14, pm = (R[R_PS] >> 12) & 3;
+	u16 *sp = cm == pm ? &R[R_SP] : &stack[pm];
+
+	if (write)
+		*sp = R[reg];
+	else
+		R[reg] = *sp;
+}
+
+/* onto the stack of the vector's mode, with the old mode as previous */
+int rt_trap(int vector, u16 pc)
+{
+	u16 npc, nps, ops = R[R_PS];
+
+	in_trap = 1;
+	npc = rt_read(vector);
+	nps = rt_read(vector + 2);
+	set_ps((nps & ~PS_PM) | ((ops >> 2) & PS_PM));
+	R[R_SP] -= 2;
+	rt_write(R[R_SP], ops);
+	R[R_SP] -= 2;
+	rt_write(R[R_SP], pc);
+	in_trap = 0;
+
+	return npc;
+}
+
+/*
+ * out of kernel mode rti and rtt only change the condition codes and t.
+ * rti traces at once; rtt, and anything else, after the next instruction.
+ */
+int rt_rti(u16 pc, u16 ps, int rtt)
+{
+	if (R[R_PS] & PS_CM)
+		ps = (R[R_PS] & ~037) | (ps & 037);
+	set_ps(ps);
+
+	return (!rtt && (R[R_PS] & PS_T)) ? rt_trap(014, pc) : pc;
+}
+
+int rt_halt(u16 pc)
+{
+	halted = 1;
+	return pc;
+}
+
+/* the decoder's instruction fetch */
+u16 read_mem(u22 addr)
+{
+	return rt_read(addr);
+}
+
+/* one instruction, for an address with no block */
+static int interpret(int addr)
+{
+	u32 si;
+	int next, op, d, s, i;
+
+#define GOTO(a)	(next = (a))
+
+	rt_pc = addr;
+	pc = addr;
+	fetch();
+	decode();
+	next = rt_pc = pc;
+
+	while (get_xlate_fifo(&si)) {
+		op = si >> 24;
+		d = (si >> 20) & 0xf;
+		s = (si >> 16) & 0xf;
+		i = si & 0xffff;
+
+		switch (op) {
+		case X_LI:	LI(d, s, i); break;
+		case X_SI:	SI(d, s, i); break;
+		case X_ADDA:	ADDA(d, s, i); break;
+		case X_ADDIM:	ADDIM(d, s, i); break;
+		case X_SWAB:	SWAB(d, s, i); break;
+		case X_HALT:	HALT(d, s, i); break;
+		case X_WAIT:	WAIT(d, s, i); break;
+		case X_RESET:	RESET(d, s, i); break;
+		case X_JUMP:	JUMP(d, s, i); break;
+		case X_LIB:	LIB(d, s, i); break;
+		case X_SIB:	SIB(d, s, i); break;
+		case X_LA:	LA(d, s, i); break;
+		case X_MOVR:	MOVR(d, s, i); break;
+		case X_MOV:	MOV(d, s, i); break;
+		case X_CMP:	CMP(d, s, i); break;
+		case X_BIT:	BIT(d, s, i); break;
+		case X_BIC:	BIC(d, s, i); break;
+		case X_BIS:	BIS(d, s, i); break;
+		case X_ADD:	ADD(d, s, i); break;
+		case X_SUB:	SUB(d, s, i); break;
+		case X_CLR:	CLR(d, s, i); break;
+		case X_COM:	COM(d, s, i); break;
+		case X_INC:	INC(d, s, i); break;
+		case X_DEC:	DEC(d, s, i); break;
+		case X_NEG:	NEG(d, s, i); break;
+		case X_ADC:	ADC(d, s, i); break;
+		case X_SBC:	SBC(d, s, i); break;
+		case X_TST:	TST(d, s, i); break;
+		case X_ROR:	ROR(d, s, i); break;
+		case X_ROL:	ROL(d, s, i); break;
+		case X_ASR:	ASR(d, s, i); break;
+		case X_ASL:	ASL(d, s, i); break;
+		case X_SXT:	SXT(d, s, i); break;
+		case X_XOR:	XOR(d, s, i); break;
+		case X_MUL:	MUL(d, s, i); break;
+		case X_DIV:	DIV(d, s, i); break;
+		case X_ASH:	ASH(d, s, i); break;
+		case X_ASHC:	ASHC(d, s, i); break;
+		case X_MFPS:	MFPS(d, s, i); break;
+		case X_MTPS:	MTPS(d, s, i); break;
+		case X_PSP:	PSP(d, s, i); break;
+		case X_SPL:	SPL(d, s, i); break;
+		case X_CC:	CC(d, s, i); break;
+		case X_BR:	BR(d, s, i); break;
+		case X_SOB:	SOB(d, s, i); break;
+		case X_TRAP:	TRAP(d, s, i); break;
+		case X_RTI:	RTI(d, s, i); break;
+		}
+	}
+
+#undef GOTO
+
+	interpreted++;
+	return next;
+}
+
+static void run(void)
+{
+	volatile int addr = rt_start;
+
+	if (setjmp(fault))
+		addr = rt_trap(04, rt_pc);
+
+	while (!halted) {
+		if (R[R_PS] & PS_T) {
+			addr = interpret(addr);
+			if (!halted)
+				addr = rt_trap(014, addr);
+		} else if ((addr & 1) == 0 && rt_block[addr >> 1]) {
+			blocks++;
+			addr = rt_block[addr >> 1]();
+		} else
+			addr = interpret(addr);
+		addr &= 0177777;
+	}
+
+	fflush(stdout);
+	fprintf(stderr, "halt at %06o\n", addr);
+}
+
+int main(int argc, char *argv[])
+{
+	int stats = argc > 1 && strcmp(argv[1], "-s") == 0;
+
+	memcpy(&M[rt_image_addr >> 1], rt_image, rt_image_words * 2);
+	R[R_SP] = rt_sp;
+	rt_blocks();
+
+	run();
+
+	if (stats)
+		fprintf(stderr, "rt: %llu blocks, %llu instructions "
+			"interpreted\n", blocks, interpreted);
+	return 0;
+}
+
+
+
+/*
+ * Local Variables:
+ * indent-tabs-mode:nil
+ * c-basic-offset:4
+ * End:
+*/
@@ -0,0 +1,369 @@
+/* rt.h */
+
+#include "xlate.h"
+
+/*
+ * what translated code and rt.c's interpreter run on.  each xlate op is
+ * a macro here, (d, s, i), on the register file R[]; a translated block
+ * is the ops' macro calls with constants, so it compiles to what the
+ * interpreter does, without the decoding.  the includer defines GOTO(a),
+ * for the ops that change the pc.
+ */
+
+typedef int (*rt_block_t)(void);
+
+extern u16 R[16];
+extern u16 rt_pc;			/* past the instruction, for bus errors */
+extern rt_block_t rt_block[32768];
+
+u16 rt_read(u16 addr);
+u16 rt_readb(u16 addr);
+void rt_write(u16 addr, u16 data);
+void rt_writeb(u16 addr, u16 data);
+int rt_trap(int vector, u16 pc);
+int rt_halt(u16 pc);
+int rt_rti(u16 pc, u16 ps, int rtt);
+void rt_psp(int reg, int write);
+
+/* from rbs's output */
+extern u16 rt_image[];
+extern int rt_image_addr, rt_image_words;
+extern int rt_start, rt_sp;
+void rt_blocks(void);
+
+#define PS_CM	0140000
+#define PS_PM	030000
+#define PS_T	020
+#define PS_N	010
+#define PS_Z	004
+#define PS_V	002
+#define PS_C	001
+
+#define CBIT	(R[R_PS] & PS_C)
+
+static inline int rt_sign(u32 v, int f)
+{
+	return (f & XF_BYTE) ? (v >> 7) & 1 : (v >> 15) & 1;
+}
+
+static inline u32 rt_mask(u32 v, int f)
+{
+	return (f & XF_BYTE) ? v & 0377 : v & 0177777;
+}
+
+static inline void rt_cc(int n, int z, int v, int c)
+{
+	R[R_PS] = (R[R_PS] & ~017) | (n << 3) | (z << 2) | (v << 1) | c;
+}
+
+/* n and z from r, with v and c */
+static inline void rt_nz(u32 r, int f, int v, int c)
+{
+	rt_cc(rt_sign(r, f), rt_mask(r, f) == 0, v, c);
+}
+
+/* a byte result into a register leaves the high byte, or sign extends */
+static inline u16 rt_merge(u16 d, u32 r, int f)
+{
+	if (f & XF_SEXT)
+		return (r & 0200) ? (r | 0177400) : (r & 0377);
+	if (f & XF_BYTE)
+		return (d & 0177400) | (r & 0377);
+	return r;
+}
+
+static inline u16 rt_mov(u16 d, u16 s, int f)
+{
+	rt_nz(s, f, 0, CBIT);
+	return rt_merge(d, s, f);
+}
+
+static inline void rt_cmp(u16 d, u16 s, int f)
+{
+	u32 a = rt_mask(s, f), b = rt_mask(d, f), r = rt_mask(a - b, f);
+
+	rt_nz(r, f, rt_sign((a ^ b) & (~b ^ r), f), a < b);
+}
+
+static inline void rt_bit(u16 d, u16 s, int f)
+{
+	rt_nz(d & s, f, 0, CBIT);
+}
+
+static inline u16 rt_logic(u16 d, u32 r, int f)
+{
+	rt_nz(r, f, 0, CBIT);
+	return rt_merge(d, r, f);
+}
+
+static inline u16 rt_add(u16 d, u16 s)
+{
+	u16 r = d + s;
+
+	rt_nz(r, 0, rt_sign(~(s ^ d) & (s ^ r), 0), r < s);
+	return r;
+}
+
+static inline u16 rt_sub(u16 d, u16 s)
+{
+	u16 r = d - s;
+
+	rt_nz(r, 0, rt_sign((s ^ d) & (~s ^ r), 0), d < s);
+	return r;
+}
+
+static inline u16 rt_single(int op, u16 d, int f)
+{
+	u32 v = rt_mask(d, f), r, top = (f & XF_BYTE) ? 0200 : 0100000;
+	int c = CBIT, n;
+
+	switch (op) {
+	case X_CLR:
+		r = 0;
+		rt_cc(0, 1, 0, 0);
+		break;
+	case X_COM:
+		r = rt_mask(~v, f);
+		rt_nz(r, f, 0, 1);
+		break;
+	case X_INC:
+		r = rt_mask(v + 1, f);
+		rt_nz(r, f, r == top, c);
+		break;
+	case X_DEC:
+		r = rt_mask(v - 1, f);
+		rt_nz(r, f, r == top - 1, c);
+		break;
+	case X_NEG:
+		r = rt_mask(-v, f);
+		rt_nz(r, f, r == top, r != 0);
+		break;
+	case X_ADC:
+		r = rt_mask(v + c, f);
+		rt_nz(r, f, c && r == top, c && r == 0);
+		break;
+	case X_SBC:
+		r = rt_mask(v - c, f);
+		rt_nz(r, f, c && r == top - 1, c && r == rt_mask(~0, f));
+		break;
+	case X_TST:
+		rt_nz(v, f, 0, 0);
+		return d;
+	case X_ROR:
+		r = (v >> 1) | (c ? top : 0);
+		n = rt_sign(r, f);
+		rt_nz(r, f, n ^ (v & 1), v & 1);
+		break;
+	case X_ROL:
+		r = rt_mask((v << 1) | c, f);
+		n = rt_sign(r, f);
+		rt_nz(r, f, n ^ rt_sign(v, f), rt_sign(v, f));
+		break;
+	case X_ASR:
+		r = (v >> 1) | (v & top);
+		n = rt_sign(r, f);
+		rt_nz(r, f, n ^ (v & 1), v & 1);
+		break;
+	case X_ASL:
+		r = rt_mask(v << 1, f);
+		n = rt_sign(r, f);
+		rt_nz(r, f, n ^ rt_sign(v, f), rt_sign(v, f));
+		break;
+	case X_SWAB:
+		r = ((v >> 8) | (v << 8)) & 0177777;
+		rt_nz(r, XF_BYTE, 0, 0);
+		break;
+	case X_SXT:
+		r = (R[R_PS] & PS_N) ? 0177777 : 0;
+		rt_cc((r >> 15) & 1, r == 0, 0, c);
+		break;
+	default:
+		r = v;
+		break;
+	}
+
+	return rt_merge(d, r, f);
+}
+
+static inline void rt_mul(int d, u16 s)
+{
+	int r = (short)R[d] * (short)s;
+
+	R[d] = r >> 16;
+	R[d | 1] = r;
+	rt_cc(r < 0, r == 0, 0, r > 077777 || r < -0100000);
+}
+
+static inline void rt_div(int d, u16 s)
+{
+	int n = (int)(((u32)R[d] << 16) | R[d | 1]), q;
+
+	if (s == 0) {
+		rt_cc(0, 1, 1, 1);
+		return;
+	}
+	if (n == (int)020000000000 && s == 0177777) {
+		rt_cc(0, 0, 1, 0);
+		return;
+	}
+
+	q = n / (short)s;
+	if (q > 077777 || q < -0100000) {
+		rt_cc(q < 0, 0, 1, 0);
+		return;
+	}
+
+	R[d] = q;
+	R[d | 1] = n - q * (short)s;
+	rt_cc(q < 0, q == 0, 0, 0);
+}
+
+/* ash and ashc as simh has them */
+static inline void rt_ash(int d, u16 s)
+{
+	int n = s & 077, sign = (R[d] >> 15) & 1, v = (short)R[d];
+	int r, i, ov, c;
+
+	if (n == 0) {
+		r = v;
+		ov = c = 0;
+	} else if (n <= 15) {
+		r = (u32)v << n;
+		i = (v >> (16 - n)) & 0177777;
+		ov = i != ((r & 0100000) ? 0177777 : 0);
+		c = i & 1;
+	} else if (n <= 31) {
+		r = 0;
+		ov = v != 0;
+		c = n == 16 ? v & 1 : 0;
+	} else if (n == 32) {
+		r = -sign;
+		ov = c = 0;
+	} else {
+		r = (v >> (64 - n)) | (int)((u32)-sign << (n - 32));
+		ov = 0;
+		c = (v >> (63 - n)) & 1;
+	}
+
+	R[d] = r;
+	rt_cc((R[d] >> 15) & 1, R[d] == 0, ov, c);
+}
+
+static inline void rt_ashc(int d, u16 s)
+{
+	int n = s & 077, sign = (R[d] >> 15) & 1;
+	int v = (int)(((u32)R[d] << 16) | R[d | 1]);
+	int r, i, ov, c;
+
+	if (n == 0) {
+		r = v;
+		ov = c = 0;
+	} else if (n <= 31) {
+		r = (u32)v << n;
+		i = (v >> (32 - n)) | (int)((u32)-sign << n);
+		ov = i != ((r & 020000000000) ? -1 : 0);
+		c = i & 1;
+	} else if (n == 32) {
+		r = -sign;
+		ov = 0;
+		c = (v >> 31) & 1;
+	} else {
+		r = (v >> (64 - n)) | (int)((u32)-sign << (n - 32));
+		ov = 0;
+		c = (v >> (63 - n)) & 1;
+	}
+
+	R[d] = r >> 16;
+	R[d | 1] = r;
+	rt_cc((r >> 31) & 1, r == 0, ov, c);
+}
+
+static inline int rt_cond(int cond)
+{
+	int n = (R[R_PS] >> 3) & 1, z = (R[R_PS] >> 2) & 1;
+	int v = (R[R_PS] >> 1) & 1, c = R[R_PS] & 1;
+
+	switch (cond) {
+	case 1:  return 1;			/* br */
+	case 2:  return !z;			/* bne */
+	case 3:  return z;			/* beq */
+	case 4:  return !(n ^ v);		/* bge */
+	case 5:  return n ^ v;			/* blt */
+	case 6:  return !(z | (n ^ v));		/* bgt */
+	case 7:  return z | (n ^ v);		/* ble */
+	case 8:  return !n;			/* bpl */
+	case 9:  return n;			/* bmi */
+	case 10: return !(c | z);		/* bhi */
+	case 11: return c | z;			/* blos */
+	case 12: return !v;			/* bvc */
+	case 13: return v;			/* bvs */
+	case 14: return !c;			/* bcc */
+	case 15: return c;			/* bcs */
+	}
+	return 0;
+}
+
+#define LI(d, s, i)	(R[d] = rt_read(R[s] + (i)))
+#define SI(d, s, i)	rt_write(R[s] + (i), R[d])
+#define LIB(d, s, i)	(R[d] = rt_readb(R[s] + (i)))
+#define SIB(d, s, i)	rt_writeb(R[s] + (i), R[d])
+#define LA(d, s, i)	(R[d] = (i))
+#define MOVR(d, s, i)	(R[d] = R[s])
+#define ADDA(d, s, i)	(R[d] += R[s])
+#define ADDIM(d, s, i)	(R[d] += (i))
+
+#define MOV(d, s, i)	(R[d] = rt_mov(R[d], R[s], i))
+#define CMP(d, s, i)	rt_cmp(R[d], R[s], i)
+#define BIT(d, s, i)	rt_bit(R[d], R[s], i)
+#define BIC(d, s, i)	(R[d] = rt_logic(R[d], R[d] & ~R[s], i))
+#define BIS(d, s, i)	(R[d] = rt_logic(R[d], R[d] | R[s], i))
+#define XOR(d, s, i)	(R[d] = rt_logic(R[d], R[d] ^ R[s], i))
+#define ADD(d, s, i)	(R[d] = rt_add(R[d], R[s]))
+#define SUB(d, s, i)	(R[d] = rt_sub(R[d], R[s]))
+
+#define CLR(d, s, i)	(R[d] = rt_single(X_CLR, R[d], i))
+#define COM(d, s, i)	(R[d] = rt_single(X_COM, R[d], i))
+#define INC(d, s, i)	(R[d] = rt_single(X_INC, R[d], i))
+#define DEC(d, s, i)	(R[d] = rt_single(X_DEC, R[d], i))
+#define NEG(d, s, i)	(R[d] = rt_single(X_NEG, R[d], i))
+#define ADC(d, s, i)	(R[d] = rt_single(X_ADC, R[d], i))
+#define SBC(d, s, i)	(R[d] = rt_single(X_SBC, R[d], i))
+#define TST(d, s, i)	rt_single(X_TST, R[d], i)
+#define ROR(d, s, i)	(R[d] = rt_single(X_ROR, R[d], i))
+#define ROL(d, s, i)	(R[d] = rt_single(X_ROL, R[d], i))
+#define ASR(d, s, i)	(R[d] = rt_single(X_ASR, R[d], i))
+#define ASL(d, s, i)	(R[d] = rt_single(X_ASL, R[d], i))
+#define SWAB(d, s, i)	(R[d] = rt_single(X_SWAB, R[d], i))
+#define SXT(d, s, i)	(R[d] = rt_single(X_SXT, R[d], i))
+
+#define MUL(d, s, i)	rt_mul(d, R[s])
+#define DIV(d, s, i)	rt_div(d, R[s])
+#define ASH(d, s, i)	rt_ash(d, R[s])
+#define ASHC(d, s, i)	rt_ashc(d, R[s])
+
+#define MFPS(d, s, i)	(R[d] = rt_mov(R[d], R[R_PS] & 0377, i))
+#define MTPS(d, s, i)	(R[R_PS] = (R[R_PS] & ~0357) | (R[s] & 0357))
+#define PSP(d, s, i)	rt_psp(d, i)
+#define SPL(d, s, i)	(R[R_PS] = (R[R_PS] & ~0340) | ((i) << 5))
+#define CC(d, s, i)	(R[R_PS] = ((i) & 020) ? R[R_PS] | ((i) & 017) : \
+					   R[R_PS] & ~((i) & 017))
+
+/* no interrupts, so wait has nothing to wait for; reset nothing to reset */
+#define WAIT(d, s, i)
+#define RESET(d, s, i)
+
+#define BR(d, s, i)	if (rt_cond(d)) GOTO(i)
+#define SOB(d, s, i)	if (--R[d]) GOTO(i)
+#define JUMP(d, s, i)	GOTO(R[s])
+#define TRAP(d, s, i)	GOTO(rt_trap(i, R[s]))
+#define HALT(d, s, i)	GOTO(rt_halt(R[s]))
+#define RTI(d, s, i)	GOTO(rt_rti(R[s], R[d], i))
+
+
+
+/*
+ * Local Variables:
+ * indent-tabs-mode:nil
+ * c-basic-offset:4
+ * End:
+*/
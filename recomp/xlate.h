@@ -1,22 +1,93 @@
 
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+
+typedef unsigned int u22;
+
+/*
+ * xlate ops; each is one u32 in the fifo:
+ *
+ *	8       4     4     16
+ *	opcode  d-reg s-reg immediate
+ *
+ * and each is a macro of the same name, (d, s, i), in rt.h; rbs prints
+ * the macro calls and rt.c's interpreter switches on the opcode.  keep
+ * xlate_name[] in decode.c in step.
+ */
 enum {
-	X_LI,
-	X_SI,
-	X_ADDA,
-	X_ADDIM,
+	X_LI,		/* d = [s + i] */
+	X_SI,		/* [s + i] = d */
+	X_ADDA,		/* d += s */
+	X_ADDIM,	/* d += i */
 	X_SWAB,
 
-	X_HALT,
+	X_HALT,		/* stop; s holds the pc */
 	X_WAIT,
 	X_RESET,
 
-	X_JUMP,
-	X_RTS,
+	X_JUMP,		/* pc = s */
+
+	X_LIB,		/* d = byte [s + i] */
+	X_SIB,		/* byte [s + i] = d */
+	X_LA,		/* d = i */
+	X_MOVR,		/* d = s */
+
+	/* d op= s, setting the condition codes; i is XF_ flags */
+	X_MOV, X_CMP, X_BIT, X_BIC, X_BIS, X_ADD, X_SUB,
+	X_CLR, X_COM, X_INC, X_DEC, X_NEG, X_ADC, X_SBC, X_TST,
+	X_ROR, X_ROL, X_ASR, X_ASL, X_SXT, X_XOR,
+	X_MUL, X_DIV, X_ASH, X_ASHC,
+	X_MFPS, X_MTPS,
+	X_PSP,		/* d = previous mode's sp, or the other way if i */
+
+	X_SPL,		/* priority i */
+	X_CC,		/* set or clear condition codes, as isn & 037 */
+	X_BR,		/* if condition d, pc = i */
+	X_SOB,		/* if --d, pc = i */
+	X_TRAP,		/* through vector i; s holds the pc */
+	X_RTI,		/* pc = s, ps = d; i for rtt */
+
+	X_NUM
 };
 
+/* xlate op flags */
+#define XF_BYTE		1
+#define XF_SEXT		2	/* movb or mfps to a register */
+
+/* the register file */
+#define R_R0	0
+#define R_SP	6
+#define R_PC	7
+#define R_S0	8		/* scratch */
+#define R_S1	9
+#define R_S2	10
+#define R_S3	11
+#define R_Z	12		/* always 0 */
+#define R_PS	15
+
+/* where control goes after an instruction */
+#define F_NEXT		0
+#define F_BRANCH	1	/* to target or the next */
+#define F_JUMP		2	/* to target, if known */
+#define F_CALL		3	/* to target, if known, and back to the next */
+#define F_TRAP		4	/* through a vector and back to the next */
+#define F_STOP		5
+
+extern u22 pc;
+extern u16 isn;
+extern int flow;
+extern int target;
+extern int entry;
+extern char *xlate_name[];
+
+u16 read_mem(u22 addr);		/* from the decoder's user */
+void fetch(void);
+void decode(void);
+int get_xlate_fifo(u32 *v);
+
 
 
-
 /*
  * Local Variables:
  * indent-tabs-mode:nil
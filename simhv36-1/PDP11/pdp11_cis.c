@@ -82,10 +82,21 @@
 
    CIS instructions can run for a very long time, so they are interruptible
    and restartable.  In the simulator, all instructions run to completion.
-   The code is unoptimized.
+
+   The character string instructions work on runs of bytes: as much of
+   each string as lies in one page is mapped once (relocSpan) and then
+   moved, compared or scanned in host memory.  Interrupts are tested
+   between runs, so a long string can still be interrupted at any page
+   boundary.  A run that cannot be mapped (I/O page, a page that would
+   trap or abort, memory tracing) is done byte by byte as before; so is
+   everything while a binary trace (SET CPU TRACE) is recording, so the
+   string operands show up in its data references.  The
+   decimal instructions already do their arithmetic eight digits to a
+   word; only their operand fetch and store is byte by byte.
 */
 
 #include "pdp11_defs.h"
+#include "pdp11_trc.h"
 
 /* Opcode bits */
 
@@ -97,6 +108,13 @@
 
 #define INT_TEST        100
 
+/* Byte runs: bytes from a (16b) to the end of its page, or from the
+   start of its page to a - 1; l bytes at a, cut at the end of the page */
+
+#define PG_AFTER(a)     (020000 - ((a) & VA_DF))
+#define PG_BEFORE(a)    ((((a) - 1) & VA_DF) + 1)
+#define CIS_RUN(l,a)    (((l) < PG_AFTER (a))? (l): PG_AFTER (a))
+
 /* Operand type definitions */
 
 #define R0_DESC         1                               /* descr in R0:R1 */
@@ -192,6 +210,11 @@ void CreateTable (DSTR *dsrc, DSTR mtable[10]);
 t_bool cis_int_test (int32 cycles, int32 oldpc, t_stat *st);
 int32 movx_setup (int32 op, int32 *arg);
 void movx_cleanup (int32 op);
+int32 movx_span (int32 op, t_bool bkwd);
+void movx_fill (int32 va, int32 lnt);
+int32 cmpc_span (int32 *c, int32 *t);
+int32 cis_skip (uint8 *p, int32 lnt, int32 c);
+int32 cis_same (uint8 *p1, uint8 *p2, int32 lnt);
 
 extern int32 ReadW (int32 addr);
 extern void WriteW (int32 data, int32 addr);
@@ -199,6 +222,12 @@ extern int32 ReadB (int32 addr);
 extern int32 ReadMB (int32 addr);
 extern void WriteB (int32 data, int32 addr);
 extern int32 calc_ints (int32 nipl, int32 trq);
+extern uint8 *relocSpan (int32 va, int32 lnt, int32 acc);
+extern TRC_REC *trc_rec;
+
+/* Map a run, unless a binary trace wants every byte reference */
+
+#define CIS_SPAN(va,lnt,acc)    (trc_rec? NULL: relocSpan (va, lnt, acc))
 
 /* Table of instruction operands */
 
@@ -331,12 +360,13 @@ static unsigned char movbuf[65536];
 
 t_stat cis11 (int32 IR)
 {
-int32 c, i, j, t, op, rn, addr;
+int32 c, i, j, k, n, t, op, rn, addr;
 int32 match, limit, mvlnt, shift;
 int32 spc, ldivd, ldivr;
 int32 arg[6];                                           /* operands */
 int32 old_PC;
 uint32 nc, digit, result;
+uint8 *sp, *tp, *cp;
 t_stat st;
 static DSTR accum, src1, src2, dst;
 static DSTR mptable[10];
@@ -429,14 +459,17 @@ switch (op) {                                           /* case on opcode */
         if (R[0] && R[2]) {                             /* move to do? */
             if (R[1] < R[3]) {                          /* backwards? */
                 for (i = 0; R[0] && R[2]; ) {           /* move loop */
-                    t = ReadB (((R[1] - 1) & 0177777) | dsenable);
-                    if (op & 2) t = ReadB (((R[5] + t) & 0177777) | dsenable);
-                    WriteB (t, ((R[3] - 1) & 0177777) | dsenable);
-                    R[0]--;
-                    R[1] = (R[1] - 1) & 0177777;
-                    R[2]--;
-                    R[3] = (R[3] - 1) & 0177777;
-                    if ((++i >= INT_TEST) && R[0] && R[2]) {
+                    if ((n = movx_span (op, TRUE)) == 0) {  /* byte by byte? */
+                        t = ReadB (((R[1] - 1) & 0177777) | dsenable);
+                        if (op & 2) t = ReadB (((R[5] + t) & 0177777) | dsenable);
+                        WriteB (t, ((R[3] - 1) & 0177777) | dsenable);
+                        R[0]--;
+                        R[1] = (R[1] - 1) & 0177777;
+                        R[2]--;
+                        R[3] = (R[3] - 1) & 0177777;
+                        n = 1;
+                        }
+                    if (((i = i + n) >= INT_TEST) && R[0] && R[2]) {
                         if (cis_int_test (i, old_PC, &st)) return st;
                         i = 0;
                         }
@@ -446,23 +479,24 @@ switch (op) {                                           /* case on opcode */
                 }                                       /* end if bkwd */
             else {                                      /* forward */
                 for (i = 0; R[0] && R[2]; ) {           /* move loop */
-                    t = ReadB ((R[1] & 0177777) | dsenable);
-                    if (op & 2) t = ReadB (((R[5] + t) & 0177777) | dsenable);
-                    WriteB (t, (R[3] & 0177777) | dsenable);
-                    R[0]--;
-                    R[1] = (R[1] + 1) & 0177777;
-                    R[2]--;
-                    R[3] = (R[3] + 1) & 0177777;
-                    if ((++i >= INT_TEST) && R[0] && R[2]) {
+                    if ((n = movx_span (op, FALSE)) == 0) { /* byte by byte? */
+                        t = ReadB ((R[1] & 0177777) | dsenable);
+                        if (op & 2) t = ReadB (((R[5] + t) & 0177777) | dsenable);
+                        WriteB (t, (R[3] & 0177777) | dsenable);
+                        R[0]--;
+                        R[1] = (R[1] + 1) & 0177777;
+                        R[2]--;
+                        R[3] = (R[3] + 1) & 0177777;
+                        n = 1;
+                        }
+                    if (((i = i + n) >= INT_TEST) && R[0] && R[2]) {
                         if (cis_int_test (i, old_PC, &st)) return st;
                         i = 0;
                         }
                     }                                   /* end for lnts */
                 }                                       /* end else fwd */
             }                                           /* end if move */
-        for (i = 0; i < R[2]; i++) {
-            WriteB (R[4], ((R[3] + i) & 0177777) | dsenable);
-            }
+        movx_fill (R[3], R[2]);                         /* fill */
         movx_cleanup (op);                              /* cleanup */
         return SCPE_OK;
 
@@ -507,13 +541,16 @@ switch (op) {                                           /* case on opcode */
         if (R[0] && R[2]) {                             /* move to do? */
             if (R[1] < R[3]) {                          /* backwards? */
                 for (i = 0; R[0] && R[2]; ) {           /* move loop */
-                    t = ReadB (((R[1] - 1) & 0177777) | dsenable);
-                    WriteB (t, ((R[3] - 1) & 0177777) | dsenable);
-                    R[0]--;
-                    R[1] = (R[1] - 1) & 0177777;
-                    R[2]--;
-                    R[3] = (R[3] - 1) & 0177777;
-                    if ((++i >= INT_TEST) && R[0] && R[2]) {
+                    if ((n = movx_span (op, TRUE)) == 0) {  /* byte by byte? */
+                        t = ReadB (((R[1] - 1) & 0177777) | dsenable);
+                        WriteB (t, ((R[3] - 1) & 0177777) | dsenable);
+                        R[0]--;
+                        R[1] = (R[1] - 1) & 0177777;
+                        R[2]--;
+                        R[3] = (R[3] - 1) & 0177777;
+                        n = 1;
+                        }
+                    if (((i = i + n) >= INT_TEST) && R[0] && R[2]) {
                         if (cis_int_test (i, old_PC, &st)) return st;
                         i = 0;
                         }
@@ -521,13 +558,16 @@ switch (op) {                                           /* case on opcode */
                 }                                       /* end if bkwd */
             else {                                      /* forward */
                 for (i = 0; R[0] && R[2]; ) {           /* move loop */
-                    t = ReadB ((R[1] & 0177777) | dsenable);
-                    WriteB (t, (R[3] & 0177777) | dsenable);
-                    R[0]--;
-                    R[1] = (R[1] + 1) & 0177777;
-                    R[2]--;
-                    R[3] = (R[3] + 1) & 0177777;
-                    if ((++i >= INT_TEST) && R[0] && R[2]) {
+                    if ((n = movx_span (op, FALSE)) == 0) { /* byte by byte? */
+                        t = ReadB ((R[1] & 0177777) | dsenable);
+                        WriteB (t, (R[3] & 0177777) | dsenable);
+                        R[0]--;
+                        R[1] = (R[1] + 1) & 0177777;
+                        R[2]--;
+                        R[3] = (R[3] + 1) & 0177777;
+                        n = 1;
+                        }
+                    if (((i = i + n) >= INT_TEST) && R[0] && R[2]) {
                         if (cis_int_test (i, old_PC, &st)) return st;
                         i = 0;
                         }
@@ -536,9 +576,7 @@ switch (op) {                                           /* case on opcode */
                 R[3] = (R[3] - mvlnt) & 0177777;        /* start of dst str */
                 }                                       /* end else fwd */
             }                                           /* end if move */
-        for (i = 0; i < R[2]; i++) {
-            WriteB (R[4], ((R[3] - R[2] + i) & 0177777) | dsenable);
-            }
+        movx_fill ((R[3] - R[2]) & 0177777, R[2]);      /* fill */
         movx_cleanup (op);                              /* cleanup */
         return SCPE_OK;
 
@@ -589,11 +627,23 @@ switch (op) {                                           /* case on opcode */
         fpd = 1;                                        /* set FPD */
         R[4] = R[4] & 0377;                             /* match character */
         for (i = 0; R[0] != 0;) {                       /* loop */
-            c = ReadB (R[1] | dsenable);                /* get char */
-            if ((c == R[4]) ^ (op & 1)) break;          /* = + LOC, != + SKP? */
-            R[0]--;                                     /* decr count, */
-            R[1] = (R[1] + 1) & 0177777;                /* incr addr */
-            if ((++i >= INT_TEST) && R[0]) {            /* test for intr? */
+            n = CIS_RUN (R[0], R[1]);                   /* run in page */
+            if (sp = CIS_SPAN (R[1] | dsenable, n, READ)) {
+                if (op & 1) k = cis_skip (sp, n, R[4]); /* SKP */
+                else k = (cp = (uint8 *) memchr (sp, R[4], n))? /* LOC */
+                    (int32) (cp - sp): n;
+                R[0] = R[0] - k;                        /* skip matches */
+                R[1] = (R[1] + k) & 0177777;
+                if (k < n) break;                       /* stopped in run? */
+                }
+            else {                                      /* byte by byte */
+                c = ReadB (R[1] | dsenable);            /* get char */
+                if ((c == R[4]) ^ (op & 1)) break;      /* = + LOC, != + SKP? */
+                R[0]--;                                 /* decr count, */
+                R[1] = (R[1] + 1) & 0177777;            /* incr addr */
+                n = 1;
+                }
+            if (((i = i + n) >= INT_TEST) && R[0]) {    /* test for intr? */
                 if (cis_int_test (i, old_PC, &st)) return st;
                 i = 0;
                 }
@@ -641,12 +691,24 @@ switch (op) {                                           /* case on opcode */
         fpd = 1;                                        /* set FPD */
         R[4] = R[4] & 0377;                             /* match character */
         for (i = 0; R[0] != 0;) {                       /* loop */
-            t = ReadB (R[1] | dsenable);                /* get char as index */
-            c = ReadB (((R[5] + t) & 0177777) | dsenable);
-            if (((c & R[4]) != 0) ^ (op & 1)) break;    /* != + SCN, = + SPN? */
-            R[0]--;                                     /* decr count, */
-            R[1] = (R[1] + 1) & 0177777;                /* incr addr */
-            if ((++i >= INT_TEST) && R[0]) {            /* test for intr? */
+            n = CIS_RUN (R[0], R[1]);                   /* run in page */
+            if ((sp = CIS_SPAN (R[1] | dsenable, n, READ)) &&
+                (tp = CIS_SPAN (R[5] | dsenable, 256, READ))) {
+                for (k = 0; (k < n) &&                  /* scan run */
+                    (((tp[sp[k]] & R[4]) != 0) == (op & 1)); k++) ;
+                R[0] = R[0] - k;                        /* skip matches */
+                R[1] = (R[1] + k) & 0177777;
+                if (k < n) break;                       /* stopped in run? */
+                }
+            else {                                      /* byte by byte */
+                t = ReadB (R[1] | dsenable);            /* get char as index */
+                c = ReadB (((R[5] + t) & 0177777) | dsenable);
+                if (((c & R[4]) != 0) ^ (op & 1)) break; /* != + SCN, = + SPN? */
+                R[0]--;                                 /* decr count, */
+                R[1] = (R[1] + 1) & 0177777;            /* incr addr */
+                n = 1;
+                }
+            if (((i = i + n) >= INT_TEST) && R[0]) {    /* test for intr? */
                 if (cis_int_test (i, old_PC, &st)) return st;
                 i = 0;
                 }
@@ -701,20 +763,26 @@ switch (op) {                                           /* case on opcode */
         R[4] = R[4] & 0377;                             /* mask fill */
         c = t = 0;
         for (i = 0; (R[0] || R[2]); ) {                   /* until cnts == 0 */
-            if (R[0]) c = ReadB (R[1] | dsenable);      /* get src1 or fill */
-            else c = R[4];
-            if (R[2]) t = ReadB (R[3] | dsenable);      /* get src2 or fill */
-            else t = R[4];
-            if (c != t) break;                          /* if diff, done */
-            if (R[0]) {                                 /* if more src1 */
-                R[0]--;                                 /* decr count, */
-                R[1] = (R[1] + 1) & 0177777;            /* incr addr */
+            if ((n = cmpc_span (&c, &t)) >= 0) {        /* run in memory? */
+                if (c != t) break;                      /* if diff, done */
                 }
-            if (R[2]) {                                 /* if more src2 */
-                R[2]--;                                 /* decr count, */
-                R[3] = (R[3] + 1) & 0177777;            /* incr addr */
+            else {                                      /* byte by byte */
+                if (R[0]) c = ReadB (R[1] | dsenable);  /* get src1 or fill */
+                else c = R[4];
+                if (R[2]) t = ReadB (R[3] | dsenable);  /* get src2 or fill */
+                else t = R[4];
+                if (c != t) break;                      /* if diff, done */
+                if (R[0]) {                             /* if more src1 */
+                    R[0]--;                             /* decr count, */
+                    R[1] = (R[1] + 1) & 0177777;        /* incr addr */
+                    }
+                if (R[2]) {                             /* if more src2 */
+                    R[2]--;                             /* decr count, */
+                    R[3] = (R[3] + 1) & 0177777;        /* incr addr */
+                    }
+                n = 1;
                 }
-            if ((++i >= INT_TEST) && (R[0] || R[2])) {  /* test for intr? */
+            if (((i = i + n) >= INT_TEST) && (R[0] || R[2])) { /* test for intr? */
                 if (cis_int_test (i, old_PC, &st)) return st;
                 i = 0;
                 }
@@ -1560,6 +1628,159 @@ fpd = 0;                                                /* instr done */
 return;
 }
     
+/* Move a run of bytes in host memory, for MOVC class instructions
+
+   Inputs:
+        op      =       opcode, <1> set for translate
+        bkwd    =       TRUE to move down from R1, R3
+   Outputs:
+        n       =       bytes moved, 0 if the run could not be mapped
+
+   The run ends with the shorter string or at a page boundary in either
+   string.  Bytes go in the same order as the byte loop, so overlapping
+   strings (also through aliased pages) and a translation table that is
+   overwritten come out the same; memmove is used when that order makes
+   no difference.  R0:R3 are updated as the byte loop would leave them.
+*/
+
+int32 movx_span (int32 op, t_bool bkwd)
+{
+int32 k, n, sa, da;
+uint8 *sp, *dp, *tp;
+
+n = (R[0] < R[2])? R[0]: R[2];
+if (bkwd) {
+    if (n > PG_BEFORE (R[1])) n = PG_BEFORE (R[1]);
+    if (n > PG_BEFORE (R[3])) n = PG_BEFORE (R[3]);
+    sa = (R[1] - n) & 0177777;
+    da = (R[3] - n) & 0177777;
+    }
+else {
+    n = CIS_RUN (n, R[1]);
+    n = CIS_RUN (n, R[3]);
+    sa = R[1];
+    da = R[3];
+    }
+if ((sp = CIS_SPAN (sa | dsenable, n, READ)) == NULL) return 0;
+tp = NULL;
+if ((op & 2) && ((tp = CIS_SPAN (R[5] | dsenable, 256, READ)) == NULL))
+    return 0;
+if ((dp = CIS_SPAN (da | dsenable, n, WRITE)) == NULL) return 0;
+if (tp) {                                               /* translate */
+    if (bkwd) for (k = n - 1; k >= 0; k--) dp[k] = tp[sp[k]];
+    else for (k = 0; k < n; k++) dp[k] = tp[sp[k]];
+    }
+else if (bkwd && (dp < sp) && ((dp + n) > sp)) {        /* overlap against */
+    for (k = n - 1; k >= 0; k--) dp[k] = sp[k];         /* the move? */
+    }
+else if (!bkwd && (sp < dp) && ((sp + n) > dp)) {
+    for (k = 0; k < n; k++) dp[k] = sp[k];
+    }
+else memmove (dp, sp, n);
+R[0] = R[0] - n;
+R[2] = R[2] - n;
+if (bkwd) {
+    R[1] = sa;
+    R[3] = da;
+    }
+else {
+    R[1] = (R[1] + n) & 0177777;
+    R[3] = (R[3] + n) & 0177777;
+    }
+return n;
+}
+
+/* Fill a string with R4<7:0>, for MOVC class instructions */
+
+void movx_fill (int32 va, int32 lnt)
+{
+int32 n;
+uint8 *dp;
+
+for ( ; lnt > 0; lnt = lnt - n, va = (va + n) & 0177777) {
+    n = CIS_RUN (lnt, va);
+    if (((R[4] & ~0377) == 0) &&                        /* clean fill char? */
+        (dp = CIS_SPAN (va | dsenable, n, WRITE))) memset (dp, R[4], n);
+    else {
+        WriteB (R[4], va | dsenable);                   /* byte by byte */
+        n = 1;
+        }
+    }
+return;
+}
+
+/* Compare a run of bytes in host memory, for CMPC
+
+   Outputs:
+        n       =       bytes that compared equal, -1 if the run could
+                        not be mapped
+        *c, *t  =       last src1 and src2 (or fill) bytes compared; they
+                        differ if the run stopped at a mismatch
+
+   A string that has run out is compared as its fill character.  R0:R3
+   are advanced past the bytes that compared equal.
+*/
+
+int32 cmpc_span (int32 *c, int32 *t)
+{
+int32 j, k, n;
+uint8 *s1, *s2;
+
+if (R[0] && R[2]) n = CIS_RUN (CIS_RUN (R[0], R[1]), R[3]);
+else if (R[0]) n = CIS_RUN (R[0], R[1]);
+else n = CIS_RUN (R[2], R[3]);
+s1 = s2 = NULL;
+if (R[0] && ((s1 = CIS_SPAN (R[1] | dsenable, n, READ)) == NULL))
+    return -1;
+if (R[2] && ((s2 = CIS_SPAN (R[3] | dsenable, n, READ)) == NULL))
+    return -1;
+if (s1 && s2) k = cis_same (s1, s2, n);
+else if (s1) k = cis_skip (s1, n, R[4]);
+else k = cis_skip (s2, n, R[4]);
+j = (k < n)? k: k - 1;                                  /* last compared */
+*c = s1? s1[j]: R[4];
+*t = s2? s2[j]: R[4];
+if (R[0]) {
+    R[0] = R[0] - k;
+    R[1] = (R[1] + k) & 0177777;
+    }
+if (R[2]) {
+    R[2] = R[2] - k;
+    R[3] = (R[3] + k) & 0177777;
+    }
+return k;
+}
+
+/* Count leading bytes equal to c, or equal in two strings, a word at a time */
+
+int32 cis_skip (uint8 *p, int32 lnt, int32 c)
+{
+int32 k;
+uint32 w, pat;
+
+pat = ((uint32) c & 0377) * 0x01010101;
+for (k = 0; (k + 4) <= lnt; k = k + 4) {
+    memcpy (&w, p + k, 4);
+    if (w != pat) break;
+    }
+while ((k < lnt) && (p[k] == c)) k++;
+return k;
+}
+
+int32 cis_same (uint8 *p1, uint8 *p2, int32 lnt)
+{
+int32 k;
+uint32 w1, w2;
+
+for (k = 0; (k + 4) <= lnt; k = k + 4) {
+    memcpy (&w1, p1 + k, 4);
+    memcpy (&w2, p2 + k, 4);
+    if (w1 != w2) break;
+    }
+while ((k < lnt) && (p1[k] == p2[k])) k++;
+return k;
+}
+
 /* Test for CIS mid-instruction interrupt - stub for now */
 
 t_bool cis_int_test (int32 cycles, int32 oldpc, t_stat *st)
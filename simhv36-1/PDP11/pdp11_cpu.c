@@ -197,7 +197,8 @@
       under the interrupt priority level, ipl.  If any interrupt request
       is not masked, the interrupt bit is set in trap_req.  While most
       interrupts are handled centrally, a device can supply an interrupt
-      acknowledge routine.
+      acknowledge routine.  Word int_lvl summarizes which levels have
+      requests, so that the search for the highest one is a bit scan.
 
    3. PSW handling.  The PSW is kept as components, for easier access.
       Because the PSW can be explicitly written as address 17777776,
@@ -213,6 +214,9 @@
 
 #include "pdp11_defs.h"
 #include "pdp11_cpumod.h"
+#include "pdp11_trc.h"
+#include "sim_trace.h"
+#include "sim_stats.h"
 #include "stubs.h"
 
 #define PCQ_SIZE        64                              /* must be 2**n */
@@ -244,14 +248,25 @@ typedef struct {
     uint16              inst[HIST_ILNT];
     } InstHistory;
 
+/* Binary trace: note a data reference in the current record */
+
+#define TRC_PA(x)       if (trc_rec && (trc_rec->npa < TRC_MAXPA)) \
+                            trc_rec->pa[trc_rec->npa++] = (x)
+#define TRC_PAW(x)      if (trc_rec && (trc_rec->npa < TRC_MAXPA)) { \
+                            trc_rec->wr |= 1u << trc_rec->npa; \
+                            trc_rec->pa[trc_rec->npa++] = (x); }
+
 /* Global state */
 
 extern FILE *sim_log;
 extern int max_cycles;
 extern int show_i;
+extern int show_m;
 extern int isn_count;
 static int isn_last;
 static int need_stop;
+static int32 hook_stop;
+static int32 stop_armed;
 
 uint16 *M = NULL;                                       /* memory */
 int32 REGFILE[6][2] = { 0 };                            /* R0-R5, two sets */
@@ -269,6 +284,7 @@ int32 PSW = 0;                                          /* PSW */
 int32 wait_state = 0;                                   /* wait state */
 int32 trap_req = 0;                                     /* trap requests */
 int32 int_req[IPL_HLVL] = { 0 };                        /* interrupt requests */
+uint32 int_lvl = 0;                                     /* levels requesting */
 int32 PIRQ = 0;                                         /* programmed int req */
 int32 STKLIM = 0;                                       /* stack limit */
 fpac_t FR[6] = { 0 };                                   /* fp accumulators */
@@ -298,15 +314,27 @@ jmp_buf save_env;                                       /* abort handler */
 int32 hst_p = 0;                                        /* history pointer */
 int32 hst_lnt = 0;                                      /* history length */
 InstHistory *hst = NULL;                                /* instruction history */
+SIM_TRACE *trc_str = NULL;                              /* binary trace */
+TRC_REC *trc_rec = NULL;                                /* record filling */
+FILE *trc_fref = NULL;                                  /* trace file */
+TRC_CODER trc_coder;                                    /* trace coder */
+t_uint64 cpu_icnt = 0;                                  /* instructions */
+t_uint64 trap_cnt[TRAP_V_MAX] = { 0 };                  /* traps taken */
 int32 dsmask[4] = { MMR3_KDS, MMR3_SDS, 0, MMR3_UDS };  /* dspace enables */
+int32 cpu_stop_pc = -1;                                 /* host stop PC */
+int32 (*cpu_pc_hook) (int32 pc, int32 ir) = NULL;       /* host PC hook */
 
 extern int32 CPUERR, MAINT;
 extern int32 sim_interval;
+extern int32 sim_resume;
+extern int32 sim_end;
+extern void *(*sim_vm_mem) (UNIT *uptr, t_addr *size);
 extern UNIT clk_unit, pclk_unit;
 extern int32 sim_int_char;
 extern uint32 sim_switches;
 extern uint32 sim_brk_types, sim_brk_dflt, sim_brk_summ; /* breakpoint info */
 extern DEVICE *sim_devices[];
+extern void io_stats (SIM_STATS *sp);
 extern CPUTAB cpu_tab[];
 
 /* Function declarations */
@@ -314,13 +342,23 @@ extern CPUTAB cpu_tab[];
 t_stat cpu_ex (t_value *vptr, t_addr addr, UNIT *uptr, int32 sw);
 t_stat cpu_dep (t_value val, t_addr addr, UNIT *uptr, int32 sw);
 t_stat cpu_reset (DEVICE *dptr);
+void *cpu_mem (UNIT *uptr, t_addr *size);
+void cpu_load_regs (void);
 t_stat cpu_set_hist (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, void *desc);
+void cpu_fprint_hist (FILE *st, int32 pc, int32 psw, int32 src, int32 dst,
+    uint16 *inst);
+uint32 cpu_inst_words (uint16 *inst);
+t_stat cpu_set_trace (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat cpu_clr_trace (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat cpu_show_trace (FILE *st, UNIT *uptr, int32 val, void *desc);
+void cpu_stats (SIM_STATS *sp);
 t_stat cpu_show_virt (FILE *st, UNIT *uptr, int32 val, void *desc);
 int32 GeteaB (int32 spec);
 int32 GeteaW (int32 spec);
 int32 relocR (int32 addr);
 int32 relocW (int32 addr);
+uint8 *relocSpan (int32 va, int32 lnt, int32 acc);
 void relocR_test (int32 va, int32 apridx);
 void relocW_test (int32 va, int32 apridx);
 t_bool PLF_test (int32 va, int32 apr);
@@ -348,6 +386,9 @@ extern t_stat build_dib_tab (void);
 extern t_stat show_iospace (FILE *st, UNIT *uptr, int32 val, void *desc);
 extern t_stat set_autocon (UNIT *uptr, int32 val, char *cptr, void *desc);
 extern t_stat show_autocon (FILE *st, UNIT *uptr, int32 val, void *desc);
+extern t_stat fp_set_fast (UNIT *uptr, int32 val, char *cptr, void *desc);
+extern t_stat fp_show_fast (FILE *st, UNIT *uptr, int32 val, void *desc);
+extern t_stat fp_check (UNIT *uptr, int32 val, char *cptr, void *desc);
 extern t_stat iopageR (int32 *data, uint32 addr, int32 access);
 extern t_stat iopageW (int32 data, uint32 addr, int32 access);
 extern int32 calc_ints (int32 nipl, int32 trq);
@@ -374,6 +415,13 @@ int32 trap_clear[TRAP_V_MAX] = {                        /* trap clears */
     TRAP_YEL, TRAP_PWRFL, TRAP_FPE
     };
 
+static char *trap_name[TRAP_V_MAX] = {                  /* for SHOW STATS */
+    "RED", "ODD", "MME", "NXM",
+    "PAR", "PRV", "ILL", "BPT",
+    "IOT", "EMT", "TRAP", "TRC",
+    "YEL", "PWRFL", "FPE"
+    };
+
 /* CPU data structures
 
    cpu_dev      CPU device descriptor
@@ -585,6 +633,12 @@ MTAB cpu_mod[] = {
     { MTAB_XTD|MTAB_VDV, OPT_FIS, NULL, "NOFIS", &cpu_clr_opt },
     { MTAB_XTD|MTAB_VDV, OPT_FPP, NULL, "FPP", &cpu_set_opt },
     { MTAB_XTD|MTAB_VDV, OPT_FPP, NULL, "NOFPP", &cpu_clr_opt },
+    { MTAB_XTD|MTAB_VDV, 1, "FPFAST", "FPFAST",
+      &fp_set_fast, &fp_show_fast },
+    { MTAB_XTD|MTAB_VDV, 0, NULL, "NOFPFAST",
+      &fp_set_fast, NULL },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, NULL, "FPCHECK",
+      &fp_check, NULL },
     { MTAB_XTD|MTAB_VDV, OPT_CIS, NULL, "CIS", &cpu_set_opt },
     { MTAB_XTD|MTAB_VDV, OPT_CIS, NULL, "NOCIS", &cpu_clr_opt },
     { MTAB_XTD|MTAB_VDV, OPT_MMU, NULL, "MMU", &cpu_set_opt },
@@ -617,6 +671,10 @@ MTAB cpu_mod[] = {
       &set_autocon, NULL },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "HISTORY", "HISTORY",
       &cpu_set_hist, &cpu_show_hist },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_NC, 0, "TRACE", "TRACE",
+      &cpu_set_trace, &cpu_show_trace },
+    { MTAB_XTD|MTAB_VDV, 0, NULL, "NOTRACE",
+      &cpu_clr_trace, NULL },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP, 0, "VIRTUAL", NULL,
       NULL, &cpu_show_virt },
     { 0 }
@@ -646,8 +704,10 @@ t_stat reason;
         5. Interrupt system
 */
 
-reason = build_dib_tab ();                              /* build, chk dib_tab */
-if (reason != SCPE_OK) return reason;
+if (!sim_resume) {                                      /* config may differ? */
+    reason = build_dib_tab ();                          /* build, chk dib_tab */
+    if (reason != SCPE_OK) return reason;
+    }
 cpu_type = 1u << cpu_model;                             /* reset type mask */
 cpu_bme = (MMR3 & MMR3_BME) && (cpu_opt & OPT_UBM);     /* map enabled? */
 PC = saved_PC;
@@ -657,14 +717,20 @@ SP = STACKFILE[cm];
 isenable = calc_is (cm);
 dsenable = calc_ds (cm);
 put_PIRQ (PIRQ);                                        /* rewrite PIRQ */
+for (i = 0, int_lvl = 0; i < IPL_HLVL; i++) {           /* int_req may have */
+    if (int_req[i]) int_lvl = int_lvl | (1u << i);      /* been deposited */
+    }
 STKLIM = STKLIM & STKLIM_RW;                            /* clean up STKLIM */
 MMR0 = MMR0 | MMR0_IC;                                  /* usually on */
 
 trap_req = calc_ints (ipl, trap_req);                   /* upd int req */
 trapea = 0;
 reason = 0;
-sim_rtcn_init (clk_unit.wait, TMR_CLK);                 /* init line clock */
-sim_rtcn_init (pclk_unit.wait, TMR_PCLK);               /* init prog clock */
+stop_armed = 0;                                         /* no stop PC yet */
+if (!sim_resume) {                                      /* not a host re-entry? */
+    sim_rtcn_init (clk_unit.wait, TMR_CLK);             /* init line clock */
+    sim_rtcn_init (pclk_unit.wait, TMR_PCLK);           /* init prog clock */
+    }
 
 /* Abort handling
 
@@ -724,6 +790,12 @@ while (reason == 0)  {
         break;
 		}
 
+    if (hook_stop) {                                    /* host hook stop? */
+        hook_stop = 0;
+        reason = STOP_HOOK;
+        break;
+        }
+
     if (sim_interval <= 0) {                            /* intv cnt expired? */
         reason = sim_process_event ();                  /* process events */
         trap_req = calc_ints (ipl, trap_req);           /* recalc int req */
@@ -736,6 +808,7 @@ while (reason == 0)  {
             for (trapnum = 0; trapnum < TRAP_V_MAX; trapnum++) {
                 if ((t >> trapnum) & 1) {               /* trap set? */
                     trapea = trap_vec[trapnum];         /* get vec, clr */
+                    trap_cnt[trapnum] = trap_cnt[trapnum] + 1;
                     trap_req = trap_req & ~trap_clear[trapnum];
                     if ((stop_trap >> trapnum) & 1)     /* stop on trap? */
                         reason = trapnum + 1;
@@ -832,33 +905,50 @@ while (reason == 0)  {
         continue;
 		}
 
+    if ((PC == cpu_stop_pc) && stop_armed) {            /* host stop PC? */
+        reason = STOP_UNTIL;
+        continue;
+        }
+
     if (update_MM) {                                    /* if mm not frozen */
         MMR1 = 0;
         MMR2 = PC;
         }
     IR = ReadE (PC | isenable);                         /* fetch instruction */
 simh_report_pc(PC, IR);
+    if (cpu_pc_hook && (*cpu_pc_hook) (PC, IR))         /* host wants stop? */
+        hook_stop = 1;                                  /* after this inst */
+    stop_armed = 1;
     sim_interval = sim_interval - 1;
+    cpu_icnt = cpu_icnt + 1;
     srcspec = (IR >> 6) & 077;                          /* src, dst specs */
     dstspec = IR & 077;
     srcreg = (srcspec <= 07);                           /* src, dst = rmode? */
     dstreg = (dstspec <= 07);
     if (hst_lnt) {                                      /* record history? */
-        t_value val;
-        uint32 i;
         hst[hst_p].pc = PC | HIST_VLD;
         hst[hst_p].psw = get_PSW ();
         hst[hst_p].src = R[srcspec & 07];
         hst[hst_p].dst = R[dstspec & 07];
         hst[hst_p].inst[0] = IR;
-        for (i = 1; i < HIST_ILNT; i++) {
-            if (cpu_ex (&val, (PC + (i << 1)) & 0177777, &cpu_unit, SWMASK ('V')))
-                hst[hst_p].inst[i] = 0;
-            else hst[hst_p].inst[i] = (uint16) val;
-            }
+        cpu_inst_words (hst[hst_p].inst);
         hst_p = (hst_p + 1);
         if (hst_p >= hst_lnt) hst_p = 0;
         }
+    if (trc_str) {                                      /* binary trace? */
+        if (trc_rec) sim_trace_put (trc_str);           /* last inst done */
+        if (trc_rec = (TRC_REC *) sim_trace_slot (trc_str)) {
+            trc_rec->pc = PC;
+            trc_rec->psw = get_PSW ();
+            trc_rec->src = R[srcspec & 07];
+            trc_rec->dst = R[dstspec & 07];
+            trc_rec->inst[0] = IR;
+            trc_rec->ipa = cpu_inst_words (trc_rec->inst);
+            trc_rec->npa = 0;
+            trc_rec->wr = 0;
+            }
+        else cpu_clr_trace (NULL, 0, NULL, NULL);       /* writer gone */
+        }
 #if 1
     {
 	    unsigned short psw;
@@ -907,6 +997,7 @@ simh_report_pc(PC, IR);
 		    extern int show_i;
 		    if (show_i) printf("WAIT\n");
 	    }
+                sim_os_flush_out ();                    /* guest idle, show output */
                 if (wait_enable) wait_state = 1;
                 break;
             case 3:                                     /* BPT */
@@ -921,6 +1012,7 @@ simh_report_pc(PC, IR);
                     PIRQ = 0;                           /* clear PIRQ, STKLIM, */
                     STKLIM = 0;                         /* MMR0<15:12,0>, */
                     for (i = 0; i < IPL_HLVL; i++) int_req[i] = 0;
+                    int_lvl = 0;
                     MMR0 = MMR0 & ~(MMR0_MME | MMR0_FREEZE);
                     MMR3 = 0;                           /* MMR3 */
                     trap_req = trap_req & ~TRAP_INT;
@@ -2220,6 +2312,7 @@ if ((pa < IOPAGEBASE) ||                                /* I/O address */
         ABORT (TRAP_NXM);
         }
 if (iopageR (&data, pa, READ) != SCPE_OK) {             /* invalid I/O addr? */
+data = 0177777;                                         /* as the rtl bus */
 simh_record_io_read_word(pa, data);
     setCPUERR (CPUE_TMO);
     ABORT (TRAP_NXM);
@@ -2237,6 +2330,7 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     ABORT (TRAP_ODD);
     }
 pa = relocR (va);                                       /* relocate */
+TRC_PA (pa);
 if (ADDR_IS_MEM (pa)) {
 simh_record_mem_read_word(pa, M[pa>>1]);
 	return (M[pa >> 1]);              /* memory address? */
@@ -2246,6 +2340,7 @@ if (pa < IOPAGEBASE) {                                  /* I/O address? */
     ABORT (TRAP_NXM);
     }
 if (iopageR (&data, pa, READ) != SCPE_OK) {             /* invalid I/O addr? */
+data = 0177777;                                         /* as the rtl bus */
 simh_record_io_read_word(pa, data);
     setCPUERR (CPUE_TMO);
     ABORT (TRAP_NXM);
@@ -2259,6 +2354,7 @@ int32 ReadB (int32 va)
 int32 pa, data;
 
 pa = relocR (va);                                       /* relocate */
+TRC_PA (pa);
 if (ADDR_IS_MEM (pa)) {
 simh_record_mem_read_byte(pa, (va & 1? M[pa >> 1] >> 8: M[pa >> 1]) & 0377);
 	return (va & 1? M[pa >> 1] >> 8: M[pa >> 1]) & 0377;
@@ -2268,6 +2364,7 @@ if (pa < IOPAGEBASE) {                                  /* I/O address? */
     ABORT (TRAP_NXM);
     }
 if (iopageR (&data, pa, READ) != SCPE_OK) {             /* invalid I/O addr? */
+data = 0177777;                                         /* as the rtl bus */
 simh_record_io_read_byte(pa, (va & 1? data >> 8: data) & 0377);
     setCPUERR (CPUE_TMO);
     ABORT (TRAP_NXM);
@@ -2285,6 +2382,7 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     ABORT (TRAP_ODD);
     }
 last_pa = relocW (va);                                  /* reloc, wrt chk */
+TRC_PA (last_pa);
 if (ADDR_IS_MEM (last_pa)) {
 	simh_record_mem_read_word(last_pa, M[last_pa>>1] & 0xffff);
 	return (M[last_pa >> 1]);    /* memory address? */
@@ -2294,6 +2392,7 @@ if (last_pa < IOPAGEBASE) {                             /* I/O address? */
     ABORT (TRAP_NXM);
     }
 if (iopageR (&data, last_pa, READ) != SCPE_OK) {        /* invalid I/O addr? */
+data = 0177777;                                         /* as the rtl bus */
 simh_record_io_read_word(last_pa, data);
     setCPUERR (CPUE_TMO);
     ABORT (TRAP_NXM);
@@ -2307,6 +2406,7 @@ int32 ReadMB (int32 va)
 int32 data;
 
 last_pa = relocW (va);                                  /* reloc, wrt chk */
+TRC_PA (last_pa);
 if (ADDR_IS_MEM (last_pa)) {
 	simh_record_mem_read_byte(
 	       last_pa, (va & 1? M[last_pa >> 1] >> 8: M[last_pa >> 1]) & 0377);
@@ -2317,6 +2417,7 @@ if (last_pa < IOPAGEBASE) {                             /* I/O address? */
     ABORT (TRAP_NXM);
     }
 if (iopageR (&data, last_pa, READ) != SCPE_OK) {        /* invalid I/O addr? */
+data = 0177777;                                         /* as the rtl bus */
 simh_record_io_read_byte(va, ((va & 1)? data >> 8: data) & 0377);
     setCPUERR (CPUE_TMO);
     ABORT (TRAP_NXM);
@@ -2343,6 +2444,7 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     ABORT (TRAP_ODD);
     }
 pa = relocW (va);                                       /* relocate */
+TRC_PAW (pa);
 if (ADDR_IS_MEM (pa)) {                                 /* memory address? */
     simh_record_mem_write_word(pa, data);
     M[pa >> 1] = data;
@@ -2365,6 +2467,7 @@ void WriteB (int32 data, int32 va)
 int32 pa;
 
 pa = relocW (va);                                       /* relocate */
+TRC_PAW (pa);
 if (ADDR_IS_MEM (pa)) {                                 /* memory address? */
     simh_record_mem_write_byte(pa, data);
     if (va & 1) M[pa >> 1] = (M[pa >> 1] & 0377) | (data << 8);
@@ -2385,6 +2488,7 @@ return;
 
 void PWriteW (int32 data, int32 pa)
 {
+TRC_PAW (pa);
 if (ADDR_IS_MEM (pa)) {                                 /* memory address? */
     simh_record_mem_write_word(pa, data);
     M[pa >> 1] = data;
@@ -2404,6 +2508,7 @@ return;
 
 void PWriteB (int32 data, int32 pa)
 {
+TRC_PAW (pa);
 if (ADDR_IS_MEM (pa)) {                                 /* memory address? */
     simh_record_mem_write_byte(pa, data);
     if (pa & 1) M[pa >> 1] = (M[pa >> 1] & 0377) | (data << 8);
@@ -2422,6 +2527,56 @@ if (iopageW (data, pa, WRITEB) != SCPE_OK) {            /* invalid I/O addr? */
 return;
 }
 
+/* Relocate a run of bytes for the string instructions
+
+   Inputs:
+        va      =       virtual address, <18:16> = mode, I/D space
+        lnt     =       number of bytes, all in the page holding va
+        acc     =       READ or WRITE
+   Outputs:
+        ptr     =       host address of the first byte, or NULL
+
+   A run is mapped only if every byte is in memory and can be accessed
+   without a trap or abort, so that the caller can work on host memory
+   directly.  Otherwise NULL is returned, and the caller goes byte by
+   byte through ReadB/WriteB, which take any trap or abort as before.
+   Bytes are in host order only on little endian hosts, and memory
+   tracing wants every access, so both also return NULL.
+*/
+
+uint8 *relocSpan (int32 va, int32 lnt, int32 acc)
+{
+int32 apridx, apr, pa, lim;
+
+if ((lnt <= 0) || (sim_end == 0) || show_m) return NULL;
+if (MMR0 & MMR0_MME) {                                  /* if mmgt */
+    if ((va ^ (va + lnt - 1)) & ~VA_DF) return NULL;    /* crosses page? */
+    apridx = (va >> VA_V_APF) & 077;                    /* index into APR */
+    apr = APRFILE[apridx];
+    if (acc == WRITE) {
+        if ((apr & PDR_ACF) != 6) return NULL;          /* not read/write? */
+        }
+    else if ((apr & PDR_PRD) != 2) return NULL;         /* not 2, 6? */
+    if (PLF_test (va, apr) || PLF_test (va + lnt - 1, apr))
+        return NULL;                                    /* pg lnt error? */
+    pa = ((va & VA_DF) + ((apr >> 10) & 017777700)) & PAMASK;
+    if ((MMR3 & MMR3_M22E) == 0) {                      /* 18b: below I/O pg */
+        pa = pa & 0777777;
+        lim = 0760000;
+        }
+    else lim = IOPAGEBASE;
+    }
+else {
+    pa = va & 0177777;                                  /* mmgt off */
+    lim = 0160000;
+    }
+if (((pa + lnt) > lim) || !ADDR_IS_MEM (pa + lnt - 1))  /* all in memory? */
+    return NULL;
+if ((acc == WRITE) && (MMR0 & MMR0_MME))                /* set W */
+    APRFILE[apridx] = apr | PDR_W;
+return ((uint8 *) M) + pa;
+}
+
 /* Relocate virtual address, read access
 
    Inputs:
@@ -2938,6 +3093,8 @@ trap_req = 0;
 wait_state = 0;
 if (M == NULL) M = (uint16 *) calloc (MEMSIZE >> 1, sizeof (uint16));
 if (M == NULL) return SCPE_MEM;
+sim_vm_mem = &cpu_mem;                                  /* no sim_vm_init here */
+sim_vm_stats = &cpu_stats;
 pcq_r = find_reg ("PCQ", NULL, dptr);
 if (pcq_r) pcq_r->qptr = 0;
 else return SCPE_IERR;
@@ -2950,6 +3107,30 @@ if (getenv("M")) max_cycles = atoi(getenv("M"));
 return SCPE_OK;
 }
 
+/* Memory array, for snapshots */
+
+void *cpu_mem (UNIT *uptr, t_addr *size)
+{
+if ((uptr != &cpu_unit) || (M == NULL)) return NULL;
+*size = MEMSIZE;
+return M;
+}
+
+/* Reload the working registers from the register files, as sim_instr
+   does on entry, after the saved state has been changed underneath */
+
+void cpu_load_regs (void)
+{
+int32 i, mrs, mcm;
+
+mrs = (PSW >> PSW_V_RS) & 01;
+mcm = (PSW >> PSW_V_CM) & 03;
+for (i = 0; i < 6; i++) R[i] = REGFILE[i][mrs];
+SP = STACKFILE[mcm];
+PC = saved_PC;
+return;
+}
+
 /* Memory examine */
 
 t_stat cpu_ex (t_value *vptr, t_addr addr, UNIT *uptr, int32 sw)
@@ -3037,13 +3218,10 @@ return SCPE_OK;
 
 t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, void *desc)
 {
-int32 j, k, di, lnt, ir;
+int32 k, di, lnt;
 char *cptr = (char *) desc;
-t_value sim_eval[HIST_ILNT];
 t_stat r;
 InstHistory *h;
-extern t_stat fprint_sym (FILE *ofile, t_addr addr, t_value *val,
-    UNIT *uptr, int32 sw);
 
 if (hst_lnt == 0) return SCPE_NOFNC;                    /* enabled? */
 if (cptr) {
@@ -3057,25 +3235,134 @@ fprintf (st, "PC     PSW     src    dst     IR\n\n");
 for (k = 0; k < lnt; k++) {                             /* print specified */
     h = &hst[(di++) % hst_lnt];                         /* entry pointer */
     if (h->pc & HIST_VLD) {                             /* instruction? */
-        ir = h->inst[0];
-        fprintf (st, "%06o %06o|", h->pc & ~HIST_VLD, h->psw);
-        if (((ir & 0070000) != 0) ||                    /* dops, eis, fpp */
-            ((ir & 0177000) == 0004000))                /* jsr */
-            fprintf (st, "%06o %06o  ", h->src, h->dst);
-        else if ((ir >= 0000100) &&                     /* not no opnd */
-            (((ir & 0007700) <  0000300) ||             /* not branch */
-             ((ir & 0007700) >= 0004000)))
-            fprintf (st, "       %06o  ", h->dst);
-        else fprintf (st, "               ");
-        for (j = 0; j < HIST_ILNT; j++) sim_eval[j] = h->inst[j];
-        if ((fprint_sym (st, h->pc & ~HIST_VLD, sim_eval, &cpu_unit, SWMASK ('M'))) > 0)
-            fprintf (st, "(undefined) %06o", h->inst[0]);
+        cpu_fprint_hist (st, h->pc & ~HIST_VLD, h->psw, h->src, h->dst,
+            h->inst);
         fputc ('\n', st);                               /* end line */
         }                                               /* end else instruction */
     }                                                   /* end for */
 return SCPE_OK;
 }
 
+/* Print one history entry, also used for the binary trace */
+
+void cpu_fprint_hist (FILE *st, int32 pc, int32 psw, int32 src, int32 dst,
+    uint16 *inst)
+{
+int32 j, ir;
+t_value sim_eval[HIST_ILNT];
+extern t_stat fprint_sym (FILE *ofile, t_addr addr, t_value *val,
+    UNIT *uptr, int32 sw);
+
+ir = inst[0];
+fprintf (st, "%06o %06o|", pc, psw);
+if (((ir & 0070000) != 0) ||                            /* dops, eis, fpp */
+    ((ir & 0177000) == 0004000))                        /* jsr */
+    fprintf (st, "%06o %06o  ", src, dst);
+else if ((ir >= 0000100) &&                             /* not no opnd */
+    (((ir & 0007700) <  0000300) ||                     /* not branch */
+     ((ir & 0007700) >= 0004000)))
+    fprintf (st, "       %06o  ", dst);
+else fprintf (st, "               ");
+for (j = 0; j < HIST_ILNT; j++) sim_eval[j] = inst[j];
+if ((fprint_sym (st, pc, sim_eval, &cpu_unit, SWMASK ('M'))) > 0)
+    fprintf (st, "(undefined) %06o", ir);
+return;
+}
+
+/* Instruction words after the IR at PC, for history and trace
+
+   Inputs:
+        inst    =       inst[0] is the IR, inst[1..HIST_ILNT-1] are filled
+   Outputs:
+        pa      =       physical address of PC
+   The words are usually in the same page as PC and are copied from
+   memory directly; otherwise they are examined as by EXAMINE -V, and
+   words that cannot be read are 0.
+*/
+
+uint32 cpu_inst_words (uint16 *inst)
+{
+uint8 *p;
+t_value val;
+uint32 i;
+
+if (p = relocSpan (PC | isenable, HIST_ILNT << 1, READ)) {
+    memcpy (inst + 1, p + 2, (HIST_ILNT - 1) << 1);
+    return (uint32) (p - (uint8 *) M);
+    }
+for (i = 1; i < HIST_ILNT; i++) {
+    if (cpu_ex (&val, (PC + (i << 1)) & 0177777, &cpu_unit, SWMASK ('V')))
+        inst[i] = 0;
+    else inst[i] = (uint16) val;
+    }
+return relocC (PC, 0);
+}
+
+/* Set binary trace: SET CPU TRACE=file starts a trace, replacing any
+   trace in progress; SET CPU NOTRACE ends it.  See pdp11_trc.c for the
+   record and file format, trcdec to print a trace. */
+
+t_stat cpu_set_trace (UNIT *uptr, int32 val, char *cptr, void *desc)
+{
+FILE *fref;
+
+if ((cptr == NULL) || (*cptr == 0)) return SCPE_MISVAL;
+cpu_clr_trace (NULL, 0, NULL, NULL);                    /* end old trace */
+fref = fopen (cptr, "wb");
+if (fref == NULL) return SCPE_OPENERR;
+if (fwrite (TRC_MAGIC, 1, TRC_HDRLNT, fref) != TRC_HDRLNT) {
+    fclose (fref);
+    return SCPE_IOERR;
+    }
+trc_init (&trc_coder);
+trc_str = sim_trace_open (fref, sizeof (TRC_REC), TRC_RING,
+    &trc_pack, &trc_coder, TRC_MAXPACK);
+if (trc_str == NULL) {                                  /* no writer? */
+    fclose (fref);
+    return SCPE_NOFNC;
+    }
+trc_fref = fref;
+return SCPE_OK;
+}
+
+t_stat cpu_clr_trace (UNIT *uptr, int32 val, char *cptr, void *desc)
+{
+t_stat r;
+
+if (trc_str == NULL) return SCPE_OK;
+if (trc_rec) sim_trace_put (trc_str);                   /* last inst */
+trc_rec = NULL;
+r = sim_trace_close (trc_str);                          /* drain */
+trc_str = NULL;
+if (fclose (trc_fref)) r = SCPE_IOERR;
+trc_fref = NULL;
+return r;
+}
+
+t_stat cpu_show_trace (FILE *st, UNIT *uptr, int32 val, void *desc)
+{
+if (trc_str == NULL) fprintf (st, "no trace\n");
+else fprintf (st, "trace, %.0f instructions, %.0f bytes\n",
+    (double) trc_str->recs, (double) trc_str->bytes);
+return SCPE_OK;
+}
+
+/* Statistics for SHOW STATS and the stats socket */
+
+void cpu_stats (SIM_STATS *sp)
+{
+int32 i;
+
+sim_stats_val (sp, "instructions", cpu_icnt);
+io_stats (sp);
+sim_stats_grp (sp, "traps");
+for (i = 0; i < TRAP_V_MAX; i++) {
+    if (trap_cnt[i]) sim_stats_val (sp, trap_name[i], trap_cnt[i]);
+    }
+sim_stats_end (sp);
+return;
+}
+
 /* Virtual address translation */
 
 t_stat cpu_show_virt (FILE *of, UNIT *uptr, int32 val, void *desc)
@@ -455,6 +455,8 @@ typedef struct {
 #define STOP_RQ         (TRAP_V_MAX + 6)                /* RQDX3 panic */
 #define STOP_SANITY     (TRAP_V_MAX + 7)                /* sanity timer exp */
 #define STOP_DTOFF      (TRAP_V_MAX + 8)                /* DECtape off reel */
+#define STOP_UNTIL      (TRAP_V_MAX + 9)                /* host stop PC */
+#define STOP_HOOK       (TRAP_V_MAX + 10)               /* host PC hook */
 #define IORETURN(f,v)   ((f)? (v): SCPE_OK)             /* cond error return */
 
 /* Timers */
@@ -764,9 +766,16 @@ typedef struct pdp_dib DIB;
 
 #define IVCL(dv)        ((IPL_##dv * 32) + INT_V_##dv)
 #define IREQ(dv)        int_req[IPL_##dv]
-#define SET_INT(dv)     int_req[IPL_##dv] = int_req[IPL_##dv] | (INT_##dv)
+#define SET_INT(dv)     int_lvl = int_lvl | (1u << IPL_##dv), \
+                        int_req[IPL_##dv] = int_req[IPL_##dv] | (INT_##dv)
 #define CLR_INT(dv)     int_req[IPL_##dv] = int_req[IPL_##dv] & ~(INT_##dv)
 
+/* int_lvl has bit n set if int_req[n] may be nonzero.  Setting a request
+   must set its level bit; clearing one may leave the bit set, and
+   calc_ints and get_vector drop it when they find the level empty. */
+
+extern uint32 int_lvl;
+
 /* Massbus definitions */
 
 #define MBA_NUM         2                               /* number of MBA's */
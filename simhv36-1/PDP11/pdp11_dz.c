@@ -379,7 +379,9 @@ return SCPE_OK;
    The DZ11 polls to see if asynchronous activity has occurred and now
    needs to be processed.  The polling interval is controlled by the clock
    simulator, so for most environments, it is calibrated to real time.
-   Typical polling intervals are 50-60 times per second.
+   Typical polling intervals are 50-60 times per second.  Where the
+   multiplexor library has a socket reactor, connections and input are
+   only looked for once it reports something has arrived.
 
    The simulator assumes that software enables all of the multiplexors,
    or none of them.
@@ -392,14 +394,16 @@ int32 dz, t, newln;
 for (dz = t = 0; dz < DZ_MUXES; dz++)                   /* check enabled */
     t = t | (dz_csr[dz] & CSR_MSE);
 if (t) {                                                /* any enabled? */
-    newln = tmxr_poll_conn (&dz_desc);                  /* poll connect */
-    if ((newln >= 0) && dz_mctl) {                      /* got a live one? */
-        dz = newln / DZ_LINES;                          /* get mux num */
-        if (dz_tcr[dz] & (1 << (newln + TCR_V_DTR)))    /* DTR set? */
-         dz_msr[dz] |= (1 << (newln + MSR_V_CD));       /* set cdet */
-        else dz_msr[dz] |= (1 << newln);                /* set ring */
+    if (tmxr_rx_pend (&dz_desc)) {                      /* conn or input? */
+        newln = tmxr_poll_conn (&dz_desc);              /* poll connect */
+        if ((newln >= 0) && dz_mctl) {                  /* got a live one? */
+            dz = newln / DZ_LINES;                      /* get mux num */
+            if (dz_tcr[dz] & (1 << (newln + TCR_V_DTR)))/* DTR set? */
+             dz_msr[dz] |= (1 << (newln + MSR_V_CD));   /* set cdet */
+            else dz_msr[dz] |= (1 << newln);            /* set ring */
+            }
+        tmxr_poll_rx (&dz_desc);                        /* poll input */
         }
-    tmxr_poll_rx (&dz_desc);                            /* poll input */
     dz_update_rcvi ();                                  /* upd rcv intr */
     tmxr_poll_tx (&dz_desc);                            /* poll output */
     dz_update_xmti ();                                  /* upd xmt intr */
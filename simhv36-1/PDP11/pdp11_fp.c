@@ -85,6 +85,14 @@
         immediate       for integers or floating point, only 16b are
                         accessed;  if the operand is 32b or 64b, these
                         are the high order 16b of the operand
+
+   Single precision, rounded ADDF, SUBF, MULF and DIVF are done in host
+   IEEE double precision where that gives the same result bit for bit:
+   see fastfp11.  Everything else, and any case the fast path cannot
+   prove, goes through the software routines.  SET CPU NOFPFAST turns
+   the fast path off; SET CPU FPCHECK=n compares it with the software
+   routines on n random operand pairs per operation.  Compiling with
+   FP_NOHOST (hosts without IEEE doubles) leaves it out.
 */
 
 #include "pdp11_defs.h"
@@ -137,6 +145,19 @@
 #define FP_BIAS         0200                            /* exponent bias */
 #define FP_GUARD        3                               /* guard bits */
 
+/* Host fast path: FP11 F format in IEEE double.  Both have a hidden
+   bit; FP11 is 0.1f x 2^(exp-200), IEEE is 1.f x 2^(exp-1777). */
+
+#define FFP_ADD         0                               /* operations */
+#define FFP_MUL         1
+#define FFP_DIV         2
+#define FFP_EBIAS       (01777 - (FP_BIAS + 1))         /* exp offset */
+#define FFP_V_FRAC      (52 - FP_V_HB)                  /* frac offset */
+#define FFP_SIGN        (((t_uint64) 1) << 63)
+#define FFP_LOW         ((((t_uint64) 1) << FFP_V_FRAC) - 1) /* below F lsb */
+#define FFP_HALF        (((t_uint64) 1) << (FFP_V_FRAC - 1)) /* F half lsb */
+#define FFP_MAXEDIFF    28                              /* exact add limit */
+
 /* Data lengths */
 
 #define WORD            2
@@ -199,6 +220,7 @@ extern jmp_buf save_env;
 extern uint32 cpu_type;
 extern int32 FEC, FEA, FPS;
 extern int32 CPUERR, trap_req;
+extern FILE *sim_log;
 extern int32 N, Z, V, C;
 extern int32 R[8];
 extern int32 STKLIM;
@@ -222,6 +244,11 @@ static const uint32 and_mask[33] = { 0,
     0x1FFFFFFF, 0x3FFFFFFF, 0x7FFFFFFF, 0xFFFFFFFF
     };
 int32 backup_PC;
+#if defined (FP_NOHOST)
+int32 fp_fast = 0;                                      /* host fast path */
+#else
+int32 fp_fast = 1;
+#endif
 int32 fpnotrap (int32 code);
 int32 GeteaFP (int32 spec, int32 len);
 
@@ -237,6 +264,10 @@ int32 modfp11 (fpac_t *src1, fpac_t *src2, fpac_t *frac);
 void frac_mulfp11 (fpac_t *src1, fpac_t *src2);
 int32 roundfp11 (fpac_t *src);
 int32 round_and_pack (fpac_t *fac, int32 exp, fpac_t *frac, int r);
+t_bool fastfp11 (fpac_t *facp, fpac_t *fsrcp, int32 op);
+t_stat fp_set_fast (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat fp_show_fast (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat fp_check (UNIT *uptr, int32 val, char *cptr, void *desc);
 
 extern int32 GeteaW (int32 spec);
 extern int32 ReadW (int32 addr);
@@ -469,7 +500,8 @@ switch ((IR >> 8) & 017) {                              /* decode IR<11:8> */
     case 002:                                           /* MULf */
         ReadFP (&fsrc, GeteaFP (dstspec, lenf), dstspec, lenf);
         F_LOAD (qdouble, FR[ac], fac);
-        newV = mulfp11 (&fac, &fsrc);
+        if (fp_fast && fastfp11 (&fac, &fsrc, FFP_MUL)) newV = 0;
+        else newV = mulfp11 (&fac, &fsrc);
         F_STORE (qdouble, fac, FR[ac]);
         FPS = setfcc (FPS, fac.h, newV);
         break;
@@ -486,7 +518,8 @@ switch ((IR >> 8) & 017) {                              /* decode IR<11:8> */
     case 004:                                           /* ADDf */
         ReadFP (&fsrc, GeteaFP (dstspec, lenf), dstspec, lenf);
         F_LOAD (qdouble, FR[ac], fac);
-        newV = addfp11 (&fac, &fsrc);
+        if (fp_fast && fastfp11 (&fac, &fsrc, FFP_ADD)) newV = 0;
+        else newV = addfp11 (&fac, &fsrc);
         F_STORE (qdouble, fac, FR[ac]);
         FPS = setfcc (FPS, fac.h, newV);
         break;
@@ -495,7 +528,8 @@ switch ((IR >> 8) & 017) {                              /* decode IR<11:8> */
         ReadFP (&fsrc, GeteaFP (dstspec, lenf), dstspec, lenf);
         F_LOAD (qdouble, FR[ac], fac);
         if (GET_EXP (fsrc.h) != 0) fsrc.h = fsrc.h ^ FP_SIGN;
-        newV = addfp11 (&fac, &fsrc);
+        if (fp_fast && fastfp11 (&fac, &fsrc, FFP_ADD)) newV = 0;
+        else newV = addfp11 (&fac, &fsrc);
         F_STORE (qdouble, fac, FR[ac]);
         FPS = setfcc (FPS, fac.h, newV);
         break;
@@ -507,7 +541,8 @@ switch ((IR >> 8) & 017) {                              /* decode IR<11:8> */
             fpnotrap (FEC_DZRO);
             ABORT (TRAP_INT);
             }
-        newV = divfp11 (&fac, &fsrc);
+        if (fp_fast && fastfp11 (&fac, &fsrc, FFP_DIV)) newV = 0;
+        else newV = divfp11 (&fac, &fsrc);
         F_STORE (qdouble, fac, FR[ac]);
         FPS = setfcc (FPS, fac.h, newV);
         break;
@@ -1077,6 +1112,181 @@ if (GET_BIT (quo.h, FP_V_HB + FP_GUARD) == 0) {
 return round_and_pack (facp, facexp, &quo, 1);
 }
 
+/* Host floating point fast path
+
+   Inputs:
+        facp    =       pointer to src1 (output)
+        fsrcp   =       pointer to src2, nonzero for divide
+        op      =       FFP_ADD, FFP_MUL, FFP_DIV
+   Outputs:
+        done    =       TRUE if result computed, FALSE to use software
+
+   The software routines form the exact result (the 64b working fraction
+   holds all of it for F format, unless an add aligns across more than
+   32 bits), then round by adding 1/2 LSB to the magnitude and
+   truncating.  The host does the same here:
+
+   - the product of two 24b fractions, and the sum of two whose
+     exponents differ by at most FFP_MAXEDIFF, fit in 53b, so the host
+     result is exact;
+   - the host quotient is correctly rounded to 53b.  It can only fall on
+     the other side of an F rounding boundary from the exact quotient by
+     landing on the boundary itself; that case is left to software.
+
+   The rounded magnitude is then truncated to F precision.  Zero and
+   unnormalized operands, D format, truncate mode, and results that
+   overflow or underflow (and may trap) are left to software.
+*/
+
+#if defined (FP_NOHOST)
+
+t_bool fastfp11 (fpac_t *facp, fpac_t *fsrcp, int32 op)
+{
+return FALSE;
+}
+
+#else
+
+static double fp_to_host (uint32 h)
+{
+t_uint64 r;
+double d;
+
+r = (((t_uint64) GET_SIGN (h)) << 63) |
+    (((t_uint64) (GET_EXP (h) + FFP_EBIAS)) << 52) |
+    (((t_uint64) (h & FP_FRACH)) << FFP_V_FRAC);
+memcpy (&d, &r, sizeof (d));
+return d;
+}
+
+t_bool fastfp11 (fpac_t *facp, fpac_t *fsrcp, int32 op)
+{
+int32 e1, e2, exp;
+double a, b;
+t_uint64 r;
+
+if (FPS & (FPS_D | FPS_T)) return FALSE;                /* F, rounded only */
+e1 = GET_EXP (facp->h);
+e2 = GET_EXP (fsrcp->h);
+if ((e1 == 0) || (e2 == 0)) return FALSE;              /* zero operand? */
+a = fp_to_host (facp->h);
+b = fp_to_host (fsrcp->h);
+switch (op) {
+
+    case FFP_ADD:
+        if ((e1 - e2 > FFP_MAXEDIFF) || (e2 - e1 > FFP_MAXEDIFF))
+            return FALSE;                               /* not exact? */
+        a = a + b;
+        break;
+
+    case FFP_MUL:
+        a = a * b;
+        break;
+
+    case FFP_DIV:
+        a = a / b;
+        break;
+
+    default:
+        return FALSE;
+        }
+memcpy (&r, &a, sizeof (r));
+if ((r & ~FFP_SIGN) == 0) {                             /* exact zero? */
+    *facp = zero_fac;
+    return TRUE;
+    }
+if ((op == FFP_DIV) && ((r & FFP_LOW) == FFP_HALF))     /* on a boundary? */
+    return FALSE;
+r = (r & FFP_SIGN) | (((r & ~FFP_SIGN) + FFP_HALF) & ~FFP_LOW); /* round */
+exp = (int32) ((r >> 52) & 03777) - FFP_EBIAS;
+if ((exp <= 0) || (exp > FP_M_EXP)) return FALSE;       /* unflo, ovflo? */
+facp->h = (((uint32) (r >> 63)) << FP_V_SIGN) | (exp << FP_V_EXP) |
+    (((uint32) (r >> FFP_V_FRAC)) & FP_FRACH);
+facp->l = 0;
+return TRUE;
+}
+
+#endif
+
+/* Set/show fast path */
+
+t_stat fp_set_fast (UNIT *uptr, int32 val, char *cptr, void *desc)
+{
+if (cptr) return SCPE_ARG;
+#if defined (FP_NOHOST)
+if (val) return SCPE_NOFNC;
+#endif
+fp_fast = val;
+return SCPE_OK;
+}
+
+t_stat fp_show_fast (FILE *st, UNIT *uptr, int32 val, void *desc)
+{
+fprintf (st, fp_fast? "FP fast path": "no FP fast path");
+return SCPE_OK;
+}
+
+/* Compare fast path and software on random F operands
+
+   Exponents are mostly near the bias, so that most pairs stay in range
+   and differ by little; the rest cover the whole range.  The machine's
+   FPS and error registers are preserved.
+*/
+
+t_stat fp_check (UNIT *uptr, int32 val, char *cptr, void *desc)
+{
+static const char *opname[3] = { "ADDF", "MULF", "DIVF" };
+uint32 n, i, seed, x, fast, bad;
+int32 op, k, sFPS, sFEC, sFEA, strap;
+fpac_t a[2], f, s;
+t_stat r;
+
+if (cptr == NULL) return SCPE_ARG;
+n = (uint32) get_uint (cptr, 10, 0x7FFFFFFF, &r);
+if ((r != SCPE_OK) || (n == 0)) return SCPE_ARG;
+sFPS = FPS;
+sFEC = FEC;
+sFEA = FEA;
+strap = trap_req;
+seed = 0x2545F491;
+for (op = FFP_ADD; op <= FFP_DIV; op++) {
+    for (i = fast = bad = 0; i < n; i++) {
+        for (k = 0; k < 2; k++) {                       /* random operands */
+            seed = seed ^ (seed << 13);
+            seed = seed ^ (seed >> 17);
+            seed = seed ^ (seed << 5);
+            x = seed;
+            a[k].h = (x & (FP_SIGN | FP_FRACH)) |       /* exp, 1..377 */
+                ((((x >> 24) & 3)?
+                (FP_BIAS - 8 + ((x >> 26) & 017)):
+                (1 + ((x >> 23) % FP_M_EXP))) << FP_V_EXP);
+            a[k].l = 0;
+            }
+        FPS = sFPS & ~(FPS_D | FPS_T);
+        f = a[0];
+        s = a[1];
+        if (!fastfp11 (&f, &s, op)) continue;
+        fast++;
+        s = a[1];
+        if (op == FFP_ADD) addfp11 (&a[0], &s);
+        else if (op == FFP_MUL) mulfp11 (&a[0], &s);
+        else divfp11 (&a[0], &s);
+        if (f.h != a[0].h) {
+            if (bad++ < 5) printf ("%s: host %011o, soft %011o\n",
+                opname[op], f.h, a[0].h);
+            }
+        }
+    printf ("%s: %d pairs, %d fast, %d mismatched\n", opname[op], n, fast, bad);
+    if (sim_log) fprintf (sim_log, "%s: %d pairs, %d fast, %d mismatched\n",
+        opname[op], n, fast, bad);
+    }
+FPS = sFPS;
+FEC = sFEC;
+FEA = sFEA;
+trap_req = strap;
+return SCPE_OK;
+}
+
 /* Update floating condition codes
    Note that FC is only set by STCfi via the integer condition codes
 
@@ -43,6 +43,7 @@
 */
 
 #include "pdp11_defs.h"
+#include "sim_stats.h"
 
 extern uint16 *M;
 extern int32 int_req[IPL_HLVL];
@@ -52,6 +53,7 @@ extern int32 trap_req, ipl;
 extern int32 cpu_log;
 extern int32 autcon_enb;
 extern int32 uba_last;
+extern int32 sim_end;
 extern FILE *sim_log;
 extern DEVICE *sim_devices[], cpu_dev;
 extern UNIT cpu_unit;
@@ -67,6 +69,9 @@ extern t_stat build_mbus_tab (DEVICE *dptr, DIB *dibp);
 static t_stat (*iodispR[IOPAGESIZE >> 1])(int32 *dat, int32 ad, int32 md);
 static t_stat (*iodispW[IOPAGESIZE >> 1])(int32 dat, int32 ad, int32 md);
 static DIB *iodibp[IOPAGESIZE >> 1];
+static t_uint64 iocntR[IOPAGESIZE >> 1];                /* accesses, SHOW STATS */
+static t_uint64 iocntW[IOPAGESIZE >> 1];
+static t_uint64 int_cnt[01000 >> 2];                    /* ints by vector */
 
 int32 int_vec[IPL_HLVL][32];                            /* int req to vector */
 
@@ -95,6 +100,7 @@ t_stat stat;
 
 idx = (pa & IOPAGEMASK) >> 1;
 if (iodispR[idx]) {
+    iocntR[idx] = iocntR[idx] + 1;
     stat = iodispR[idx] (data, pa, access);
     trap_req = calc_ints (ipl, trap_req);
     return stat;
@@ -109,6 +115,7 @@ t_stat stat;
 
 idx = (pa & IOPAGEMASK) >> 1;
 if (iodispW[idx]) {
+    iocntW[idx] = iocntW[idx] + 1;
     stat = iodispW[idx] (data, pa, access);
     trap_req = calc_ints (ipl, trap_req);
     return stat;
@@ -116,14 +123,44 @@ if (iodispW[idx]) {
 return SCPE_NXM;
 }
 
-/* Calculate interrupt outstanding */
+/* Bit scans: highest and lowest set bit of a nonzero word */
+
+#if defined (__GNUC__)
+#define INT_HIBIT(x)    (31 - __builtin_clz (x))
+#define INT_LOBIT(x)    __builtin_ctz (x)
+#else
+static int32 INT_HIBIT (uint32 x)
+{
+int32 n;
+
+for (n = 31; (x & (1u << n)) == 0; n--) ;
+return n;
+}
+
+static int32 INT_LOBIT (uint32 x)
+{
+int32 n;
+
+for (n = 0; (x & (1u << n)) == 0; n++) ;
+return n;
+}
+#endif
+
+/* Calculate interrupt outstanding
+
+   Only the levels above nipl that int_lvl marks are looked at; a marked
+   level found empty (its last request was cleared) is unmarked.
+*/
 
 int32 calc_ints (int32 nipl, int32 trq)
 {
+uint32 lvl;
 int32 i;
 
-for (i = IPL_HLVL - 1; i > nipl; i--) {
+while ((lvl = int_lvl & (~0u << (nipl + 1))) != 0) {    /* levels > nipl */
+    i = INT_HIBIT (lvl);
     if (int_req[i]) return (trq | TRAP_INT);
+    int_lvl = int_lvl & ~(1u << i);                     /* level now empty */
     }
 return (trq & ~TRAP_INT);
 }
@@ -132,19 +169,23 @@ return (trq & ~TRAP_INT);
 
 int32 get_vector (int32 nipl)
 {
-int32 i, j, t, vec;
-
-for (i = IPL_HLVL - 1; i > nipl; i--) {                 /* loop thru lvls */
-    t = int_req[i];                                     /* get level */
-    for (j = 0; t && (j < 32); j++) {                   /* srch level */
-        if ((t >> j) & 1) {                             /* irq found? */
-            int_req[i] = int_req[i] & ~(1u << j);       /* clr irq */
-            if (int_ack[i][j]) vec = int_ack[i][j]();
-            else vec = int_vec[i][j];
-            return vec;                                 /* return vector */
-            }                                           /* end if t */
-        }                                               /* end for j */
-    }                                                   /* end for i */
+uint32 lvl, t;
+int32 i, j, vec;
+
+while ((lvl = int_lvl & (~0u << (nipl + 1))) != 0) {    /* levels > nipl */
+    i = INT_HIBIT (lvl);                                /* highest level */
+    t = (uint32) int_req[i];
+    if (t == 0) {                                       /* level empty? */
+        int_lvl = int_lvl & ~(1u << i);
+        continue;
+        }
+    j = INT_LOBIT (t);                                  /* rightmost irq */
+    int_req[i] = int_req[i] & ~(1u << j);               /* clr irq */
+    if (int_ack[i][j]) vec = int_ack[i][j]();
+    else vec = int_vec[i][j];
+    int_cnt[(vec >> 2) & 0177] = int_cnt[(vec >> 2) & 0177] + 1;
+    return vec;                                         /* return vector */
+    }
 return 0;
 }
 
@@ -202,6 +243,75 @@ else uba_last = (IOPAGEBASE + off) & PAMASK;            /* yes, use fixed */
 return uba_last;
 }
 
+/* Map a run of bus addresses - caller checks cpu_bme
+
+   Inputs:
+        ba      =       bus address
+        lim     =       end of the transfer
+        *lnt    =       returned length
+   Outputs:
+        ma      =       memory address of ba
+        *lnt    =       bytes from ba, at most lim - ba, that map to
+                        consecutive memory addresses from ma
+
+   The run goes on through map pages whose registers are consecutive,
+   so a transfer the OS mapped contiguously is one run.  It stops
+   short of the fixed last page and of address wraparound.  Whether
+   the run is in memory is for the caller to check; uba_last is not
+   changed.
+*/
+
+static uint32 Map_Span (uint32 ba, uint32 lim, uint32 *lnt)
+{
+int32 pg = UBM_GETPN (ba);
+uint32 ma, n;
+
+if (pg == UBM_M_PN) {                                   /* last page? */
+    *lnt = lim - ba;                                    /* never memory */
+    return (IOPAGEBASE + UBM_GETOFF (ba)) & PAMASK;
+    }
+ma = (ub_map[pg] + UBM_GETOFF (ba)) & PAMASK;
+n = UBM_PAGSIZE - UBM_GETOFF (ba);                      /* rest of page */
+while (((ba + n) < lim) && ((pg + 1) < UBM_M_PN) &&     /* next page follows? */
+    (((uint32) ub_map[pg + 1]) == ((ma + n) & PAMASK))) {
+    pg = pg + 1;
+    n = n + UBM_PAGSIZE;
+    }
+if (n > (lim - ba)) n = lim - ba;
+if ((ma + n) > (PAMASK + 1)) n = PAMASK + 1 - ma;       /* stop at wrap */
+*lnt = n;
+return ma;
+}
+
+/* Bytes of a run that are in memory */
+
+#define MAP_INMEM(ma,n) (ADDR_IS_MEM (ma)? \
+                            (((ma) + (n) > MEMSIZE)? (MEMSIZE - (ma)): (n)): 0)
+
+/* Byte copies to and from memory; a little endian host holds M in
+   PDP-11 byte order */
+
+static void Mem_ReadB (uint32 ma, uint32 n, uint8 *buf)
+{
+if (sim_end) memcpy (buf, ((uint8 *) M) + ma, n);
+else for ( ; n != 0; ma++, n--) {
+    if (ma & 1) *buf++ = (M[ma >> 1] >> 8) & 0377;      /* get byte */
+    else *buf++ = M[ma >> 1] & 0377;
+    }
+return;
+}
+
+static void Mem_WriteB (uint32 ma, uint32 n, uint8 *buf)
+{
+if (sim_end) memcpy (((uint8 *) M) + ma, buf, n);
+else for ( ; n != 0; ma++, n--) {
+    if (ma & 1) M[ma >> 1] = (M[ma >> 1] & 0377) |
+        ((uint16) *buf++ << 8);
+    else M[ma >> 1] = (M[ma >> 1] & ~0377) | *buf++;
+    }
+return;
+}
+
 /* I/O buffer routines, aligned access
 
    Map_ReadB    -       fetch byte buffer from memory
@@ -220,20 +330,29 @@ return uba_last;
      trimmed to 18b.
    - In a Qbus configuration, the map is always disabled.
      Device addresses are trimmed to 22b.
+
+   Data is copied a run at a time: with the map enabled, a run of
+   consecutively mapped pages (Map_Span); otherwise the part of the
+   transfer below MEMSIZE.  On a nonexistent memory error, uba_last
+   holds the failing address, as if mapped a word at a time.
 */
 
 int32 Map_ReadB (uint32 ba, int32 bc, uint8 *buf)
 {
-uint32 alim, lim, ma;
+uint32 alim, lim, ma, n, m;
 
 ba = ba & BUSMASK;                                      /* trim address */
 lim = ba + bc;
 if (cpu_bme) {                                          /* map enabled? */
-    for ( ; ba < lim; ba++) {                           /* by bytes */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma)) return (lim - ba);       /* NXM? err */
-        if (ma & 1) *buf++ = (M[ma >> 1] >> 8) & 0377;  /* get byte */
-        else *buf++ = M[ma >> 1] & 0377;
+    for ( ; ba < lim; ba = ba + n, buf = buf + n) {     /* by runs */
+        ma = Map_Span (ba, lim, &n);                    /* map run */
+        m = MAP_INMEM (ma, n);
+        Mem_ReadB (ma, m, buf);
+        if (m < n) {                                    /* NXM? err */
+            Map_Addr (ba + m);
+            return (lim - (ba + m));
+            }
+        uba_last = ma + n - 1;
         }
     return 0;
     }
@@ -241,25 +360,27 @@ else {                                                  /* physical */
     if (ADDR_IS_MEM (lim)) alim = lim;                  /* end ok? */
     else if (ADDR_IS_MEM (ba)) alim = MEMSIZE;          /* no, strt ok? */
     else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba++) {                          /* by bytes */
-        if (ba & 1) *buf++ = (M[ba >> 1] >> 8) & 0377;  /* get byte */
-        else *buf++ = M[ba >> 1] & 0377;
-        }
+    Mem_ReadB (ba, alim - ba, buf);
     return (lim - alim);
     }
 }
 
 int32 Map_ReadW (uint32 ba, int32 bc, uint16 *buf)
 {
-uint32 alim, lim, ma;
+uint32 alim, lim, ma, n, m;
 
 ba = (ba & BUSMASK) & ~01;                              /* trim, align addr */
 lim = ba + (bc & ~01);
 if (cpu_bme) {                                          /* map enabled? */
-    for (; ba < lim; ba = ba + 2) {                     /* by words */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma)) return (lim - ba);       /* NXM? err */
-        *buf++ = M[ma >> 1];
+    for ( ; ba < lim; ba = ba + n, buf = buf + (n >> 1)) { /* by runs */
+        ma = Map_Span (ba, lim, &n);                    /* map run */
+        m = MAP_INMEM (ma, n);
+        memcpy (buf, M + (ma >> 1), m);
+        if (m < n) {                                    /* NXM? err */
+            Map_Addr (ba + m);
+            return (lim - (ba + m));
+            }
+        uba_last = ma + n - 2;
         }
     return 0;
     }
@@ -267,26 +388,27 @@ else {                                                  /* physical */
     if (ADDR_IS_MEM (lim)) alim = lim;                  /* end ok? */
     else if (ADDR_IS_MEM (ba)) alim = MEMSIZE;          /* no, strt ok? */
     else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba = ba + 2) {                   /* by words */
-        *buf++ = M[ba >> 1];
-        }
+    memcpy (buf, M + (ba >> 1), alim - ba);
     return (lim - alim);
     }
 }
 
 int32 Map_WriteB (uint32 ba, int32 bc, uint8 *buf)
 {
-uint32 alim, lim, ma;
+uint32 alim, lim, ma, n, m;
 
 ba = ba & BUSMASK;                                      /* trim address */
 lim = ba + bc;
 if (cpu_bme) {                                          /* map enabled? */
-    for ( ; ba < lim; ba++) {                           /* by bytes */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma)) return (lim - ba);       /* NXM? err */
-        if (ma & 1) M[ma >> 1] = (M[ma >> 1] & 0377) |
-            ((uint16) *buf++ << 8);
-        else M[ma >> 1] = (M[ma >> 1] & ~0377) | *buf++;
+    for ( ; ba < lim; ba = ba + n, buf = buf + n) {     /* by runs */
+        ma = Map_Span (ba, lim, &n);                    /* map run */
+        m = MAP_INMEM (ma, n);
+        Mem_WriteB (ma, m, buf);
+        if (m < n) {                                    /* NXM? err */
+            Map_Addr (ba + m);
+            return (lim - (ba + m));
+            }
+        uba_last = ma + n - 1;
         }
     return 0;
     }
@@ -294,26 +416,27 @@ else {                                                  /* physical */
     if (ADDR_IS_MEM (lim)) alim = lim;                  /* end ok? */
     else if (ADDR_IS_MEM (ba)) alim = MEMSIZE;          /* no, strt ok? */
     else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba++) {                          /* by bytes */
-        if (ba & 1) M[ba >> 1] = (M[ba >> 1] & 0377) |
-            ((uint16) *buf++ << 8);
-        else M[ba >> 1] = (M[ba >> 1] & ~0377) | *buf++;
-        }
+    Mem_WriteB (ba, alim - ba, buf);
     return (lim - alim);
     }
 }
 
 int32 Map_WriteW (uint32 ba, int32 bc, uint16 *buf)
 {
-uint32 alim, lim, ma;
+uint32 alim, lim, ma, n, m;
 
 ba = (ba & BUSMASK) & ~01;                              /* trim, align addr */
 lim = ba + (bc & ~01);
 if (cpu_bme) {                                          /* map enabled? */
-    for (; ba < lim; ba = ba + 2) {                     /* by words */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma)) return (lim - ba);       /* NXM? err */
-        M[ma >> 1] = *buf++;
+    for ( ; ba < lim; ba = ba + n, buf = buf + (n >> 1)) { /* by runs */
+        ma = Map_Span (ba, lim, &n);                    /* map run */
+        m = MAP_INMEM (ma, n);
+        memcpy (M + (ma >> 1), buf, m);
+        if (m < n) {                                    /* NXM? err */
+            Map_Addr (ba + m);
+            return (lim - (ba + m));
+            }
+        uba_last = ma + n - 2;
         }
     return 0;
     }
@@ -321,9 +444,7 @@ else {                                                  /* physical */
     if (ADDR_IS_MEM (lim)) alim = lim;                  /* end ok? */
     else if (ADDR_IS_MEM (ba)) alim = MEMSIZE;          /* no, strt ok? */
     else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba = ba + 2) {                   /* by words */
-        M[ba >> 1] = *buf++;
-        }
+    memcpy (M + (ba >> 1), buf, alim - ba);
     return (lim - alim);
     }
 }
@@ -576,6 +697,53 @@ for (i = 0, dibp = NULL; i < (IOPAGESIZE >> 1); i++) {  /* loop thru entries */
 return SCPE_OK;
 }
 
+/* Statistics: I/O page accesses by device, interrupts by vector */
+
+void io_stats (SIM_STATS *sp)
+{
+int32 i, j, k, ndev;
+DEVICE *dptr;
+DIB *dibp;
+t_uint64 *cnt;
+char vbuf[8];
+
+for (ndev = 0; sim_devices[ndev] != NULL; ndev++) ;
+cnt = (t_uint64 *) calloc (2 * (ndev + 1), sizeof (t_uint64));
+if (cnt == NULL) return;
+for (i = 0, dibp = NULL, k = ndev; i < (IOPAGESIZE >> 1); i++) {
+    if (iodibp[i] != dibp) {                            /* new block? */
+        dibp = iodibp[i];
+        for (j = 0, k = ndev; dibp && (sim_devices[j] != NULL); j++) {
+            if (((DIB*) sim_devices[j]->ctxt) == dibp) {
+                k = j;                                  /* device, else CPU */
+                break;
+                }
+            }
+        }
+    cnt[2 * k] = cnt[2 * k] + iocntR[i];
+    cnt[(2 * k) + 1] = cnt[(2 * k) + 1] + iocntW[i];
+    }
+sim_stats_grp (sp, "io");
+for (k = 0; k <= ndev; k++) {
+    if ((cnt[2 * k] | cnt[(2 * k) + 1]) == 0) continue;
+    dptr = (k < ndev)? sim_devices[k]: NULL;
+    sim_stats_grp (sp, dptr? sim_dname (dptr): "CPU");
+    sim_stats_val (sp, "reads", cnt[2 * k]);
+    sim_stats_val (sp, "writes", cnt[(2 * k) + 1]);
+    sim_stats_end (sp);
+    }
+sim_stats_end (sp);
+free (cnt);
+sim_stats_grp (sp, "interrupts");
+for (i = 1; i < (01000 >> 2); i++) {
+    if (int_cnt[i] == 0) continue;
+    sprintf (vbuf, "%o", i << 2);
+    sim_stats_val (sp, vbuf, int_cnt[i]);
+    }
+sim_stats_end (sp);
+return;
+}
+
 /* Autoconfiguration
 
    The table reflects the MicroVAX 3900 microcode, with one addition - the
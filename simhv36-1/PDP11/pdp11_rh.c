@@ -623,6 +623,7 @@ DIB *dibp;
 if (mb >= MBA_NUM) return;
 dibp = (DIB *) mba_dev[mb].ctxt;
 int_req[dibp->vloc >> 5] |= (1 << (dibp->vloc & 037));
+int_lvl = int_lvl | (1u << (dibp->vloc >> 5));
 return;
 }
 
@@ -178,6 +178,7 @@
 extern uint16 *M;                                       /* memory */
 extern int32 int_req[IPL_HLVL];
 extern FILE *sim_deb;
+extern int32 sim_switches;
 
 uint16 *rkxb = NULL;                                    /* xfer buffer */
 int32 rkcs = 0;                                         /* control/status */
@@ -198,6 +199,7 @@ t_stat rk_wr (int32 data, int32 PA, int32 access);
 int32 rk_inta (void);
 t_stat rk_svc (UNIT *uptr);
 t_stat rk_reset (DEVICE *dptr);
+t_stat rk_attach (UNIT *uptr, char *cptr);
 void rk_go (void);
 void rk_set_done (int32 error);
 void rk_clr_done (void);
@@ -279,7 +281,7 @@ DEVICE rk_dev = {
     "RK", rk_unit, rk_reg, rk_mod,
     RK_NUMDR, 8, 24, 1, 8, 16,
     NULL, NULL, &rk_reset,
-    &rk_boot, NULL, NULL,
+    &rk_boot, &rk_attach, NULL,
     &rk_dib, DEV_DISABLE | DEV_UBUS | DEV_Q18
     };
 
@@ -492,7 +494,7 @@ t_stat rk_svc (UNIT *uptr)
 int32 i, drv, err, awc, wc, cma, cda, t;
 int32 da, cyl, track, sect;
 uint32 ma;
-uint16 comp;
+uint16 comp, *xb;
 
 drv = (int32) (uptr - rk_dev.units);                    /* get drv number */
 if (uptr->FUNC == RKCS_SEEK) {                          /* seek */
@@ -543,7 +545,14 @@ if ((da + wc) > (int32) uptr->capac) {                  /* overrun? */
 extern int show_i;
 if (show_i) printf("rk: seek %d (lba %d)\n", da *2, (da*2)/512);
 }
-err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
+if (uptr->flags & UNIT_MMAP) {                          /* mapped image? */
+    xb = ((uint16 *) uptr->filebuf) + da;               /* xfer in place */
+    err = 0;
+    }
+else {
+    xb = rkxb;
+    err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
+    }
 if (wc && (err == 0)) {                                 /* seek ok? */
     switch (uptr->FUNC) {                               /* case on function */
 
@@ -558,8 +567,9 @@ if (wc && (err == 0)) {                                 /* seek ok? */
                 rkxb[i] = (cda / RK_NUMWD) / (RK_NUMSF * RK_NUMSC);
                 cda = cda + RK_NUMWD;                   /* next sector */
                 }                                       /* end for wc */
+            xb = rkxb;
             }                                           /* end if format */
-        else {                                          /* normal read */
+        else if (xb == rkxb) {                          /* normal read */
             i = fxread (rkxb, sizeof (int16), wc, uptr->fileref);
 {
 extern int show_i;
@@ -573,13 +583,13 @@ if (show_i) {
             for ( ; i < wc; i++) rkxb[i] = 0;           /* fill buf */
             }
         if (rkcs & RKCS_INH) {                          /* incr inhibit? */
-            if (t = Map_WriteW (ma, 2, &rkxb[wc - 1])) {        /* store last */
+            if (t = Map_WriteW (ma, 2, &xb[wc - 1])) {  /* store last */
                 rker = rker | RKER_NXM;                 /* NXM? set flag */
                 wc = 0;                                 /* no transfer */
                 }
             }
         else {                                          /* normal store */
-            if (t = Map_WriteW (ma, wc << 1, rkxb)) {   /* store buf */
+            if (t = Map_WriteW (ma, wc << 1, xb)) {     /* store buf */
                 rker = rker | RKER_NXM;                 /* NXM? set flag */
                 wc = wc - t;                            /* adj wd cnt */
                 }
@@ -592,17 +602,17 @@ if (show_i) {
                 rker = rker | RKER_NXM;                 /* NXM? set flag */
                 wc = 0;                                 /* no transfer */
                 }
-            for (i = 0; i < wc; i++) rkxb[i] = comp;    /* all words same */
+            for (i = 0; i < wc; i++) xb[i] = comp;      /* all words same */
             }
         else {                                          /* normal fetch */
-            if (t = Map_ReadW (ma, wc << 1, rkxb)) {    /* get buf */
+            if (t = Map_ReadW (ma, wc << 1, xb)) {      /* get buf */
                 rker = rker | RKER_NXM;                 /* NXM? set flg */
                 wc = wc - t;                            /* adj wd cnt */
                 }
             }
         if (wc) {                                       /* any xfer? */
             awc = (wc + (RK_NUMWD - 1)) & ~(RK_NUMWD - 1);      /* clr to */
-            for (i = wc; i < awc; i++) rkxb[i] = 0;     /* end of blk */
+            for (i = wc; i < awc; i++) xb[i] = 0;       /* end of blk */
 {
 extern int show_i;
 if (show_i) {
@@ -611,25 +621,29 @@ if (show_i) {
 	       rkxb[0], rkxb[1], rkxb[2], rkxb[3]);
 }
 }
-            fxwrite (rkxb, sizeof (int16), awc, uptr->fileref);
-            err = ferror (uptr->fileref);
+            if (xb == rkxb) {                           /* not mapped? */
+                fxwrite (rkxb, sizeof (int16), awc, uptr->fileref);
+                err = ferror (uptr->fileref);
+                }
             }
         break;                                          /* end write */
 
     case RKCS_WCHK:                                     /* write check */
-        i = fxread (rkxb, sizeof (int16), wc, uptr->fileref);
-        if (err = ferror (uptr->fileref)) {             /* read error? */
-            wc = 0;                                     /* no transfer */
-            break;
+        if (xb == rkxb) {                               /* not mapped? */
+            i = fxread (rkxb, sizeof (int16), wc, uptr->fileref);
+            if (err = ferror (uptr->fileref)) {         /* read error? */
+                wc = 0;                                 /* no transfer */
+                break;
+                }
+            for ( ; i < wc; i++) rkxb[i] = 0;           /* fill buf */
             }
-        for ( ; i < wc; i++) rkxb[i] = 0;               /* fill buf */
         awc = wc;                                       /* save wc */
         for (wc = 0, cma = ma; wc < awc; wc++)  {       /* loop thru buf */
             if (Map_ReadW (cma, 2, &comp)) {            /* mem wd */
                 rker = rker | RKER_NXM;                 /* NXM? set flg */
                 break;
                 }
-            if (comp != rkxb[wc])  {                    /* match to disk? */
+            if (comp != xb[wc])  {                      /* match to disk? */
                 rker = rker | RKER_WCE;                 /* no, err */
                 if (rkcs & RKCS_SSE) break;
                 }
@@ -737,6 +751,19 @@ if (rkxb == NULL) return SCPE_MEM;
 return SCPE_OK;
 }
 
+/* Device attach; -M maps the image */
+
+t_stat rk_attach (UNIT *uptr, char *cptr)
+{
+t_stat r;
+
+r = attach_unit (uptr, cptr);                           /* attach unit */
+if (r != SCPE_OK) return r;
+if (sim_switches & SWMASK ('M'))                        /* map image? */
+    sim_fmap (uptr, uptr->capac * sizeof (int16));
+return SCPE_OK;
+}
+
 /* Device bootstrap */
 
 #define BOOT_START      02000                           /* start */
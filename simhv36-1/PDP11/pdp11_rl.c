@@ -192,6 +192,7 @@ extern uint32 cpu_opt;
 #define RLBAE_IMP       0000077                         /* implemented */
 
 extern int32 int_req[IPL_HLVL];
+extern int32 sim_switches;
 
 uint16 *rlxb = NULL;                                    /* xfer buffer */
 int32 rlcs = 0;                                         /* control/status */
@@ -431,7 +432,7 @@ t_stat rl_svc (UNIT *uptr)
 int32 err, wc, maxwc, t;
 int32 i, func, da, awc;
 uint32 ma;
-uint16 comp;
+uint16 comp, *xb;
 
 func = GET_FUNC (rlcs);                                 /* get function */
 if (func == RLCS_GSTA) {                                /* get status */
@@ -482,42 +483,56 @@ wc = 0200000 - rlmp;                                    /* get true wc */
 
 maxwc = (RL_NUMSC - GET_SECT (rlda)) * RL_NUMWD;        /* max transfer */
 if (wc > maxwc) wc = maxwc;                             /* track overrun? */
-err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
+if ((uptr->flags & UNIT_MMAP) &&                        /* mapped image, */
+    ((t_addr) (da + wc) <= uptr->capac)) {              /* on the drive? */
+    xb = ((uint16 *) uptr->filebuf) + da;               /* xfer in place */
+    err = 0;
+    }
+else {
+    xb = rlxb;
+    err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
+    }
 
 if ((func >= RLCS_READ) && (err == 0)) {                /* read (no hdr)? */
-    i = fxread (rlxb, sizeof (int16), wc, uptr->fileref);
-    err = ferror (uptr->fileref);
-    for ( ; i < wc; i++) rlxb[i] = 0;                   /* fill buffer */
-    if (t = Map_WriteW (ma, wc << 1, rlxb)) {           /* store buffer */
+    if (xb == rlxb) {                                   /* not mapped? */
+        i = fxread (rlxb, sizeof (int16), wc, uptr->fileref);
+        err = ferror (uptr->fileref);
+        for ( ; i < wc; i++) rlxb[i] = 0;               /* fill buffer */
+        }
+    if (t = Map_WriteW (ma, wc << 1, xb)) {             /* store buffer */
         rlcs = rlcs | RLCS_ERR | RLCS_NXM;              /* nxm */
         wc = wc - t;                                    /* adjust wc */
         }
     }                                                   /* end read */
 
 if ((func == RLCS_WRITE) && (err == 0)) {               /* write? */
-    if (t = Map_ReadW (ma, wc << 1, rlxb)) {            /* fetch buffer */
+    if (t = Map_ReadW (ma, wc << 1, xb)) {              /* fetch buffer */
         rlcs = rlcs | RLCS_ERR | RLCS_NXM;              /* nxm */
         wc = wc - t;                                    /* adj xfer lnt */
         }
     if (wc) {                                           /* any xfer? */
         awc = (wc + (RL_NUMWD - 1)) & ~(RL_NUMWD - 1);  /* clr to */
-        for (i = wc; i < awc; i++) rlxb[i] = 0;         /* end of blk */
-        fxwrite (rlxb, sizeof (int16), awc, uptr->fileref);
-        err = ferror (uptr->fileref);
+        for (i = wc; i < awc; i++) xb[i] = 0;           /* end of blk */
+        if (xb == rlxb) {                               /* not mapped? */
+            fxwrite (rlxb, sizeof (int16), awc, uptr->fileref);
+            err = ferror (uptr->fileref);
+            }
         }
     }                                                   /* end write */
 
 if ((func == RLCS_WCHK) && (err == 0)) {                /* write check? */
-    i = fxread (rlxb, sizeof (int16), wc, uptr->fileref);
-    err = ferror (uptr->fileref);
-    for ( ; i < wc; i++) rlxb[i] = 0;                   /* fill buffer */
+    if (xb == rlxb) {                                   /* not mapped? */
+        i = fxread (rlxb, sizeof (int16), wc, uptr->fileref);
+        err = ferror (uptr->fileref);
+        for ( ; i < wc; i++) rlxb[i] = 0;               /* fill buffer */
+        }
     awc = wc;                                           /* save wc */
     for (wc = 0; (err == 0) && (wc < awc); wc++)  {     /* loop thru buf */
         if (Map_ReadW (ma + (wc << 1), 2, &comp)) {     /* mem wd */
             rlcs = rlcs | RLCS_ERR | RLCS_NXM;          /* nxm */
             break;
             }
-        if (comp != rlxb[wc])                           /* check to buf */
+        if (comp != xb[wc])                             /* check to buf */
             rlcs = rlcs | RLCS_ERR | RLCS_CRC;
         }                                               /* end for */
     }                                                   /* end wcheck */
@@ -585,19 +600,22 @@ if (r != SCPE_OK) return r;                             /* error? */
 uptr->TRK = 0;                                          /* cylinder 0 */
 uptr->STAT = RLDS_VCK;                                  /* new volume */
 if ((p = sim_fsize (uptr->fileref)) == 0) {             /* new disk image? */
-    if (uptr->flags & UNIT_RO) return SCPE_OK;          /* if ro, done */
-    return pdp11_bad_block (uptr, RL_NUMSC, RL_NUMWD);
+    if ((uptr->flags & UNIT_RO) == 0)                   /* if ro, done */
+        r = pdp11_bad_block (uptr, RL_NUMSC, RL_NUMWD);
     }
-if ((uptr->flags & UNIT_AUTO) == 0) return SCPE_OK;     /* autosize? */
-if (p > (RL01_SIZE * sizeof (int16))) {
-    uptr->flags = uptr->flags | UNIT_RL02;
-    uptr->capac = RL02_SIZE;
-    }
-else {
-    uptr->flags = uptr->flags & ~UNIT_RL02;
-    uptr->capac = RL01_SIZE;
+else if (uptr->flags & UNIT_AUTO) {                     /* autosize? */
+    if (p > (RL01_SIZE * sizeof (int16))) {
+        uptr->flags = uptr->flags | UNIT_RL02;
+        uptr->capac = RL02_SIZE;
+        }
+    else {
+        uptr->flags = uptr->flags & ~UNIT_RL02;
+        uptr->capac = RL01_SIZE;
+        }
     }
-return SCPE_OK;
+if ((r == SCPE_OK) && (sim_switches & SWMASK ('M')))    /* map image? */
+    sim_fmap (uptr, uptr->capac * sizeof (int16));
+return r;
 }
 
 /* Set size routine */
@@ -354,6 +354,7 @@ static const char *rp_fname[CS1_N_FNC] = {
     };
 
 extern FILE *sim_deb;
+extern int32 sim_switches;
 
 t_stat rp_mbrd (int32 *data, int32 ofs, int32 drv);
 t_stat rp_mbwr (int32 data, int32 ofs, int32 drv);
@@ -771,6 +772,7 @@ t_stat rp_svc (UNIT *uptr)
 {
 int32 i, fnc, dtype, drv, err;
 int32 wc, abc, awc, mbc, da;
+uint16 *xb;
 
 dtype = GET_DTYPE (uptr->flags);                        /* get drive type */
 drv = (int32) (uptr - rp_dev.units);                    /* get drv number */
@@ -816,7 +818,6 @@ switch (fnc) {                                          /* case on function */
     case FNC_WCHK:                                      /* write check */
     case FNC_READ:                                      /* read */
     case FNC_READH:                                     /* read headers */
-        err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
         mbc = mba_get_bc (rp_dib.ba);                   /* get byte count */
         wc = (mbc + 1) >> 1;                            /* convert to words */
         if ((da + wc) > drv_tab[dtype].size) {          /* disk overrun? */
@@ -829,23 +830,34 @@ switch (fnc) {                                          /* case on function */
                 break;
                 }
             }
+        if ((uptr->flags & UNIT_MMAP) &&                /* mapped image, */
+            ((t_addr) (da + wc) <= uptr->capac)) {      /* on the drive? */
+            xb = ((uint16 *) uptr->filebuf) + da;       /* xfer in place */
+            err = 0;
+            }
+        else {
+            xb = rpxb;
+            err = fseek (uptr->fileref, da * sizeof (int16), SEEK_SET);
+            }
         if (fnc == FNC_WRITE) {                         /* write? */
-            abc = mba_rdbufW (rp_dib.ba, mbc, rpxb);    /* get buffer */
+            abc = mba_rdbufW (rp_dib.ba, mbc, xb);      /* get buffer */
             wc = (abc + 1) >> 1;                        /* actual # wds */
             awc = (wc + (RP_NUMWD - 1)) & ~(RP_NUMWD - 1);
-            for (i = wc; i < awc; i++) rpxb[i] = 0;     /* fill buf */
-            if (wc && !err) {                           /* write buf */
+            for (i = wc; i < awc; i++) xb[i] = 0;       /* fill buf */
+            if (wc && !err && (xb == rpxb)) {           /* write buf */
                 fxwrite (rpxb, sizeof (uint16), awc, uptr->fileref);
                 err = ferror (uptr->fileref);
                 }
             }                                           /* end if wr */
         else {                                          /* read or wchk */
-            awc = fxread (rpxb, sizeof (uint16), wc, uptr->fileref);
-            err = ferror (uptr->fileref);
-            for (i = awc; i < wc; i++) rpxb[i] = 0;     /* fill buf */
+            if (xb == rpxb) {                           /* not mapped? */
+                awc = fxread (rpxb, sizeof (uint16), wc, uptr->fileref);
+                err = ferror (uptr->fileref);
+                for (i = awc; i < wc; i++) rpxb[i] = 0; /* fill buf */
+                }
             if (fnc == FNC_WCHK)                        /* write check? */
-                mba_chbufW (rp_dib.ba, mbc, rpxb);      /* check vs mem */
-            else mba_wrbufW (rp_dib.ba, mbc, rpxb);     /* store in mem */
+                mba_chbufW (rp_dib.ba, mbc, xb);        /* check vs mem */
+            else mba_wrbufW (rp_dib.ba, mbc, xb);       /* store in mem */
             }                                           /* end if read */
         da = da + wc + (RP_NUMWD - 1);
         if (da >= drv_tab[dtype].size) rpds[drv] = rpds[drv] | DS_LST;
@@ -967,19 +979,22 @@ rper1[drv] = 0;
 rp_update_ds (DS_ATA, drv);                             /* upd ctlr status */
 
 if ((p = sim_fsize (uptr->fileref)) == 0) {             /* new disk image? */
-    if (uptr->flags & UNIT_RO) return SCPE_OK;
-    return pdp11_bad_block (uptr,
-        drv_tab[GET_DTYPE (uptr->flags)].sect, RP_NUMWD);
+    if ((uptr->flags & UNIT_RO) == 0)
+        r = pdp11_bad_block (uptr,
+            drv_tab[GET_DTYPE (uptr->flags)].sect, RP_NUMWD);
     }
-if ((uptr->flags & UNIT_AUTO) == 0) return SCPE_OK;     /* autosize? */
-for (i = 0; drv_tab[i].sect != 0; i++) {
-    if (p <= (drv_tab[i].size * (int) sizeof (int16))) {
-        uptr->flags = (uptr->flags & ~UNIT_DTYPE) | (i << UNIT_V_DTYPE);
-        uptr->capac = drv_tab[i].size;
-        return SCPE_OK;
+else if (uptr->flags & UNIT_AUTO) {                     /* autosize? */
+    for (i = 0; drv_tab[i].sect != 0; i++) {
+        if (p <= (drv_tab[i].size * (int) sizeof (int16))) {
+            uptr->flags = (uptr->flags & ~UNIT_DTYPE) | (i << UNIT_V_DTYPE);
+            uptr->capac = drv_tab[i].size;
+            break;
+            }
         }
     }
-return SCPE_OK;
+if ((r == SCPE_OK) && (sim_switches & SWMASK ('M')))    /* map image? */
+    sim_fmap (uptr, uptr->capac * sizeof (int16));
+return r;
 }
 
 /* Device detach */
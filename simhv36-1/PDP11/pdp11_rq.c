@@ -95,6 +95,7 @@ extern int32 cpu_opt;
 
 #include "pdp11_uqssp.h"
 #include "pdp11_mscp.h"
+#include "sim_aio.h"
 
 #define UF_MSK          (UF_CMR|UF_CMW)                 /* settable flags */
 
@@ -137,6 +138,8 @@ extern int32 cpu_opt;
 #define uf              buf                             /* settable unit flags */
 #define cnum            wait                            /* controller index */
 #define UNIT_WPRT       (UNIT_WLK | UNIT_RO)            /* write prot */
+#define DEV_V_AIO       (DEV_V_FFUF + 0)                /* async host I/O */
+#define DEV_AIO         (1u << DEV_V_AIO)
 #define RQ_RMV(u)       ((drv_tab[GET_DTYPE (u->flags)].flgs & RQDF_RMV)? \
                         UF_RMV: 0)
 #define RQ_WPH(u)       (((drv_tab[GET_DTYPE (u->flags)].flgs & RQDF_RO) || \
@@ -554,6 +557,12 @@ int32 rq_itime4 = 10;                                   /* stage 4 */
 int32 rq_qtime = RQ_QTIME;                              /* queue time */
 int32 rq_xtime = RQ_XTIME;                              /* transfer time */
 
+struct rq_aio {
+    SIM_AIOREQ          rd;                             /* read ahead */
+    SIM_AIOREQ          wr;                             /* write behind */
+    int32               rdok;                           /* rd still valid */
+    };
+
 typedef struct {
     uint32              cnum;                           /* ctrl number */
     uint32              ubase;                          /* unit base */
@@ -576,6 +585,8 @@ typedef struct {
     struct uq_ring      cq;                             /* cmd ring */
     struct uq_ring      rq;                             /* rsp ring */
     struct rqpkt        pak[RQ_NPKTS];                  /* packet queue */
+    SIM_AIO             *aio;                           /* host I/O thread */
+    struct rq_aio       *aiou;                          /* per unit I/O */
     } MSC;
 
 DEVICE rq_dev, rqb_dev, rqc_dev,rqd_dev;
@@ -593,6 +604,8 @@ t_stat rq_set_wlk (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat rq_set_type (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat rq_show_type (FILE *st, UNIT *uptr, int32 val, void *desc);
 t_stat rq_show_wlk (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat rq_set_aio (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat rq_show_aio (FILE *st, UNIT *uptr, int32 val, void *desc);
 t_stat rq_show_ctrl (FILE *st, UNIT *uptr, int32 val, void *desc);
 t_stat rq_show_unitq (FILE *st, UNIT *uptr, int32 val, void *desc);
 
@@ -610,6 +623,12 @@ t_bool rq_suc (MSC *cp, int32 pkt, t_bool q);
 t_bool rq_plf (MSC *cp, uint32 err);
 t_bool rq_dte (MSC *cp, UNIT *uptr, uint32 err);
 t_bool rq_hbe (MSC *cp, UNIT *uptr);
+struct rq_aio *rq_aio_unit (MSC *cp, UNIT *uptr);
+void rq_aio_rdahead (MSC *cp, UNIT *uptr, t_addr da, uint32 bc);
+uint16 *rq_aio_read (MSC *cp, struct rq_aio *ua, UNIT *uptr, t_addr da, uint32 tbc, uint32 *err);
+uint16 *rq_aio_wrbuf (MSC *cp, struct rq_aio *ua, uint32 *err);
+void rq_aio_write (MSC *cp, struct rq_aio *ua, UNIT *uptr, t_addr da, uint32 lnt);
+void rq_aio_drain (MSC *cp);
 t_bool rq_una (MSC *cp, int32 un);
 t_bool rq_deqf (MSC *cp, int32 *pkt);
 int32 rq_deqh (MSC *cp, int32 *lh);
@@ -764,6 +783,12 @@ MTAB rq_mod[] = {
       NULL, &show_vec, NULL },
     { MTAB_XTD | MTAB_VDV, 0, NULL, "AUTOCONFIGURE",
       &set_addr_flt, NULL, NULL },
+    { MTAB_XTD | MTAB_VDV, 1, NULL, "ASYNC",
+      &rq_set_aio, NULL, NULL },
+    { MTAB_XTD | MTAB_VDV, 0, NULL, "SYNC",
+      &rq_set_aio, NULL, NULL },
+    { MTAB_XTD | MTAB_VDV, 0, "IO", NULL,
+      NULL, &rq_show_aio, NULL },
     { 0 }
     };
 
@@ -1582,6 +1607,9 @@ if (uptr = rq_getucb (cp, lu)) {                        /* unit exist? */
         cp->pak[pkt].d[RW_WBLL] = cp->pak[pkt].d[RW_LBNL];
         cp->pak[pkt].d[RW_WBLH] = cp->pak[pkt].d[RW_LBNH];
         sim_activate (uptr, rq_xtime);                  /* activate */
+        if ((cmd == OP_RD) || (cmd == OP_CMP))          /* start host read */
+            rq_aio_rdahead (cp, uptr, ((t_addr) GETP32 (pkt, RW_LBNL)) *
+                RQ_NUMBY, GETP32 (pkt, RW_BCL));
         return OK;                                      /* done */
         }
     }
@@ -1642,6 +1670,8 @@ uint32 ba = GETP32 (pkt, RW_WBAL);                      /* buf addr */
 uint32 bc = GETP32 (pkt, RW_WBCL);                      /* byte count */
 uint32 bl = GETP32 (pkt, RW_WBLL);                      /* block addr */
 t_addr da = ((t_addr) bl) * RQ_NUMBY;                   /* disk addr */
+uint16 *xb = rqxb;
+struct rq_aio *ua = NULL;
 
 if ((cp == NULL) || (pkt == 0)) return STOP_RQ;         /* what??? */
 tbc = (bc > RQ_MAXFR)? RQ_MAXFR: bc;                    /* trim cnt to max */
@@ -1666,22 +1696,37 @@ if ((cmd == OP_ERS) || (cmd == OP_WR)) {                /* write op? */
         }
     }
 
+if ((uptr->flags & UNIT_MMAP) &&                        /* mapped image, */
+    ((da + ((tbc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1))) <= uptr->capac))
+    xb = (uint16 *) (((uint8 *) uptr->filebuf) + da);   /* not RCT? in place */
+else if (ua = rq_aio_unit (cp, uptr)) {                 /* async host I/O? */
+    if ((cmd == OP_ERS) || (cmd == OP_WR))
+        xb = rq_aio_wrbuf (cp, ua, &err);               /* free write buf */
+    else xb = rq_aio_read (cp, ua, uptr, da, tbc, &err); /* wait for data */
+    }
+
 if (cmd == OP_ERS) {                                    /* erase? */
     wwc = ((tbc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
-    for (i = 0; i < wwc; i++) rqxb[i] = 0;              /* clr buf */
-    err = sim_fseek (uptr->fileref, da, SEEK_SET);      /* set pos */
-    if (!err) sim_fwrite (rqxb, sizeof (int16), wwc, uptr->fileref);
-    err = ferror (uptr->fileref);                       /* end if erase */
-    }
+    for (i = 0; i < wwc; i++) xb[i] = 0;                /* clr buf */
+    if (xb == rqxb) {                                   /* stdio? */
+        err = sim_fseek (uptr->fileref, da, SEEK_SET);  /* set pos */
+        if (!err) sim_fwrite (rqxb, sizeof (int16), wwc, uptr->fileref);
+        err = ferror (uptr->fileref);
+        }
+    else if (ua && !err) rq_aio_write (cp, ua, uptr, da, wwc << 1);
+    }                                                   /* end if erase */
 
 else if (cmd == OP_WR) {                                /* write? */
-    t = Map_ReadW (ba, tbc, rqxb);                      /* fetch buffer */
+    t = Map_ReadW (ba, tbc, xb);                        /* fetch buffer */
     if (abc = tbc - t) {                                /* any xfer? */
         wwc = ((abc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
-        for (i = (abc >> 1); i < wwc; i++) rqxb[i] = 0;
-        err = sim_fseek (uptr->fileref, da, SEEK_SET);
-        if (!err) sim_fwrite (rqxb, sizeof (int16), wwc, uptr->fileref);
-        err = ferror (uptr->fileref);
+        for (i = (abc >> 1); i < wwc; i++) xb[i] = 0;
+        if (xb == rqxb) {                               /* stdio? */
+            err = sim_fseek (uptr->fileref, da, SEEK_SET);
+            if (!err) sim_fwrite (rqxb, sizeof (int16), wwc, uptr->fileref);
+            err = ferror (uptr->fileref);
+            }
+        else if (ua && !err) rq_aio_write (cp, ua, uptr, da, wwc << 1);
         }
     if (t) {                                            /* nxm? */
         PUTP32 (pkt, RW_WBCL, bc - abc);                /* adj bc */
@@ -1693,14 +1738,16 @@ else if (cmd == OP_WR) {                                /* write? */
     }
 
 else {
-    err = sim_fseek (uptr->fileref, da, SEEK_SET);      /* set pos */
-    if (!err) {
-        i = sim_fread (rqxb, sizeof (int16), tbc >> 1, uptr->fileref);
-        for ( ; i < (tbc >> 1); i++) rqxb[i] = 0;       /* fill */
-        err = ferror (uptr->fileref);
+    if (xb == rqxb) {                                   /* stdio? */
+        err = sim_fseek (uptr->fileref, da, SEEK_SET);  /* set pos */
+        if (!err) {
+            i = sim_fread (rqxb, sizeof (int16), tbc >> 1, uptr->fileref);
+            for ( ; i < (tbc >> 1); i++) rqxb[i] = 0;   /* fill */
+            err = ferror (uptr->fileref);
+            }
         }
     if ((cmd == OP_RD) && !err) {                       /* read? */
-        if (t = Map_WriteW (ba, tbc, rqxb)) {           /* store, nxm? */
+        if (t = Map_WriteW (ba, tbc, xb)) {             /* store, nxm? */
             PUTP32 (pkt, RW_WBCL, bc - (tbc - t));      /* adj bc */
             PUTP32 (pkt, RW_WBAL, ba + (tbc - t));      /* adj ba */
             if (rq_hbe (cp, uptr))                      /* post err log */
@@ -1718,7 +1765,7 @@ else {
                     rq_rw_end (cp, uptr, EF_LOG, ST_HST | SB_HST_NXM);
                 return SCPE_OK;
                 }
-            dby = (rqxb[i >> 1] >> ((i & 1)? 8: 0)) & 0xFF;
+            dby = (xb[i >> 1] >> ((i & 1)? 8: 0)) & 0xFF;
             if (mby != dby) {                           /* cmp err? */
                 PUTP32 (pkt, RW_WBCL, bc - i);          /* adj bc */
                 rq_rw_end (cp, uptr, 0, ST_CMP);        /* done */
@@ -1740,7 +1787,11 @@ bl = bl + ((tbc + (RQ_NUMBY - 1)) / RQ_NUMBY);          /* incr blk # */
 PUTP32 (pkt, RW_WBAL, ba);                              /* update pkt */
 PUTP32 (pkt, RW_WBCL, bc);
 PUTP32 (pkt, RW_WBLL, bl);
-if (bc) sim_activate (uptr, rq_xtime);                  /* more? resched */
+if (bc) {                                               /* more? */
+    sim_activate (uptr, rq_xtime);                      /* resched */
+    if (ua && (cmd != OP_ERS) && (cmd != OP_WR))        /* read next */
+        rq_aio_rdahead (cp, uptr, ((t_addr) bl) * RQ_NUMBY, bc);
+    }
 else rq_rw_end (cp, uptr, 0, ST_SUC);                   /* done! */
 return SCPE_OK;
 }
@@ -1770,6 +1821,122 @@ if (uptr->pktq)                                         /* more to do? */
 return OK;
 }
 
+/* Asynchronous host I/O
+
+   With SET RQn ASYNC, host reads and writes for the controller's units
+   are done by an I/O thread (sim_aio), one request per unit in each
+   direction.  The read for a transfer is started when the command is
+   accepted, or when the previous transfer of the command completes, so
+   it normally finishes within the rq_xtime before rq_svc needs the
+   data; rq_svc waits only if the host is slower than that.  Writes are
+   still taken from memory in rq_svc and written behind; because the
+   thread works in order, later reads see them.  A failed write is
+   reported on the unit's next transfer.  Memory, packets and interrupts
+   are touched only by rq_svc, so the guest sees the same sequence of
+   events, at the same simulated times, as with synchronous I/O.
+*/
+
+struct rq_aio *rq_aio_unit (MSC *cp, UNIT *uptr)
+{
+DEVICE *dptr = rq_devmap[cp->cnum];
+int32 i;
+
+if (((dptr->flags & DEV_AIO) == 0) ||                   /* sync, or mapped? */
+    (uptr->flags & UNIT_MMAP) || (uptr->fileref == NULL))
+    return NULL;
+if (cp->aio == NULL) {                                  /* first use? */
+    if (cp->aiou == NULL)
+        cp->aiou = (struct rq_aio *) calloc (RQ_NUMDR, sizeof (struct rq_aio));
+    for (i = 0; cp->aiou && (i < RQ_NUMDR); i++) {
+        if (cp->aiou[i].rd.buf == NULL) cp->aiou[i].rd.buf = malloc (RQ_MAXFR);
+        if (cp->aiou[i].wr.buf == NULL) cp->aiou[i].wr.buf = malloc (RQ_MAXFR);
+        if ((cp->aiou[i].rd.buf == NULL) || (cp->aiou[i].wr.buf == NULL))
+            break;
+        }
+    if ((i < RQ_NUMDR) || ((cp->aio = sim_aio_create ()) == NULL)) {
+        printf ("%s: asynchronous I/O not available\n", sim_dname (dptr));
+        dptr->flags = dptr->flags & ~DEV_AIO;           /* back to stdio */
+        return NULL;
+        }
+    }
+return cp->aiou + (uptr - dptr->units);
+}
+
+/* Start reading the next transfer of a read or compare */
+
+void rq_aio_rdahead (MSC *cp, UNIT *uptr, t_addr da, uint32 bc)
+{
+struct rq_aio *ua;
+
+if ((bc == 0) || ((ua = rq_aio_unit (cp, uptr)) == NULL)) return;
+if (ua->rd.busy) sim_aio_wait (cp->aio, &ua->rd);       /* stale, in use */
+ua->rd.op = AIO_RD;
+ua->rd.fref = uptr->fileref;
+ua->rd.pos = da;
+ua->rd.len = (bc > RQ_MAXFR)? RQ_MAXFR: bc;
+ua->rdok = 1;
+sim_aio_submit (cp->aio, &ua->rd);
+return;
+}
+
+/* Get the data for a read or compare; reads now if nothing usable was
+   started (first transfer after SET ASYNC, a write in between) */
+
+uint16 *rq_aio_read (MSC *cp, struct rq_aio *ua, UNIT *uptr, t_addr da, uint32 tbc, uint32 *err)
+{
+if (!ua->rdok || (ua->rd.fref != uptr->fileref) ||
+    (ua->rd.pos != da) || (ua->rd.len != tbc))
+    rq_aio_rdahead (cp, uptr, da, tbc);
+ua->rdok = 0;                                           /* consumed */
+if (sim_aio_wait (cp->aio, &ua->rd) != SCPE_OK) {
+    errno = ua->rd.err;
+    *err = 1;
+    }
+else if (ua->wr.err) {                                  /* write behind err? */
+    errno = ua->wr.err;
+    ua->wr.err = 0;
+    *err = 1;
+    }
+if (ua->rd.xfr < tbc)                                   /* past eof? fill */
+    memset (((uint8 *) ua->rd.buf) + ua->rd.xfr, 0, tbc - ua->rd.xfr);
+return (uint16 *) ua->rd.buf;
+}
+
+/* Get the write buffer, once the previous write from it is done */
+
+uint16 *rq_aio_wrbuf (MSC *cp, struct rq_aio *ua, uint32 *err)
+{
+if (sim_aio_wait (cp->aio, &ua->wr) != SCPE_OK) {       /* write behind err? */
+    errno = ua->wr.err;
+    ua->wr.err = 0;
+    *err = 1;
+    }
+return (uint16 *) ua->wr.buf;
+}
+
+void rq_aio_write (MSC *cp, struct rq_aio *ua, UNIT *uptr, t_addr da, uint32 lnt)
+{
+ua->rdok = 0;                                           /* read ahead stale */
+ua->wr.op = AIO_WR;
+ua->wr.fref = uptr->fileref;
+ua->wr.pos = da;
+ua->wr.len = lnt;
+sim_aio_submit (cp->aio, &ua->wr);
+return;
+}
+
+/* Finish all host I/O, e.g. before the file is closed */
+
+void rq_aio_drain (MSC *cp)
+{
+int32 i;
+
+if (cp->aio == NULL) return;
+sim_aio_drain (cp->aio);
+for (i = 0; i < RQ_NUMDR; i++) cp->aiou[i].rdok = 0;
+return;
+}
+
 /* Data transfer error log packet */
 
 t_bool rq_dte (MSC *cp, UNIT *uptr, uint32 err)
@@ -2208,6 +2375,33 @@ else fprintf (st, "write enabled");
 return SCPE_OK;
 }
 
+/* Set/show asynchronous host I/O */
+
+t_stat rq_set_aio (UNIT *uptr, int32 val, char *cptr, void *desc)
+{
+DEVICE *dptr = find_dev_from_unit (uptr);
+int32 i;
+
+if (cptr) return SCPE_ARG;
+for (i = 0; (i < RQ_NUMCT) && (rq_devmap[i] != dptr); i++) ;
+if (i >= RQ_NUMCT) return SCPE_IERR;
+if (val) dptr->flags = dptr->flags | DEV_AIO;
+else {
+    rq_aio_drain (rq_ctxmap[i]);                        /* finish writes */
+    dptr->flags = dptr->flags & ~DEV_AIO;
+    }
+return SCPE_OK;
+}
+
+t_stat rq_show_aio (FILE *st, UNIT *uptr, int32 val, void *desc)
+{
+DEVICE *dptr = find_dev_from_unit (uptr);
+
+if (dptr == NULL) return SCPE_IERR;
+fprintf (st, (dptr->flags & DEV_AIO)? "asynchronous I/O": "synchronous I/O");
+return SCPE_OK;
+}
+
 /* Set unit type (and capacity if user defined) */
 
 t_stat rq_set_type (UNIT *uptr, int32 val, char *cptr, void *desc)
@@ -2247,6 +2441,8 @@ t_stat r;
 
 r = attach_unit (uptr, cptr);
 if (r != SCPE_OK) return r;
+if (sim_switches & SWMASK ('M'))                        /* map image? */
+    sim_fmap (uptr, uptr->capac);
 if (cp->csta == CST_UP) uptr->flags = uptr->flags | UNIT_ATP;
 return SCPE_OK;
 }
@@ -2255,8 +2451,10 @@ return SCPE_OK;
 
 t_stat rq_detach (UNIT *uptr)
 {
+MSC *cp = rq_ctxmap[uptr->cnum];
 t_stat r;
 
+rq_aio_drain (cp);                                      /* host I/O done */
 r = detach_unit (uptr);                                 /* detach unit */
 if (r != SCPE_OK) return r;
 uptr->flags = uptr->flags & ~(UNIT_ONL | UNIT_ATP);     /* clr onl, atn pend */
@@ -2307,6 +2505,8 @@ for (i = 0; i < RQ_NPKTS; i++) {                        /* all pkts free */
 cp->rspq = 0;                                           /* no q'd rsp pkts */
 cp->pbsy = 0;                                           /* all pkts free */
 cp->pip = 0;                                            /* not polling */
+for (i = 0; cp->aiou && (i < RQ_NUMDR); i++)            /* no read ahead */
+    cp->aiou[i].rdok = 0;
 rq_clrint (cp);                                         /* clr intr req */
 for (i = 0; i < (RQ_NUMDR + 2); i++) {                  /* init units */
     uptr = dptr->units + i;
@@ -75,6 +75,7 @@ int32 clk_tps = 60;                                     /* ticks/second */
 int32 clk_default = 60;                                 /* default ticks/second */
 int32 clk_fie = 0;                                      /* force IE = 1 */
 int32 clk_fnxm = 0;                                     /* force NXM on reg */
+int32 clk_ext = 0;                                      /* ticks by clk_tick */
 int32 tmxr_poll = CLK_DELAY;                            /* term mux poll */
 int32 tmr_poll = CLK_DELAY;                             /* timer poll */
 
@@ -90,6 +91,7 @@ t_stat tty_set_mode (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat clk_rd (int32 *data, int32 PA, int32 access);
 t_stat clk_wr (int32 data, int32 PA, int32 access);
 t_stat clk_svc (UNIT *uptr);
+void clk_tick (void);
 int32 clk_inta (void);
 t_stat clk_reset (DEVICE *dptr);
 t_stat clk_set_freq (UNIT *uptr, int32 val, char *cptr, void *desc);
@@ -233,6 +235,7 @@ REG clk_reg[] = {
     { DRDATA (DEFTPS, clk_default, 16), PV_LEFT + REG_HRO },
     { FLDATA (FIE, clk_fie, 0), REG_HIDDEN },
     { FLDATA (FNXM, clk_fnxm, 0), REG_HIDDEN },
+    { FLDATA (EXT, clk_ext, 0), REG_HIDDEN },
     { NULL }
     };
 
@@ -433,15 +436,18 @@ if ((((clk_csr & CSR_IE) == 0) && !clk_fie) ||          /* unless IE+DONE */
 return SCPE_OK;
 }
 
-/* Clock service */
+/* Clock service
+
+   With EXT set the timer still calibrates the poll intervals, but the
+   ticks the program sees are given by calls to clk_tick, so that a
+   caller such as a cosimulation can place them at a fixed instruction.
+*/
 
 t_stat clk_svc (UNIT *uptr)
 {
 int32 t;
 
-{ extern int show_i; if (show_i) printf("clk: done\n"); }
-clk_csr = clk_csr | CSR_DONE;                           /* set done */
-if ((clk_csr & CSR_IE) || clk_fie) SET_INT (CLK);
+if (!clk_ext) clk_tick ();                              /* tick, unless given */
 t = sim_rtcn_calb (clk_tps, TMR_CLK);                   /* calibrate clock */
 sim_activate (&clk_unit, t);                            /* reactivate unit */
 tmr_poll = t;                                           /* set timer poll */
@@ -449,6 +455,15 @@ tmxr_poll = t;                                          /* set mux poll */
 return SCPE_OK;
 }
 
+/* Clock tick */
+
+void clk_tick (void)
+{
+{ extern int show_i; if (show_i) printf("clk: done\n"); }
+clk_csr = clk_csr | CSR_DONE;                           /* set done */
+if ((clk_csr & CSR_IE) || clk_fie) SET_INT (CLK);
+}
+
 /* Clock interrupt acknowledge */
 
 int32 clk_inta (void)
@@ -174,7 +174,9 @@ const char *sim_stop_messages[] = {
     "Trap stack push abort",
     "RQDX3 consistency error",
     "Sanity timer expired",
-    "DECtape off reel"
+    "DECtape off reel",
+    "Host stop address",
+    "Host PC hook stop"
     };
 
 /* Binary loader.
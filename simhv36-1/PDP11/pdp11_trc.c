@@ -0,0 +1,239 @@
+/* pdp11_trc.c: PDP-11 binary instruction trace coder
+
+   The CPU fills one TRC_REC per instruction into a sim_trace stream
+   (SET CPU TRACE=file); this module codes the records for the file on
+   the writer thread, and decodes and prints them for trcdec.
+
+   A file is TRC_MAGIC followed by the coded records.  Each record
+   starts with a flags byte saying which fields do not follow from the
+   record before:
+
+   TRC_F_PC     PC is not the previous PC + 2: zigzag varint delta
+   TRC_F_IPA    physical PC did not move with PC: varint
+   TRC_F_PSW    PSW changed: 2 bytes
+   TRC_F_CODE   instruction words not in the code cache: 4 x 2 bytes
+   TRC_F_SRC    source register changed: zigzag varint delta
+   TRC_F_DST    destination register changed: zigzag varint delta
+   TRC_F_PA     data references: a byte with the count in the low four
+                bits and which of them are writes in the high four,
+                then for each a zigzag varint delta from the same
+                reference of the last record with one
+
+   The code cache is indexed by physical PC and holds the last words
+   seen there, so loops code their instructions in the flags byte.
+   Words are little endian.  A typical record takes 4 to 8 bytes,
+   against 40 in memory.
+*/
+
+#include "pdp11_defs.h"
+#include "pdp11_trc.h"
+
+#define TRC_F_PC        0001
+#define TRC_F_IPA       0002
+#define TRC_F_PSW       0004
+#define TRC_F_CODE      0010
+#define TRC_F_SRC       0020
+#define TRC_F_DST       0040
+#define TRC_F_PA        0100
+
+#define SEXT16(x)       ((int32) (((x) & 0177777) ^ 0100000) - 0100000)
+#define ZIG(x)          ((((uint32) (x)) << 1) ^ ((uint32) ((x) < 0? -1: 0)))
+#define UNZIG(v)        ((int32) ((v) >> 1) ^ -((int32) ((v) & 1)))
+
+extern void cpu_fprint_hist (FILE *st, int32 pc, int32 psw, int32 src,
+    int32 dst, uint16 *inst);
+
+static uint32 trc_putv (uint8 *out, uint32 v);
+static int32 trc_getv (uint8 *buf, int32 lnt, uint32 *v);
+
+void trc_init (TRC_CODER *cp)
+{
+uint32 i;
+
+memset (&cp->prev, 0, sizeof (TRC_REC));
+for (i = 0; i < TRC_CODE; i++) cp->ctag[i] = 0xFFFFFFFF; /* cache empty */
+return;
+}
+
+/* Code a record; the sim_trace packing routine */
+
+uint32 trc_pack (void *ctx, void *rec, uint8 *out)
+{
+TRC_CODER *cp = (TRC_CODER *) ctx;
+TRC_REC *rp = (TRC_REC *) rec;
+TRC_REC *pp = &cp->prev;
+uint32 k, n, fl, ci, npa;
+int32 dpc;
+
+n = 1;                                                  /* flags go first */
+fl = 0;
+dpc = SEXT16 (rp->pc - pp->pc);
+if (dpc != 2) {
+    fl = fl | TRC_F_PC;
+    n = n + trc_putv (out + n, ZIG (dpc));
+    }
+if (rp->ipa != (uint32) (pp->ipa + dpc)) {
+    fl = fl | TRC_F_IPA;
+    n = n + trc_putv (out + n, rp->ipa);
+    }
+if (rp->psw != pp->psw) {
+    fl = fl | TRC_F_PSW;
+    out[n++] = rp->psw & 0377;
+    out[n++] = rp->psw >> 8;
+    }
+ci = (rp->ipa >> 1) & (TRC_CODE - 1);
+if ((cp->ctag[ci] != rp->ipa) ||                        /* cache miss? */
+    memcmp (cp->code[ci], rp->inst, sizeof (rp->inst))) {
+    fl = fl | TRC_F_CODE;
+    for (k = 0; k < TRC_ILNT; k++) {
+        out[n++] = rp->inst[k] & 0377;
+        out[n++] = rp->inst[k] >> 8;
+        }
+    cp->ctag[ci] = rp->ipa;
+    memcpy (cp->code[ci], rp->inst, sizeof (rp->inst));
+    }
+if (rp->src != pp->src) {
+    fl = fl | TRC_F_SRC;
+    n = n + trc_putv (out + n, ZIG (SEXT16 (rp->src - pp->src)));
+    }
+if (rp->dst != pp->dst) {
+    fl = fl | TRC_F_DST;
+    n = n + trc_putv (out + n, ZIG (SEXT16 (rp->dst - pp->dst)));
+    }
+npa = (rp->npa < TRC_MAXPA)? rp->npa: TRC_MAXPA;
+if (npa) {
+    fl = fl | TRC_F_PA;
+    out[n++] = npa | ((rp->wr & ((1u << npa) - 1)) << 4);
+    for (k = 0; k < npa; k++) {
+        n = n + trc_putv (out + n, ZIG ((int32) (rp->pa[k] - pp->pa[k])));
+        pp->pa[k] = rp->pa[k];
+        }
+    }
+out[0] = fl;
+pp->pc = rp->pc;                                        /* becomes previous */
+pp->psw = rp->psw;
+pp->src = rp->src;
+pp->dst = rp->dst;
+pp->ipa = rp->ipa;
+pp->npa = npa;
+return n;
+}
+
+/* Decode a record
+
+   Inputs:
+        cp      =       coder state
+        buf     =       coded data
+        lnt     =       bytes available
+        rp      =       record to fill
+   Outputs:
+        n       =       bytes used, 0 if the record is incomplete, -1 if
+                        the data is not a record
+   The coder state is changed only when a record is returned.
+*/
+
+int32 trc_unpack (TRC_CODER *cp, uint8 *buf, int32 lnt, TRC_REC *rp)
+{
+TRC_REC *pp = &cp->prev;
+uint32 k, v, fl, ci;
+int32 n, m, dpc;
+
+if (lnt < 1) return 0;
+fl = buf[0];
+if (fl & ~0177) return -1;
+n = 1;
+*rp = *pp;
+dpc = 2;
+if (fl & TRC_F_PC) {
+    if ((m = trc_getv (buf + n, lnt - n, &v)) <= 0) return m;
+    n = n + m;
+    dpc = UNZIG (v);
+    }
+rp->pc = (pp->pc + dpc) & 0177777;
+rp->ipa = pp->ipa + dpc;
+if (fl & TRC_F_IPA) {
+    if ((m = trc_getv (buf + n, lnt - n, &v)) <= 0) return m;
+    n = n + m;
+    rp->ipa = v;
+    }
+if (fl & TRC_F_PSW) {
+    if ((n + 2) > lnt) return 0;
+    rp->psw = buf[n] | (buf[n + 1] << 8);
+    n = n + 2;
+    }
+ci = (rp->ipa >> 1) & (TRC_CODE - 1);
+if (fl & TRC_F_CODE) {
+    if ((n + (2 * TRC_ILNT)) > lnt) return 0;
+    for (k = 0; k < TRC_ILNT; k++, n = n + 2)
+        rp->inst[k] = buf[n] | (buf[n + 1] << 8);
+    }
+else if (cp->ctag[ci] != rp->ipa) return -1;            /* must be cached */
+else memcpy (rp->inst, cp->code[ci], sizeof (rp->inst));
+if (fl & TRC_F_SRC) {
+    if ((m = trc_getv (buf + n, lnt - n, &v)) <= 0) return m;
+    n = n + m;
+    rp->src = (pp->src + UNZIG (v)) & 0177777;
+    }
+if (fl & TRC_F_DST) {
+    if ((m = trc_getv (buf + n, lnt - n, &v)) <= 0) return m;
+    n = n + m;
+    rp->dst = (pp->dst + UNZIG (v)) & 0177777;
+    }
+rp->npa = 0;
+rp->wr = 0;
+if (fl & TRC_F_PA) {
+    if (n >= lnt) return 0;
+    rp->npa = buf[n] & 017;
+    rp->wr = buf[n++] >> 4;
+    if ((rp->npa == 0) || (rp->npa > TRC_MAXPA) ||
+        (rp->wr >> rp->npa)) return -1;
+    for (k = 0; k < rp->npa; k++) {
+        if ((m = trc_getv (buf + n, lnt - n, &v)) <= 0) return m;
+        n = n + m;
+        rp->pa[k] = pp->pa[k] + UNZIG (v);
+        }
+    }
+cp->ctag[ci] = rp->ipa;                                 /* complete, commit */
+memcpy (cp->code[ci], rp->inst, sizeof (rp->inst));
+*pp = *rp;                                              /* pa[npa..] kept */
+return n;
+}
+
+/* Print a record: physical PC, the SHOW CPU HISTORY line, data refs,
+   writes marked w */
+
+void trc_fprint (FILE *st, TRC_REC *rp)
+{
+uint32 k;
+
+fprintf (st, "%08o ", rp->ipa);
+cpu_fprint_hist (st, rp->pc, rp->psw, rp->src, rp->dst, rp->inst);
+for (k = 0; k < rp->npa; k++)
+    fprintf (st, k? " %08o%s": "  ; %08o%s", rp->pa[k],
+        ((rp->wr >> k) & 1)? "w": "");
+fputc ('\n', st);
+return;
+}
+
+/* Varints: 7 bits a byte, low order first */
+
+static uint32 trc_putv (uint8 *out, uint32 v)
+{
+uint32 n;
+
+for (n = 0; v >= 0200; n++, v = v >> 7) out[n] = (v & 0177) | 0200;
+out[n++] = v;
+return n;
+}
+
+static int32 trc_getv (uint8 *buf, int32 lnt, uint32 *v)
+{
+int32 n;
+
+for (n = 0, *v = 0; n < lnt; n++) {
+    if (n > 4) return -1;                               /* too long */
+    *v = *v | ((uint32) (buf[n] & 0177) << (7 * n));
+    if ((buf[n] & 0200) == 0) return n + 1;
+    }
+return 0;                                               /* incomplete */
+}
@@ -0,0 +1,53 @@
+/* pdp11_trc.h: PDP-11 binary instruction trace definitions
+
+   Record and file format shared by the CPU (SET CPU TRACE) and the
+   trace decoder (trcdec); see pdp11_trc.c.
+*/
+
+#ifndef _PDP11_TRC_H_
+#define _PDP11_TRC_H_   0
+
+#define TRC_ILNT        4                               /* inst words kept */
+#define TRC_MAXPA       4                               /* data refs kept */
+#define TRC_RING        (1u << 16)                      /* ring, records */
+#define TRC_MAXPACK     64                              /* max packed record */
+#define TRC_CODE        4096                            /* coder inst cache */
+#define TRC_MAGIC       "PDP11TR1"                      /* file header */
+#define TRC_HDRLNT      8
+
+#if (TRC_MAXPA > 4)                                     /* count, wr: a nibble each */
+#error "TRC_MAXPA must not exceed 4"
+#endif
+
+/* One record per instruction.  pa[] holds the physical addresses of
+   the first TRC_MAXPA data references, in order, and bit k of wr says
+   pa[k] was a write; references made by a trap or interrupt sequence
+   are counted with the instruction before. */
+
+typedef struct {
+    uint16              pc;                             /* virtual PC */
+    uint16              psw;                            /* PSW before */
+    uint16              src;                            /* src reg before */
+    uint16              dst;                            /* dst reg before */
+    uint16              inst[TRC_ILNT];                 /* IR, next words */
+    uint32              ipa;                            /* physical PC */
+    uint32              npa;                            /* data refs */
+    uint32              pa[TRC_MAXPA];                  /* their phys addrs */
+    uint32              wr;                             /* writes, by bit */
+    } TRC_REC;
+
+/* Coder state, the same on both sides: each record is coded against
+   the one before, and instruction words against a cache of code */
+
+typedef struct {
+    TRC_REC             prev;                           /* last record */
+    uint32              ctag[TRC_CODE];                 /* cache: phys PC */
+    uint16              code[TRC_CODE][TRC_ILNT];       /* cache: words */
+    } TRC_CODER;
+
+void trc_init (TRC_CODER *cp);
+uint32 trc_pack (void *ctx, void *rec, uint8 *out);
+int32 trc_unpack (TRC_CODER *cp, uint8 *buf, int32 lnt, TRC_REC *rp);
+void trc_fprint (FILE *st, TRC_REC *rp);
+
+#endif
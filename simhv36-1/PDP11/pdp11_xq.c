@@ -804,13 +804,13 @@ t_stat xq_process_rbdl(CTLR* xq)
 
     item = &xq->var->ReadQ.item[xq->var->ReadQ.head];
     rbl = item->packet.len;
-    rbuf = item->packet.msg;
+    rbuf = ETH_MSG(&item->packet);            /* may be a shared frame */
 
     /* see if packet must be size-adjusted or is splitting */
     if (item->packet.used) {
       int used = item->packet.used;
       rbl -= used;
-      rbuf = &item->packet.msg[used];
+      rbuf = &rbuf[used];
     } else {
       /* adjust runt packets */
       if (rbl < ETH_MIN_PACKET) {
@@ -818,7 +818,7 @@ t_stat xq_process_rbdl(CTLR* xq)
         sim_debug(DBG_WRN, xq->dev, "Runt detected, size = %d\n", rbl);
         /* pad runts with zeros up to minimum size - this allows "legal" (size - 60)
            processing of those weird short ARP packets that seem to occur occasionally */
-        memset(&item->packet.msg[rbl], 0, ETH_MIN_PACKET-rbl);
+        memset(&rbuf[rbl], 0, ETH_MIN_PACKET-rbl);
         rbl = ETH_MIN_PACKET;
       };
 
@@ -1310,12 +1310,14 @@ t_stat xq_process_local (CTLR* xq, ETH_PACK* pack)
   if (xq->var->type == XQ_T_DEQNA)
     return SCPE_NOFNC;
 
-  protocol = pack->msg[12] | (pack->msg[13] << 8);
+  protocol = ETH_MSG(pack)[12] | (ETH_MSG(pack)[13] << 8);
   switch (protocol) {
     case 0x0090:  /* ethernet loopback */
+      eth_unref(pack);
       return xq_process_loopback(xq, pack);
       break;
     case 0x0260:  /* MOP remote console */
+      eth_unref(pack);
       return xq_process_remote_console(xq, pack);
       break;
   }
@@ -1336,6 +1338,7 @@ void xq_read_callback(CTLR* xq, int status)
   } else {
     sim_debug(DBG_WRN, xq->dev, "packet received with receiver disabled\n");
   }
+  eth_release(&xq->var->read_buffer);   /* unless queued */
 }
 
 void xqa_read_callback(int status)
@@ -370,6 +370,7 @@ void xu_read_callback(CTLR* xu, int status)
   /* add packet to read queue */
   if (status != SCPE_OK)
     ethq_insert(&xu->var->ReadQ, 2, &xu->var->read_buffer, 0);
+  eth_release(&xu->var->read_buffer);   /* unless queued */
 }
 
 void xua_read_callback(int status)
@@ -969,7 +970,7 @@ void xu_process_receive(CTLR* xu)
        */
       if (item->packet.len < ETH_MIN_PACKET) {
         int len = item->packet.len;
-        memset (&item->packet.msg[len], 0, ETH_MIN_PACKET - len);
+        memset (&ETH_MSG(&item->packet)[len], 0, ETH_MIN_PACKET - len);
 	      item->packet.len = ETH_MIN_PACKET;
       }
     }
@@ -986,7 +987,7 @@ void xu_process_receive(CTLR* xu)
       wlen = slen;
 
     /* transfer chained packet to host buffer */
-    wstatus = Map_WriteB (segb, wlen, &item->packet.msg[off]);
+    wstatus = Map_WriteB (segb, wlen, &ETH_MSG(&item->packet)[off]); /* may be shared */
     if (wstatus) {
       /* error during write */
       xu->var->stat |= STAT_ERRS | STAT_MERR | STAT_TMOT | STAT_RRNG;
@@ -1030,7 +1031,7 @@ void xu_process_receive(CTLR* xu)
       /* update stats */
       upd_stat32(&xu->var->stats.frecv, 1);
       upd_stat32(&xu->var->stats.rbytes, item->packet.len - 14);
-      if (item->packet.msg[0] & 1) {        /* multicast? */
+      if (ETH_MSG(&item->packet)[0] & 1) {  /* multicast? */
         upd_stat32(&xu->var->stats.mfrecv, 1);
         upd_stat32(&xu->var->stats.mrbytes, item->packet.len - 14);
       }
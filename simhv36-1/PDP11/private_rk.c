@@ -12,7 +12,7 @@
 
 #include "pdp11_defs.h"
 
-UNIT rk_unit[];
+extern UNIT rk_unit[];
 #define LOCAL_IO
 
 //typedef int int32;
@@ -232,6 +232,7 @@ void rk_service(struct rk_context_s *rk)
 {
     int i, drv, err, awc, wc, cma, cda, t;
     int da, cyl, track, sector, ret;
+    off_t off;
     unsigned int ma;
     unsigned short comp;
 
@@ -281,7 +282,10 @@ void rk_service(struct rk_context_s *rk)
            "unknown", da * sizeof(short), da * sizeof(short));
 
 #ifdef LOCAL_IO
-    err = lseek(rk->rk_fd, da * sizeof(short), SEEK_SET);
+    /* the rtl and simh contexts share rk_fd, and may run on
+       different threads; use positioned i/o, not the fd offset */
+    off = da * sizeof(short);
+    err = 0;
 #else
     err = fseek (rk_unit[0].fileref, da * sizeof (int16), SEEK_SET);
 #endif
@@ -305,7 +309,7 @@ void rk_service(struct rk_context_s *rk)
             } else {
 printf("rk: read() wc %d\n", wc);
 #ifdef LOCAL_IO
-                i = read(rk->rk_fd, rk->rkxb, sizeof(short)*wc);
+                i = pread(rk->rk_fd, rk->rkxb, sizeof(short)*wc, off);
 #else
 	        i = fxread (rk->rkxb, sizeof (int16), wc, rk_unit[0].fileref);
 #endif
@@ -347,7 +351,7 @@ printf("rk: buffer %06o %06o %06o %06o\n",
             awc = (wc + (256 - 1)) & ~(256 - 1);
 printf("rk: write()\n");
 #ifdef LOCAL_IO
-	    ret = write(rk->rk_fd, rk->rkxb, awc*2);
+	    ret = pwrite(rk->rk_fd, rk->rkxb, awc*2, off);
 #else
 	    ret = fxwrite (rk->rkxb, sizeof (int16), awc, rk_unit[0].fileref);
 #endif
@@ -355,7 +359,7 @@ printf("rk: write()\n");
 
         case RKCS_WCHK:
 #ifdef LOCAL_IO
-            i = read(rk->rk_fd, rk->rkxb, sizeof(short)*wc);
+            i = pread(rk->rk_fd, rk->rkxb, sizeof(short)*wc, off);
 #else
 	    i = fxread (rk->rkxb, sizeof (int16), wc, rk_unit[0].fileref);
 #endif
@@ -548,13 +552,15 @@ void _io_rk_write(struct rk_context_s *rk, u22 addr, u16 data, int writeb)
 
 #include <fcntl.h>
 
+char *private_rk_image = "rk.dsk";
+
 void
 io_rk_reset(void)
 {
     rk_context[0].rkcs = CSR_DONE;
     rk_context[1].rkcs = CSR_DONE;
 
-    rk_context[0].rk_fd = open("rk.dsk", O_RDONLY);
+    rk_context[0].rk_fd = open(private_rk_image, O_RDONLY);
     rk_context[1].rk_fd = rk_context[0].rk_fd;
 
     rk_context[0].has_init = 1;
@@ -617,6 +623,21 @@ void io_rk_write(u22 addr, u16 data, int writeb)
     _io_rk_write(&rk_context[1], addr, data, writeb);
 }
 
+/* cosim checkpoints of one context; which is 0 for simh, 1 for rtl */
+#define RK_SAVED 2
+
+static struct rk_context_s rk_saved[RK_SAVED][2];
+
+void private_rk_save(int which, int slot)
+{
+    rk_saved[slot][which] = rk_context[which];
+}
+
+void private_rk_restore(int which, int slot)
+{
+    rk_context[which] = rk_saved[slot][which];
+}
+
 
 
 /*
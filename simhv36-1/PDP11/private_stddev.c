@@ -18,6 +18,7 @@ struct stddev_context_s {
     u16 tto_csr;
     u8 tti_data;
     u8 tto_data;
+    int tti_typed;		/* canned input given so far */
 } stddev_context[2];
 
 static int _io_has_reset;
@@ -122,17 +123,18 @@ u16 _io_tti_read(struct stddev_context_s *s, u22 addr)
 
 #if 1
 {
-	static int state = 0;
-	//printf("STATE %d\r\n", state);
+	/* per side, so simh and the rtl are given the same input */
+	int *state = &s->tti_typed;
+	//printf("STATE %d\r\n", *state);
 #if 1
-	if (state <= 9) {
-            s->tti_data = "rkunix.40\r"[state++];
+	if (*state <= 9) {
+            s->tti_data = "rkunix.40\r"[(*state)++];
             s->tti_csr |= CSR_DONE;
         }
 #endif
 #if 0
-	if (state <= 13) {
-            s->tti_data = "rk(0,0)rkunix\r"[state++];
+	if (*state <= 13) {
+            s->tti_data = "rk(0,0)rkunix\r"[(*state)++];
             s->tti_csr |= CSR_DONE;
         }
 #endif
@@ -143,6 +145,7 @@ u16 _io_tti_read(struct stddev_context_s *s, u22 addr)
                            addr, s->name, s->tti_data);
         return s->tti_data;
     } else {
+        sim_os_poll_out();              /* guest waiting for input */
         if (show_i) printf("_io_tti_read(%o) %s csr %o\e\n",
                            addr, s->name,
                            s->tti_csr & (CSR_DONE | CSR_IE));
@@ -195,7 +198,8 @@ void _io_tto_write(struct stddev_context_s *s, u22 addr, u16 data)
     if (addr & 2) {
         if ((addr & 1) == 0) {
             //printf("TTO %o %c\n", data, data);
-            printf("%c", data); fflush(stdout);
+            sim_putchar(data & 0377);   /* console output buffer */
+            sim_os_poll_out();          /* written if held too long */
             s->tto_data = data;
         }
         s->tto_csr &= ~CSR_DONE;
@@ -243,8 +247,22 @@ void _io_clk_write(struct stddev_context_s *s, u22 addr, u16 data)
     }
 }
 
+/* a line clock tick; the caller decides when */
+void _io_clk_tick(struct stddev_context_s *s)
+{
+    _io_check_reset();
+    s->clk_csr |= CSR_DONE;
+    if (s->clk_csr & CSR_IE)
+        _io_cpu_int_set(s, 0);
+}
+
 /* ---------------------------------------- */
 
+void io_clk_tick(void)
+{
+	_io_clk_tick(&stddev_context[1]);
+}
+
 void io_clk_write(u22 addr, u16 data)
 {
 	_io_clk_write(&stddev_context[1], addr, data);
@@ -328,6 +346,21 @@ int private_tto_wr (int32 data, int32 PA, int32 access)
 	return 0;
 }
 
+/* cosim checkpoints of one context; which is 0 for simh, 1 for rtl */
+#define STDDEV_SAVED 2
+
+static struct stddev_context_s stddev_saved[STDDEV_SAVED][2];
+
+void private_stddev_save(int which, int slot)
+{
+    stddev_saved[slot][which] = stddev_context[which];
+}
+
+void private_stddev_restore(int which, int slot)
+{
+    stddev_context[which] = stddev_saved[slot][which];
+}
+
 
 
 /*
@@ -159,6 +159,7 @@
 
 #include "sim_defs.h"
 #include "sim_rev.h"
+#include "sim_stats.h"
 #include <signal.h>
 #include <ctype.h>
 
@@ -248,6 +249,8 @@ void (*sim_vm_post) (t_bool from_scp) = NULL;
 CTAB *sim_vm_cmd = NULL;
 void (*sim_vm_fprint_addr) (FILE *st, DEVICE *dptr, t_addr addr) = NULL;
 t_addr (*sim_vm_parse_addr) (DEVICE *dptr, char *cptr, char **tptr) = NULL;
+void *(*sim_vm_mem) (UNIT *uptr, t_addr *size) = NULL;
+void (*sim_vm_stats) (SIM_STATS *sp) = NULL;
 
 /* Prototypes */
 
@@ -354,6 +357,7 @@ t_bool sim_brk_pend[SIM_BKPT_N_SPC] = { FALSE };
 t_addr sim_brk_ploc[SIM_BKPT_N_SPC] = { 0 };
 int32 sim_quiet = 0;
 int32 sim_step = 0;
+int32 sim_resume = 0;                                   /* VM may skip run setup */
 static double sim_time;
 static uint32 sim_rtime;
 static int32 noqueue_time;
@@ -746,6 +750,7 @@ int flag = 0;
 int stat;
 cptr = line;
 do_arg[0] = "";
+    sim_resume = 0;                                     /* may reconfigure */
     sub_args (cbuf, gbuf, CBUFSIZE, nargs, do_arg);
     if (echo) printf("do> %s\n", cptr);                 /* echo if -v */
     if (echo && sim_log) fprintf (sim_log, "do> %s\n", cptr);
@@ -786,6 +791,19 @@ void simh_write_mem(int addr, int val)
     M[addr >> 1] = val & 0177777;
 }
 
+/* a block of words at once, clipped to the memory size */
+void simh_load_mem(int addr, unsigned short *data, int words)
+{
+    extern uint16 *M;
+    t_addr size = sim_devices[0]->units->capac;
+
+    if ((t_addr) addr >= size)
+        return;
+    if ((t_addr) (addr + words*2) > size)
+        words = (size - addr) / 2;
+    memcpy (&M[addr >> 1], data, words * sizeof (uint16));
+}
+
 void simh_read_mem(int addr, short *pval)
 {
     extern uint16 *M;
@@ -826,13 +844,95 @@ void simh_read_psw(unsigned short *pval)
 
 void simh_set_pc(int pcv)
 {
+	sim_resume = 0;
 	run_boot_prep();
         put_rval (sim_PC, 0, pcv);
 }
 
+/* Host stepping interface
+
+   run_cmd is built for the interactive console: it installs the WRU
+   handler, switches the terminal mode, repositions and flushes every
+   attached file and prints a stop message.  simh_run_fast skips all of
+   that and calls sim_instr directly, with sim_resume set once the VM
+   has done its full setup, so a lockstep host pays only for the
+   register restore and setjmp on each call.
+*/
+
+static t_stat simh_run_fast (int32 steps)
+{
+t_stat r;
+
+stop_cpu = 0;
+sim_step = steps;
+if (sim_step) sim_activate (&sim_step_unit, sim_step);  /* set step timer */
+sim_is_running = 1;
+r = sim_instr ();
+sim_is_running = 0;
+sim_resume = 1;                                         /* setup now done */
+sim_cancel (&sim_step_unit);                            /* cancel step timer */
+if (sim_clock_queue != NULL) {                          /* update sim time */
+    UPDATE_SIM_TIME (sim_clock_queue->time);
+    }
+else {
+    UPDATE_SIM_TIME (noqueue_time);
+    }
+return r;
+}
+
+/* Execute n instructions; returns SCPE_STEP if all n were executed */
+
+t_stat simh_step_n (int32 n)
+{
+if (n <= 0) return SCPE_ARG;
+return simh_run_fast (n);
+}
+
+/* Run until the PC reaches pc (after at least one instruction) or
+   max instructions have executed, max = 0 means no limit */
+
+t_stat simh_run_until (int32 pc, int32 max)
+{
+extern int32 cpu_stop_pc;
+t_stat r;
+
+if (max < 0) return SCPE_ARG;
+cpu_stop_pc = pc;
+r = simh_run_fast (max);
+cpu_stop_pc = -1;
+return r;
+}
+
+/* Install a routine called with (PC, IR) for every instruction fetched;
+   a nonzero return stops the CPU once that instruction completes */
+
+void simh_set_pc_hook (int32 (*hook) (int32 pc, int32 ir))
+{
+extern int32 (*cpu_pc_hook) (int32 pc, int32 ir);
+
+cpu_pc_hook = hook;
+}
+
 void simh_step(void)
 {
-	run_cmd(RU_STEP, "");
+	simh_step_n(1);
+}
+
+/* Snapshot and restore the whole machine in host memory; see sim_snap_take */
+
+SIM_SNAP *simh_snapshot (void)
+{
+return sim_snap_take ();
+}
+
+t_stat simh_restore (SIM_SNAP *sp)
+{
+extern void cpu_load_regs (void);
+t_stat r;
+
+r = sim_snap_restore (sp);
+if (r == SCPE_OK) cpu_load_regs ();                     /* R[] for simh_read_reg */
+return r;
 }
 
 #endif
@@ -1075,6 +1175,7 @@ C1TAB *ctbr, *glbr;
 static CTAB set_glob_tab[] = {
     { "CONSOLE", &sim_set_console, 0 },
     { "BREAK", &brk_cmd, SSH_ST },
+    { "STATS", &sim_set_stats, 0 },
     { "TELNET", &sim_set_telnet, 0 },                   /* deprecated */
     { "NOTELNET", &sim_set_notelnet, 0 },               /* deprecated */
     { "LOG", &sim_set_logon, 0 },                       /* deprecated */
@@ -1308,6 +1409,7 @@ static SHTAB show_glob_tab[] = {
     { "VERSION", &show_version, 1 },
     { "CONSOLE", &sim_show_console, 0 },
     { "BREAK", &show_break, 0 },
+    { "STATS", &sim_show_stats, 0 },
     { "LOG", &sim_show_log, 0 },                        /* deprecated */
     { "TELNET", &sim_show_telnet, 0 },                  /* deprecated */
     { "DEBUG", &sim_show_debug, 0 },                    /* deprecated */
@@ -2015,6 +2117,7 @@ if (uptr->flags & UNIT_BUF) {
         }
     uptr->flags = uptr->flags & ~UNIT_BUF;
     }
+sim_funmap (uptr);                                      /* unmap if mapped */
 uptr->flags = uptr->flags & ~(UNIT_ATT | UNIT_RO);
 free (uptr->filename);
 uptr->filename = NULL;
@@ -2393,6 +2496,246 @@ for ( ;; ) {                                            /* device loop */
 return SCPE_OK;
 }
 
+/* In-process snapshots
+
+   sim_snap_take copies the simulator state into host memory, and
+   sim_snap_restore puts it back, without going through a save file:
+   simulated time and the event queue, device and unit flags and unit
+   fields, every register, memory-like units and the buffers of units
+   buffered in memory.  Memory the VM exposes through sim_vm_mem is
+   copied with memcpy rather than a word at a time.
+
+   Attached files are not copied.  A restore fails if the attachments
+   have changed, and data written to an unbuffered image after the
+   snapshot stays written; to fan out runs that write their disks,
+   start sim_inst instances from the restored state, since each
+   instance gets a private copy of its images.
+*/
+
+typedef struct {
+    UNIT                *uptr;                          /* queued unit */
+    int32               time;                           /* delta time */
+    } SNAP_EVT;
+
+struct sim_snap {
+    double              time;                           /* sim time */
+    uint32              rtime;                          /* sim rel time */
+    int32               noqueue_time;
+    int32               interval;                       /* sim_interval */
+    int32               nevt;                           /* event queue */
+    SNAP_EVT            *evt;
+    int32               ndev;                           /* device flags */
+    uint32              *dflags;
+    int32               nunit;                          /* unit copies */
+    UNIT                *units;
+    void                **ubuf;                         /* unit memory */
+    size_t              *ulnt;
+    int32               nval;                           /* register values */
+    t_value             *vals;
+    };
+
+/* Size in bytes of the memory behind a memory-like or buffered unit;
+   returns 0 if the unit has none.  *host is set to the host array when
+   it can be copied directly, NULL when examine/deposit must be used. */
+
+static size_t sim_snap_mlnt (DEVICE *dptr, UNIT *uptr, void **host)
+{
+t_addr lnt;
+
+*host = NULL;
+if (uptr->flags & UNIT_BUF) {                           /* buffered file? */
+    *host = uptr->filebuf;
+    return (size_t) (uptr->capac / dptr->aincr) * SZ_D (dptr);
+    }
+if (((uptr->flags & (UNIT_FIX + UNIT_ATTABLE)) == UNIT_FIX) &&
+    (dptr->examine != NULL) && (uptr->capac != 0)) {    /* memory-like unit? */
+    if (sim_vm_mem && (*host = sim_vm_mem (uptr, &lnt)))
+        return (size_t) lnt;
+    return (size_t) (uptr->capac / dptr->aincr) * sizeof (t_value);
+    }
+return 0;
+}
+
+SIM_SNAP *sim_snap_take (void)
+{
+SIM_SNAP *sp;
+DEVICE *dptr;
+UNIT *uptr, *cptr;
+REG *rptr;
+void *host;
+t_value *vp;
+t_addr k;
+int32 n, nu, nv;
+uint32 i, j;
+
+if ((sp = (SIM_SNAP *) calloc (1, sizeof (SIM_SNAP))) == NULL)
+    return NULL;
+if (sim_clock_queue != NULL) {                          /* update sim time */
+    UPDATE_SIM_TIME (sim_clock_queue->time);
+    }
+else {
+    UPDATE_SIM_TIME (noqueue_time);
+    }
+sp->time = sim_time;
+sp->rtime = sim_rtime;
+sp->noqueue_time = noqueue_time;
+sp->interval = sim_interval;
+for (cptr = sim_clock_queue, n = 0; cptr != NULL; cptr = cptr->next) n++;
+for (i = nu = nv = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    nu = nu + dptr->numunits;
+    for (rptr = dptr->registers; (rptr != NULL) && (rptr->name != NULL); rptr++)
+        nv = nv + rptr->depth;
+    }
+sp->evt = (SNAP_EVT *) calloc (n + 1, sizeof (SNAP_EVT));
+sp->dflags = (uint32 *) calloc (i + 1, sizeof (uint32));
+sp->units = (UNIT *) calloc (nu + 1, sizeof (UNIT));
+sp->ubuf = (void **) calloc (nu + 1, sizeof (void *));
+sp->ulnt = (size_t *) calloc (nu + 1, sizeof (size_t));
+sp->vals = (t_value *) calloc (nv + 1, sizeof (t_value));
+if (!sp->evt || !sp->dflags || !sp->units || !sp->ubuf || !sp->ulnt || !sp->vals) {
+    sim_snap_free (sp);
+    return NULL;
+    }
+for (cptr = sim_clock_queue; cptr != NULL; cptr = cptr->next) {
+    sp->evt[sp->nevt].uptr = cptr;                      /* queue in order */
+    sp->evt[sp->nevt++].time = cptr->time;
+    }
+for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    sp->dflags[sp->ndev++] = dptr->flags;
+    for (j = 0; j < dptr->numunits; j++) {
+        uptr = dptr->units + j;
+        sp->units[sp->nunit] = *uptr;
+        sp->units[sp->nunit].filename = NULL;           /* own copy, below */
+        if ((uptr->flags & UNIT_ATT) && uptr->filename) {
+            if ((sp->units[sp->nunit].filename = (char *)
+                malloc (strlen (uptr->filename) + 1)) == NULL) {
+                sim_snap_free (sp);
+                return NULL;
+                }
+            strcpy (sp->units[sp->nunit].filename, uptr->filename);
+            }
+        sp->ulnt[sp->nunit] = sim_snap_mlnt (dptr, uptr, &host);
+        if (sp->ulnt[sp->nunit]) {
+            if ((sp->ubuf[sp->nunit] = malloc (sp->ulnt[sp->nunit])) == NULL) {
+                sim_snap_free (sp);
+                return NULL;
+                }
+            if (host) memcpy (sp->ubuf[sp->nunit], host, sp->ulnt[sp->nunit]);
+            else {
+                vp = (t_value *) sp->ubuf[sp->nunit];
+                for (k = 0; k < uptr->capac; k = k + dptr->aincr, vp++) {
+                    if (dptr->examine (vp, k, uptr, SIM_SW_REST) != SCPE_OK)
+                        *vp = 0;
+                    }
+                }
+            }
+        sp->nunit++;
+        }
+    for (rptr = dptr->registers; (rptr != NULL) && (rptr->name != NULL); rptr++) {
+        for (j = 0; j < rptr->depth; j++)
+            sp->vals[sp->nval++] = get_rval (rptr, j);
+        }
+    }
+return sp;
+}
+
+t_stat sim_snap_restore (SIM_SNAP *sp)
+{
+DEVICE *dptr;
+UNIT *uptr, *sv, *cptr, *nptr;
+REG *rptr;
+void *host;
+t_value *vp;
+t_addr k;
+int32 nu, nv;
+uint32 i, j;
+
+if (sp == NULL) return SCPE_ARG;
+for (i = nu = 0; (dptr = sim_devices[i]) != NULL; i++) { /* check config */
+    for (j = 0; j < dptr->numunits; j++, nu++) {
+        uptr = dptr->units + j;
+        sv = sp->units + nu;
+        if ((nu >= sp->nunit) ||
+            ((uptr->flags ^ sv->flags) & (UNIT_ATT | UNIT_BUF | UNIT_MMAP)) ||
+            (uptr->capac != sv->capac) ||
+            ((uptr->flags & UNIT_ATT) && ((uptr->filename == NULL) ||
+                (sv->filename == NULL) ||
+                strcmp (uptr->filename, sv->filename))) ||
+            (sim_snap_mlnt (dptr, uptr, &host) != sp->ulnt[nu]))
+            return SCPE_INCOMP;
+        }
+    }
+if ((i != (uint32) sp->ndev) || (nu != sp->nunit)) return SCPE_INCOMP;
+for (cptr = sim_clock_queue; cptr != NULL; cptr = nptr) { /* empty queue */
+    nptr = cptr->next;
+    cptr->next = NULL;
+    }
+sim_clock_queue = NULL;
+for (i = nu = nv = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    dptr->flags = sp->dflags[i];
+    for (j = 0; j < dptr->numunits; j++, nu++) {
+        uptr = dptr->units + j;
+        sv = sp->units + nu;
+        uptr->flags = sv->flags;
+        uptr->hwmark = sv->hwmark;
+        uptr->pos = sv->pos;
+        uptr->buf = sv->buf;
+        uptr->wait = sv->wait;
+        uptr->u3 = sv->u3;
+        uptr->u4 = sv->u4;
+        uptr->u5 = sv->u5;
+        uptr->u6 = sv->u6;
+        if (sp->ulnt[nu]) {
+            sim_snap_mlnt (dptr, uptr, &host);
+            if (host) memcpy (host, sp->ubuf[nu], sp->ulnt[nu]);
+            else {
+                vp = (t_value *) sp->ubuf[nu];
+                for (k = 0; k < uptr->capac; k = k + dptr->aincr, vp++)
+                    dptr->deposit (*vp, k, uptr, SIM_SW_REST);
+                }
+            }
+        }
+    for (rptr = dptr->registers; (rptr != NULL) && (rptr->name != NULL); rptr++) {
+        for (j = 0; j < rptr->depth; j++)
+            put_rval (rptr, j, sp->vals[nv++]);
+        }
+    }
+for (i = 0; i < (uint32) sp->nevt; i++) {               /* rebuild queue */
+    uptr = sp->evt[i].uptr;
+    uptr->time = sp->evt[i].time;
+    uptr->next = NULL;
+    if (i == 0) sim_clock_queue = uptr;
+    else sp->evt[i - 1].uptr->next = uptr;
+    }
+sim_time = sp->time;
+sim_rtime = sp->rtime;
+noqueue_time = sp->noqueue_time;
+sim_interval = sp->interval;
+sim_resume = 0;                                         /* flags may differ */
+return SCPE_OK;
+}
+
+void sim_snap_free (SIM_SNAP *sp)
+{
+int32 i;
+
+if (sp == NULL) return;
+if (sp->ubuf) {
+    for (i = 0; i < sp->nunit; i++) free (sp->ubuf[i]);
+    }
+if (sp->units) {                                        /* filename copies */
+    for (i = 0; i <= sp->nunit; i++) free (sp->units[i].filename);
+    }
+free (sp->evt);
+free (sp->dflags);
+free (sp->units);
+free (sp->ubuf);
+free (sp->ulnt);
+free (sp->vals);
+free (sp);
+return;
+}
+
 /* Run, go, cont, step commands
 
    ru[n] [new PC]       reset and start simulation
@@ -2485,6 +2828,7 @@ if ((r = sim_check_console (30)) != SCPE_OK) {          /* check console, error?
 if (sim_step) sim_activate (&sim_step_unit, sim_step);  /* set step timer */
 sim_is_running = 1;                                     /* flag running */
 sim_brk_clract ();                                      /* defang actions */
+sim_resume = 0;                                         /* full VM setup */
 r = sim_instr();
 
 sim_is_running = 0;                                     /* flag idle */
@@ -2508,8 +2852,10 @@ for (i = 1; (dptr = sim_devices[i]) != NULL; i++) {     /* flush attached files
             !(uptr->flags & UNIT_BUF) &&                /* not buffered, */
             (uptr->fileref) &&                          /* real file, */
             !(uptr->flags & UNIT_RAW) &&                /* not raw, */
-            !(uptr->flags & UNIT_RO))                   /* not read only? */
-            fflush (uptr->fileref);
+            !(uptr->flags & UNIT_RO)) {                 /* not read only? */
+            if (uptr->flags & UNIT_MMAP) sim_fmap_flush (uptr);
+            else fflush (uptr->fileref);
+            }
         }
     }
 #if defined (VMS)
@@ -3003,6 +3349,13 @@ for (i = 0, j = addr; i < sim_emax; i++, j = j + dptr->aincr) {
         if (uptr->flags & UNIT_BUF) {
             SZ_LOAD (sz, sim_eval[i], uptr->filebuf, loc);
             }
+        else if (uptr->flags & UNIT_MMAP) {             /* mapped file? */
+            if ((sz * (loc + 1)) > uptr->hwmark) {
+                reason = SCPE_NXM;
+                break;
+                }
+            SZ_LOAD (sz, sim_eval[i], uptr->filebuf, loc);
+            }
         else {
             sim_fseek (uptr->fileref, sz * loc, SEEK_SET);
             sim_fread (&sim_eval[i], sz, 1, uptr->fileref);
@@ -3082,6 +3435,11 @@ for (i = 0, j = addr; i < count; i++, j = j + dptr->aincr) {
             SZ_STORE (sz, sim_eval[i], uptr->filebuf, loc);
             if (loc >= uptr->hwmark) uptr->hwmark = (uint32) loc + 1;
             }
+        else if (uptr->flags & UNIT_MMAP) {             /* mapped file? */
+            if (uptr->flags & UNIT_RO) return SCPE_RO;
+            if ((sz * (loc + 1)) > uptr->hwmark) return SCPE_NXM;
+            SZ_STORE (sz, sim_eval[i], uptr->filebuf, loc);
+            }
         else {
             sim_fseek (uptr->fileref, sz * loc, SEEK_SET);
             sim_fwrite (&sim_eval[i], sz, 1, uptr->fileref);
@@ -3883,12 +4241,16 @@ return SCPE_OK;
    Outputs:
         reason  =       reason code returned by any event processor,
                         or 0 (SCPE_OK) if no exceptions
+
+   Each event processor is timed in host time for SHOW STATS, and a
+   due statistics report is sent from here.
 */
 
 t_stat sim_process_event (void)
 {
 UNIT *uptr;
 t_stat reason;
+t_uint64 t0, t1;
 
 if (stop_cpu) return SCPE_STOP;                         /* stop CPU? */
 if (sim_clock_queue == NULL) {                          /* queue empty? */
@@ -3897,6 +4259,7 @@ if (sim_clock_queue == NULL) {                          /* queue empty? */
     return SCPE_OK;
     }
 UPDATE_SIM_TIME (sim_clock_queue->time);                /* update sim time */
+t1 = sim_stats_nsec ();
 do {
     uptr = sim_clock_queue;                             /* get first */
     sim_clock_queue = uptr->next;                       /* remove first */
@@ -3906,7 +4269,11 @@ do {
     else sim_interval = noqueue_time = NOQUEUE_WAIT;
     if (uptr->action != NULL) reason = uptr->action (uptr);
     else reason = SCPE_OK;
+    t0 = t1;                                            /* time the action */
+    t1 = sim_stats_nsec ();
+    sim_stats_event (uptr, t1 - t0);
     } while ((reason == SCPE_OK) && (sim_interval == 0));
+if (t1 >= sim_stats_next) sim_stats_poll (t1);          /* stats report due? */
 
 /* Empty queue forces sim_interval != 0 */
 
@@ -116,4 +116,20 @@ void sim_debug_u16 (uint32 dbits, DEVICE* dptr, const char* const* bitdefs,
 void sim_debug (uint32 dbits, DEVICE* dptr, const char* fmt, ...);
 void fprint_stopped_gen (FILE *st, t_stat v, REG *pc, DEVICE *dptr);
 
+/* In-process snapshots */
+
+typedef struct sim_snap SIM_SNAP;
+
+SIM_SNAP *sim_snap_take (void);
+t_stat sim_snap_restore (SIM_SNAP *sp);
+void sim_snap_free (SIM_SNAP *sp);
+
+/* Host interface (library build) */
+
+t_stat simh_step_n (int32 n);
+t_stat simh_run_until (int32 pc, int32 max);
+void simh_set_pc_hook (int32 (*hook) (int32 pc, int32 ir));
+SIM_SNAP *simh_snapshot (void);
+t_stat simh_restore (SIM_SNAP *sp);
+
 #endif
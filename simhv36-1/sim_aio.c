@@ -0,0 +1,234 @@
+/* sim_aio.c: simulator asynchronous file I/O library
+
+   This library includes:
+
+   sim_aio_create       -       create an I/O context (thread and queue)
+   sim_aio_submit       -       queue a read or write request
+   sim_aio_wait         -       wait for a request to complete
+   sim_aio_drain        -       wait for all queued requests to complete
+
+   A device that wants its host file I/O off the simulator thread keeps
+   one context per controller.  Requests complete in the order they are
+   submitted, so a read queued behind a write of the same blocks sees
+   the written data.  The request block and its buffer belong to the
+   caller and must not be touched while the request is busy.
+
+   Everything that touches simulator state - memory, the event queue,
+   interrupts - stays on the simulator thread: the device queues a
+   request, carries on, and collects the result from its own unit
+   service routine.
+
+   Transfers use pread/pwrite on the stream's descriptor, so they do
+   not disturb the stream position; sim_aio_submit flushes the stream
+   first, in case it holds data written through stdio.  Data is moved
+   as is, so sim_aio_create declines on big endian hosts, as it does
+   where threads are not available; callers then use stdio.
+
+   Before a fork every context is drained, so a forked instance starts
+   with no requests in flight; its thread is restarted on first use.
+*/
+
+#include "sim_defs.h"
+#include "sim_aio.h"
+
+#if defined (USE_AIO_THREAD)
+#include <unistd.h>
+
+extern int32 sim_end;
+
+static SIM_AIO *sim_aio_list = NULL;                    /* all contexts */
+
+static t_stat sim_aio_start (SIM_AIO *ap);
+static void *sim_aio_thread (void *arg);
+static void sim_aio_xfer (SIM_AIOREQ *rp);
+static void sim_aio_prefork (void);
+static void sim_aio_parent (void);
+static void sim_aio_child (void);
+
+SIM_AIO *sim_aio_create (void)
+{
+SIM_AIO *ap;
+
+if (sim_end == 0) return NULL;                          /* big endian? */
+ap = (SIM_AIO *) calloc (1, sizeof (SIM_AIO));
+if (ap == NULL) return NULL;
+pthread_mutex_init (&ap->lock, NULL);
+pthread_cond_init (&ap->work, NULL);
+pthread_cond_init (&ap->done, NULL);
+if (sim_aio_start (ap) != SCPE_OK) {                    /* no thread? */
+    pthread_mutex_destroy (&ap->lock);
+    pthread_cond_destroy (&ap->work);
+    pthread_cond_destroy (&ap->done);
+    free (ap);
+    return NULL;
+    }
+if (sim_aio_list == NULL)                               /* first context? */
+    pthread_atfork (&sim_aio_prefork, &sim_aio_parent, &sim_aio_child);
+ap->next = sim_aio_list;
+sim_aio_list = ap;
+return ap;
+}
+
+/* Queue a request; the caller fills in op, fref, pos, buf and len */
+
+void sim_aio_submit (SIM_AIO *ap, SIM_AIOREQ *rp)
+{
+fflush (rp->fref);                                      /* stdio data out */
+rp->next = NULL;
+rp->xfr = 0;
+rp->err = 0;
+rp->busy = 1;
+if (!ap->run && (sim_aio_start (ap) != SCPE_OK)) {      /* lost thread? */
+    sim_aio_xfer (rp);                                  /* do it here */
+    rp->busy = 0;
+    return;
+    }
+pthread_mutex_lock (&ap->lock);
+if (ap->tail) ap->tail->next = rp;
+else ap->head = rp;
+ap->tail = rp;
+pthread_cond_signal (&ap->work);
+pthread_mutex_unlock (&ap->lock);
+return;
+}
+
+/* Wait for a request; returns SCPE_IOERR if the host I/O failed.
+   A short read (end of file) is not an error, see rp->xfr. */
+
+t_stat sim_aio_wait (SIM_AIO *ap, SIM_AIOREQ *rp)
+{
+pthread_mutex_lock (&ap->lock);
+while (rp->busy) pthread_cond_wait (&ap->done, &ap->lock);
+pthread_mutex_unlock (&ap->lock);
+return (rp->err? SCPE_IOERR: SCPE_OK);
+}
+
+void sim_aio_drain (SIM_AIO *ap)
+{
+pthread_mutex_lock (&ap->lock);
+while (ap->head || ap->run > 1)                         /* queued, active? */
+    pthread_cond_wait (&ap->done, &ap->lock);
+pthread_mutex_unlock (&ap->lock);
+return;
+}
+
+/* I/O thread
+
+   ap->run is 1 while the thread is idle and 2 while it has a request
+   off the queue, so that sim_aio_drain can tell when it is finished.
+*/
+
+static t_stat sim_aio_start (SIM_AIO *ap)
+{
+ap->run = 1;
+if (pthread_create (&ap->thr, NULL, &sim_aio_thread, (void *) ap)) {
+    ap->run = 0;
+    return SCPE_IERR;
+    }
+pthread_detach (ap->thr);
+return SCPE_OK;
+}
+
+static void *sim_aio_thread (void *arg)
+{
+SIM_AIO *ap = (SIM_AIO *) arg;
+SIM_AIOREQ *rp;
+
+pthread_mutex_lock (&ap->lock);
+for ( ;; ) {
+    while (ap->head == NULL) pthread_cond_wait (&ap->work, &ap->lock);
+    rp = ap->head;                                      /* dequeue */
+    if ((ap->head = rp->next) == NULL) ap->tail = NULL;
+    ap->run = 2;                                        /* active */
+    pthread_mutex_unlock (&ap->lock);
+    sim_aio_xfer (rp);
+    pthread_mutex_lock (&ap->lock);
+    rp->busy = 0;
+    ap->run = 1;                                        /* idle */
+    pthread_cond_broadcast (&ap->done);
+    }
+return NULL;
+}
+
+static void sim_aio_xfer (SIM_AIOREQ *rp)
+{
+int fd = fileno (rp->fref);
+char *bp = (char *) rp->buf;
+ssize_t n;
+
+while (rp->xfr < rp->len) {
+    if (rp->op == AIO_RD)
+        n = pread (fd, bp + rp->xfr, rp->len - rp->xfr, (off_t) (rp->pos + rp->xfr));
+    else n = pwrite (fd, bp + rp->xfr, rp->len - rp->xfr, (off_t) (rp->pos + rp->xfr));
+    if (n < 0) {
+        if (errno == EINTR) continue;
+        rp->err = errno;
+        break;
+        }
+    if (n == 0) break;                                  /* end of file */
+    rp->xfr = rp->xfr + (uint32) n;
+    }
+return;
+}
+
+/* Fork handlers: quiesce and hold every context across the fork; the
+   child has no I/O threads, and starts them again when needed */
+
+static void sim_aio_prefork (void)
+{
+SIM_AIO *ap;
+
+for (ap = sim_aio_list; ap != NULL; ap = ap->next) {
+    sim_aio_drain (ap);
+    pthread_mutex_lock (&ap->lock);
+    }
+return;
+}
+
+static void sim_aio_parent (void)
+{
+SIM_AIO *ap;
+
+for (ap = sim_aio_list; ap != NULL; ap = ap->next)
+    pthread_mutex_unlock (&ap->lock);
+return;
+}
+
+static void sim_aio_child (void)
+{
+SIM_AIO *ap;
+
+for (ap = sim_aio_list; ap != NULL; ap = ap->next) {
+    pthread_mutex_unlock (&ap->lock);
+    pthread_cond_init (&ap->work, NULL);
+    pthread_cond_init (&ap->done, NULL);
+    ap->run = 0;                                        /* no thread */
+    }
+return;
+}
+
+#else
+
+/* No threads: callers fall back to synchronous stdio */
+
+SIM_AIO *sim_aio_create (void)
+{
+return NULL;
+}
+
+void sim_aio_submit (SIM_AIO *ap, SIM_AIOREQ *rp)
+{
+return;
+}
+
+t_stat sim_aio_wait (SIM_AIO *ap, SIM_AIOREQ *rp)
+{
+return SCPE_NOFNC;
+}
+
+void sim_aio_drain (SIM_AIO *ap)
+{
+return;
+}
+
+#endif
@@ -0,0 +1,53 @@
+/* sim_aio.h: simulator asynchronous file I/O library headers
+
+   A SIM_AIO is one host I/O thread with a FIFO of requests; see sim_aio.c.
+*/
+
+#ifndef _SIM_AIO_H_
+#define _SIM_AIO_H_     0
+
+#if defined (__unix__) || defined (__APPLE__)
+#define USE_AIO_THREAD  1
+#endif
+
+#if defined (USE_AIO_THREAD)
+#include <pthread.h>
+#endif
+
+#define AIO_RD          1                               /* read */
+#define AIO_WR          2                               /* write */
+
+typedef struct sim_aio SIM_AIO;
+typedef struct sim_aioreq SIM_AIOREQ;
+
+struct sim_aioreq {
+    SIM_AIOREQ          *next;                          /* queue link */
+    int32               op;                             /* AIO_RD, AIO_WR */
+    FILE                *fref;                          /* file */
+    t_addr              pos;                            /* byte position */
+    void                *buf;                           /* data */
+    uint32              len;                            /* bytes to xfer */
+    uint32              xfr;                            /* bytes xfered */
+    int32               err;                            /* errno, 0 = ok */
+    volatile int32      busy;                           /* queued, active */
+    };
+
+struct sim_aio {
+    SIM_AIO             *next;                          /* all contexts */
+    SIM_AIOREQ          *head;                          /* request queue */
+    SIM_AIOREQ          *tail;
+    int32               run;                            /* thread started */
+#if defined (USE_AIO_THREAD)
+    pthread_t           thr;                            /* I/O thread */
+    pthread_mutex_t     lock;
+    pthread_cond_t      work;                           /* queue not empty */
+    pthread_cond_t      done;                           /* request done */
+#endif
+    };
+
+SIM_AIO *sim_aio_create (void);
+void sim_aio_submit (SIM_AIO *ap, SIM_AIOREQ *rp);
+t_stat sim_aio_wait (SIM_AIO *ap, SIM_AIOREQ *rp);
+void sim_aio_drain (SIM_AIO *ap);
+
+#endif
@@ -70,6 +70,8 @@
    sim_ttclose  -       called once before the simulator exits
    sim_os_poll_kbd -    poll for keyboard input
    sim_os_putchar -     output character to console
+   sim_os_flush_out -   write buffered console output
+   sim_os_poll_out -    write it if it has been held long enough
 
    The first group is OS-independent; the second group is OS-dependent.
 
@@ -94,6 +96,7 @@
 int32 sim_int_char = 005;                               /* interrupt character */
 int32 sim_brk_char = 000;                               /* break character */
 int32 sim_tt_pchar = 0x00002780;
+int32 sim_con_obuf = SIM_CON_BUF;                       /* output buffering */
 #if defined (_WIN32) || defined (__OS2__) || (defined (__MWERKS__) && defined (macintosh))
 int32 sim_del_char = '\b';                              /* delete character */
 #else
@@ -120,6 +123,9 @@ static CTAB set_con_tab[] = {
     { "NOLOG", &sim_set_logoff, 0 },
     { "DEBUG", &sim_set_debon, 0 },
     { "NODEBUG", &sim_set_deboff, 0 },
+    { "BUFFERED", &sim_set_cbuf, SIM_CON_BUF },
+    { "UNBUFFERED", &sim_set_cbuf, SIM_CON_UNBUF },
+    { "HEADLESS", &sim_set_cbuf, SIM_CON_HEADLESS },
     { NULL, NULL, 0 }
     };
 
@@ -131,6 +137,7 @@ static SHTAB show_con_tab[] = {
     { "LOG", &sim_show_log, 0 },
     { "TELNET", &sim_show_telnet, 0 },
     { "DEBUG", &sim_show_debug, 0 },
+    { "BUFFER", &sim_show_cbuf, 0 },
     { NULL, NULL, 0 }
     };
 
@@ -339,6 +346,35 @@ else fputs ("Debug output disabled\n", st);
 return SCPE_OK;
 }
 
+/* Set console output buffering
+
+   UNBUFFERED writes each character as it is output.  BUFFERED collects
+   output and writes it when the buffer fills, when the guest executes a
+   wait, when the simulator stops, and, from sim_os_poll_out, shortly
+   after the first character was buffered, so interactive echo is not
+   delayed.  HEADLESS drops the time limit, for a console on pipes or
+   files; it is the default when standard output is not a terminal.
+*/
+
+t_stat sim_set_cbuf (int32 flag, char *cptr)
+{
+if (cptr && (*cptr != 0)) return SCPE_2MARG;            /* too many arguments? */
+sim_os_flush_out ();                                    /* write what was held */
+sim_con_obuf = flag;
+return SCPE_OK;
+}
+
+/* Show console output buffering */
+
+t_stat sim_show_cbuf (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr)
+{
+if (cptr && (*cptr != 0)) return SCPE_2MARG;
+if (sim_con_obuf == SIM_CON_HEADLESS) fputs ("Output buffered, headless\n", st);
+else if (sim_con_obuf == SIM_CON_BUF) fputs ("Output buffered\n", st);
+else fputs ("Output unbuffered\n", st);
+return SCPE_OK;
+}
+
 /* Set console to Telnet port */
 
 t_stat sim_set_telnet (int32 flg, char *cptr)
@@ -598,6 +634,16 @@ if ((status != SS$_NORMAL) || (iosb.status != SS$_NORMAL)) return SCPE_TTOERR;
 return SCPE_OK;
 }
 
+t_stat sim_os_flush_out (void)
+{
+return SCPE_OK;
+}
+
+t_stat sim_os_poll_out (void)
+{
+return SCPE_OK;
+}
+
 /* Win32 routines */
 
 #elif defined (_WIN32)
@@ -664,6 +710,16 @@ if (c != 0177) _putch (c);
 return SCPE_OK;
 }
 
+t_stat sim_os_flush_out (void)
+{
+return SCPE_OK;
+}
+
+t_stat sim_os_poll_out (void)
+{
+return SCPE_OK;
+}
+
 /* OS/2 routines, from Bruce Ray and Holger Veit */
 
 #elif defined (__OS2__)
@@ -730,6 +786,16 @@ if (c != 0177) {
 return SCPE_OK;
 }
 
+t_stat sim_os_flush_out (void)
+{
+return SCPE_OK;
+}
+
+t_stat sim_os_poll_out (void)
+{
+return SCPE_OK;
+}
+
 /* Metrowerks CodeWarrior Macintosh routines, from Louis Chretien and
    Peter Schorn */
 
@@ -903,6 +969,16 @@ if (c != 0177) {
 return SCPE_OK;
 }
 
+t_stat sim_os_flush_out (void)
+{
+return SCPE_OK;
+}
+
+t_stat sim_os_poll_out (void)
+{
+return SCPE_OK;
+}
+
 /* BSD UNIX routines */
 
 #elif defined (BSDTTY)
@@ -986,18 +1062,155 @@ write (1, &c, 1);
 return SCPE_OK;
 }
 
-/* POSIX UNIX routines, from Leendert Van Doorn */
+t_stat sim_os_flush_out (void)
+{
+return SCPE_OK;
+}
+
+t_stat sim_os_poll_out (void)
+{
+return SCPE_OK;
+}
+
+/* POSIX UNIX routines, from Leendert Van Doorn
+
+   Console output is collected in the stdio buffer of stdout and written
+   as described for SET CONSOLE BUFFERED.  Simulator messages share that
+   buffer, so the two stay in order.  Output and its hold time are kept
+   under con_olock, so more than one thread may write the console; the
+   pipelined cosim does, from the model and simh threads.
+   Line buffering on a terminal writes it
+   at the end of each line; the time limit is checked on each keyboard
+   poll and by sim_os_poll_out.
+   While the simulator runs, a reader thread copies keyboard input, as
+   much as is waiting, into the ring con_ibuf, so a keyboard poll is a
+   memory reference and standard input may be a pipe that never has
+   input ready.  The thread is stopped, through con_stop, on return to
+   command mode; input it has read stays in the ring for the next run.
+*/
 
 #else
 
 #include <termios.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+
+#define CON_OHOLD       20                              /* max hold, msec */
+#define CON_IBUFSIZE    1024                            /* input ring, 2**n */
 
 struct termios cmdtty, runtty;
 static int prior_norm = 1;
+static int32 con_olnt = 0;                              /* chars held */
+static uint32 con_otime = 0;                            /* time of first */
+static pthread_mutex_t con_olock = PTHREAD_MUTEX_INITIALIZER;   /* output */
+static unsigned char con_ibuf[CON_IBUFSIZE];
+static volatile uint32 con_iput = 0;                    /* ring, reader */
+static volatile uint32 con_iget = 0;                    /* ring, simulator */
+static int con_stop[2] = { -1, -1 };                    /* reader stop pipe */
+static pthread_t con_thr;
+static t_bool con_thr_run = FALSE;                      /* reader started */
+
+static void *con_reader (void *arg)
+{
+struct pollfd pfd[2];
+unsigned char buf[CON_IBUFSIZE];
+int32 i, n, room;
+
+pfd[0].fd = 0;                                          /* keyboard */
+pfd[0].events = POLLIN;
+pfd[1].fd = con_stop[0];                                /* stop request */
+pfd[1].events = POLLIN;
+for (;;) {
+    room = CON_IBUFSIZE - (con_iput - con_iget);
+    if (room == 0) {                                    /* ring full? */
+        if (poll (&pfd[1], 1, 10) != 0) break;          /* wait for room */
+        continue;
+        }
+    if (poll (pfd, 2, -1) < 0) {
+        if (errno == EINTR) continue;
+        break;
+        }
+    if (pfd[1].revents) break;                          /* stop? */
+    if (pfd[0].revents == 0) continue;
+    n = read (0, buf, room);
+    if (n <= 0) {
+        if ((n < 0) && ((errno == EINTR) || (errno == EAGAIN))) continue;
+        break;                                          /* end of input */
+        }
+    for (i = 0; i < n; i++)
+        con_ibuf[(con_iput + i) & (CON_IBUFSIZE - 1)] = buf[i];
+    __sync_synchronize ();                              /* data before index */
+    con_iput = con_iput + n;
+    }
+return NULL;
+}
+
+static void con_start (void)
+{
+sigset_t all, old;
+
+if (con_thr_run || (pipe (con_stop) < 0)) return;
+sigfillset (&all);                                      /* signals stay with */
+pthread_sigmask (SIG_BLOCK, &all, &old);                /* the simulator */
+con_thr_run = (pthread_create (&con_thr, NULL, con_reader, NULL) == 0);
+pthread_sigmask (SIG_SETMASK, &old, NULL);
+if (!con_thr_run) {
+    close (con_stop[0]);
+    close (con_stop[1]);
+    }
+}
+
+static void con_end (void)
+{
+if (!con_thr_run) return;
+write (con_stop[1], "", 1);
+pthread_join (con_thr, NULL);
+close (con_stop[0]);
+close (con_stop[1]);
+con_thr_run = FALSE;
+}
+
+static void con_atfork_prepare (void)
+{
+pthread_mutex_lock (&con_olock);                        /* held over fork */
+con_olnt = 0;
+fflush (stdout);                                        /* not in both */
+}
+
+static void con_atfork_parent (void)
+{
+pthread_mutex_unlock (&con_olock);
+}
+
+static void con_atfork_child (void)
+{
+pthread_mutex_unlock (&con_olock);
+if (con_thr_run) {                                      /* reader not copied */
+    close (con_stop[0]);                                /* nor needs its pipe */
+    close (con_stop[1]);
+    con_stop[0] = con_stop[1] = -1;
+    con_thr_run = FALSE;
+    }
+}
+
+static void con_atexit (void)
+{
+sim_os_flush_out ();
+}
 
 t_stat sim_ttinit (void)
 {
+static t_bool once = FALSE;
+
+if (!once) {
+    pthread_atfork (con_atfork_prepare, con_atfork_parent, con_atfork_child);
+    atexit (con_atexit);
+    once = TRUE;
+    }
+if (!isatty (fileno (stdout))) sim_con_obuf = SIM_CON_HEADLESS;
 if (!isatty (fileno (stdin))) return SCPE_OK;           /* skip if !tty */
 if (tcgetattr (0, &cmdtty) < 0) return SCPE_TTIERR;     /* get old flags */
 runtty = cmdtty;
@@ -1038,9 +1251,13 @@ return SCPE_OK;
 
 t_stat sim_ttrun (void)
 {
-if (!isatty (fileno (stdin))) return SCPE_OK;           /* skip if !tty */
+if (!isatty (fileno (stdin))) {                         /* !tty? */
+    con_start ();                                       /* just start reader */
+    return SCPE_OK;
+    }
 runtty.c_cc[VINTR] = sim_int_char;                      /* in case changed */
 if (tcsetattr (0, TCSAFLUSH, &runtty) < 0) return SCPE_TTIERR;
+con_start ();                                           /* start reader */
 if (prior_norm) {                                       /* at normal pri? */
     errno =     0;
     (void)nice (10);                                    /* try to lower pri */
@@ -1051,6 +1268,8 @@ return SCPE_OK;
 
 t_stat sim_ttcmd (void)
 {
+con_end ();                                             /* stop reader */
+sim_os_flush_out ();                                    /* write output */
 if (!isatty (fileno (stdin))) return SCPE_OK;           /* skip if !tty */
 if (!prior_norm) {                                      /* priority down? */
     errno =     0;
@@ -1071,8 +1290,17 @@ t_stat sim_os_poll_kbd (void)
 int status;
 unsigned char buf[1];
 
-status = read (0, buf, 1);
-if (status != 1) return SCPE_OK;
+sim_os_poll_out ();                                      /* output held? */
+if (con_thr_run) {                                      /* reader running? */
+    if (con_iget == con_iput) return SCPE_OK;           /* nothing read */
+    __sync_synchronize ();                              /* index before data */
+    buf[0] = con_ibuf[con_iget & (CON_IBUFSIZE - 1)];
+    con_iget = con_iget + 1;
+    }
+else {
+    status = read (0, buf, 1);
+    if (status != 1) return SCPE_OK;
+    }
 if (sim_brk_char && (buf[0] == sim_brk_char)) return SCPE_BREAK;
 else return (buf[0] | SCPE_KFLAG);
 }
@@ -1081,8 +1309,41 @@ t_stat sim_os_putchar (int32 out)
 {
 char c;
 
-c = out;
-write (1, &c, 1);
+pthread_mutex_lock (&con_olock);                        /* one writer */
+if (sim_con_obuf == SIM_CON_UNBUF) {                    /* unbuffered? */
+    c = out;
+    fflush (stdout);                                    /* messages first */
+    write (1, &c, 1);
+    }
+else {
+    if (con_olnt == 0) con_otime = sim_os_msec ();      /* first held? */
+    con_olnt = con_olnt + 1;
+    putc (out, stdout);                                 /* after any message */
+    }
+pthread_mutex_unlock (&con_olock);
+return SCPE_OK;
+}
+
+t_stat sim_os_flush_out (void)
+{
+pthread_mutex_lock (&con_olock);
+if (con_olnt) {                                         /* anything held? */
+    con_olnt = 0;
+    fflush (stdout);
+    }
+pthread_mutex_unlock (&con_olock);
+return SCPE_OK;
+}
+
+t_stat sim_os_poll_out (void)
+{
+if (sim_con_obuf != SIM_CON_BUF) return SCPE_OK;        /* no time limit? */
+pthread_mutex_lock (&con_olock);
+if (con_olnt && ((sim_os_msec () - con_otime) >= CON_OHOLD)) {  /* held long? */
+    con_olnt = 0;
+    fflush (stdout);
+    }
+pthread_mutex_unlock (&con_olock);
 return SCPE_OK;
 }
 
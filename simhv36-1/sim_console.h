@@ -50,6 +50,12 @@
 #define  TT_MODE_KSR    (TT_MODE_UC)
 #define TT_GET_MODE(x)  (((x) >> TTUF_V_MODE) & TTUF_M_MODE)
 
+#define SIM_CON_UNBUF   0                               /* output unbuffered */
+#define SIM_CON_BUF     1                               /* buffered */
+#define SIM_CON_HEADLESS 2                              /* buffered, no time limit */
+
+extern int32 sim_con_obuf;
+
 t_stat sim_set_console (int32 flag, char *cptr);
 t_stat sim_set_kmap (int32 flag, char *cptr);
 t_stat sim_set_telnet (int32 flag, char *cptr);
@@ -59,12 +65,14 @@ t_stat sim_set_logoff (int32 flag, char *cptr);
 t_stat sim_set_debon (int32 flag, char *cptr);
 t_stat sim_set_deboff (int32 flag, char *cptr);
 t_stat sim_set_pchar (int32 flag, char *cptr);
+t_stat sim_set_cbuf (int32 flag, char *cptr);
 t_stat sim_show_console (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
 t_stat sim_show_kmap (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
 t_stat sim_show_telnet (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
 t_stat sim_show_log (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
 t_stat sim_show_debug (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
 t_stat sim_show_pchar (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
+t_stat sim_show_cbuf (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
 t_stat sim_check_console (int32 sec);
 t_stat sim_poll_kbd (void);
 t_stat sim_putchar (int32 c);
@@ -75,6 +83,8 @@ t_stat sim_ttcmd (void);
 t_stat sim_ttclose (void);
 t_stat sim_os_poll_kbd (void);
 t_stat sim_os_putchar (int32 out);
+t_stat sim_os_flush_out (void);
+t_stat sim_os_poll_out (void);
 int32 sim_tt_inpcvt (int32 c, uint32 mode);
 int32 sim_tt_outcvt (int32 c, uint32 mode);
 
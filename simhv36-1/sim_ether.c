@@ -230,6 +230,7 @@
 */
 
 #include <ctype.h>
+#include <stddef.h>
 #include "sim_ether.h"
 #include "sim_sock.h"
 
@@ -518,6 +519,10 @@ t_stat eth_show (FILE* st, UNIT* uptr, int32 val, void* desc)
       for (i=0; i<number; i++)
         fprintf(st,"  %d  %-*s (%s)\n", i, min, list[i].name, list[i].desc);
     }
+  fprintf(st, "  loop:<name>       hub within this simulator\n");
+#if defined (__unix__) || defined (__APPLE__)
+  fprintf(st, "  unix:<directory>  segment shared through a socket directory\n");
+#endif
   return SCPE_OK;
 }
 
@@ -544,6 +549,11 @@ t_stat ethq_init(ETH_QUE* que, int max)
 
 void ethq_clear(ETH_QUE* que)
 {
+  int i;
+
+  /* drop frames held by reference */
+  for (i = 0; i < que->max; i++)
+    eth_release(&que->item[i].packet);
   /* clear packet array */
   memset(que->item, 0, sizeof(struct eth_item) * que->max);
   /* clear rest of structure */
@@ -555,7 +565,9 @@ void ethq_remove(ETH_QUE* que)
   struct eth_item* item = &que->item[que->head];
 
   if (que->count) {
-    memset(item, 0, sizeof(struct eth_item));
+    eth_release(&item->packet);
+    item->type = 0;                   /* frame data is left for the next insert */
+    item->packet.len = item->packet.used = item->packet.status = 0;
     if (++que->head == que->max)
       que->head = 0;
     que->count--;
@@ -587,30 +599,499 @@ void ethq_insert(ETH_QUE* que, int32 type, ETH_PACK* pack, int32 status)
 
   /* set information in (new) tail item */
   item = &que->item[que->tail];
+  eth_release(&item->packet);         /* oldest, if it was lost */
   item->type = type;
   item->packet.len = pack->len;
   item->packet.used = 0;
   item->packet.crc_len = pack->crc_len;
-  memcpy(item->packet.msg, pack->msg, ((pack->len > pack->crc_len) ? pack->len : pack->crc_len));
+  if (pack->ref) {                    /* the reference moves to the queue */
+    item->packet.ref = pack->ref;
+    pack->ref = NULL;
+  } else
+    memcpy(item->packet.msg, pack->msg, ((pack->len > pack->crc_len) ? pack->len : pack->crc_len));
   item->packet.status = status;
 }
 
+/*============================================================================*/
+/*                        Local packet transports                             */
+/*============================================================================*/
+/*
+  Two transports connect simulated interfaces with no host NIC, pcap or
+  privileges.  Attach with one of these names in place of a device:
+
+    loop:<name>       in-process hub: every interface of this simulator
+                      attached to the same name is on one segment
+    unix:<directory>  Unix-domain datagram sockets: every interface, in any
+                      simulator on the host, attached to the same directory
+                      is on one segment.  Each binds a socket there named
+                      for its process and device.
+
+  A frame sent on a hub is copied once, into a shared buffer; each port
+  whose filter accepts it queues a reference.  eth_read hands the
+  reference on in the packet's ref (read the frame through ETH_MSG),
+  ethq_insert moves it into the device's receive queue, and the device
+  DMAs the frame from the buffer; ethq_remove, or the reader's
+  eth_release for a frame it did not queue, gives it back, and the
+  buffer returns to the free list when the last port is done with it.  A device that must edit a
+  frame calls eth_unref for a private copy.  Socket frames are received
+  directly into the caller's packet.  There is no BPF, so the
+  eth_filter addresses are applied here: on a hub when a frame is sent,
+  on a socket when it is read.  A sender never receives its own frames,
+  so DECnet duplicate address detection needs no reflection count.
+
+  A socket port sends broadcast, multicast and unknown unicast frames to
+  every socket in the directory, and learns which socket each source
+  address is behind, so unicast traffic between two guests goes only
+  between their two sockets.  An address whose socket has gone away is
+  forgotten and its frame flooded, in case the guest is back on another
+  socket.  The directory is read again once a second, and when a peer
+  has gone away.
+*/
+
+#if defined (__unix__) || defined (__APPLE__)
+#define USE_LOCAL_SOCKET 1
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+#define ETH_LRING      256                      /* hub frames queued per port */
+#define ETH_LLEARN      64                      /* addresses learned per port */
+#define ETH_LPEERS      64                      /* sockets per directory */
+#define ETH_LRESCAN   1000                      /* directory reread, msec */
+
+struct eth_lbuf {
+  struct eth_lbuf*  next;                       /* free list */
+  int               refs;                       /* ports holding it */
+  int               len;                        /* frame length */
+  int               crc;                        /* CRC appended */
+  uint8             msg[ETH_FRAME_SIZE];        /* frame */
+};
+
+struct eth_lhub {
+  struct eth_lhub*  next;                       /* all hubs */
+  struct eth_lport* ports;                      /* ports on hub */
+  char              name[ETH_DEV_NAME_MAX];     /* hub name */
+};
+
+struct eth_lport {
+  struct eth_lport* next;                       /* next port on hub */
+  struct eth_lhub*  hub;                        /* hub, NULL if socket */
+  ETH_DEV*          dev;                        /* owning device */
+  struct eth_lbuf*  ring[ETH_LRING];            /* hub frames received */
+  int               head;                       /* oldest in ring */
+  int               count;                      /* frames in ring */
+  int               loss;                       /* frames lost, ring full */
+#if defined (USE_LOCAL_SOCKET)
+  int               sock;                       /* datagram socket */
+  struct sockaddr_un self;                      /* own address */
+  char              dir[ETH_DEV_NAME_MAX];      /* segment directory */
+  struct sockaddr_un peer[ETH_LPEERS];          /* other sockets */
+  int               npeer;
+  uint32            scan;                       /* time of last read, msec */
+  ETH_MAC           lmac[ETH_LLEARN];           /* learned addresses */
+  struct sockaddr_un lpeer[ETH_LLEARN];         /*   and their sockets */
+  int               nlearn;
+  int               nextl;                      /* next to replace */
+#endif
+};
+
+static struct eth_lhub* eth_lhubs = NULL;       /* in-process hubs */
+static struct eth_lbuf* eth_lfree = NULL;       /* free frame buffers */
+
+static int eth_local_name (char* name)
+{
+  return ((eth_strncasecmp(name, "loop:", 5) == 0) ||
+          (eth_strncasecmp(name, "unix:", 5) == 0));
+}
+
+/* would the device's filter accept a frame? */
+static int eth_local_accept (ETH_DEV* dev, const uint8* msg)
+{
+  int i;
+
+  if (dev->promiscuous) return 1;
+  if (dev->all_multicast && (msg[0] & 0x01)) return 1;
+  for (i = 0; i < dev->addr_count; i++)
+    if (memcmp(msg, dev->filter_address[i], 6) == 0) return 1;
+  return 0;
+}
+
+static void eth_local_release (struct eth_lbuf* buf)
+{
+  if (--buf->refs <= 0) {
+    buf->next = eth_lfree;
+    eth_lfree = buf;
+  }
+}
+
+void eth_release (ETH_PACK* packet)
+{
+  if (packet->ref) {
+    eth_local_release((struct eth_lbuf*)
+                      (packet->ref - offsetof(struct eth_lbuf, msg)));
+    packet->ref = NULL;
+  }
+}
+
+void eth_unref (ETH_PACK* packet)
+{
+  uint8* ref = packet->ref;
+
+  if (ref) {
+    memcpy(packet->msg, ref, (packet->crc_len > packet->len)?
+           packet->crc_len: packet->len);
+    eth_release(packet);
+  }
+}
+
+#if defined (USE_LOCAL_SOCKET)
+
+/* read the directory for the other sockets on the segment */
+static void eth_local_scan (struct eth_lport* port)
+{
+  DIR* dir;
+  struct dirent* ent;
+  struct sockaddr_un* sa;
+
+  port->npeer = 0;
+  port->scan = sim_os_msec();
+  if ((dir = opendir(port->dir)) == NULL) return;
+  while (((ent = readdir(dir)) != NULL) && (port->npeer < ETH_LPEERS)) {
+    if (ent->d_name[0] == '.') continue;
+    sa = &port->peer[port->npeer];
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+    if ((strlen(port->dir) + strlen(ent->d_name) + 2) > sizeof(sa->sun_path))
+      continue;
+    sprintf(sa->sun_path, "%s/%s", port->dir, ent->d_name);
+    if (strcmp(sa->sun_path, port->self.sun_path) != 0)
+      port->npeer++;
+  }
+  closedir(dir);
+}
+
+/* send to one socket; a socket nobody has bound is stale and removed.
+   Returns 0 if sent or the peer is busy, 1 if the peer is gone, -1 on error */
+static int eth_local_sendto (struct eth_lport* port, struct sockaddr_un* sa,
+                             ETH_PACK* packet)
+{
+  if (sendto(port->sock, packet->msg, packet->len, 0,
+             (struct sockaddr*) sa, sizeof(*sa)) == packet->len)
+    return 0;
+  if ((errno == ECONNREFUSED) || (errno == ENOENT)) {
+    if (errno == ECONNREFUSED)
+      unlink(sa->sun_path);
+    port->scan = port->scan - ETH_LRESCAN;      /* reread directory */
+    return 1;
+  }
+  return (errno == EAGAIN) || (errno == ENOBUFS)? 0: -1;  /* busy: lost */
+}
+
+static int eth_local_learned (struct eth_lport* port, const uint8* mac)
+{
+  int i;
+
+  for (i = 0; i < port->nlearn; i++)
+    if (memcmp(port->lmac[i], mac, 6) == 0) return i;
+  return -1;
+}
+
+static void eth_local_forget (struct eth_lport* port, int i)
+{
+  if (--port->nlearn != i) {                    /* last into the hole */
+    memcpy(port->lmac[i], port->lmac[port->nlearn], 6);
+    port->lpeer[i] = port->lpeer[port->nlearn];
+  }
+  if (port->nextl >= port->nlearn)
+    port->nextl = 0;
+}
+
+static void eth_local_learn (struct eth_lport* port, const uint8* mac,
+                             struct sockaddr_un* sa)
+{
+  int i;
+
+  if (mac[0] & 0x01) return;                    /* multicast source? */
+  if ((i = eth_local_learned(port, mac)) < 0) {
+    if (port->nlearn < ETH_LLEARN)
+      i = port->nlearn++;
+    else {
+      i = port->nextl;
+      port->nextl = (port->nextl + 1) % ETH_LLEARN;
+    }
+    memcpy(port->lmac[i], mac, 6);
+  }
+  port->lpeer[i] = *sa;
+}
+
+static t_stat eth_local_sopen (struct eth_lport* port, char* dir, DEVICE* dptr)
+{
+  static int seq = 0;
+  struct sockaddr_un* sa = &port->self;
+  int size = 256 * 1024;
+
+  if (strlen(dir) >= sizeof(port->dir)) return SCPE_ARG;
+  strcpy(port->dir, dir);
+  mkdir(dir, 0777);                             /* first on the segment? */
+  memset(sa, 0, sizeof(*sa));
+  sa->sun_family = AF_UNIX;
+  if ((strlen(dir) + 40) > sizeof(sa->sun_path)) return SCPE_ARG;
+  sprintf(sa->sun_path, "%s/%d.%s.%d", dir, (int) getpid(),
+          dptr? sim_dname(dptr): "eth", seq++);
+  unlink(sa->sun_path);
+  port->sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (port->sock < 0) return SCPE_OPENERR;
+  setsockopt(port->sock, SOL_SOCKET, SO_SNDBUF, (char*) &size, sizeof(size));
+  setsockopt(port->sock, SOL_SOCKET, SO_RCVBUF, (char*) &size, sizeof(size));
+  if ((bind(port->sock, (struct sockaddr*) sa, sizeof(*sa)) < 0) ||
+      (fcntl(port->sock, F_SETFL, fcntl(port->sock, F_GETFL) | O_NONBLOCK) < 0)) {
+    close(port->sock);
+    return SCPE_OPENERR;
+  }
+  eth_local_scan(port);
+  return SCPE_OK;
+}
+
+static t_stat eth_local_swrite (struct eth_lport* port, ETH_PACK* packet)
+{
+  int i, status = 0;
+
+  if ((sim_os_msec() - port->scan) >= ETH_LRESCAN)
+    eth_local_scan(port);
+  if ((i = eth_local_learned(port, packet->msg)) >= 0) { /* known unicast? */
+    if ((status = eth_local_sendto(port, &port->lpeer[i], packet)) <= 0)
+      return status;
+    eth_local_forget(port, i);                          /* gone: flood */
+    if ((sim_os_msec() - port->scan) >= ETH_LRESCAN)
+      eth_local_scan(port);
+    status = 0;
+  }
+  for (i = 0; i < port->npeer; i++)                     /* flood */
+    if (eth_local_sendto(port, &port->peer[i], packet) < 0)
+      status = -1;
+  return status;
+}
+
+static int eth_local_sread (struct eth_lport* port, ETH_PACK* packet)
+{
+  struct sockaddr_un sa;
+  socklen_t salen;
+  int len;
+
+  for (;;) {
+    salen = sizeof(sa);
+    len = recvfrom(port->sock, packet->msg, ETH_MAX_PACKET, 0,
+                   (struct sockaddr*) &sa, &salen);
+    if (len < 0) return 0;                      /* nothing waiting */
+    if (len < 14) continue;                     /* runt */
+    if (salen > offsetof(struct sockaddr_un, sun_path))
+      eth_local_learn(port, &packet->msg[6], &sa);
+    if (eth_local_accept(port->dev, packet->msg)) return len;
+  }
+}
+
+#endif /* USE_LOCAL_SOCKET */
+
+static t_stat eth_local_open (ETH_DEV* dev, char* name, DEVICE* dptr, uint32 dbit)
+{
+  struct eth_lport* port;
+  struct eth_lhub* hub;
+  char* msg;
+
+  eth_zero(dev);
+  dev->reflections = 0;                         /* no echo of own frames */
+  port = (struct eth_lport*) calloc(1, sizeof(struct eth_lport));
+  if (!port) return SCPE_MEM;
+  port->dev = dev;
+  if (eth_strncasecmp(name, "loop:", 5) == 0) {
+    if ((name[5] == 0) || (strlen(&name[5]) >= ETH_DEV_NAME_MAX)) {
+      free(port);
+      return SCPE_ARG;
+    }
+    for (hub = eth_lhubs; hub && strcmp(hub->name, &name[5]); hub = hub->next) ;
+    if (!hub) {                                 /* first port on hub? */
+      hub = (struct eth_lhub*) calloc(1, sizeof(struct eth_lhub));
+      if (!hub) {
+        free(port);
+        return SCPE_MEM;
+      }
+      strcpy(hub->name, &name[5]);
+      hub->next = eth_lhubs;
+      eth_lhubs = hub;
+    }
+    port->hub = hub;
+    port->next = hub->ports;
+    hub->ports = port;
+  } else {
+#if defined (USE_LOCAL_SOCKET)
+    t_stat status = (name[5] == 0)? SCPE_ARG: eth_local_sopen(port, &name[5], dptr);
+    if (status != SCPE_OK) {
+      free(port);
+      return status;
+    }
+#else
+    free(port);
+    return SCPE_NOFNC;
+#endif
+  }
+  dev->local = port;
+  dev->name = malloc(strlen(name)+1);
+  strcpy(dev->name, name);
+  dev->dptr = dptr;
+  dev->dbit = dbit;
+  msg = "Eth: opened %s\r\n";
+  printf (msg, name);
+  if (sim_log) fprintf (sim_log, msg, name);
+  return SCPE_OK;
+}
+
+static t_stat eth_local_close (ETH_DEV* dev)
+{
+  struct eth_lport* port = (struct eth_lport*) dev->local;
+  struct eth_lport** pp;
+  char* msg = "Eth: closed %s\r\n";
+
+  if (port->hub) {
+    for (pp = &port->hub->ports; *pp != port; pp = &(*pp)->next) ;
+    *pp = port->next;                           /* off the hub */
+    for ( ; port->count; port->count--) {       /* drop queued frames */
+      eth_local_release(port->ring[port->head]);
+      port->head = (port->head + 1) % ETH_LRING;
+    }
+  }
+#if defined (USE_LOCAL_SOCKET)
+  else {
+    close(port->sock);
+    unlink(port->self.sun_path);
+  }
+#endif
+  free(port);
+  printf (msg, dev->name);
+  if (sim_log) fprintf (sim_log, msg, dev->name);
+  free(dev->name);
+  eth_zero(dev);
+  return SCPE_OK;
+}
+
+static t_stat eth_local_write (ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
+{
+  struct eth_lport* port = (struct eth_lport*) dev->local;
+  struct eth_lport* rp;
+  struct eth_lbuf* buf;
+  int status = 1;
+
+  if ((packet->len >= ETH_MIN_PACKET) && (packet->len <= ETH_MAX_PACKET)) {
+    eth_packet_trace (dev, packet->msg, packet->len, "writing");
+    status = 0;
+    if (port->hub) {
+      if ((buf = eth_lfree) != NULL)
+        eth_lfree = buf->next;
+      else
+        buf = (struct eth_lbuf*) malloc(sizeof(struct eth_lbuf));
+      if (buf) {
+        buf->refs = 1;                          /* held while queueing */
+        buf->len = packet->len;
+        buf->crc = 0;
+        memcpy(buf->msg, packet->msg, packet->len);
+        for (rp = port->hub->ports; rp; rp = rp->next) {
+          if ((rp == port) || !eth_local_accept(rp->dev, buf->msg)) continue;
+          if (rp->count >= ETH_LRING) {         /* receiver not keeping up */
+            rp->loss++;
+            continue;
+          }
+          rp->ring[(rp->head + rp->count++) % ETH_LRING] = buf;
+          buf->refs++;
+        }
+        eth_local_release(buf);
+      } else status = 1;
+    }
+#if defined (USE_LOCAL_SOCKET)
+    else status = eth_local_swrite(port, packet);
+#endif
+  }
+
+  /* call optional write callback function */
+  if (routine)
+    (routine)(status);
+
+  return ((status == 0) ? SCPE_OK : SCPE_IOERR);
+}
+
+static t_stat eth_local_read (ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
+{
+  struct eth_lport* port = (struct eth_lport*) dev->local;
+  struct eth_lbuf* buf;
+
+  packet->ref = NULL;                           /* the caller releases */
+  packet->len = 0;
+  if (port->hub) {
+    if (port->count == 0) return SCPE_OK;
+    buf = port->ring[port->head];               /* port's reference, */
+    port->head = (port->head + 1) % ETH_LRING;
+    port->count--;
+    packet->ref = buf->msg;                     /*   now the packet's */
+    packet->len = buf->len;
+    packet->crc_len = 0;
+    if (dev->need_crc) {
+      if (!buf->crc) {                          /* first to need it? */
+        uint32 ncrc = htonl(eth_crc32(0, buf->msg, buf->len));
+        memcpy(&buf->msg[buf->len], &ncrc, sizeof(ncrc));
+        buf->crc = 1;
+      }
+      packet->crc_len = buf->len + ETH_CRC_SIZE;
+    }
+  }
+#if defined (USE_LOCAL_SOCKET)
+  else if ((packet->len = eth_local_sread(port, packet)) == 0)
+    return SCPE_OK;
+  else if (dev->need_crc)
+    eth_add_crc32(packet);
+#endif
+  eth_packet_trace (dev, ETH_MSG(packet), packet->len, "reading");
+
+  /* call optional read callback function */
+  if (routine)
+    (routine)(0);
+  return SCPE_OK;
+}
+
+static t_stat eth_local_filter (ETH_DEV* dev, int addr_count, ETH_MAC* addresses,
+                                ETH_BOOL all_multicast, ETH_BOOL promiscuous)
+{
+  int i;
+
+  /* filter count OK? */
+  if ((addr_count < 0) || (addr_count > ETH_FILTER_MAX) || !addresses)
+    return SCPE_ARG;
+  for (i = 0; i < addr_count; i++)
+    memcpy(dev->filter_address[i], addresses[i], sizeof(ETH_MAC));
+  dev->addr_count = addr_count;
+  dev->all_multicast = all_multicast;
+  dev->promiscuous   = promiscuous;
+  sim_debug(dev->dbit, dev->dptr, "Filter Set, %d addresses%s%s\n", addr_count,
+            all_multicast? ", all multicast": "", promiscuous? ", promiscuous": "");
+  return SCPE_OK;
+}
+
 /*============================================================================*/
 /*                        Non-implemented versions                            */
 /*============================================================================*/
 
 #if !defined (USE_NETWORK)
 t_stat eth_open(ETH_DEV* dev, char* name, DEVICE* dptr, uint32 dbit)
-  {return SCPE_NOFNC;}
+  {return eth_local_name(name)? eth_local_open(dev, name, dptr, dbit): SCPE_NOFNC;}
 t_stat eth_close (ETH_DEV* dev)
-  {return SCPE_NOFNC;}
+  {return (dev && dev->local)? eth_local_close(dev): SCPE_NOFNC;}
 t_stat eth_write (ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
-  {return SCPE_NOFNC;}
+  {return (dev && dev->local && packet)? eth_local_write(dev, packet, routine): SCPE_NOFNC;}
 t_stat eth_read (ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
-  {return SCPE_NOFNC;}
+  {return (dev && dev->local && packet)? eth_local_read(dev, packet, routine): SCPE_NOFNC;}
 t_stat eth_filter (ETH_DEV* dev, int addr_count, ETH_MAC* addresses,
                    ETH_BOOL all_multicast, ETH_BOOL promiscuous)
-  {return SCPE_NOFNC;}
+  {return (dev && dev->local)?
+     eth_local_filter(dev, addr_count, addresses, all_multicast, promiscuous): SCPE_NOFNC;}
 int eth_devices (int max, ETH_LIST* dev)
   {return -1;}
 #else	 /* endif unimplemented */
@@ -707,6 +1188,10 @@ t_stat eth_open(ETH_DEV* dev, char* name, DEVICE* dptr, uint32 dbit)
   int   num;
   char* msg;
 
+  /* local transport? */
+  if (eth_local_name(name))
+    return eth_local_open(dev, name, dptr, dbit);
+
   /* initialize device */
   eth_zero(dev);
 
@@ -794,6 +1279,7 @@ t_stat eth_close(ETH_DEV* dev)
 
   /* make sure device exists */
   if (!dev) return SCPE_UNATT;
+  if (dev->local) return eth_local_close(dev);
 
   /* close the device */
   pcap = (pcap_t *)dev->handle;
@@ -867,6 +1353,7 @@ t_stat eth_write(ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
 
   /* make sure device exists */
   if (!dev) return SCPE_UNATT;
+  if (dev->local) return packet? eth_local_write(dev, packet, routine): SCPE_ARG;
 
   /* make sure packet exists */
   if (!packet) return SCPE_ARG;
@@ -938,6 +1425,7 @@ void eth_callback(u_char* info, const struct pcap_pkthdr* header, const u_char*
     ETH_PACK tmp_packet;
 
     /* set data in passed read packet */
+    tmp_packet.ref = NULL;
     tmp_packet.len = header->len;
     memcpy(tmp_packet.msg, data, header->len);
     if (dev->need_crc)
@@ -974,6 +1462,7 @@ t_stat eth_read(ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine)
 
   /* make sure packet exists */
   if (!packet) return SCPE_ARG;
+  if (dev->local) return eth_local_read(dev, packet, routine);
 
 #if !defined (USE_READER_THREAD)
   /* set read packet */
@@ -1023,6 +1512,8 @@ t_stat eth_filter(ETH_DEV* dev, int addr_count, ETH_MAC* addresses,
 
   /* make sure device exists */
   if (!dev) return SCPE_UNATT;
+  if (dev->local)
+    return eth_local_filter(dev, addr_count, addresses, all_multicast, promiscuous);
 
   /* filter count OK? */
   if ((addr_count < 0) || (addr_count > ETH_FILTER_MAX))
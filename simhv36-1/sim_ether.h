@@ -122,8 +122,13 @@ struct eth_packet {
   int     used;                                         /* bytes processed (used in packet chaining) */
   int     status;                                       /* transmit/receive status */
   int     crc_len;                                      /* packet length with CRC */
+  uint8*  ref;                                          /* frame held by reference, or NULL */
 };
 
+/* the frame: a local hub passes a shared buffer through eth_read and the
+   queues in place of msg, until eth_release or eth_unref */
+#define ETH_MSG(pack)   ((pack)->ref? (pack)->ref: (pack)->msg)
+
 struct eth_item {
   int                 type;                             /* receive (0=setup, 1=loopback, 2=normal) */
   struct eth_packet   packet;
@@ -170,6 +175,7 @@ struct eth_device {
   uint32        dbit;                                   /* debugging bit */
   int           reflections;                            /* packet reflections on interface */
   int           need_crc;				/* device needs CRC (Cyclic Redundancy Check) */
+  void*         local;                                  /* local transport port, NULL if none */
 #if defined (USE_READER_THREAD)
   ETH_QUE       read_queue;
   pthread_mutex_t     lock;
@@ -207,6 +213,8 @@ void ethq_clear  (ETH_QUE* que);                        /* clear FIFO queue */
 void ethq_remove (ETH_QUE* que);                        /* remove item from FIFO queue */
 void ethq_insert (ETH_QUE* que, int32 type,             /* insert item into FIFO queue */
                   ETH_PACK* packet, int32 status);
+void eth_release (ETH_PACK* packet);                    /* drop a frame held by reference */
+void eth_unref   (ETH_PACK* packet);                    /* copy it into msg and drop it */
 
 
 #endif                                                  /* _SIM_ETHER_H */
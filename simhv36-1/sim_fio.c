@@ -40,14 +40,20 @@
    sim_write    -       endian independent write (formerly fxwrite)
    sim_fseek    -       extended (>32b) seek (formerly fseek_ext)
    sim_fsize    -       get file size
+   sim_fmap     -       map an attached file into memory
+   sim_funmap   -       write back and unmap a mapped file
+   sim_fmap_flush -     start write back of a mapped file
 
-   sim_fopen and sim_fseek are OS-dependent.  The other routines are not.
+   sim_fopen, sim_fseek and sim_fmap are OS-dependent.  The other routines
+   are not.
    sim_fsize is always a 32b routine (it is used only with small capacity random
    access devices like fixed head disks and DECtapes).
 */
 
 #include "sim_defs.h"
 
+extern int32 sim_quiet;
+
 static unsigned char sim_flip[FLIP_SIZE];
 int32 sim_end = 1;                                      /* 1 = little */
 
@@ -318,3 +324,100 @@ return fseek (st, (int32) xpos, origin);
 #endif
 
 uint32 sim_taddr_64 = _SIM_IO_FSEEK_EXT_;
+
+/* Memory mapped unit files
+
+   A disk device may map its image instead of reading and writing it
+   through stdio.  The whole capacity is mapped shared, so a transfer is
+   a copy between the mapping and simulated memory, and the host page
+   cache does the write back.  filebuf points at the mapping, hwmark
+   holds its length in bytes, and UNIT_MMAP is set; a mapped unit must
+   not also be accessed through its stream.
+
+   A writable image shorter than the capacity is extended (sparsely) to
+   full size.  Short read only images, and big endian hosts, where the
+   image byte order differs from the host's, are left on stdio.
+*/
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static t_stat sim_fmap_unit (UNIT *uptr, t_addr size)
+{
+struct stat st;
+void *mp;
+int fd, prot;
+
+if (sim_end == 0) return SCPE_NOFNC;                    /* big endian? */
+fflush (uptr->fileref);                                 /* push stdio data */
+fd = fileno (uptr->fileref);
+if (fstat (fd, &st) < 0) return SCPE_IOERR;
+if ((t_addr) st.st_size < size) {                       /* short image? */
+    if (uptr->flags & UNIT_RO) return SCPE_RO;
+    if (ftruncate (fd, (off_t) size) < 0) return SCPE_IOERR;
+    }
+prot = (uptr->flags & UNIT_RO)? PROT_READ: (PROT_READ | PROT_WRITE);
+mp = mmap (NULL, (size_t) size, prot, MAP_SHARED, fd, 0);
+if (mp == MAP_FAILED) return SCPE_IOERR;
+uptr->filebuf = mp;
+uptr->hwmark = (uint32) size;
+uptr->flags = uptr->flags | UNIT_MMAP;
+return SCPE_OK;
+}
+
+/* Map an attached unit; size is the capacity in bytes.  On failure the
+   unit stays attached and on stdio, so callers may ignore the status. */
+
+t_stat sim_fmap (UNIT *uptr, t_addr size)
+{
+t_stat r;
+
+if ((uptr->fileref == NULL) || (uptr->flags & (UNIT_BUF | UNIT_MMAP)) ||
+    (size == 0) || (size != (uint32) size)) return SCPE_ARG;
+r = sim_fmap_unit (uptr, size);
+if ((r != SCPE_OK) && !sim_quiet)
+    printf ("%s: not mapped, using file I/O\n", uptr->filename);
+return r;
+}
+
+void sim_funmap (UNIT *uptr)
+{
+if (!(uptr->flags & UNIT_MMAP)) return;
+if (!(uptr->flags & UNIT_RO) &&
+    (msync (uptr->filebuf, uptr->hwmark, MS_SYNC) < 0))
+    perror ("Mapped file write back error");
+munmap (uptr->filebuf, uptr->hwmark);
+uptr->filebuf = NULL;
+uptr->hwmark = 0;
+uptr->flags = uptr->flags & ~UNIT_MMAP;
+return;
+}
+
+void sim_fmap_flush (UNIT *uptr)
+{
+if ((uptr->flags & UNIT_MMAP) && !(uptr->flags & UNIT_RO))
+    msync (uptr->filebuf, uptr->hwmark, MS_ASYNC);
+return;
+}
+
+#else
+
+t_stat sim_fmap (UNIT *uptr, t_addr size)
+{
+return SCPE_NOFNC;
+}
+
+void sim_funmap (UNIT *uptr)
+{
+return;
+}
+
+void sim_fmap_flush (UNIT *uptr)
+{
+return;
+}
+
+#endif
@@ -0,0 +1,223 @@
+/* sim_inst.c: simulator instance library
+
+   This library includes:
+
+   sim_inst_start       -       start an instance running a host routine
+   sim_inst_wait        -       wait for an instance, collect its status
+   sim_inst_read        -       read data written by an instance
+   sim_inst_write       -       (in an instance) write data to the template
+
+   The simulator keeps all machine state - M, the register files, the
+   event queue, the interrupt requests and every device's UNIT array -
+   in process globals, and the static DEVICE and UNIT tables point at
+   them.  Rather than thread a context through every device, an
+   instance is a forked copy of the calling process.  The caller sets
+   up a template once (simh_init, SET commands, ATTACH, optionally
+   BOOT and run to a known point); each instance then starts from that
+   state in a few hundred microseconds, shares the template's memory
+   copy-on-write, and runs on its own core.
+
+   Attached files are the only state that is not private after a fork:
+   the stdio stream and its file offset are shared with the template.
+   Each instance reopens its attached files; read/write images get a
+   private, already unlinked, copy unless SIM_INST_SHARED is given.
+*/
+
+#include "sim_defs.h"
+#include "sim_inst.h"
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define INST_CBUF       65536                           /* image copy buf */
+
+extern DEVICE *sim_devices[];
+extern t_stat detach_all (int32 start_device, t_bool shutdown);
+
+int32 sim_inst_id = 0;                                  /* instance number */
+static int32 sim_inst_next = 0;                         /* last assigned */
+static int sim_inst_wfd = -1;                           /* result pipe, wr */
+
+static t_stat sim_inst_private (int32 flags);
+static FILE *sim_inst_copy (FILE *fp);
+
+/* Start an instance
+
+   Inputs:
+        flags   =       SIM_INST_xxx
+        body    =       routine run in the instance
+        arg     =       argument to body
+   Outputs:
+        ip      =       instance handle, NULL if error
+
+   The instance exits with the low eight bits of the status returned by
+   body, which sim_inst_wait hands back to the template.
+*/
+
+SIM_INST *sim_inst_start (int32 flags, t_stat (*body) (void *arg), void *arg)
+{
+SIM_INST *ip;
+int fds[2];
+t_stat r;
+
+if (body == NULL) return NULL;
+ip = (SIM_INST *) calloc (1, sizeof (SIM_INST));
+if (ip == NULL) return NULL;
+if (pipe (fds) < 0) {
+    free (ip);
+    return NULL;
+    }
+ip->id = ++sim_inst_next;
+fflush (NULL);                                          /* no dup'd output */
+ip->pid = fork ();
+if (ip->pid < 0) {                                      /* fork failed? */
+    close (fds[0]);
+    close (fds[1]);
+    free (ip);
+    return NULL;
+    }
+if (ip->pid == 0) {                                     /* instance */
+    close (fds[0]);
+    sim_inst_wfd = fds[1];
+    sim_inst_id = ip->id;
+    free (ip);
+    r = sim_inst_private (flags);                       /* own the files */
+    if (r == SCPE_OK) r = body (arg);
+    detach_all (0, TRUE);                               /* flush, close */
+    fflush (NULL);
+    close (sim_inst_wfd);
+    _exit (r & 0377);
+    }
+close (fds[1]);                                         /* template */
+ip->fd = fds[0];
+return ip;
+}
+
+/* Wait for an instance to exit; frees the handle */
+
+t_stat sim_inst_wait (SIM_INST *ip, int32 *status)
+{
+int ws;
+
+if (ip == NULL) return SCPE_ARG;
+while (waitpid (ip->pid, &ws, 0) < 0) {
+    if (errno != EINTR) {
+        ws = -1;
+        break;
+        }
+    }
+close (ip->fd);
+if ((ws != -1) && WIFEXITED (ws)) ip->status = WEXITSTATUS (ws);
+else ip->status = SCPE_IERR;                            /* killed, lost */
+if (status) *status = ip->status;
+free (ip);
+return SCPE_OK;
+}
+
+/* Read up to lnt bytes written by an instance; returns bytes read,
+   0 at end of file (instance closed its pipe), or -1 if error */
+
+int32 sim_inst_read (SIM_INST *ip, void *buf, int32 lnt)
+{
+int32 n, tot;
+
+if ((ip == NULL) || (buf == NULL)) return -1;
+for (tot = 0; tot < lnt; tot = tot + n) {
+    n = read (ip->fd, ((char *) buf) + tot, lnt - tot);
+    if (n == 0) break;                                  /* eof */
+    if (n < 0) {
+        if (errno == EINTR) n = 0;
+        else return -1;
+        }
+    }
+return tot;
+}
+
+/* Write lnt bytes to the template; returns bytes written or -1 */
+
+int32 sim_inst_write (void *buf, int32 lnt)
+{
+int32 n, tot;
+
+if ((sim_inst_wfd < 0) || (buf == NULL)) return -1;     /* not an instance */
+for (tot = 0; tot < lnt; tot = tot + n) {
+    n = write (sim_inst_wfd, ((char *) buf) + tot, lnt - tot);
+    if (n < 0) {
+        if (errno == EINTR) n = 0;
+        else return -1;
+        }
+    }
+return tot;
+}
+
+/* Give the instance its own file for every attached unit
+
+   The template's streams are abandoned, not closed: fclose would flush
+   or reposition the file offset the template still depends on.
+   Network attachments (no fileref) are left alone.  A mapped unit is
+   remapped onto the instance's own file.
+*/
+
+static t_stat sim_inst_private (int32 flags)
+{
+DEVICE *dptr;
+UNIT *uptr;
+FILE *fp;
+uint32 i, j, msize;
+
+for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    for (j = 0; j < dptr->numunits; j++) {
+        uptr = dptr->units + j;
+        if (!(uptr->flags & UNIT_ATT) || (uptr->fileref == NULL))
+            continue;
+        if (uptr->flags & UNIT_RO)                      /* read only? */
+            fp = sim_fopen (uptr->filename, "rb");
+        else if (flags & SIM_INST_SHARED)               /* share image? */
+            fp = sim_fopen (uptr->filename, "rb+");
+        else fp = sim_inst_copy (uptr->fileref);        /* private copy */
+        if (fp == NULL) return SCPE_OPENERR;
+        msize = (uptr->flags & UNIT_MMAP)? uptr->hwmark: 0;
+        sim_funmap (uptr);                              /* drop shared map */
+        uptr->fileref = fp;
+        if (msize && (sim_fmap (uptr, msize) != SCPE_OK))
+            return SCPE_IOERR;
+        }
+    }
+return SCPE_OK;
+}
+
+/* Copy an open image to an unlinked temporary file
+
+   pread does not move the shared file offset, so the template can keep
+   running while its instances copy.
+*/
+
+static FILE *sim_inst_copy (FILE *fp)
+{
+char *tdir, tname[PATH_MAX];
+char *cbuf;
+off_t off;
+ssize_t n;
+int fd;
+FILE *tp;
+
+if ((tdir = getenv ("TMPDIR")) == NULL) tdir = "/tmp";
+snprintf (tname, sizeof (tname), "%s/siminstXXXXXX", tdir);
+if ((fd = mkstemp (tname)) < 0) return NULL;
+unlink (tname);                                         /* gone on exit */
+if ((cbuf = (char *) malloc (INST_CBUF)) == NULL) {
+    close (fd);
+    return NULL;
+    }
+for (off = 0; (n = pread (fileno (fp), cbuf, INST_CBUF, off)) > 0; off = off + n) {
+    if (write (fd, cbuf, n) != n) {
+        n = -1;
+        break;
+        }
+    }
+free (cbuf);
+if ((n < 0) || ((tp = fdopen (fd, "rb+")) == NULL)) {
+    close (fd);
+    return NULL;
+    }
+return tp;
+}
@@ -0,0 +1,32 @@
+/* sim_inst.h: simulator instance library headers
+
+   An instance is an independent copy of a configured simulator, forked
+   from the calling (template) process.  See sim_inst.c.
+*/
+
+#ifndef _SIM_INST_H_
+#define _SIM_INST_H_    0
+
+#include <sys/types.h>
+
+/* sim_inst_start flags */
+
+#define SIM_INST_SHARED 001                             /* share r/w images */
+
+typedef struct sim_inst SIM_INST;
+
+struct sim_inst {
+    pid_t               pid;                            /* child process */
+    int32               id;                             /* instance number */
+    int                 fd;                             /* result pipe, rd */
+    int32               status;                         /* body return */
+    };
+
+extern int32 sim_inst_id;                               /* 0 = template */
+
+SIM_INST *sim_inst_start (int32 flags, t_stat (*body) (void *arg), void *arg);
+t_stat sim_inst_wait (SIM_INST *ip, int32 *status);
+int32 sim_inst_read (SIM_INST *ip, void *buf, int32 lnt);
+int32 sim_inst_write (void *buf, int32 lnt);
+
+#endif
@@ -0,0 +1,374 @@
+/* sim_stats.c: simulator statistics library
+
+   This library includes:
+
+   sim_stats_grp        -       open a group of values
+   sim_stats_end        -       close a group
+   sim_stats_val        -       report one value
+   sim_stats_nsec       -       host time, for event timing
+   sim_stats_event      -       count an event and its host time
+   sim_stats_poll       -       send a JSON report to socket clients
+   sim_set_stats        -       SET STATS SOCKET=path, NOSOCKET, INTERVAL=msec
+   sim_show_stats       -       SHOW STATS
+
+   The counters answer where a running guest spends its time: how many
+   events each device's units take and how much host time their service
+   routines use, plus whatever the VM counts (instructions, I/O page
+   accesses, interrupts, traps), which it reports through sim_vm_stats.
+
+   A report is a tree of groups and values.  SHOW STATS prints it as
+   text; a client connected to the stats socket gets it as one line of
+   JSON every interval, while the simulator runs.  The socket is served
+   from sim_process_event, on the simulator thread, so a report is a
+   consistent snapshot and needs no locking.  A client that does not
+   keep up with the reports is disconnected.  A forked instance closes
+   its copies of the sockets and does not report.
+
+   The counters only increase; clients take differences.
+*/
+
+#include "sim_defs.h"
+#include "sim_stats.h"
+
+#if defined (USE_STATS_SOCKET)
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#if !defined (MSG_NOSIGNAL)
+#define MSG_NOSIGNAL    0
+#endif
+#endif
+
+#define STATS_UNITS     256                             /* event table, 2^n */
+#define STATS_HASH(p)   ((((size_t) (p)) >> 4) & (STATS_UNITS - 1))
+#define STATS_MAXCLI    8                               /* socket clients */
+#define STATS_IVL       1000                            /* dflt interval, msec */
+#define STATS_MINIVL    10
+
+typedef struct {
+    UNIT                *uptr;                          /* unit, NULL = free */
+    t_uint64            cnt;                            /* events */
+    t_uint64            nsec;                           /* host time */
+    } STATS_EVT;
+
+extern DEVICE *sim_devices[];
+
+t_uint64 sim_stats_next = ~((t_uint64) 0);              /* next report, nsec */
+
+static STATS_EVT sim_stats_evt[STATS_UNITS + 1];        /* last = overflow */
+static t_uint64 sim_stats_ecnt = 0;                     /* events */
+static t_uint64 sim_stats_ensec = 0;                    /* their host time */
+static uint32 sim_stats_ivl = STATS_IVL;                /* interval, msec */
+
+static void sim_stats_put (SIM_STATS *sp, char *fmt, ...);
+static void sim_stats_item (SIM_STATS *sp, char *name);
+static void sim_stats_all (SIM_STATS *sp);
+
+#if defined (USE_STATS_SOCKET)
+static int sim_stats_lsn = -1;                          /* listen socket */
+static int sim_stats_cli[STATS_MAXCLI];                 /* clients */
+static int32 sim_stats_ncli = 0;
+static char sim_stats_path[sizeof (((struct sockaddr_un *) 0)->sun_path)];
+static t_bool sim_stats_fork = FALSE;                   /* handler set */
+
+static t_stat sim_stats_open (char *path);
+static void sim_stats_close (t_bool unl);
+static void sim_stats_child (void);
+#endif
+
+/* Report building: text is written as it comes, JSON is collected in
+   a buffer so it can go out as one line */
+
+static void sim_stats_put (SIM_STATS *sp, char *fmt, ...)
+{
+va_list arg;
+int32 n;
+char *nb;
+
+if (sp->st) {                                           /* text? */
+    va_start (arg, fmt);
+    vfprintf (sp->st, fmt, arg);
+    va_end (arg);
+    return;
+    }
+for ( ;; ) {
+    va_start (arg, fmt);
+    n = vsnprintf (sp->buf + sp->lnt, sp->size - sp->lnt, fmt, arg);
+    va_end (arg);
+    if ((n >= 0) && ((uint32) n < (sp->size - sp->lnt))) break;
+    nb = (char *) realloc (sp->buf, sp->size * 2);      /* grow */
+    if (nb == NULL) return;                             /* lose the item */
+    sp->buf = nb;
+    sp->size = sp->size * 2;
+    }
+sp->lnt = sp->lnt + n;
+return;
+}
+
+static void sim_stats_item (SIM_STATS *sp, char *name)
+{
+if (sp->st) sim_stats_put (sp, "%*s%s", sp->depth * 2, "", name);
+else sim_stats_put (sp, "%s\"%s\":", sp->first? "": ",", name);
+sp->first = FALSE;
+return;
+}
+
+void sim_stats_grp (SIM_STATS *sp, char *name)
+{
+sim_stats_item (sp, name);
+sim_stats_put (sp, sp->st? ":\n": "{");
+sp->depth = sp->depth + 1;
+sp->first = TRUE;
+return;
+}
+
+void sim_stats_end (SIM_STATS *sp)
+{
+if (sp->st == NULL) sim_stats_put (sp, "}");
+sp->depth = sp->depth - 1;
+sp->first = FALSE;
+return;
+}
+
+void sim_stats_val (SIM_STATS *sp, char *name, t_uint64 val)
+{
+int32 w;
+
+sim_stats_item (sp, name);
+w = 24 - (sp->depth * 2) - (int32) strlen (name);       /* values in a column */
+if (sp->st) sim_stats_put (sp, "%*s%.0f\n", (w > 0)? w: 1, "", (double) val);
+else sim_stats_put (sp, "%.0f", (double) val);
+return;
+}
+
+/* The report: simulator time and events, then the VM's counters.
+   Units of one device are reported together. */
+
+static void sim_stats_all (SIM_STATS *sp)
+{
+DEVICE *dptr;
+STATS_EVT *ep;
+t_uint64 cnt, nsec;
+int32 i, k;
+
+sim_stats_val (sp, "time", (t_uint64) sim_gtime ());
+sim_stats_grp (sp, "events");
+sim_stats_val (sp, "queue", (t_uint64) sim_qcount ());
+sim_stats_val (sp, "count", sim_stats_ecnt);
+sim_stats_val (sp, "host_usec", sim_stats_ensec / 1000);
+for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    for (k = 0, cnt = nsec = 0; k < STATS_UNITS; k++) {
+        ep = &sim_stats_evt[k];
+        if (ep->uptr && (ep->uptr >= dptr->units) &&
+            (ep->uptr < (dptr->units + dptr->numunits))) {
+            cnt = cnt + ep->cnt;
+            nsec = nsec + ep->nsec;
+            }
+        }
+    if (cnt == 0) continue;
+    sim_stats_grp (sp, sim_dname (dptr));
+    sim_stats_val (sp, "count", cnt);
+    sim_stats_val (sp, "host_usec", nsec / 1000);
+    sim_stats_end (sp);
+    }
+sim_stats_end (sp);
+if (sim_vm_stats) sim_vm_stats (sp);
+return;
+}
+
+/* Event accounting, from sim_process_event */
+
+void sim_stats_event (UNIT *uptr, t_uint64 nsec)
+{
+STATS_EVT *ep;
+uint32 h, i;
+
+sim_stats_ecnt = sim_stats_ecnt + 1;
+sim_stats_ensec = sim_stats_ensec + nsec;
+h = STATS_HASH (uptr);
+for (i = 0; i < STATS_UNITS; i++) {                     /* probe */
+    ep = &sim_stats_evt[(h + i) & (STATS_UNITS - 1)];
+    if (ep->uptr == uptr) break;
+    if (ep->uptr == NULL) {                             /* new unit */
+        ep->uptr = uptr;
+        break;
+        }
+    }
+if (i >= STATS_UNITS) ep = &sim_stats_evt[STATS_UNITS]; /* table full */
+ep->cnt = ep->cnt + 1;
+ep->nsec = ep->nsec + nsec;
+return;
+}
+
+/* SHOW STATS */
+
+t_stat sim_show_stats (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr)
+{
+SIM_STATS s;
+
+if (cptr && (*cptr != 0)) return SCPE_2MARG;
+memset (&s, 0, sizeof (s));
+s.st = st;
+s.first = TRUE;
+sim_stats_all (&s);
+#if defined (USE_STATS_SOCKET)
+if (sim_stats_lsn >= 0)
+    fprintf (st, "Socket %s, every %d msec, %d clients\n",
+        sim_stats_path, sim_stats_ivl, sim_stats_ncli);
+#endif
+return SCPE_OK;
+}
+
+/* SET STATS SOCKET=path, NOSOCKET, INTERVAL=msec */
+
+t_stat sim_set_stats (int32 flag, char *cptr)
+{
+char gbuf[CBUFSIZE];
+t_stat r;
+uint32 ivl;
+
+if ((cptr == NULL) || (*cptr == 0)) return SCPE_2FARG;
+cptr = get_glyph (cptr, gbuf, '=');
+if (strcmp (gbuf, "INTERVAL") == 0) {
+    if ((cptr == NULL) || (*cptr == 0)) return SCPE_MISVAL;
+    ivl = (uint32) get_uint (cptr, 10, 3600000, &r);
+    if ((r != SCPE_OK) || (ivl < STATS_MINIVL)) return SCPE_ARG;
+    sim_stats_ivl = ivl;
+    return SCPE_OK;
+    }
+#if defined (USE_STATS_SOCKET)
+if (strcmp (gbuf, "SOCKET") == 0) {
+    if ((cptr == NULL) || (*cptr == 0)) return SCPE_MISVAL;
+    get_glyph_nc (cptr, gbuf, 0);                       /* path, case kept */
+    sim_stats_close (TRUE);
+    return sim_stats_open (gbuf);
+    }
+if (strcmp (gbuf, "NOSOCKET") == 0) {
+    if (cptr && *cptr) return SCPE_2MARG;
+    sim_stats_close (TRUE);
+    return SCPE_OK;
+    }
+#endif
+return SCPE_ARG;
+}
+
+#if defined (USE_STATS_SOCKET)
+
+t_uint64 sim_stats_nsec (void)
+{
+struct timespec ts;
+
+clock_gettime (CLOCK_MONOTONIC, &ts);
+return (((t_uint64) ts.tv_sec) * 1000000000) + (t_uint64) ts.tv_nsec;
+}
+
+/* Send a report if one is due: take new clients, then send the report
+   to each, dropping any that cannot take it whole */
+
+void sim_stats_poll (t_uint64 now)
+{
+SIM_STATS s;
+int32 i, fd;
+ssize_t n;
+
+sim_stats_next = now + ((t_uint64) sim_stats_ivl) * 1000000;
+if (sim_stats_lsn < 0) {                                /* closed? */
+    sim_stats_next = ~((t_uint64) 0);
+    return;
+    }
+while ((fd = accept (sim_stats_lsn, NULL, NULL)) >= 0) {
+    if (sim_stats_ncli >= STATS_MAXCLI) close (fd);     /* too many */
+    else {
+        fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+        sim_stats_cli[sim_stats_ncli++] = fd;
+        }
+    }
+if (sim_stats_ncli == 0) return;
+memset (&s, 0, sizeof (s));
+s.size = 4096;
+if ((s.buf = (char *) malloc (s.size)) == NULL) return;
+s.first = TRUE;
+sim_stats_put (&s, "{");
+sim_stats_all (&s);
+sim_stats_put (&s, "}\n");
+for (i = 0; i < sim_stats_ncli; ) {
+    n = send (sim_stats_cli[i], s.buf, s.lnt, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n == (ssize_t) s.lnt) i++;
+    else {                                              /* gone or slow */
+        close (sim_stats_cli[i]);
+        sim_stats_cli[i] = sim_stats_cli[--sim_stats_ncli];
+        }
+    }
+free (s.buf);
+return;
+}
+
+static t_stat sim_stats_open (char *path)
+{
+struct sockaddr_un sa;
+struct stat sb;
+int fd;
+
+if (strlen (path) >= sizeof (sa.sun_path)) return SCPE_ARG;
+memset (&sa, 0, sizeof (sa));
+sa.sun_family = AF_UNIX;
+strcpy (sa.sun_path, path);
+if ((lstat (path, &sb) == 0) && S_ISSOCK (sb.st_mode))  /* stale socket? */
+    unlink (path);
+fd = socket (AF_UNIX, SOCK_STREAM, 0);
+if (fd < 0) return SCPE_OPENERR;
+if ((bind (fd, (struct sockaddr *) &sa, sizeof (sa)) < 0) ||
+    (listen (fd, STATS_MAXCLI) < 0) ||
+    (fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK) < 0)) {
+    close (fd);
+    return SCPE_OPENERR;
+    }
+if (!sim_stats_fork) {                                  /* first socket? */
+    pthread_atfork (NULL, NULL, &sim_stats_child);
+    sim_stats_fork = TRUE;
+    }
+strcpy (sim_stats_path, path);
+sim_stats_lsn = fd;
+sim_stats_next = 0;                                     /* poll at once */
+return SCPE_OK;
+}
+
+static void sim_stats_close (t_bool unl)
+{
+while (sim_stats_ncli > 0) close (sim_stats_cli[--sim_stats_ncli]);
+if (sim_stats_lsn >= 0) {
+    close (sim_stats_lsn);
+    if (unl) unlink (sim_stats_path);
+    }
+sim_stats_lsn = -1;
+sim_stats_next = ~((t_uint64) 0);
+return;
+}
+
+/* Fork handler: the socket path belongs to the parent */
+
+static void sim_stats_child (void)
+{
+sim_stats_close (FALSE);
+return;
+}
+
+#else
+
+t_uint64 sim_stats_nsec (void)
+{
+return ((t_uint64) sim_os_msec ()) * 1000000;
+}
+
+void sim_stats_poll (t_uint64 now)
+{
+sim_stats_next = ~((t_uint64) 0);
+return;
+}
+
+#endif
@@ -0,0 +1,35 @@
+/* sim_stats.h: simulator statistics library headers
+
+   Counters are reported as a tree of named groups and values, as text
+   by SHOW STATS or as JSON on a Unix socket; see sim_stats.c.
+*/
+
+#ifndef _SIM_STATS_H_
+#define _SIM_STATS_H_   0
+
+#if defined (__unix__) || defined (__APPLE__)
+#define USE_STATS_SOCKET 1
+#endif
+
+typedef struct {
+    FILE                *st;                            /* text output */
+    char                *buf;                           /* JSON output */
+    uint32              lnt;                            /* JSON length */
+    uint32              size;                           /* JSON buffer size */
+    int32               depth;                          /* group nesting */
+    t_bool              first;                          /* no item in group */
+    } SIM_STATS;
+
+extern t_uint64 sim_stats_next;
+extern void (*sim_vm_stats) (SIM_STATS *sp);
+
+void sim_stats_grp (SIM_STATS *sp, char *name);
+void sim_stats_end (SIM_STATS *sp);
+void sim_stats_val (SIM_STATS *sp, char *name, t_uint64 val);
+t_uint64 sim_stats_nsec (void);
+void sim_stats_event (UNIT *uptr, t_uint64 nsec);
+void sim_stats_poll (t_uint64 now);
+t_stat sim_set_stats (int32 flag, char *cptr);
+t_stat sim_show_stats (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, char *cptr);
+
+#endif
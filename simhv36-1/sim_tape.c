@@ -57,10 +57,43 @@
    sim_tape_show_fmt    show tape format
    sim_tape_set_capac   set tape capacity
    sim_tape_show_capac  show tape capacity
+
+   SIMH and E11 format images get an index of their objects (records
+   and tape marks): the position and length word of each, built by one
+   pass over the image the first time the tape is spaced or read in
+   reverse.  Spacing is then done in the index, without file I/O, and
+   reverse reads need only the seek to the data.  The index covers the
+   image from BOT up to the end of medium, or up to the last object
+   written in this attachment; past that the image is read as before.
+   The index of an image that was not written is kept when the unit is
+   detached, and is reused if the same, unchanged file is attached
+   again.
 */
 
 #include "sim_defs.h"
 #include "sim_tape.h"
+#include <sys/stat.h>
+
+#define IDX_INIT        1024                            /* initial objects */
+#define IDX_CACHE       8                               /* indexes kept */
+
+typedef struct sim_tape_idx IDX;
+
+struct sim_tape_idx {
+    IDX                 *next;                          /* cache link */
+    uint32              fmt;                            /* tape format */
+    t_addr              fsize;                          /* file identity */
+    time_t              mtime;
+    dev_t               dev;
+    ino_t               ino;
+    uint32              objc;                           /* # objects */
+    uint32              alloc;                          /* # allocated */
+    uint32              cur;                            /* last object used */
+    t_bool              eom;                            /* ends at eom? */
+    t_bool              wr;                             /* image written? */
+    t_addr              *pos;                           /* obj positions */
+    t_mtrlnt            *lnt;                           /* obj length words */
+    };
 
 struct sim_tape_fmt {
     char                *name;                          /* name */
@@ -83,6 +116,16 @@ t_stat sim_tape_ioerr (UNIT *uptr);
 t_stat sim_tape_wrdata (UNIT *uptr, uint32 dat);
 uint32 sim_tape_tpc_map (UNIT *uptr, t_addr *map);
 t_addr sim_tape_tpc_fnd (UNIT *uptr, t_addr *map);
+IDX *sim_tape_idx_get (UNIT *uptr);
+int32 sim_tape_idx_fnd (IDX *ip, t_addr p);
+t_stat sim_tape_idx_lntf (UNIT *uptr, t_mtrlnt *bc);
+t_stat sim_tape_idx_lntr (UNIT *uptr, t_mtrlnt *bc);
+void sim_tape_idx_wr (UNIT *uptr, t_addr p, t_mtrlnt bc);
+t_bool sim_tape_idx_add (IDX *ip, t_addr p, t_mtrlnt bc);
+void sim_tape_idx_free (IDX *ip);
+IDX *sim_tape_idx_cache (UNIT *uptr, IDX *ip);
+
+static IDX *sim_tape_idx_list = NULL;                   /* cached indexes */
 
 /* Attach tape unit */
 
@@ -117,6 +160,10 @@ switch (MT_GET_FMT (uptr)) {                            /* case on format */
         sim_tape_tpc_map (uptr, (t_addr *) uptr->filebuf);      /* fill map */
         break;
 
+    case MTUF_F_STD: case MTUF_F_E11:                   /* SIMH, E11 */
+        uptr->filebuf = sim_tape_idx_cache (uptr, NULL); /* prior index? */
+        break;
+
     default:
         break;
         }
@@ -131,8 +178,15 @@ t_stat sim_tape_detach (UNIT *uptr)
 {
 uint32 f = MT_GET_FMT (uptr);
 t_stat r;
+IDX *ip = NULL;
 
+if ((uptr->flags & UNIT_ATT) &&                         /* SIMH, E11 index? */
+    ((f == MTUF_F_STD) || (f == MTUF_F_E11)) && uptr->filebuf) {
+    ip = sim_tape_idx_cache (uptr, (IDX *) uptr->filebuf); /* keep if clean */
+    uptr->filebuf = NULL;
+    }
 r = detach_unit (uptr);                                 /* detach unit */
+if (ip) sim_tape_idx_free (ip);                         /* not kept */
 if (r != SCPE_OK) return r;
 switch (f) {                                            /* case on format */
 
@@ -267,6 +321,7 @@ uint32 f = MT_GET_FMT (uptr);
 t_addr ppos;
 t_mtrlnt sbc;
 t_tpclnt tpcbc;
+t_stat st;
 
 MT_CLR_PNU (uptr);
 if ((uptr->flags & UNIT_ATT) == 0) return MTSE_UNATT;   /* not attached? */
@@ -274,6 +329,11 @@ if (sim_tape_bot (uptr)) return MTSE_BOT;               /* at BOT? */
 switch (f) {                                            /* switch on fmt */
 
     case MTUF_F_STD: case MTUF_F_E11:
+        if ((st = sim_tape_idx_lntr (uptr, bc)) != MTSE_FMT) { /* in index? */
+            if (st == MTSE_OK)                          /* for read */
+                sim_fseek (uptr->fileref, uptr->pos + sizeof (t_mtrlnt), SEEK_SET);
+            return st;
+            }
         sim_fseek (uptr->fileref, uptr->pos - sizeof (t_mtrlnt), SEEK_SET);
         sim_fread (bc, sizeof (t_mtrlnt), 1, uptr->fileref); /* read rec lnt */
         sbc = MTR_L (*bc);
@@ -448,6 +508,7 @@ switch (f) {                                            /* case on format */
             MT_SET_PNU (uptr);
             return sim_tape_ioerr (uptr);
             }
+        sim_tape_idx_wr (uptr, uptr->pos, bc);          /* upd index */
         uptr->pos = uptr->pos + sbc + (2 * sizeof (t_mtrlnt));  /* move tape */
         break;
 
@@ -479,6 +540,7 @@ if (ferror (uptr->fileref)) {                           /* error? */
     MT_SET_PNU (uptr);
     return sim_tape_ioerr (uptr);
     }
+sim_tape_idx_wr (uptr, uptr->pos, dat);                 /* upd index */
 uptr->pos = uptr->pos + sizeof (t_mtrlnt);              /* move tape */
 return MTSE_OK;
 }
@@ -508,7 +570,9 @@ t_stat sim_tape_sprecf (UNIT *uptr, t_mtrlnt *bc)
 {
 t_stat st;
 
-st = sim_tape_rdlntf (uptr, bc);                        /* get record length */
+st = sim_tape_idx_lntf (uptr, bc);                      /* try index */
+if (st == MTSE_FMT)                                     /* not indexed? */
+    st = sim_tape_rdlntf (uptr, bc);                    /* get record length */
 *bc = MTR_L (*bc);
 return st;
 }
@@ -524,7 +588,9 @@ if (MT_TST_PNU (uptr)) {
     *bc = 0;
     return MTSE_OK;
     }
-st = sim_tape_rdlntr (uptr, bc);                        /* get record length */
+st = sim_tape_idx_lntr (uptr, bc);                      /* try index */
+if (st == MTSE_FMT)                                     /* not indexed? */
+    st = sim_tape_rdlntr (uptr, bc);                    /* get record length */
 *bc = MTR_L (*bc);
 return st;
 }
@@ -673,3 +739,251 @@ if (uptr->capac) fprintf (st, "capacity=%dMB", (uint32) (uptr->capac / ((t_addr)
 else fprintf (st, "unlimited capacity");
 return SCPE_OK;
 }
+
+/* Object index routines
+
+   pos[0..objc-1] are the positions of the indexed objects, in order, and
+   pos[objc] is where the index ends: at the end of medium (an EOM mark
+   or end of file) if eom is set, otherwise at an object that has not
+   been indexed, such as a damaged record or one past the last write.
+*/
+
+/* Get the unit's index, building it on first use */
+
+IDX *sim_tape_idx_get (UNIT *uptr)
+{
+uint32 f = MT_GET_FMT (uptr);
+IDX *ip;
+t_addr tpos;
+t_mtrlnt bc, sbc;
+struct stat st;
+
+if ((uptr->flags & UNIT_ATT) == 0) return NULL;
+if ((f != MTUF_F_STD) && (f != MTUF_F_E11)) return NULL;
+if (uptr->filebuf) return (IDX *) uptr->filebuf;
+ip = (IDX *) calloc (1, sizeof (IDX));
+if (ip == NULL) return NULL;
+ip->pos = (t_addr *) malloc (IDX_INIT * sizeof (t_addr));
+ip->lnt = (t_mtrlnt *) malloc (IDX_INIT * sizeof (t_mtrlnt));
+if ((ip->pos == NULL) || (ip->lnt == NULL)) {
+    sim_tape_idx_free (ip);
+    return NULL;
+    }
+ip->alloc = IDX_INIT;
+ip->fmt = f;
+if (fstat (fileno (uptr->fileref), &st) == 0) {
+    ip->fsize = (t_addr) st.st_size;
+    ip->mtime = st.st_mtime;
+    ip->dev = st.st_dev;
+    ip->ino = st.st_ino;
+    }
+for (tpos = 0; ; ) {                                    /* scan image */
+    sim_fseek (uptr->fileref, tpos, SEEK_SET);
+    if (sim_fread (&bc, sizeof (t_mtrlnt), 1, uptr->fileref) == 0) {
+        ip->eom = !ferror (uptr->fileref);              /* end of file */
+        break;
+        }
+    if (bc == MTR_EOM) {                                /* end of medium */
+        ip->eom = TRUE;
+        break;
+        }
+    if (bc == MTR_TMK) sbc = 0;                         /* tape mark */
+    else {                                              /* record */
+        sbc = MTR_L (bc);
+        if (f == MTUF_F_STD) sbc = (sbc + 1) & ~1;
+        sbc = sbc + sizeof (t_mtrlnt);                  /* data, trailer */
+        if ((tpos + sizeof (t_mtrlnt) + sbc) > ip->fsize)
+            break;                                      /* truncated record */
+        }
+    if (!sim_tape_idx_add (ip, tpos, bc)) {             /* no memory? */
+        sim_tape_idx_free (ip);
+        clearerr (uptr->fileref);
+        return NULL;
+        }
+    tpos = tpos + sizeof (t_mtrlnt) + sbc;
+    }
+clearerr (uptr->fileref);
+ip->pos[ip->objc] = tpos;                               /* end of index */
+uptr->filebuf = ip;
+return ip;
+}
+
+/* Add an object at the end of the index; the caller sets the end
+   position after it.  Returns FALSE if out of memory. */
+
+t_bool sim_tape_idx_add (IDX *ip, t_addr p, t_mtrlnt bc)
+{
+t_addr *np;
+t_mtrlnt *nl;
+uint32 n;
+
+if ((ip->objc + 1) >= ip->alloc) {                      /* full? */
+    n = ip->alloc? ip->alloc * 2: IDX_INIT;
+    np = (t_addr *) realloc (ip->pos, n * sizeof (t_addr));
+    if (np == NULL) return FALSE;
+    ip->pos = np;
+    nl = (t_mtrlnt *) realloc (ip->lnt, n * sizeof (t_mtrlnt));
+    if (nl == NULL) return FALSE;
+    ip->lnt = nl;
+    ip->alloc = n;
+    }
+ip->pos[ip->objc] = p;
+ip->lnt[ip->objc] = bc;
+ip->objc = ip->objc + 1;
+return TRUE;
+}
+
+/* Find the object that starts at p; returns its number, objc if p is
+   the end of the index, or -1.  Sequential use is found next to the
+   last object used. */
+
+int32 sim_tape_idx_fnd (IDX *ip, t_addr p)
+{
+uint32 lo, hi, k;
+
+for (k = (ip->cur? ip->cur - 1: 0); (k <= ip->objc) && (k <= ip->cur + 1); k++) {
+    if (ip->pos[k] == p) return (ip->cur = k);
+    }
+lo = 0;
+hi = ip->objc;
+while (lo <= hi) {                                      /* binary search */
+    k = (lo + hi) >> 1;
+    if (ip->pos[k] == p) return (ip->cur = k);
+    if (ip->pos[k] < p) lo = k + 1;
+    else if (k == 0) break;
+    else hi = k - 1;
+    }
+return -1;
+}
+
+/* Space forward over one object using the index; same results as
+   sim_tape_rdlntf, except that the file is not positioned.  Returns
+   MTSE_FMT if the index does not cover the position. */
+
+t_stat sim_tape_idx_lntf (UNIT *uptr, t_mtrlnt *bc)
+{
+IDX *ip;
+int32 k;
+
+MT_CLR_PNU (uptr);
+if ((ip = sim_tape_idx_get (uptr)) == NULL) return MTSE_FMT;
+if ((k = sim_tape_idx_fnd (ip, uptr->pos)) < 0) return MTSE_FMT;
+if ((uint32) k == ip->objc) {                           /* end of index? */
+    if (!ip->eom) return MTSE_FMT;
+    MT_SET_PNU (uptr);                                  /* end of medium */
+    return MTSE_EOM;
+    }
+*bc = ip->lnt[k];
+uptr->pos = ip->pos[k + 1];                             /* next object */
+return ((*bc == MTR_TMK)? MTSE_TMK: MTSE_OK);
+}
+
+/* Space reverse over one object using the index; same results as
+   sim_tape_rdlntr, except that the file is not positioned.  Returns
+   MTSE_FMT if the index does not cover the position (or at BOT). */
+
+t_stat sim_tape_idx_lntr (UNIT *uptr, t_mtrlnt *bc)
+{
+IDX *ip;
+int32 k;
+
+MT_CLR_PNU (uptr);
+if ((ip = sim_tape_idx_get (uptr)) == NULL) return MTSE_FMT;
+if ((k = sim_tape_idx_fnd (ip, uptr->pos)) <= 0) return MTSE_FMT;
+*bc = ip->lnt[k - 1];
+uptr->pos = ip->pos[k - 1];                             /* prev object */
+return ((*bc == MTR_TMK)? MTSE_TMK: MTSE_OK);
+}
+
+/* Update the index for an object written at p: everything from p on is
+   dropped, and the new object becomes the last one indexed */
+
+void sim_tape_idx_wr (UNIT *uptr, t_addr p, t_mtrlnt bc)
+{
+IDX *ip = (IDX *) uptr->filebuf;
+uint32 f = MT_GET_FMT (uptr);
+int32 k;
+t_mtrlnt sbc;
+
+if ((ip == NULL) || ((f != MTUF_F_STD) && (f != MTUF_F_E11))) return;
+ip->wr = TRUE;                                          /* image changed */
+ip->eom = FALSE;
+if ((k = sim_tape_idx_fnd (ip, p)) < 0) {               /* inside an object? */
+    for (k = 0; (k < (int32) ip->objc) && (ip->pos[k + 1] <= p); k++) ;
+    ip->objc = k;                                       /* end before it */
+    ip->cur = 0;
+    return;
+    }
+ip->objc = k;                                           /* drop from p on */
+if (bc == MTR_EOM) {                                    /* end of medium */
+    ip->eom = TRUE;
+    return;
+    }
+sbc = (bc == MTR_TMK)? 0: MTR_L (bc);
+if (sbc && (f == MTUF_F_STD)) sbc = (sbc + 1) & ~1;
+if (!sim_tape_idx_add (ip, p, bc)) return;              /* no memory: stop */
+ip->pos[ip->objc] = p + sizeof (t_mtrlnt) +
+    (sbc? sbc + sizeof (t_mtrlnt): 0);
+return;
+}
+
+/* Free an index */
+
+void sim_tape_idx_free (IDX *ip)
+{
+if (ip == NULL) return;
+free (ip->pos);
+free (ip->lnt);
+free (ip);
+return;
+}
+
+/* Index cache
+
+   With ip NULL (attach), returns the cached index for the unit's file,
+   if the file is unchanged, and removes it from the cache.  Otherwise
+   (detach) caches ip if the image was not written and returns NULL, or
+   returns ip for the caller to free.
+*/
+
+IDX *sim_tape_idx_cache (UNIT *uptr, IDX *ip)
+{
+IDX *cp, **pp;
+struct stat st;
+uint32 n;
+
+if (fstat (fileno (uptr->fileref), &st) != 0) return ip;
+if (ip == NULL) {                                       /* attach */
+    for (pp = &sim_tape_idx_list; (cp = *pp) != NULL; pp = &cp->next) {
+        if ((cp->dev == st.st_dev) && (cp->ino == st.st_ino) &&
+            (cp->fsize == (t_addr) st.st_size) &&
+            (cp->mtime == st.st_mtime) &&
+            (cp->fmt == MT_GET_FMT (uptr))) {
+            *pp = cp->next;                             /* take it */
+            cp->next = NULL;
+            cp->cur = 0;
+            return cp;
+            }
+        }
+    return NULL;
+    }
+if (ip->wr || (ip->mtime != st.st_mtime) ||             /* changed? */
+    (ip->fsize != (t_addr) st.st_size)) return ip;
+for (pp = &sim_tape_idx_list; (cp = *pp) != NULL; ) {   /* drop older copy */
+    if ((cp->dev == ip->dev) && (cp->ino == ip->ino)) {
+        *pp = cp->next;
+        sim_tape_idx_free (cp);
+        }
+    else pp = &cp->next;
+    }
+ip->next = sim_tape_idx_list;                           /* newest first */
+sim_tape_idx_list = ip;
+for (n = 1, cp = ip; cp->next != NULL; n++, cp = cp->next) {
+    if (n >= IDX_CACHE) {                               /* drop the oldest */
+        sim_tape_idx_free (cp->next);
+        cp->next = NULL;
+        break;
+        }
+    }
+return NULL;
+}
@@ -66,8 +66,20 @@
    tmxr_dscln   -       disconnect line (SET routine)
    tmxr_rqln    -       number of available characters for line
    tmxr_tqln    -       number of buffered characters for line
+   tmxr_rx_pend -       test for pending input or connection
 
    All routines are OS-independent.
+
+   On Linux, an open multiplexor also has a reactor: a thread that waits
+   in epoll on the master and line sockets and flags the ones that are
+   readable.  tmxr_poll_conn and tmxr_poll_rx then only accept or read
+   where the reactor has flagged, and a device can skip polling entirely
+   while tmxr_rx_pend says nothing has arrived.  The reactor never reads
+   a socket itself; the receive buffers and the Telnet state belong to
+   the simulator thread.  Each socket is armed one-shot: once flagged,
+   the reactor ignores it until the simulator has read it and rearmed it.
+   Without a reactor (other hosts, or epoll not available), every line
+   is polled as before.
 */
 
 #include "sim_defs.h"
@@ -75,6 +87,38 @@
 #include "sim_tmxr.h"
 #include <ctype.h>
 
+#if defined (__linux__)
+#define USE_TMXR_REACTOR 1
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define TMXR_EVMAX      16                              /* events per wait */
+#define TMXR_EV_MASTER  0xFFFFFFFE                      /* event: master */
+#define TMXR_EV_STOP    0xFFFFFFFF                      /* event: wake pipe */
+
+typedef struct tmxr_rct TMXR_RCT;
+
+struct tmxr_rct {
+    TMXR_RCT            *next;                          /* all reactors */
+    int                 efd;                            /* epoll instance */
+    int                 wfd[2];                         /* wake pipe */
+    pthread_t           thr;                            /* reactor thread */
+    int32               live;                           /* thread running */
+    volatile int32      pend;                           /* something flagged */
+    volatile int32      mrdy;                           /* master readable */
+    volatile char       *rdy;                           /* line readable */
+    };
+
+static TMXR_RCT *tmxr_rct_list = NULL;
+
+static void tmxr_rct_open (TMXR *mp);
+static void tmxr_rct_close (TMXR *mp);
+static void tmxr_rct_arm (TMXR_RCT *rp, SOCKET sock, uint32 id, int op);
+static void *tmxr_rct_thread (void *arg);
+static void tmxr_rct_child (void);
+#endif
+
 /* Telnet protocol constants - negatives are for init'ing signed char data */
 
 #define TN_IAC          -1                              /* protocol delim */
@@ -130,6 +174,17 @@ static char mantra[] = {
     TN_IAC, TN_DO, TN_BIN
     };
 
+#if defined (USE_TMXR_REACTOR)
+TMXR_RCT *rp = (TMXR_RCT *) mp->rct;
+
+if (rp && rp->live) {                                   /* reactor? */
+    if (!rp->mrdy) return -1;                           /* nothing waiting */
+    rp->mrdy = 0;
+    newsock = sim_accept_conn (mp->master, &ipaddr);
+    tmxr_rct_arm (rp, mp->master, TMXR_EV_MASTER, EPOLL_CTL_MOD);
+    }
+else
+#endif
 newsock = sim_accept_conn (mp->master, &ipaddr);        /* poll connect */
 if (newsock != INVALID_SOCKET) {                        /* got a live one? */
     for (i = 0; i < mp->lines; i++) {                   /* find avail line */
@@ -151,6 +206,12 @@ if (newsock != INVALID_SOCKET) {                        /* got a live one? */
         lp->tsta = 0;                                   /* init telnet state */
         lp->xmte = 1;                                   /* enable transmit */
         lp->dstb = 0;                                   /* default bin mode */
+#if defined (USE_TMXR_REACTOR)
+        if (rp && rp->live) {                           /* watch the line */
+            rp->rdy[i] = 0;
+            tmxr_rct_arm (rp, newsock, (uint32) i, EPOLL_CTL_ADD);
+            }
+#endif
         sim_write_sock (newsock, mantra, 15);
         tmxr_linemsg (lp, "\n\r\nConnected to the ");
         tmxr_linemsg (lp, sim_name);
@@ -215,9 +276,30 @@ void tmxr_poll_rx (TMXR *mp)
 {
 int32 i, nbytes, j;
 TMLN *lp;
+#if defined (USE_TMXR_REACTOR)
+TMXR_RCT *rp = (TMXR_RCT *) mp->rct;
+
+if (rp && !rp->live) rp = NULL;                         /* reactor gone? */
+if (rp) {
+    if (!rp->pend) return;                              /* nothing flagged */
+    rp->pend = 0;                                       /* clear, then scan */
+    __sync_synchronize ();
+    if (rp->mrdy) rp->pend = 1;                         /* conn not taken */
+    }
+#endif
 
 for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     lp = mp->ldsc + i;                                  /* get line desc */
+#if defined (USE_TMXR_REACTOR)
+    if (rp) {
+        if (!rp->rdy[i] || !lp->conn) continue;         /* not readable */
+        if (!lp->rcve || (lp->rxbpi && !lp->tsta)) {    /* can't read now? */
+            rp->pend = 1;                               /* try next poll */
+            continue;
+            }
+        rp->rdy[i] = 0;                                 /* read, rearm */
+        }
+#endif
     if (!lp->conn || !lp->rcve) continue;               /* skip if !conn */
 
     nbytes = 0;
@@ -229,6 +311,10 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
         nbytes = sim_read_sock (lp->conn,               /* yes, read to end */
             &(lp->rxb[lp->rxbpi]),
             TMXR_MAXBUF - lp->rxbpi);
+#if defined (USE_TMXR_REACTOR)
+    if (rp && (nbytes >= 0))
+        tmxr_rct_arm (rp, lp->conn, (uint32) i, EPOLL_CTL_MOD);
+#endif
     if (nbytes < 0) tmxr_reset_ln (lp);                 /* closed? reset ln */
     else if (nbytes > 0) {                              /* if data rcvd */
         j = lp->rxbpi;                                  /* start of data */
@@ -296,6 +382,22 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
 return;
 }
 
+/* Test for pending input or connection
+
+   Returns TRUE if tmxr_poll_conn or tmxr_poll_rx may find something;
+   always TRUE without a reactor.
+*/
+
+int32 tmxr_rx_pend (TMXR *mp)
+{
+#if defined (USE_TMXR_REACTOR)
+TMXR_RCT *rp = (TMXR_RCT *) mp->rct;
+
+if (rp && rp->live) return (rp->pend != 0);
+#endif
+return TRUE;
+}
+
 /* Return count of available characters for line */
 
 int32 tmxr_rqln (TMLN *lp)
@@ -439,6 +541,9 @@ for (i = 0; i < mp->lines; i++) {                       /* initialize lines */
     lp->xmte = 1;
     lp->dstb = 0;
     }
+#if defined (USE_TMXR_REACTOR)
+tmxr_rct_open (mp);                                     /* start reactor */
+#endif
 return SCPE_OK;
 }
 
@@ -478,6 +583,9 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru conn */
         tmxr_reset_ln (lp);
         }                                               /* end if conn */
     }                                                   /* end for */
+#if defined (USE_TMXR_REACTOR)
+tmxr_rct_close (mp);                                    /* stop reactor */
+#endif
 sim_close_sock (mp->master, 1);                         /* close master socket */
 mp->master = 0;
 return SCPE_OK;
@@ -663,3 +771,130 @@ if (uptr) {                                             /* called from SET? */
 if ((val < 0) || (val >= mp->lines)) return NULL;       /* invalid line? */
 return mp->ldsc + val;                                  /* line descriptor */
 }
+
+#if defined (USE_TMXR_REACTOR)
+
+/* Reactor routines
+
+   Socket events carry the line number, TMXR_EV_MASTER or TMXR_EV_STOP.
+   The flags are only set by the thread while the socket is armed and
+   only cleared by the simulator while it is not, so they need no lock;
+   pend is set after the flag it summarizes and cleared before the scan.
+
+   Closing a line's socket drops it from the epoll set.  A forked copy of
+   the simulator (sim_inst) has no reactor thread and shares the epoll
+   instance with its parent, so it goes back to polling.
+*/
+
+static void tmxr_rct_open (TMXR *mp)
+{
+TMXR_RCT *rp;
+struct epoll_event ev;
+
+if (mp->rct) tmxr_rct_close (mp);
+if ((rp = (TMXR_RCT *) calloc (1, sizeof (TMXR_RCT))) == NULL) return;
+rp->rdy = (volatile char *) calloc (mp->lines, sizeof (char));
+rp->efd = epoll_create (mp->lines + 2);
+if ((rp->rdy == NULL) || (rp->efd < 0) || pipe (rp->wfd)) {
+    if (rp->efd >= 0) close (rp->efd);
+    free ((void *) rp->rdy);
+    free (rp);
+    return;                                             /* poll instead */
+    }
+memset (&ev, 0, sizeof (ev));
+ev.events = EPOLLIN;
+ev.data.u32 = TMXR_EV_STOP;
+epoll_ctl (rp->efd, EPOLL_CTL_ADD, rp->wfd[0], &ev);
+tmxr_rct_arm (rp, mp->master, TMXR_EV_MASTER, EPOLL_CTL_ADD);
+rp->live = 1;
+if (pthread_create (&rp->thr, NULL, &tmxr_rct_thread, (void *) rp)) {
+    close (rp->efd);
+    close (rp->wfd[0]);
+    close (rp->wfd[1]);
+    free ((void *) rp->rdy);
+    free (rp);
+    return;
+    }
+if (tmxr_rct_list == NULL)                              /* first reactor? */
+    pthread_atfork (NULL, NULL, &tmxr_rct_child);
+rp->next = tmxr_rct_list;
+tmxr_rct_list = rp;
+mp->rct = rp;
+return;
+}
+
+static void tmxr_rct_close (TMXR *mp)
+{
+TMXR_RCT *rp = (TMXR_RCT *) mp->rct;
+TMXR_RCT **pp;
+
+if (rp == NULL) return;
+if (rp->live) {                                         /* own thread? */
+    write (rp->wfd[1], "", 1);                          /* wake and stop */
+    pthread_join (rp->thr, NULL);
+    }
+for (pp = &tmxr_rct_list; *pp; pp = &(*pp)->next) {     /* unlink */
+    if (*pp == rp) {
+        *pp = rp->next;
+        break;
+        }
+    }
+close (rp->efd);
+close (rp->wfd[0]);
+close (rp->wfd[1]);
+free ((void *) rp->rdy);
+free (rp);
+mp->rct = NULL;
+return;
+}
+
+/* Arm (EPOLL_CTL_ADD) or rearm (EPOLL_CTL_MOD) a socket for one event.
+   ADD can find a stale entry for a reused descriptor number, if a
+   forked instance kept the old socket open; that entry is replaced. */
+
+static void tmxr_rct_arm (TMXR_RCT *rp, SOCKET sock, uint32 id, int op)
+{
+struct epoll_event ev;
+
+memset (&ev, 0, sizeof (ev));
+ev.events = EPOLLIN | EPOLLONESHOT;
+ev.data.u32 = id;
+if ((epoll_ctl (rp->efd, op, sock, &ev) < 0) && (op == EPOLL_CTL_ADD) &&
+    (errno == EEXIST))
+    epoll_ctl (rp->efd, EPOLL_CTL_MOD, sock, &ev);
+return;
+}
+
+static void *tmxr_rct_thread (void *arg)
+{
+TMXR_RCT *rp = (TMXR_RCT *) arg;
+struct epoll_event ev[TMXR_EVMAX];
+int i, n;
+
+for ( ;; ) {
+    n = epoll_wait (rp->efd, ev, TMXR_EVMAX, -1);
+    if (n < 0) {
+        if (errno == EINTR) continue;
+        break;
+        }
+    for (i = 0; i < n; i++) {
+        if (ev[i].data.u32 == TMXR_EV_STOP) return NULL;
+        if (ev[i].data.u32 == TMXR_EV_MASTER) rp->mrdy = 1;
+        else rp->rdy[ev[i].data.u32] = 1;
+        }
+    __sync_synchronize ();                              /* flags, then pend */
+    rp->pend = 1;
+    }
+return NULL;
+}
+
+static void tmxr_rct_child (void)
+{
+TMXR_RCT *rp;
+
+for (rp = tmxr_rct_list; rp != NULL; rp = rp->next)
+    rp->live = 0;                                       /* no thread here */
+return;
+}
+
+#endif
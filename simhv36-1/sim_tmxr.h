@@ -72,11 +72,13 @@ struct tmxr {
     int32               port;                           /* listening port */
     SOCKET              master;                         /* master socket */
     TMLN                *ldsc;                          /* line descriptors */
+    void                *rct;                           /* reactor, NULL = poll */
     };
 
 typedef struct tmxr TMXR;
 
 int32 tmxr_poll_conn (TMXR *mp);
+int32 tmxr_rx_pend (TMXR *mp);
 void tmxr_reset_ln (TMLN *lp);
 int32 tmxr_getc_ln (TMLN *lp);
 void tmxr_poll_rx (TMXR *mp);
@@ -0,0 +1,225 @@
+/* sim_trace.c: simulator binary trace stream library
+
+   This library includes:
+
+   sim_trace_open       -       start a trace stream on an open file
+   sim_trace_slot       -       get the next free record
+   sim_trace_put        -       pass the record to the writer
+   sim_trace_close      -       drain the stream and stop the writer
+
+   A trace stream carries one fixed size record per traced event (for
+   a CPU, per instruction) from the simulator thread to a file, without
+   locks or system calls on the simulator side.  The simulator fills a
+   record in place in a ring and publishes it by advancing the head
+   index; a writer thread encodes records with the caller's packing
+   routine, which does the compression, and writes them out in large
+   blocks.  There is one producer and one consumer, so the indexes need
+   only memory barriers.  If the writer falls behind, the simulator
+   waits for it rather than drop records.
+
+   The file is written through its descriptor; sim_trace_open flushes
+   whatever the caller wrote to the stream first (a file header, say),
+   and the caller closes the file after sim_trace_close.  A forked
+   instance inherits no writer, so its streams are dead: sim_trace_slot
+   returns NULL and the caller stops tracing.
+*/
+
+#include "sim_defs.h"
+#include "sim_trace.h"
+
+#if defined (USE_TRACE_THREAD)
+#include <unistd.h>
+#include <sched.h>
+
+#define TRC_OBUF        65536                           /* output block */
+#define TRC_IDLE        1000                            /* idle wait, usec */
+
+static SIM_TRACE *sim_trace_list = NULL;                /* all streams */
+
+static void *sim_trace_thread (void *arg);
+static t_bool sim_trace_flush (SIM_TRACE *tp, uint8 *buf, uint32 lnt);
+static void sim_trace_child (void);
+
+/* Open a stream: nrec must be a power of two, maxout the most bytes
+   the packing routine produces for one record */
+
+SIM_TRACE *sim_trace_open (FILE *fref, uint32 rsize, uint32 nrec,
+    SIM_TRPACK pack, void *ctx, uint32 maxout)
+{
+SIM_TRACE *tp;
+
+if ((rsize == 0) || (nrec == 0) || (nrec & (nrec - 1)) ||
+    (maxout == 0) || (maxout > TRC_OBUF)) return NULL;
+if (fflush (fref)) return NULL;                         /* header out */
+tp = (SIM_TRACE *) calloc (1, sizeof (SIM_TRACE));
+if (tp == NULL) return NULL;
+tp->ring = (uint8 *) malloc (rsize * nrec);
+if (tp->ring == NULL) {
+    free (tp);
+    return NULL;
+    }
+tp->rsize = rsize;
+tp->nrec = nrec;
+tp->pack = pack;
+tp->ctx = ctx;
+tp->maxout = maxout;
+tp->fd = fileno (fref);
+tp->live = 1;
+if (pthread_create (&tp->thr, NULL, &sim_trace_thread, (void *) tp)) {
+    free (tp->ring);
+    free (tp);
+    return NULL;
+    }
+if (sim_trace_list == NULL)                             /* first stream? */
+    pthread_atfork (NULL, NULL, &sim_trace_child);
+tp->next = sim_trace_list;
+sim_trace_list = tp;
+return tp;
+}
+
+/* Get the next record to fill; waits while the ring is full, returns
+   NULL if the writer has stopped (write error, forked instance) */
+
+void *sim_trace_slot (SIM_TRACE *tp)
+{
+while (tp->live && ((tp->head - tp->tail) >= tp->nrec))
+    sched_yield ();                                     /* full, wait */
+if (!tp->live) return NULL;
+return tp->ring + (tp->head & (tp->nrec - 1)) * tp->rsize;
+}
+
+/* Publish the record from sim_trace_slot */
+
+void sim_trace_put (SIM_TRACE *tp)
+{
+__sync_synchronize ();                                  /* record, then head */
+tp->head = tp->head + 1;
+return;
+}
+
+/* Drain and close; returns SCPE_IOERR if any write failed */
+
+t_stat sim_trace_close (SIM_TRACE *tp)
+{
+SIM_TRACE **pp;
+t_stat r;
+
+if (tp->fd >= 0) {                                      /* writer started? */
+    __sync_synchronize ();
+    tp->stop = 1;
+    pthread_join (tp->thr, NULL);
+    }
+for (pp = &sim_trace_list; *pp != NULL; pp = &(*pp)->next) {
+    if (*pp == tp) {                                    /* unlink */
+        *pp = tp->next;
+        break;
+        }
+    }
+r = tp->err? SCPE_IOERR: SCPE_OK;
+free (tp->ring);
+free (tp);
+return r;
+}
+
+/* Writer thread */
+
+static void *sim_trace_thread (void *arg)
+{
+SIM_TRACE *tp = (SIM_TRACE *) arg;
+uint8 *obuf;
+uint32 t, lnt;
+
+obuf = (uint8 *) malloc (TRC_OBUF);
+if (obuf == NULL) {
+    tp->err = ENOMEM;
+    tp->live = 0;
+    return NULL;
+    }
+for (lnt = 0; ; ) {
+    t = tp->tail;
+    if (t == tp->head) {                                /* empty? */
+        if (tp->stop) {                                 /* closing? */
+            __sync_synchronize ();
+            if (t == tp->head) break;                   /* really empty? */
+            continue;
+            }
+        if (lnt && !sim_trace_flush (tp, obuf, lnt)) break;
+        lnt = 0;
+        usleep (TRC_IDLE);
+        continue;
+        }
+    __sync_synchronize ();                              /* head, then record */
+    if ((lnt + tp->maxout) > TRC_OBUF) {                /* block full? */
+        if (!sim_trace_flush (tp, obuf, lnt)) break;
+        lnt = 0;
+        }
+    lnt = lnt + tp->pack (tp->ctx,
+        tp->ring + (t & (tp->nrec - 1)) * tp->rsize, obuf + lnt);
+    tp->recs = tp->recs + 1;
+    __sync_synchronize ();                              /* record, then tail */
+    tp->tail = t + 1;
+    }
+if ((tp->err == 0) && lnt) sim_trace_flush (tp, obuf, lnt);
+free (obuf);
+tp->live = 0;
+return NULL;
+}
+
+static t_bool sim_trace_flush (SIM_TRACE *tp, uint8 *buf, uint32 lnt)
+{
+ssize_t n;
+
+while (lnt) {
+    n = write (tp->fd, buf, lnt);
+    if (n < 0) {
+        if (errno == EINTR) continue;
+        tp->err = errno;
+        tp->live = 0;                                   /* writer stops */
+        return FALSE;
+        }
+    buf = buf + n;
+    lnt = lnt - (uint32) n;
+    tp->bytes = tp->bytes + (t_uint64) n;
+    }
+return TRUE;
+}
+
+/* Fork handler: the child has no writers */
+
+static void sim_trace_child (void)
+{
+SIM_TRACE *tp;
+
+for (tp = sim_trace_list; tp != NULL; tp = tp->next) {
+    tp->live = 0;
+    tp->fd = -1;                                        /* nothing to join */
+    }
+return;
+}
+
+#else
+
+/* No threads: no trace streams */
+
+SIM_TRACE *sim_trace_open (FILE *fref, uint32 rsize, uint32 nrec,
+    SIM_TRPACK pack, void *ctx, uint32 maxout)
+{
+return NULL;
+}
+
+void *sim_trace_slot (SIM_TRACE *tp)
+{
+return NULL;
+}
+
+void sim_trace_put (SIM_TRACE *tp)
+{
+return;
+}
+
+t_stat sim_trace_close (SIM_TRACE *tp)
+{
+return SCPE_OK;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/* sim_trace.h: simulator binary trace stream library headers
+
+   A SIM_TRACE is a ring of fixed size records, filled by the simulator
+   thread and drained to a file by a writer thread; see sim_trace.c.
+*/
+
+#ifndef _SIM_TRACE_H_
+#define _SIM_TRACE_H_   0
+
+#if defined (__unix__) || defined (__APPLE__)
+#define USE_TRACE_THREAD 1
+#endif
+
+#if defined (USE_TRACE_THREAD)
+#include <pthread.h>
+#endif
+
+typedef struct sim_trace SIM_TRACE;
+
+/* Packing routine: encode one record into at most maxout bytes,
+   return the number of bytes used.  Called on the writer thread only. */
+
+typedef uint32 (*SIM_TRPACK) (void *ctx, void *rec, uint8 *out);
+
+struct sim_trace {
+    SIM_TRACE           *next;                          /* all streams */
+    uint8               *ring;                          /* records */
+    uint32              rsize;                          /* record size */
+    uint32              nrec;                           /* ring size, 2^n */
+    volatile uint32     head;                           /* next to fill */
+    volatile uint32     tail;                           /* next to drain */
+    volatile int32      live;                           /* writer running */
+    volatile int32      stop;                           /* close requested */
+    SIM_TRPACK          pack;                           /* encoder */
+    void                *ctx;                           /* encoder state */
+    uint32              maxout;                         /* max packed size */
+    int                 fd;                             /* output file */
+    int32               err;                            /* errno, 0 = ok */
+    t_uint64            recs;                           /* records written */
+    t_uint64            bytes;                          /* bytes written */
+#if defined (USE_TRACE_THREAD)
+    pthread_t           thr;                            /* writer thread */
+#endif
+    };
+
+SIM_TRACE *sim_trace_open (FILE *fref, uint32 rsize, uint32 nrec,
+    SIM_TRPACK pack, void *ctx, uint32 maxout);
+void *sim_trace_slot (SIM_TRACE *tp);
+void sim_trace_put (SIM_TRACE *tp);
+t_stat sim_trace_close (SIM_TRACE *tp);
+
+#endif
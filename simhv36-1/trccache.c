@@ -0,0 +1,571 @@
+/* trccache.c: cache and TLB miss rates from a PDP-11 binary trace
+
+   Usage: trccache [-s skip] [-n count] [-j jobs] [-c config]...
+                   [-t tlb] file
+
+   Replays the memory references of a trace written by SET CPU TRACE=file
+   through a sweep of cache geometries and prints a miss rate table.  The
+   references are, per instruction, the fetch at the physical PC and then
+   its data references in order (operand words are data references, as
+   the CPU reads them through ReadW); the I/O page is not cached.  The
+   trace is read once, then the configurations are shared out among
+   jobs threads.
+
+   -c config    comma separated
+                    size=N[k], ways=N, line=N   a value or a range lo-hi,
+                                                powers of two
+                    wb, wt                      write-back and allocate on
+                                                a write miss, or write-
+                                                through and don't
+                    lru, fifo, random           replacement
+                    pf, nopf, pf=both           fill the next line too on
+                                                a miss
+                and may be repeated.  What is not given sweeps
+                size=1k-32k,ways=1-4,line=8-32,pf=both, wb, lru
+   -t tlb       entries=N (or a range) and page=N[k], default 8k: hit
+                rates of a fully associative lru table of pages.  The
+                trace holds only physical data addresses, so these are
+                physical pages, i.e. the reach a page or row cache in
+                front of memory would need.
+   -j jobs      threads; default, one per processor
+   -s skip      skip the first skip instructions
+   -n count     stop after count
+*/
+
+#include "pdp11_defs.h"
+#include "pdp11_trc.h"
+
+#if defined (__unix__) || defined (__APPLE__)
+#define USE_CACHE_THREADS 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define DEC_BUF         (1 << 20)                       /* read block */
+#define MAX_CFG         4096                            /* sweep limit */
+
+#define REF_PA          017777777                       /* 22b address */
+#define REF_I           0x80000000                      /* inst fetch */
+#define REF_W           0x40000000                      /* data write */
+#define REF_IOPAGE      017760000                       /* uncached */
+
+enum { CP_LRU, CP_FIFO, CP_RANDOM };
+
+typedef struct {
+    int32               size;                           /* bytes, 0 = tlb */
+    int32               ways;
+    int32               line;                           /* bytes */
+    int32               wb;                             /* write-back */
+    int32               policy;
+    int32               pf;                             /* next line too */
+    int32               entries;                        /* tlb */
+    int32               page;                           /* tlb, bytes */
+    t_uint64            fetch, fmiss;                   /* results */
+    t_uint64            read, rmiss;
+    t_uint64            write, wmiss;
+    t_uint64            fills, wbacks, wthrus;
+    t_uint64            pfills, pfused;
+    } CCFG;
+
+typedef struct {
+    uint32              tag;
+    uint32              valid;
+    uint32              dirty;
+    uint32              pf;                             /* prefetched, unused */
+    t_uint64            stamp;                          /* lru use, fifo fill */
+    } CLINE;
+
+static TRC_CODER dec_coder;
+static uint32 *refs = NULL;                             /* the trace */
+static t_uint64 nrefs = 0, nisns = 0, nio = 0;
+static CCFG cfg[MAX_CFG];
+static int32 ncfg = 0;
+static int32 next_cfg = 0;                              /* next to run */
+#if defined (USE_CACHE_THREADS)
+static pthread_mutex_t cfg_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static char *policy_names[] = { "lru", "fifo", "rand" };
+
+static int32 log2i (int32 n)
+{
+int32 l;
+
+for (l = 0; (1 << l) < n; l++) ;
+return l;
+}
+
+static int32 is_pow2 (int32 n)
+{
+return (n > 0) && ((n & (n - 1)) == 0);
+}
+
+/* N, Nk, or lo-hi of those; FALSE if bad */
+
+static t_bool cache_range (char *cptr, int32 *lo, int32 *hi)
+{
+char *tptr;
+
+*lo = *hi = strtol (cptr, &tptr, 0);
+if (tptr == cptr) return FALSE;
+if ((*tptr == 'k') || (*tptr == 'K')) {
+    *lo = *hi = *lo * 1024;
+    tptr++;
+    }
+if (*tptr == '-') {
+    cptr = tptr + 1;
+    *hi = strtol (cptr, &tptr, 0);
+    if (tptr == cptr) return FALSE;
+    if ((*tptr == 'k') || (*tptr == 'K')) {
+        *hi = *hi * 1024;
+        tptr++;
+        }
+    }
+return (*tptr == 0) && is_pow2 (*lo) && is_pow2 (*hi) && (*lo <= *hi);
+}
+
+static CCFG *new_cfg (void)
+{
+if (ncfg >= MAX_CFG) {
+    fprintf (stderr, "trccache: more than %d configurations\n", MAX_CFG);
+    exit (1);
+    }
+memset (&cfg[ncfg], 0, sizeof (CCFG));
+return &cfg[ncfg++];
+}
+
+/* Expand a -c option into its configurations */
+
+static t_bool add_cache (char *opts)
+{
+char buf[256], *o, *v;
+int32 slo = 1024, shi = 32768, wlo = 1, whi = 4, llo = 8, lhi = 32;
+int32 pflo = 0, pfhi = 1, wb = 1, policy = CP_LRU;
+int32 s, w, l, p, lo, hi;
+CCFG *cp;
+
+strncpy (buf, opts, sizeof (buf) - 1);
+buf[sizeof (buf) - 1] = 0;
+for (o = strtok (buf, ","); o; o = strtok (NULL, ",")) {
+    if ((v = strchr (o, '=')) != NULL) *v++ = 0;
+    if (v && ((strcmp (o, "size") == 0) || (strcmp (o, "ways") == 0) ||
+        (strcmp (o, "line") == 0))) {
+        if (!cache_range (v, &lo, &hi)) {
+            fprintf (stderr, "trccache: bad %s=%s\n", o, v);
+            return FALSE;
+            }
+        if (o[0] == 's') slo = lo, shi = hi;
+        else if (o[0] == 'w') wlo = lo, whi = hi;
+        else llo = lo, lhi = hi;
+        }
+    else if (strcmp (o, "wb") == 0) wb = 1;
+    else if (strcmp (o, "wt") == 0) wb = 0;
+    else if (strcmp (o, "lru") == 0) policy = CP_LRU;
+    else if (strcmp (o, "fifo") == 0) policy = CP_FIFO;
+    else if (strcmp (o, "random") == 0) policy = CP_RANDOM;
+    else if ((strcmp (o, "pf") == 0) && (v == NULL)) pflo = pfhi = 1;
+    else if (strcmp (o, "nopf") == 0) pflo = pfhi = 0;
+    else if ((strcmp (o, "pf") == 0) && (strcmp (v, "both") == 0)) {
+        pflo = 0;
+        pfhi = 1;
+        }
+    else {
+        fprintf (stderr, "trccache: unknown cache option %s\n", o);
+        return FALSE;
+        }
+    }
+if (llo < 2) {
+    fprintf (stderr, "trccache: lines are at least a word\n");
+    return FALSE;
+    }
+for (s = slo; s <= shi; s = s << 1) {
+    for (w = wlo; w <= whi; w = w << 1) {
+        for (l = llo; l <= lhi; l = l << 1) {
+            if (s < (w * l)) continue;                  /* no such cache */
+            for (p = pflo; p <= pfhi; p++) {
+                cp = new_cfg ();
+                cp->size = s;
+                cp->ways = w;
+                cp->line = l;
+                cp->wb = wb;
+                cp->policy = policy;
+                cp->pf = p;
+                }
+            }
+        }
+    }
+return TRUE;
+}
+
+/* Expand a -t option */
+
+static t_bool add_tlb (char *opts)
+{
+char buf[256], *o, *v;
+int32 elo = 8, ehi = 8, page = 8192, e, lo, hi;
+CCFG *cp;
+
+strncpy (buf, opts, sizeof (buf) - 1);
+buf[sizeof (buf) - 1] = 0;
+for (o = strtok (buf, ","); o; o = strtok (NULL, ",")) {
+    if ((v = strchr (o, '=')) != NULL) *v++ = 0;
+    if (v && (strcmp (o, "entries") == 0) && cache_range (v, &lo, &hi)) {
+        elo = lo;
+        ehi = hi;
+        }
+    else if (v && (strcmp (o, "page") == 0) && cache_range (v, &lo, &hi) &&
+        (lo == hi) && (lo >= 2)) page = lo;
+    else {
+        fprintf (stderr, "trccache: bad tlb option %s\n", o);
+        return FALSE;
+        }
+    }
+for (e = elo; e <= ehi; e = e << 1) {
+    cp = new_cfg ();
+    cp->entries = e;
+    cp->page = page;
+    }
+return TRUE;
+}
+
+/* Read the trace into refs[] */
+
+static t_bool load_trace (char *fname, double skip, double count)
+{
+FILE *fref;
+TRC_REC rec;
+uint8 *buf;
+char hdr[TRC_HDRLNT];
+double done = 0;
+t_uint64 max = 0;
+uint32 *nr;
+int32 lnt, k, n, i;
+
+if ((fref = fopen (fname, "rb")) == NULL) {
+    perror (fname);
+    return FALSE;
+    }
+if ((fread (hdr, 1, TRC_HDRLNT, fref) != TRC_HDRLNT) ||
+    memcmp (hdr, TRC_MAGIC, TRC_HDRLNT)) {
+    fprintf (stderr, "%s: not a PDP-11 trace\n", fname);
+    fclose (fref);
+    return FALSE;
+    }
+buf = (uint8 *) malloc (DEC_BUF);
+if (buf == NULL) {
+    fclose (fref);
+    return FALSE;
+    }
+trc_init (&dec_coder);
+for (lnt = 0, k = 0; (count < 0) || (done < (skip + count)); ) {
+    if ((lnt - k) < TRC_MAXPACK) {                      /* refill? */
+        memmove (buf, buf + k, lnt - k);
+        lnt = lnt - k;
+        k = 0;
+        lnt = lnt + fread (buf + lnt, 1, DEC_BUF - lnt, fref);
+        }
+    n = trc_unpack (&dec_coder, buf + k, lnt - k, &rec);
+    if (n == 0) {                                       /* end of file */
+        if (k != lnt) fprintf (stderr, "trccache: last record incomplete\n");
+        break;
+        }
+    if (n < 0) {
+        fprintf (stderr, "trccache: bad record after %.0f\n", done);
+        break;
+        }
+    k = k + n;
+    done = done + 1;
+    if (done <= skip) continue;
+    if ((nrefs + 1 + TRC_MAXPA) > max) {                /* grow */
+        max = max? max * 2: (1 << 20);
+        nr = (uint32 *) realloc (refs, (size_t) max * sizeof (uint32));
+        if (nr == NULL) {
+            fprintf (stderr, "trccache: out of memory after %.0f "
+                "instructions\n", done);
+            break;
+            }
+        refs = nr;
+        }
+    nisns++;
+    if ((rec.ipa & REF_PA) >= REF_IOPAGE) nio++;
+    else refs[nrefs++] = (rec.ipa & REF_PA) | REF_I;
+    for (i = 0; i < (int32) rec.npa; i++) {
+        if ((rec.pa[i] & REF_PA) >= REF_IOPAGE) nio++;
+        else refs[nrefs++] = (rec.pa[i] & REF_PA) |
+            (((rec.wr >> i) & 1)? REF_W: 0);
+        }
+    }
+fclose (fref);
+free (buf);
+return nisns != 0;
+}
+
+/* Run the trace through one cache */
+
+static void run_cache (CCFG *cp)
+{
+CLINE *lines, *set, *l, *victim;
+uint32 lsh, nsets, tag, r, pt;
+uint32 seed = 1;
+t_uint64 clock, i;
+int32 w, hit, write;
+
+lsh = log2i (cp->line);
+nsets = cp->size / (cp->line * cp->ways);
+lines = (CLINE *) calloc (nsets * cp->ways, sizeof (CLINE));
+if (lines == NULL) {
+    fprintf (stderr, "trccache: out of memory\n");
+    exit (1);
+    }
+for (i = 0, clock = 0; i < nrefs; i++) {
+    r = refs[i];
+    tag = (r & REF_PA) >> lsh;
+    write = (r & REF_W) != 0;
+    set = &lines[(tag & (nsets - 1)) * cp->ways];
+    clock++;
+    for (w = 0, hit = 0, victim = NULL; w < cp->ways; w++) {
+        l = &set[w];
+        if (l->valid && (l->tag == tag)) {
+            hit = 1;
+            break;
+            }
+        if ((victim == NULL) || !l->valid ||
+            (victim->valid && (l->stamp < victim->stamp)))
+            victim = l;
+        }
+    if (r & REF_I) {
+        cp->fetch++;
+        cp->fmiss += !hit;
+        }
+    else if (write) {
+        cp->write++;
+        cp->wmiss += !hit;
+        }
+    else {
+        cp->read++;
+        cp->rmiss += !hit;
+        }
+    if (hit) {
+        if (l->pf) {                                    /* prefetch paid */
+            cp->pfused++;
+            l->pf = 0;
+            }
+        if (cp->policy == CP_LRU) l->stamp = clock;
+        }
+    else if (write && !cp->wb) {                        /* wt, no allocate */
+        cp->wthrus++;
+        continue;
+        }
+    else {
+        if ((cp->policy == CP_RANDOM) && victim->valid) {
+            seed = seed * 1103515245 + 12345;
+            victim = &set[(seed >> 16) % cp->ways];
+            }
+        if (victim->valid && victim->dirty) cp->wbacks++;
+        l = victim;
+        l->tag = tag;
+        l->valid = 1;
+        l->dirty = 0;
+        l->pf = 0;
+        l->stamp = clock;
+        cp->fills++;
+        if (cp->pf) {                                   /* next line too */
+            pt = tag + 1;
+            set = &lines[(pt & (nsets - 1)) * cp->ways];
+            for (w = 0, hit = 0, victim = NULL; w < cp->ways; w++) {
+                if (set[w].valid && (set[w].tag == pt)) {
+                    hit = 1;
+                    break;
+                    }
+                if ((victim == NULL) || !set[w].valid ||
+                    (victim->valid && (set[w].stamp < victim->stamp)))
+                    victim = &set[w];
+                }
+            if (!hit && (cp->policy == CP_RANDOM) && victim->valid) {
+                seed = seed * 1103515245 + 12345;
+                w = (seed >> 16) % cp->ways;
+                if (&set[w] == l) w = (w + 1) % cp->ways;      /* keep demand */
+                victim = &set[w];
+                }
+            if (!hit && (victim != l)) {
+                if (victim->valid && victim->dirty) cp->wbacks++;
+                victim->tag = pt;
+                victim->valid = 1;
+                victim->dirty = 0;
+                victim->pf = 1;
+                victim->stamp = clock;
+                cp->pfills++;
+                }
+            }
+        }
+    if (write) {
+        if (cp->wb) l->dirty = 1;
+        else cp->wthrus++;
+        }
+    }
+free (lines);
+return;
+}
+
+/* Run the trace through one tlb: fully associative, lru */
+
+static void run_tlb (CCFG *cp)
+{
+uint32 *tag, lsh, pg;
+t_uint64 *stamp, i;
+int32 e, v;
+
+lsh = log2i (cp->page);
+tag = (uint32 *) calloc (cp->entries, sizeof (uint32));
+stamp = (t_uint64 *) calloc (cp->entries, sizeof (t_uint64));
+if ((tag == NULL) || (stamp == NULL)) {
+    fprintf (stderr, "trccache: out of memory\n");
+    exit (1);
+    }
+for (i = 0; i < nrefs; i++) {
+    pg = ((refs[i] & REF_PA) >> lsh) + 1;               /* 0 is empty */
+    for (e = 0, v = 0; e < cp->entries; e++) {
+        if (tag[e] == pg) break;
+        if (stamp[e] < stamp[v]) v = e;
+        }
+    if (refs[i] & REF_I) cp->fetch++;
+    else cp->read++;
+    if (e == cp->entries) {
+        if (refs[i] & REF_I) cp->fmiss++;
+        else cp->rmiss++;
+        e = v;
+        tag[e] = pg;
+        }
+    stamp[e] = i + 1;
+    }
+free (tag);
+free (stamp);
+return;
+}
+
+/* Worker: take configurations until there are none left */
+
+static void *run_jobs (void *arg)
+{
+int32 c;
+
+for (;;) {
+#if defined (USE_CACHE_THREADS)
+    pthread_mutex_lock (&cfg_lock);
+#endif
+    c = next_cfg++;
+#if defined (USE_CACHE_THREADS)
+    pthread_mutex_unlock (&cfg_lock);
+#endif
+    if (c >= ncfg) break;
+    if (cfg[c].size) run_cache (&cfg[c]);
+    else run_tlb (&cfg[c]);
+    }
+return NULL;
+}
+
+static double pct (t_uint64 n, t_uint64 d)
+{
+return d? (100.0 * n) / d: 0.0;
+}
+
+static void print_results (void)
+{
+CCFG *cp;
+t_uint64 fetch = 0, read = 0, write = 0;
+int32 c, hdr;
+
+for (c = 0; c < ncfg; c++) {                            /* any run will do */
+    if (cfg[c].size) {
+        fetch = cfg[c].fetch;
+        read = cfg[c].read;
+        write = cfg[c].write;
+        break;
+        }
+    }
+printf ("trace: %.0f instructions, %.0f references", (double) nisns,
+    (double) nrefs);
+if (fetch + read + write) printf (" (%.0f fetch, %.0f read, %.0f write)",
+    (double) fetch, (double) read, (double) write);
+printf (", %.0f to the i/o page\n\n", (double) nio);
+
+for (c = 0, hdr = 0; c < ncfg; c++) {
+    cp = &cfg[c];
+    if (cp->size == 0) continue;
+    if (!hdr++) printf ("   size ways line pf wb policy  fetch%%   read%%  "
+        "write%%   miss%%      fills     wbacks pfused%% bytes/inst\n");
+    printf ("%6dk %4d %4d %2s %2s %6s %6.2f%% %6.2f%% %6.2f%% %6.2f%% "
+        "%10.0f %10.0f", cp->size / 1024, cp->ways, cp->line,
+        cp->pf? "y": "-", cp->wb? "y": "-", policy_names[cp->policy],
+        pct (cp->fmiss, cp->fetch), pct (cp->rmiss, cp->read),
+        pct (cp->wmiss, cp->write),
+        pct (cp->fmiss + cp->rmiss + cp->wmiss,
+            cp->fetch + cp->read + cp->write),
+        (double) (cp->fills + cp->pfills), (double) cp->wbacks);
+    if (cp->pf) printf (" %6.2f%%", pct (cp->pfused, cp->pfills));
+    else printf ("       -");
+    printf (" %10.3f\n", (double) ((cp->fills + cp->pfills + cp->wbacks) *
+        cp->line + cp->wthrus * 2) / (double) nisns);
+    }
+
+for (c = 0, hdr = 0; c < ncfg; c++) {
+    cp = &cfg[c];
+    if (cp->size != 0) continue;
+    if (!hdr++) printf ("\ntlb entries  page  fetch%%   data%%   miss%%\n");
+    printf ("    %7d %4dk %6.2f%% %6.2f%% %6.2f%%\n", cp->entries,
+        cp->page / 1024, pct (cp->fmiss, cp->fetch),
+        pct (cp->rmiss, cp->read),
+        pct (cp->fmiss + cp->rmiss, cp->fetch + cp->read));
+    }
+return;
+}
+
+int main (int argc, char *argv[])
+{
+double skip = 0, count = -1;
+int32 i, jobs = 0, any = 0;
+#if defined (USE_CACHE_THREADS)
+pthread_t *thr;
+int32 j;
+#endif
+
+for (i = 1; (i < (argc - 1)) && (argv[i][0] == '-'); i = i + 2) {
+    if (strcmp (argv[i], "-s") == 0) skip = atof (argv[i + 1]);
+    else if (strcmp (argv[i], "-n") == 0) count = atof (argv[i + 1]);
+    else if (strcmp (argv[i], "-j") == 0) jobs = atoi (argv[i + 1]);
+    else if (strcmp (argv[i], "-c") == 0) {
+        if (!add_cache (argv[i + 1])) return 1;
+        any = 1;
+        }
+    else if (strcmp (argv[i], "-t") == 0) {
+        if (!add_tlb (argv[i + 1])) return 1;
+        }
+    else break;
+    }
+if (i != (argc - 1)) {
+    fprintf (stderr, "Usage: trccache [-s skip] [-n count] [-j jobs] "
+        "[-c config]... [-t tlb] file\n");
+    return 1;
+    }
+if (!any) add_cache ("pf=both");                        /* default sweep */
+if (!load_trace (argv[i], skip, count)) return 1;
+
+#if defined (USE_CACHE_THREADS)
+if (jobs <= 0) jobs = (int32) sysconf (_SC_NPROCESSORS_ONLN);
+if (jobs > ncfg) jobs = ncfg;
+if (jobs < 1) jobs = 1;
+thr = (pthread_t *) calloc (jobs, sizeof (pthread_t));
+for (j = 0; thr && (j < (jobs - 1)); j++) {             /* and this one */
+    if (pthread_create (&thr[j], NULL, &run_jobs, NULL)) break;
+    }
+run_jobs (NULL);
+while (thr && (--j >= 0)) pthread_join (thr[j], NULL);
+free (thr);
+#else
+run_jobs (NULL);
+#endif
+
+print_results ();
+free (refs);
+return 0;
+}
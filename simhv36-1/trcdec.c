@@ -0,0 +1,71 @@
+/* trcdec.c: print a PDP-11 binary instruction trace
+
+   Usage: trcdec [-s skip] [-n count] file
+
+   Prints the records of a trace written by SET CPU TRACE=file, one
+   line per instruction: physical PC, then the SHOW CPU HISTORY line,
+   then the physical addresses of the data references, writes marked
+   w.  -s skips the first skip instructions, -n stops after count.
+*/
+
+#include "pdp11_defs.h"
+#include "pdp11_trc.h"
+
+#define DEC_BUF         (1 << 20)                       /* read block */
+
+static TRC_CODER dec_coder;
+
+int main (int argc, char *argv[])
+{
+FILE *fref;
+TRC_REC rec;
+uint8 *buf;
+char hdr[TRC_HDRLNT];
+double skip = 0, count = -1, done = 0;
+int32 i, lnt, k, n;
+
+for (i = 1; (i < (argc - 1)) && (argv[i][0] == '-'); i = i + 2) {
+    if (strcmp (argv[i], "-s") == 0) skip = atof (argv[i + 1]);
+    else if (strcmp (argv[i], "-n") == 0) count = atof (argv[i + 1]);
+    else break;
+    }
+if (i != (argc - 1)) {
+    fprintf (stderr, "Usage: trcdec [-s skip] [-n count] file\n");
+    return 1;
+    }
+if ((fref = fopen (argv[i], "rb")) == NULL) {
+    perror (argv[i]);
+    return 1;
+    }
+if ((fread (hdr, 1, TRC_HDRLNT, fref) != TRC_HDRLNT) ||
+    memcmp (hdr, TRC_MAGIC, TRC_HDRLNT)) {
+    fprintf (stderr, "%s: not a PDP-11 trace\n", argv[i]);
+    return 1;
+    }
+buf = (uint8 *) malloc (DEC_BUF);
+if (buf == NULL) return 1;
+trc_init (&dec_coder);
+for (lnt = 0, k = 0; (count < 0) || (done < (skip + count)); ) {
+    if ((lnt - k) < TRC_MAXPACK) {                      /* refill? */
+        memmove (buf, buf + k, lnt - k);
+        lnt = lnt - k;
+        k = 0;
+        lnt = lnt + fread (buf + lnt, 1, DEC_BUF - lnt, fref);
+        }
+    n = trc_unpack (&dec_coder, buf + k, lnt - k, &rec);
+    if (n == 0) {                                       /* end of file */
+        if (k != lnt) fprintf (stderr, "trcdec: last record incomplete\n");
+        break;
+        }
+    if (n < 0) {
+        fprintf (stderr, "trcdec: bad record after %.0f\n", done);
+        return 1;
+        }
+    k = k + n;
+    if (done >= skip) trc_fprint (stdout, &rec);
+    done = done + 1;
+    }
+fclose (fref);
+free (buf);
+return 0;
+}